@@ -1,4 +1,5 @@
 #include "dbmanager.h"
+#include "tsdbstore.h"
 #include <QLibrary>
 #include <QLibraryInfo>
 #include <QDebug>
@@ -6,8 +7,16 @@
 #include <QSqlQuery>
 #include <QSettings>
 #include <QCoreApplication>
+#include <QDate>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+#include <climits>
 #include <cmath> // 引入 cmath 以使用 std::isnan 和 std::isinf
+#include <algorithm>
 // 获取单例
+static const int POOL_MAX_LIMIT = 64;
+
 DBManager& DBManager::instance()
 {
     static DBManager instance;
@@ -15,7 +24,15 @@ DBManager& DBManager::instance()
 }
 
 DBManager::DBManager(QObject *parent) : QObject(parent)
-{}
+{
+    QSettings settings(QCoreApplication::applicationDirPath() + "/config.ini", QSettings::IniFormat);
+    settings.beginGroup("Database");
+    m_maxConnections = qBound(1, settings.value("PoolMaxConnections", 8).toInt(), POOL_MAX_LIMIT);
+    m_poolWaitMs = qBound(0, settings.value("PoolWaitMs", 2000).toInt(), 60000);
+    m_idleTimeoutMs = qMax(1, settings.value("PoolIdleSec", 300).toInt()) * 1000ll;
+    m_healthCheckMs = qMax(1, settings.value("PoolHealthCheckSec", 30).toInt()) * 1000ll;
+    settings.endGroup();
+}
 
 DBManager::~DBManager()
 {
@@ -25,131 +42,847 @@ DBManager::~DBManager()
 
 bool DBManager::connectToDb()
 {
-    QLibrary lib("libmysql.dll");
-    if(lib.load()) {
-        qDebug() << "libmysql.dll 加载成功！";
-    } else {
-        qDebug() << "libmysql.dll 加载失败：" << lib.errorString();
+    if (usesEmbeddedBackend()) {
+        m_embedded = true;
+        // 其他船的存储在首次写入/查询时打开
+        TsdbStore *store = embeddedStore(0);
+        QString error;
+        if (!store->open(&error)) {
+            qDebug() << "嵌入式存储打开失败:" << error;
+            return false;
+        }
+        qDebug() << "使用嵌入式存储，0 号船已有记录" << store->count() << "条";
+        return true;
+    }
+
+    // 驱动信息只在第一次连接时打印
+    static std::atomic<bool> driverChecked{false};
+    if (!driverChecked.exchange(true)) {
+        QLibrary lib("libmysql.dll");
+        if(lib.load()) {
+            qDebug() << "libmysql.dll 加载成功！";
+        } else {
+            qDebug() << "libmysql.dll 加载失败：" << lib.errorString();
+        }
+        qDebug() << "可用数据库驱动:" << QSqlDatabase::drivers();
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        qDebug() << "插件路径:" << QLibraryInfo::path(QLibraryInfo::PluginsPath);
+#else
+        qDebug() << "插件路径:" << QLibraryInfo::location(QLibraryInfo::PluginsPath);
+#endif
+    }
+
+    // 当前线程的池连接；不受 m_available 限制，总是实际尝试一次
+    QThread *thread = QThread::currentThread();
+    QString name;
+    {
+        QMutexLocker locker(&m_poolMutex);
+        name = registerThreadLocked(thread).name;
+    }
+    QSqlDatabase db = QSqlDatabase::database(name, false);
+    if (!db.isOpen()) {
+        qDebug() << "正在连接数据库:" << db.hostName() << "用户:" << db.userName();
+        if (!openPooled(thread, db)) {
+            qDebug() << "MySQL 连接失败:" << db.lastError().text();
+            qDebug() << "提示: 请检查 1.MySQL服务是否启动 2.config.ini配置是否正确 3.libmysql.dll是否在exe目录下";
+            return false;
+        }
+        qDebug() << "MySQL 连接成功!";
+    }
+    touch(thread);
+
+    //4.建表 (进程内只做一次)；其他线程等建表完成后才返回，之后的写入不会落在升级到一半的表上
+    if (!m_schemaReady) {
+        QMutexLocker locker(&m_schemaMutex);
+        if (!m_schemaReady) {
+            ensureSchema(db);
+            m_schemaReady = true;
+        }
+    }
+    return true;
+}
+
+// ==========================================
+// 连接池
+// ==========================================
+DBManager::PooledConnection &DBManager::registerThreadLocked(QThread *thread)
+{
+    auto it = m_pool.find(thread);
+    if (it != m_pool.end()) {
+        return it.value();
+    }
+    PooledConnection conn;
+    conn.name = QString("db_pool_%1").arg(++m_poolSerial);
+    QSqlDatabase db = QSqlDatabase::addDatabase("QMYSQL", conn.name);
+    configureConnection(db);
+
+    // 空闲计时器属于该线程，只有线程有事件循环时才会触发
+    conn.idleTimer = new QTimer;
+    conn.idleTimer->setSingleShot(true);
+    conn.idleTimer->setInterval(int(qMin<qint64>(m_idleTimeoutMs, INT_MAX)));
+    connect(conn.idleTimer, &QTimer::timeout, conn.idleTimer, [=](){
+        QSqlDatabase idle = QSqlDatabase::database(conn.name, false);
+        if (idle.isOpen()) {
+            closePooled(thread, idle);
+            QMutexLocker locker(&m_poolMutex);
+            m_poolStats.idleClosed++;
+        }
+    });
+    // 线程结束时在该线程内关闭并注销自己的连接 (主线程没有这个信号，由 closeDb 处理)
+    connect(thread, &QThread::finished, this, [=](){ dropThreadConnection(thread); }, Qt::DirectConnection);
+    return m_pool.insert(thread, conn).value();
+}
+
+// 占一个名额再打开 (在连接所属线程调用)；池满时最多等 m_poolWaitMs
+bool DBManager::openPooled(QThread *thread, QSqlDatabase &db)
+{
+    {
+        QMutexLocker locker(&m_poolMutex);
+        QElapsedTimer waited;
+        waited.start();
+        while (m_openConnections >= m_maxConnections) {
+            const qint64 remaining = m_poolWaitMs - waited.elapsed();
+            if (remaining <= 0) {
+                m_poolStats.waitTimeouts++;
+                qDebug() << "数据库连接池已满 (" << m_maxConnections << ")，等待超时";
+                return false;
+            }
+            m_poolSlotFree.wait(&m_poolMutex, quint64(remaining));
+        }
+        m_openConnections++;
     }
-    if(m_db.isOpen()) return true;
 
+    // 建立连接可能要阻塞到连接超时，不持锁
+    const bool ok = db.open();
+
+    QMutexLocker locker(&m_poolMutex);
+    if (!ok) {
+        m_openConnections--;
+        m_poolSlotFree.wakeOne();
+        m_available = false;
+        return false;
+    }
+    PooledConnection &conn = m_pool[thread];
+    conn.open = true;
+    conn.reopened = true;
+    m_poolStats.opened++;
+    m_available = true;
+    return true;
+}
+
+void DBManager::closePooled(QThread *thread, QSqlDatabase &db)
+{
+    db.close();
+    QMutexLocker locker(&m_poolMutex);
+    auto it = m_pool.find(thread);
+    if (it != m_pool.end() && it->open) {
+        it->open = false;
+        m_openConnections--;
+        m_poolSlotFree.wakeOne();
+    }
+}
+
+// 记录使用时间并重新开始空闲计时 (在连接所属线程调用)
+void DBManager::touch(QThread *thread)
+{
+    QTimer *timer = nullptr;
+    {
+        QMutexLocker locker(&m_poolMutex);
+        auto it = m_pool.find(thread);
+        if (it == m_pool.end()) {
+            return;
+        }
+        it->lastUsedMs = QDateTime::currentMSecsSinceEpoch();
+        timer = it->idleTimer;
+    }
+    timer->start();
+}
+
+void DBManager::dropThreadConnection(QThread *thread)
+{
+    PooledConnection conn;
+    {
+        QMutexLocker locker(&m_poolMutex);
+        if (!m_pool.contains(thread)) {
+            return;
+        }
+        conn = m_pool.value(thread);
+    }
+    {
+        QSqlDatabase db = QSqlDatabase::database(conn.name, false);
+        closePooled(thread, db);
+    }
+    delete conn.idleTimer;
+    QSqlDatabase::removeDatabase(conn.name);
+    QMutexLocker locker(&m_poolMutex);
+    m_pool.remove(thread);
+}
+
+QSqlDatabase DBManager::threadConnection(bool *reopened)
+{
+    if (reopened) {
+        *reopened = false;
+    }
+    if (m_embedded) {
+        return QSqlDatabase();
+    }
+    QThread *thread = QThread::currentThread();
+    PooledConnection conn;
+    {
+        QMutexLocker locker(&m_poolMutex);
+        PooledConnection &registered = registerThreadLocked(thread);
+        conn = registered;
+        registered.reopened = false;
+    }
+    QSqlDatabase db = QSqlDatabase::database(conn.name, false);
+
+    // 空闲过久的连接先确认还能用 (服务器可能已重启或超时断开)
+    if (conn.open && QDateTime::currentMSecsSinceEpoch() - conn.lastUsedMs > m_healthCheckMs) {
+        QSqlQuery ping(db);
+        if (!ping.exec("SELECT 1")) {
+            qDebug() << "数据库连接已失效，重新连接:" << ping.lastError().text();
+            closePooled(thread, db);
+            conn.open = false;
+            QMutexLocker locker(&m_poolMutex);
+            m_poolStats.healthFailures++;
+        }
+    }
+    if (!conn.open) {
+        // 数据库不可用时不在这里阻塞等连接超时，由 connectToDb() 负责重试
+        if (!m_available || !openPooled(thread, db)) {
+            return QSqlDatabase();
+        }
+        QMutexLocker locker(&m_poolMutex);
+        m_pool[thread].reopened = false;
+        conn.reopened = true;
+    }
+    touch(thread);
+    if (reopened) {
+        *reopened = conn.reopened;
+    }
+    return db;
+}
+
+void DBManager::releaseThreadConnection()
+{
+    QThread *thread = QThread::currentThread();
+    QString name;
+    {
+        QMutexLocker locker(&m_poolMutex);
+        if (!m_pool.contains(thread)) {
+            return;
+        }
+        name = m_pool.value(thread).name;
+    }
+    QSqlDatabase db = QSqlDatabase::database(name, false);
+    closePooled(thread, db);
+}
+
+DBManager::PoolStats DBManager::poolStats() const
+{
+    QMutexLocker locker(&m_poolMutex);
+    PoolStats stats = m_poolStats;
+    stats.threads = m_pool.size();
+    stats.open = m_openConnections;
+    stats.max = m_maxConnections;
+    return stats;
+}
+
+int DBManager::reservePoolConnections(int connections)
+{
+    QMutexLocker locker(&m_poolMutex);
+    const int wanted = qBound(1, connections, POOL_MAX_LIMIT);
+    if (wanted > m_maxConnections) {
+        qDebug() << "数据库连接池上限" << m_maxConnections << "->" << wanted;
+        m_maxConnections = wanted;
+        m_poolSlotFree.wakeAll();
+    }
+    return m_maxConnections;
+}
+
+void DBManager::configureConnection(QSqlDatabase &db)
+{
     // 1. 读取配置文件 (config.ini) 路径：生成的 exe 文件同级目录下的 config.ini
     QString configPath = QCoreApplication::applicationDirPath() + "/config.ini";
 
     QSettings settings(configPath, QSettings::IniFormat);// 使用 QSettings 读取 ini文件
 
     // 如果配置文件不存在或没值，使用默认值
-    QString host = settings.value("Database/Host", "127.0.0.1").toString();
-    int port     = settings.value("Database/Port", 3306).toInt();
-    QString dbName = settings.value("Database/DbName", "underwater_sys").toString();
-    QString user = settings.value("Database/User", "root").toString();
-    QString pwd  = settings.value("Database/Password", "123456").toString();
+    db.setHostName(settings.value("Database/Host", "127.0.0.1").toString());
+    db.setPort(settings.value("Database/Port", 3306).toInt());
+    db.setDatabaseName(settings.value("Database/DbName", "underwater_sys").toString());
+    db.setUserName(settings.value("Database/User", "root").toString());
+    db.setPassword(settings.value("Database/Password", "123456").toString());
+    // 服务器不可达时 open() 最多阻塞这么久 (驱动默认要等很久)
+    db.setConnectOptions(QString("MYSQL_OPT_CONNECT_TIMEOUT=%1")
+                             .arg(qBound(1, settings.value("Database/ConnectTimeoutSec", 3).toInt(), 60)));
+}
+
+bool DBManager::usesEmbeddedBackend()
+{
+    QSettings settings(QCoreApplication::applicationDirPath() + "/config.ini", QSettings::IniFormat);
+    return settings.value("Database/Backend", "mysql").toString().compare("embedded", Qt::CaseInsensitive) == 0;
+}
 
-    qDebug() << "正在连接数据库:" << host << "用户:" << user;
+bool DBManager::isConnected() const
+{
+    if (!m_embedded) {
+        return m_available;
+    }
+    QMutexLocker locker(&m_tsdbMutex);
+    TsdbStore *store = m_tsdb.value(0, nullptr);
+    return store && store->isOpen();
+}
 
-    // 2. 配置 MySQL 连接
-    qDebug() << "可用数据库驱动:" << QSqlDatabase::drivers();
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-    qDebug() << "插件路径:" << QLibraryInfo::path(QLibraryInfo::PluginsPath);
-#else
-    qDebug() << "插件路径:" << QLibraryInfo::location(QLibraryInfo::PluginsPath);
-#endif
-    if(QSqlDatabase::contains("mysql_conn"))
-    {
-        m_db = QSqlDatabase::database("mysql_conn");
-    }else {
-        m_db = QSqlDatabase::addDatabase("QMYSQL","mysql_conn");
+TsdbStore *DBManager::embeddedStore(int vesselId)
+{
+    if (!m_embedded) {
+        return nullptr;
+    }
+    QMutexLocker locker(&m_tsdbMutex);
+    TsdbStore *store = m_tsdb.value(vesselId, nullptr);
+    if (store) {
+        return store;
+    }
+    QSettings settings(QCoreApplication::applicationDirPath() + "/config.ini", QSettings::IniFormat);
+    // 0 号船沿用单船版本的目录，原有数据不用搬
+    QString dir = settings.value("Database/TsdbDir", QCoreApplication::applicationDirPath() + "/tsdb").toString();
+    if (vesselId != 0) {
+        dir += QString("/vessel_%1").arg(vesselId);
     }
+    store = new TsdbStore(dir, settings.value("Database/TsdbChunkSamples", 1024).toInt());
+    QString error;
+    if (!store->open(&error)) {
+        qDebug() << "嵌入式存储打开失败 (船舶" << vesselId << "):" << error;
+    }
+    m_tsdb.insert(vesselId, store);
+    return store;
+}
+
+void DBManager::sanitizeTelemetry(double &speed, double &accel, double &dist)
+{
+    auto clamp = [](double v, double minV, double maxV){
+        if (std::isnan(v) || std::isinf(v)) return minV;
+        if (v < minV) return minV;
+        if (v > maxV) return maxV;
+        return v;
+    };
+    speed = clamp(speed, 0.0, 100.0);
+    accel = clamp(accel, -100.0, 100.0);
+    dist = clamp(dist, 0.0, 1e9);
+}
 
-    m_db.setHostName(host);
-    m_db.setPort(port);
-    m_db.setDatabaseName(dbName);
-    m_db.setUserName(user);
-    m_db.setPassword(pwd);
+// ===== ship_logs 按月分区 =====
+// 分区边界按 UTC 自然月，直接用日期差计算，与本地时区无关
 
-    // 3. 尝试打开
-    if (!m_db.open()) {
-        qDebug() << "MySQL 连接失败:" << m_db.lastError().text();
-        qDebug() << "提示: 请检查 1.MySQL服务是否启动 2.config.ini配置是否正确 3.libmysql.dll是否在exe目录下";
-        return false;
+static const qint64 MS_PER_DAY = 86400000;
+
+static QDate utcMonthOf(qint64 ms)
+{
+    const qint64 days = ms >= 0 ? ms / MS_PER_DAY : (ms - MS_PER_DAY + 1) / MS_PER_DAY;
+    const QDate date = QDate(1970, 1, 1).addDays(days);
+    return QDate(date.year(), date.month(), 1);
+}
+
+static qint64 utcMsOf(const QDate &date)
+{
+    return QDate(1970, 1, 1).daysTo(date) * MS_PER_DAY;
+}
+
+// [fromMs, toMs] 覆盖到的每个月一个分区 pYYYYMM，末尾加上兜底的 p_future
+static QString monthPartitionsSql(qint64 fromMs, qint64 toMs)
+{
+    QStringList parts;
+    for (QDate month = utcMonthOf(fromMs); month <= utcMonthOf(toMs); month = month.addMonths(1)) {
+        parts << QString("PARTITION p%1 VALUES LESS THAN (%2)")
+                     .arg(month.toString("yyyyMM")).arg(utcMsOf(month.addMonths(1)));
     }
+    parts << "PARTITION p_future VALUES LESS THAN MAXVALUE";
+    return "(" + parts.join(", ") + ")";
+}
+
+// 提前建好的月份数：写入永远落在具体的月分区，p_future 保持为空，拆分它不用搬数据
+static qint64 partitionHorizonMs()
+{
+    QSettings settings(QCoreApplication::applicationDirPath() + "/config.ini", QSettings::IniFormat);
+    const int monthsAhead = qBound(1, settings.value("Database/PartitionMonthsAhead", 2).toInt(), 24);
+    return utcMsOf(utcMonthOf(QDateTime::currentMSecsSinceEpoch()).addMonths(monthsAhead + 1)) - 1;
+}
 
-    qDebug() << "MySQL 连接成功!";
+void DBManager::ensurePartitions(const QSqlDatabase &db)
+{
+    // 各船的写入线程都会调用，串行执行以免重复拆分 p_future
+    static QMutex mutex;
+    QMutexLocker locker(&mutex);
+
+    QSqlQuery query(db);
+    if (!query.exec("SELECT MAX(CAST(PARTITION_DESCRIPTION AS SIGNED)) FROM information_schema.PARTITIONS "
+                    "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = 'ship_logs' "
+                    "AND PARTITION_NAME IS NOT NULL AND PARTITION_DESCRIPTION <> 'MAXVALUE'")
+        || !query.next() || query.value(0).isNull()) {
+        return;     // 未分区 (升级失败的旧表，下次启动时重试)
+    }
+    const qint64 coveredTo = query.value(0).toLongLong();
+    const qint64 horizonMs = partitionHorizonMs();
+    if (coveredTo > horizonMs) {
+        return;
+    }
+    if (!query.exec("ALTER TABLE ship_logs REORGANIZE PARTITION p_future INTO "
+                    + monthPartitionsSql(coveredTo, horizonMs))) {
+        qDebug() << "新增 ship_logs 分区失败:" << query.lastError().text();
+    }
+}
 
-    //4.建表
-    QSqlQuery query(m_db);
+void DBManager::ensureSchema(const QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    // log_time 保留秒级 DATETIME 便于人工查看；log_time_ms 为毫秒时间戳，用于与录像帧对齐。
+    // 按 log_time_ms 每月一个分区，分区键必须属于主键，所以主键是 (id, log_time_ms)；
+    // 两个二级索引都覆盖查询所需的列：(vessel_id, log_time_ms) 供曲线与导出，(vessel_id, id) 供历史翻页
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
     QString createSql = "CREATE TABLE IF NOT EXISTS ship_logs("
-                        "id INT AUTO_INCREMENT PRIMARY KEY,"
+                        "id INT AUTO_INCREMENT,"
+                        "vessel_id SMALLINT UNSIGNED NOT NULL DEFAULT 0,"
                         "log_time DATETIME,"
+                        "log_time_ms BIGINT NOT NULL,"
                         "speed DOUBLE,"
                         "accel DOUBLE,"
-                        "dist DOUBLE)";
+                        "dist DOUBLE,"
+                        "PRIMARY KEY (id, log_time_ms),"
+                        "INDEX idx_ship_logs_vessel_time (vessel_id, log_time_ms, speed, accel, dist),"
+                        "INDEX idx_ship_logs_vessel_id (vessel_id, id, log_time_ms, speed, accel, dist)) "
+                        "PARTITION BY RANGE (log_time_ms) " + monthPartitionsSql(nowMs, nowMs);
     if(!query.exec(createSql)) {
         qDebug() << "建表失败:" << query.lastError().text();
     }
 
-    return true;
+    // 旧版本建的表没有 log_time_ms：补列、补索引，并按秒级时间回填
+    if (query.exec("SHOW COLUMNS FROM ship_logs LIKE 'log_time_ms'") && !query.next()) {
+        if (!query.exec("ALTER TABLE ship_logs ADD COLUMN log_time_ms BIGINT AFTER log_time, "
+                        "ADD INDEX idx_ship_logs_time_ms (log_time_ms)")
+            || !query.exec("UPDATE ship_logs SET log_time_ms = UNIX_TIMESTAMP(log_time) * 1000 "
+                           "WHERE log_time_ms IS NULL")) {
+            qDebug() << "升级 ship_logs 失败:" << query.lastError().text();
+        }
+    }
+
+    // 单船版本的表：原有记录归 0 号船，换成上面的主键和索引，再按已有数据的月份分区。
+    // 两步都要重建整表；每步按表的实际状态各自判断，中途失败的升级下次启动时从失败的那步接着做
+    if (query.exec("SHOW COLUMNS FROM ship_logs LIKE 'vessel_id'") && !query.next()) {
+        qDebug() << "升级 ship_logs 为多船表 (记录多时需要一些时间)";
+        if (!query.exec("UPDATE ship_logs SET log_time_ms = COALESCE(UNIX_TIMESTAMP(log_time) * 1000, 0) "
+                        "WHERE log_time_ms IS NULL")
+            || !query.exec("ALTER TABLE ship_logs "
+                           "ADD COLUMN vessel_id SMALLINT UNSIGNED NOT NULL DEFAULT 0 AFTER id, "
+                           "MODIFY log_time_ms BIGINT NOT NULL, "
+                           "DROP PRIMARY KEY, ADD PRIMARY KEY (id, log_time_ms), "
+                           "DROP INDEX idx_ship_logs_time_ms, "
+                           "ADD INDEX idx_ship_logs_vessel_time (vessel_id, log_time_ms, speed, accel, dist), "
+                           "ADD INDEX idx_ship_logs_vessel_id (vessel_id, id, log_time_ms, speed, accel, dist)")) {
+            qDebug() << "升级 ship_logs 失败:" << query.lastError().text();
+        }
+    }
+    // 分区要求主键包含 log_time_ms，上一步没完成时不做
+    if (query.exec("SHOW COLUMNS FROM ship_logs LIKE 'vessel_id'") && query.next()
+        && query.exec("SELECT COUNT(*) FROM information_schema.PARTITIONS "
+                      "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = 'ship_logs' AND PARTITION_NAME IS NOT NULL")
+        && query.next() && query.value(0).toInt() == 0) {
+        qDebug() << "ship_logs 按月分区 (记录多时需要一些时间)";
+        qint64 firstMs = nowMs;
+        if (query.exec("SELECT MIN(log_time_ms) FROM ship_logs WHERE log_time_ms > 0")
+            && query.next() && !query.value(0).isNull()) {
+            firstMs = qMin(firstMs, query.value(0).toLongLong());
+        }
+        if (!query.exec("ALTER TABLE ship_logs PARTITION BY RANGE (log_time_ms) "
+                        + monthPartitionsSql(firstMs, nowMs))) {
+            qDebug() << "ship_logs 分区失败:" << query.lastError().text();
+        }
+    }
+    ensurePartitions(db);
+
+    // 每条日志 x 每路录像相机一行；主键即按日志查帧的索引，(cam_id, frame_time_ms) 供按录像反查
+    QString framesSql = "CREATE TABLE IF NOT EXISTS ship_log_frames("
+                        "log_id INT NOT NULL,"
+                        "cam_id TINYINT UNSIGNED NOT NULL,"
+                        "frame_seq BIGINT UNSIGNED NOT NULL,"
+                        "frame_time_ms BIGINT NOT NULL,"
+                        "PRIMARY KEY (log_id, cam_id),"
+                        "INDEX idx_log_frames_cam_time (cam_id, frame_time_ms))";
+    if(!query.exec(framesSql)) {
+        qDebug() << "建表失败:" << query.lastError().text();
+    }
+
+    // 运动事件：按相机 + 时间查 (回放页标注)，也可只按时间查所有相机
+    QString motionSql = "CREATE TABLE IF NOT EXISTS motion_events("
+                        "id INT AUTO_INCREMENT PRIMARY KEY,"
+                        "cam_id TINYINT UNSIGNED NOT NULL,"
+                        "start_ms BIGINT NOT NULL,"
+                        "end_ms BIGINT NOT NULL,"
+                        "peak_score DOUBLE,"
+                        "INDEX idx_motion_cam_start (cam_id, start_ms),"
+                        "INDEX idx_motion_start (start_ms))";
+    if(!query.exec(motionSql)) {
+        qDebug() << "建表失败:" << query.lastError().text();
+    }
+
+    // 遥测汇总：每船每级每个时间桶一行，主键即按船 + 级别 + 时间的范围查询索引；
+    // 存 sum 而不是 avg，写入时可以直接累加
+    QString rollupSql = "CREATE TABLE IF NOT EXISTS ship_log_rollups("
+                        "vessel_id SMALLINT UNSIGNED NOT NULL DEFAULT 0,"
+                        "level TINYINT UNSIGNED NOT NULL,"
+                        "bucket_ms BIGINT NOT NULL,"
+                        "cnt INT NOT NULL,"
+                        "speed_min DOUBLE, speed_max DOUBLE, speed_sum DOUBLE,"
+                        "accel_min DOUBLE, accel_max DOUBLE, accel_sum DOUBLE,"
+                        "dist_min DOUBLE, dist_max DOUBLE, dist_sum DOUBLE,"
+                        "PRIMARY KEY (vessel_id, level, bucket_ms))";
+    if(!query.exec(rollupSql)) {
+        qDebug() << "建表失败:" << query.lastError().text();
+    }
+    if (query.exec("SHOW COLUMNS FROM ship_log_rollups LIKE 'vessel_id'") && !query.next()) {
+        if (!query.exec("ALTER TABLE ship_log_rollups "
+                        "ADD COLUMN vessel_id SMALLINT UNSIGNED NOT NULL DEFAULT 0 FIRST, "
+                        "DROP PRIMARY KEY, ADD PRIMARY KEY (vessel_id, level, bucket_ms)")) {
+            qDebug() << "升级 ship_log_rollups 失败:" << query.lastError().text();
+        }
+    }
+    backfillRollups(db);
+}
+
+// 每船每级各自补齐：该级已有的最早桶及其之前的记录重新汇总。
+// 最早的桶可能是实时写入从桶中间开始累加的 (升级前已有的同桶记录没算进去)，
+// 所以边界桶也要按原始记录重建，并用 REPLACE 覆盖；它的记录数与原始记录一致时说明已补齐，跳过。
+// 上次中途失败的级别、或者补写失败后实时写入已经开始累加的级别，下次启动都会接着补
+void DBManager::backfillRollups(const QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    QVector<int> vessels;
+    if (!query.exec("SELECT DISTINCT vessel_id FROM ship_logs")) {
+        return;
+    }
+    while (query.next()) {
+        vessels.append(query.value(0).toInt());
+    }
+    bool logged = false;
+    for (int level = 0; level < ROLLUP_LEVELS; level++) {
+        for (int vesselId : vessels) {
+            query.prepare("SELECT bucket_ms, cnt FROM ship_log_rollups WHERE vessel_id = :vessel AND level = :level "
+                          "ORDER BY bucket_ms LIMIT 1");
+            query.bindValue(":vessel", vesselId);
+            query.bindValue(":level", level);
+            if (!query.exec()) {
+                return;
+            }
+            // 截止到最早的桶的末尾 (不含)；该级还没有桶时汇总全部记录
+            qint64 beforeMs = LLONG_MAX;
+            qint64 rolledCount = 0;
+            if (query.next()) {
+                beforeMs = query.value(0).toLongLong() + ROLLUP_BUCKET_MS[level];
+                rolledCount = query.value(1).toLongLong();
+            }
+            query.prepare("SELECT COUNT(*) FROM ship_logs WHERE vessel_id = :vessel AND log_time_ms < :before");
+            query.bindValue(":vessel", vesselId);
+            query.bindValue(":before", beforeMs);
+            if (!query.exec() || !query.next()) {
+                return;
+            }
+            if (query.value(0).toLongLong() == rolledCount) {
+                continue;
+            }
+            if (!logged) {
+                logged = true;
+                qDebug() << "生成遥测汇总 (记录多时需要一些时间)";
+            }
+            QString sql = QString("REPLACE INTO ship_log_rollups (vessel_id, level, bucket_ms, cnt, "
+                                  "speed_min, speed_max, speed_sum, accel_min, accel_max, accel_sum, "
+                                  "dist_min, dist_max, dist_sum) "
+                                  "SELECT vessel_id, %1, FLOOR(log_time_ms / %2) * %2 AS b, COUNT(*), "
+                                  "MIN(speed), MAX(speed), SUM(speed), MIN(accel), MAX(accel), SUM(accel), "
+                                  "MIN(dist), MAX(dist), SUM(dist) "
+                                  "FROM ship_logs WHERE vessel_id = %3 AND log_time_ms < %4 GROUP BY vessel_id, b")
+                              .arg(level).arg(ROLLUP_BUCKET_MS[level]).arg(vesselId).arg(beforeMs);
+            if (!query.exec(sql)) {
+                qDebug() << "生成汇总失败:" << query.lastError().text();
+                return;
+            }
+        }
+    }
 }
 
 void DBManager::closeDb()
 {
-    if (m_db.isOpen()) m_db.close();
+    dropThreadConnection(QThread::currentThread());
+    QMutexLocker locker(&m_tsdbMutex);
+    m_embedded = false;
+    for (TsdbStore *store : m_tsdb) {
+        store->close();
+        delete store;
+    }
+    m_tsdb.clear();
 }
 
-// 插入数据
-bool DBManager::insertLog(const QString& time, double speed, double accel, double dist)
+bool DBManager::insertMotionEvent(int camId, qint64 startMs, qint64 endMs, double peakScore)
 {
-    if (!m_db.isOpen()) return false;
+    QSqlDatabase db = threadConnection();
+    if (!db.isOpen()) return false;
 
-    // 简单防护：过滤异常值
-    auto clamp = [](double v, double minV, double maxV){
-        if (std::isnan(v) || std::isinf(v)) return minV;
-        if (v < minV) return minV;
-        if (v > maxV) return maxV;
-        return v;
-    };
-    double s = clamp(speed, 0.0, 100.0);
-    double a = clamp(accel, -100.0, 100.0);
-    double d = clamp(dist, 0.0, 1e9);
-
-    QSqlQuery query(m_db);
-    query.prepare("INSERT INTO ship_logs (log_time, speed, accel, dist) "
-                  "VALUES (:time, :speed, :accel, :dist)");
-    query.bindValue(":time", time);
-    query.bindValue(":speed", s);
-    query.bindValue(":accel", a);
-    query.bindValue(":dist", d);
-
-    if(!query.exec()) {
-        qDebug() << "插入失败:" << query.lastError().text();
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO motion_events (cam_id, start_ms, end_ms, peak_score) "
+                  "VALUES (:cam, :start, :end, :peak)");
+    query.bindValue(":cam", camId);
+    query.bindValue(":start", startMs);
+    query.bindValue(":end", endMs);
+    query.bindValue(":peak", peakScore);
+    if (!query.exec()) {
+        qDebug() << "插入运动事件失败:" << query.lastError().text();
         return false;
     }
-    qDebug() << "插入成功:" << time << "speed" << s << "accel" << a << "dist" << d;
     return true;
 }
 
-//查询分页
-QSqlQuery DBManager::getHistoryLogs(int limit, int offset)
+// 按 id 翻页
+static QVector<LogRow> readLogRows(QSqlQuery &query)
+{
+    QVector<LogRow> rows;
+    while (query.next()) {
+        LogRow row;
+        row.id = query.value(0).toInt();
+        row.timeMs = query.value(1).toLongLong();
+        row.speed = query.value(2).toDouble();
+        row.accel = query.value(3).toDouble();
+        row.dist = query.value(4).toDouble();
+        rows.append(row);
+    }
+    return rows;
+}
+
+QVector<LogRow> DBManager::getLogsBefore(int vesselId, int beforeId, int limit)
+{
+    if (TsdbStore *store = embeddedStore(vesselId)) return store->logsBefore(beforeId, limit);
+    return queryLogsBefore(threadConnection(), vesselId, beforeId, limit);
+}
+
+QVector<LogRow> DBManager::getLogsAfter(int vesselId, int afterId, int limit)
+{
+    if (TsdbStore *store = embeddedStore(vesselId)) return store->logsAfter(afterId, limit);
+    return queryLogsAfter(threadConnection(), vesselId, afterId, limit);
+}
+
+// 只取覆盖索引 idx_ship_logs_vessel_id 中的列 (升级后 log_time_ms 不再为空)，不回表
+QVector<LogRow> DBManager::queryLogsBefore(const QSqlDatabase &db, int vesselId, int beforeId, int limit)
+{
+    if (!db.isOpen()) return QVector<LogRow>();
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, log_time_ms, speed, accel, dist FROM ship_logs "
+                  "WHERE vessel_id = :vessel AND id < :before ORDER BY id DESC LIMIT :limit");
+    query.bindValue(":vessel", vesselId);
+    query.bindValue(":before", beforeId);
+    query.bindValue(":limit", limit);
+    if (!query.exec()) {
+        qDebug() << "查询历史失败:" << query.lastError().text();
+        return QVector<LogRow>();
+    }
+    return readLogRows(query);
+}
+
+QVector<LogRow> DBManager::queryLogsAfter(const QSqlDatabase &db, int vesselId, int afterId, int limit)
 {
-    QSqlQuery query(m_db);
-    // MySQL 分页语法: LIMIT 数量 OFFSET 偏移量
-    query.prepare("SELECT log_time, speed, accel, dist FROM ship_logs "
-                  "ORDER BY id DESC LIMIT :limit OFFSET :offset");
+    if (!db.isOpen()) return QVector<LogRow>();
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, log_time_ms, speed, accel, dist FROM ship_logs "
+                  "WHERE vessel_id = :vessel AND id > :after ORDER BY id ASC LIMIT :limit");
+    query.bindValue(":vessel", vesselId);
+    query.bindValue(":after", afterId);
     query.bindValue(":limit", limit);
-    query.bindValue(":offset", offset);
-    query.exec();
-    return query;
+    if (!query.exec()) {
+        qDebug() << "查询历史失败:" << query.lastError().text();
+        return QVector<LogRow>();
+    }
+    QVector<LogRow> rows = readLogRows(query);
+    std::reverse(rows.begin(), rows.end());
+    return rows;
+}
+
+qint64 DBManager::getLogCount(int vesselId)
+{
+    if (TsdbStore *store = embeddedStore(vesselId)) {
+        return store->count();
+    }
+    QSqlDatabase db = threadConnection();
+    if (!db.isOpen()) return -1;
+
+    QSqlQuery query(db);
+    query.prepare("SELECT COALESCE(SUM(cnt), 0) FROM ship_log_rollups WHERE vessel_id = :vessel AND level = :level");
+    query.bindValue(":vessel", vesselId);
+    query.bindValue(":level", ROLLUP_LEVELS - 1);
+    if (!query.exec() || !query.next()) {
+        qDebug() << "查询记录数失败:" << query.lastError().text();
+        return -1;
+    }
+    return query.value(0).toLongLong();
+}
+
+QVector<LogFrameLink> DBManager::getFrameLinks(int logId)
+{
+    QVector<LogFrameLink> links;
+    QSqlDatabase db = threadConnection();
+    if (!db.isOpen()) return links;
+
+    QSqlQuery query(db);
+    query.prepare("SELECT cam_id, frame_seq, frame_time_ms FROM ship_log_frames "
+                  "WHERE log_id = :id ORDER BY cam_id");
+    query.bindValue(":id", logId);
+    if (!query.exec()) {
+        qDebug() << "查询帧关联失败:" << query.lastError().text();
+        return links;
+    }
+    while (query.next()) {
+        LogFrameLink link;
+        link.camId = query.value(0).toInt();
+        link.seq = query.value(1).toULongLong();
+        link.frameMs = query.value(2).toLongLong();
+        links.append(link);
+    }
+    return links;
+}
+
+QVector<TelemetrySample> DBManager::getLogsInRange(int vesselId, qint64 fromMs, qint64 toMs)
+{
+    if (TsdbStore *store = embeddedStore(vesselId)) return store->range(fromMs, toMs);
+    QVector<TelemetrySample> samples;
+    QSqlDatabase db = threadConnection();
+    if (!db.isOpen()) return samples;
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT log_time_ms, speed, accel, dist FROM ship_logs "
+                  "WHERE vessel_id = :vessel AND log_time_ms BETWEEN :from AND :to ORDER BY log_time_ms");
+    query.bindValue(":vessel", vesselId);
+    query.bindValue(":from", fromMs);
+    query.bindValue(":to", toMs);
+    if (!query.exec()) {
+        qDebug() << "按时间查询失败:" << query.lastError().text();
+        return samples;
+    }
+    while (query.next()) {
+        TelemetrySample sample;
+        sample.timeMs = query.value(0).toLongLong();
+        sample.speed = query.value(1).toDouble();
+        sample.accel = query.value(2).toDouble();
+        sample.dist = query.value(3).toDouble();
+        samples.append(sample);
+    }
+    return samples;
+}
+
+int DBManager::rollupLevelFor(qint64 spanMs, int maxPoints)
+{
+    maxPoints = qMax(1, maxPoints);
+    // 记录间隔不小于 1 秒：最细一级都不超过 maxPoints 时原始记录也不会超过
+    if (spanMs / ROLLUP_BUCKET_MS[0] <= maxPoints) {
+        return -1;
+    }
+    for (int level = 0; level < ROLLUP_LEVELS; level++) {
+        if (spanMs / ROLLUP_BUCKET_MS[level] <= 2ll * maxPoints) {
+            return level;
+        }
+    }
+    return ROLLUP_LEVELS - 1;
 }
 
-// 查询总数
-int DBManager::getTotalCount()
+QVector<TelemetryBucket> DBManager::getTelemetrySeries(int vesselId, qint64 fromMs, qint64 toMs, int maxPoints,
+                                                       qint64 *bucketMs)
 {
-    if (!m_db.isOpen()) return 0;
+    QVector<TelemetryBucket> buckets;
+    const int level = rollupLevelFor(toMs - fromMs, maxPoints);
+    if (bucketMs) {
+        *bucketMs = level < 0 ? 0 : ROLLUP_BUCKET_MS[level];
+    }
+
+    if (level < 0) {
+        const QVector<TelemetrySample> samples = getLogsInRange(vesselId, fromMs, toMs);
+        buckets.reserve(samples.size());
+        for (const TelemetrySample &sample : samples) {
+            TelemetryBucket bucket;
+            bucket.timeMs = sample.timeMs;
+            bucket.count = 1;
+            bucket.speedMin = bucket.speedMax = bucket.speedAvg = sample.speed;
+            bucket.accelMin = bucket.accelMax = bucket.accelAvg = sample.accel;
+            bucket.distMin = bucket.distMax = bucket.distAvg = sample.dist;
+            buckets.append(bucket);
+        }
+        return buckets;
+    }
 
-    QSqlQuery query(m_db);
-    query.exec("SELECT COUNT(*) FROM ship_logs");
-    if (query.next()) {
-        return query.value(0).toInt();
+    if (TsdbStore *store = embeddedStore(vesselId)) {
+        // 嵌入式存储没有汇总表：解压范围内的块现算，按块跳读使代价只与范围大小有关
+        const qint64 width = ROLLUP_BUCKET_MS[level];
+        const QVector<TelemetrySample> samples = store->range(fromMs - fromMs % width, toMs);
+        for (const TelemetrySample &sample : samples) {
+            const qint64 start = sample.timeMs - sample.timeMs % width;
+            if (buckets.isEmpty() || buckets.last().timeMs != start) {
+                TelemetryBucket bucket;
+                bucket.timeMs = start;
+                bucket.speedMin = bucket.speedMax = sample.speed;
+                bucket.accelMin = bucket.accelMax = sample.accel;
+                bucket.distMin = bucket.distMax = sample.dist;
+                buckets.append(bucket);
+            }
+            TelemetryBucket &bucket = buckets.last();
+            bucket.count++;
+            bucket.speedMin = qMin(bucket.speedMin, sample.speed);
+            bucket.speedMax = qMax(bucket.speedMax, sample.speed);
+            bucket.speedAvg += sample.speed;
+            bucket.accelMin = qMin(bucket.accelMin, sample.accel);
+            bucket.accelMax = qMax(bucket.accelMax, sample.accel);
+            bucket.accelAvg += sample.accel;
+            bucket.distMin = qMin(bucket.distMin, sample.dist);
+            bucket.distMax = qMax(bucket.distMax, sample.dist);
+            bucket.distAvg += sample.dist;
+        }
+        for (TelemetryBucket &bucket : buckets) {
+            bucket.speedAvg /= bucket.count;
+            bucket.accelAvg /= bucket.count;
+            bucket.distAvg /= bucket.count;
+        }
+        return buckets;
+    }
+
+    QSqlDatabase db = threadConnection();
+    if (!db.isOpen()) return buckets;
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT bucket_ms, cnt, speed_min, speed_max, speed_sum / cnt, "
+                  "accel_min, accel_max, accel_sum / cnt, dist_min, dist_max, dist_sum / cnt "
+                  "FROM ship_log_rollups WHERE vessel_id = :vessel AND level = :level "
+                  "AND bucket_ms BETWEEN :from AND :to ORDER BY bucket_ms");
+    query.bindValue(":vessel", vesselId);
+    query.bindValue(":level", level);
+    // 包含起点所在的桶
+    query.bindValue(":from", fromMs - fromMs % ROLLUP_BUCKET_MS[level]);
+    query.bindValue(":to", toMs);
+    if (!query.exec()) {
+        qDebug() << "查询汇总失败:" << query.lastError().text();
+        return buckets;
+    }
+    while (query.next()) {
+        TelemetryBucket bucket;
+        bucket.timeMs = query.value(0).toLongLong();
+        bucket.count = query.value(1).toInt();
+        bucket.speedMin = query.value(2).toDouble();
+        bucket.speedMax = query.value(3).toDouble();
+        bucket.speedAvg = query.value(4).toDouble();
+        bucket.accelMin = query.value(5).toDouble();
+        bucket.accelMax = query.value(6).toDouble();
+        bucket.accelAvg = query.value(7).toDouble();
+        bucket.distMin = query.value(8).toDouble();
+        bucket.distMax = query.value(9).toDouble();
+        bucket.distAvg = query.value(10).toDouble();
+        buckets.append(bucket);
     }
-    return 0;
+    return buckets;
 }
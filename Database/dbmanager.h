@@ -9,8 +9,64 @@
 #include <QSettings> // 用于读取配置文件
 #include <QCoreApplication>
 #include <QDateTime>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
 
+class QThread;
+class QTimer;
 
+// 遥测记录关联的录像帧 (每路正在录像的相机一条)
+struct LogFrameLink {
+    int camId = 0;
+    quint64 seq = 0;        // 录像帧序号
+    qint64 frameMs = 0;     // 该帧的录像时间戳 (UTC 毫秒)
+};
+
+// 按时间取出的遥测样本 (回放时驱动曲线)
+struct TelemetrySample {
+    qint64 timeMs = 0;
+    double speed = 0;
+    double accel = 0;
+    double dist = 0;
+};
+
+// 遥测汇总 (金字塔)：各级桶宽，桶起点按 UTC 对齐
+static const int ROLLUP_LEVELS = 4;
+static const qint64 ROLLUP_BUCKET_MS[ROLLUP_LEVELS] = {1000, 60000, 3600000, 86400000};
+
+// 一个时间桶的汇总；取原始数据时每条样本一个桶 (count=1，min=max=avg)
+struct TelemetryBucket {
+    qint64 timeMs = 0;      // 桶起点
+    int count = 0;
+    double speedMin = 0, speedMax = 0, speedAvg = 0;
+    double accelMin = 0, accelMax = 0, accelAvg = 0;
+    double distMin = 0, distMax = 0, distAvg = 0;
+};
+
+// 历史记录表的一行
+struct LogRow {
+    int id = 0;
+    qint64 timeMs = 0;      // 旧数据的 log_time_ms 在升级表结构时由 log_time 回填
+    double speed = 0;
+    double accel = 0;
+    double dist = 0;
+};
+
+class TsdbStore;
+
+/**
+ * @brief 遥测数据访问
+ * 后端由 config.ini [Database] Backend 选择：
+ *   mysql (默认)  ship_logs 等表，见 ensureSchema()
+ *   embedded      本地压缩时序文件 (TsdbStore)，目录 TsdbDir=<程序目录>/tsdb，
+ *                 每块 TsdbChunkSamples=1024 条；不需要 MySQL 服务，
+ *                 但不保存录像帧关联和运动事件，曲线汇总在查询时现算
+ * 遥测按船舶 (vessel_id) 区分，查询接口都只取一条船的记录；单船部署及升级前的旧数据为 0 号船。
+ * 嵌入式后端每条船一个存储：0 号船在 TsdbDir，其余在 TsdbDir/vessel_<id>。
+ */
 class DBManager : public QObject
 {
     Q_OBJECT
@@ -18,18 +74,81 @@ public:
     static DBManager& instance(); // 单例模式：获取全局唯一实例
 
     // --- 1. 连接管理 ---
-    bool connectToDb(); // 读取配置文件并连接
-    void closeDb();     // 关闭连接
+    // 读取配置文件并为当前线程建立连接 (MySQL 不可达时最多阻塞 ConnectTimeoutSec=3 秒)
+    bool connectToDb();
+    void closeDb();     // 关闭当前线程的连接和嵌入式存储 (主线程退出前调用)
+    bool isConnected() const;
+    static bool usesEmbeddedBackend();
+    // 按 config.ini [Database] 设置连接参数 (不打开)；其他线程建自己的连接时也用它
+    static void configureConnection(QSqlDatabase &db);
+    // 建表，并把旧表升级为按船舶 + 时间索引、按月分区的结构；汇总表中缺的早期记录由已有记录补齐
+    static void ensureSchema(const QSqlDatabase &db);
+    // 补齐 ship_logs 到当前月之后 PartitionMonthsAhead=2 个月的分区 (写线程定期调用)
+    static void ensurePartitions(const QSqlDatabase &db);
+    // 过滤异常值 (NaN/Inf/越界)
+    static void sanitizeTelemetry(double &speed, double &accel, double &dist);
+
+    // --- 1.1 连接池 ---
+    // Qt 的连接只能在创建它的线程使用：每个线程一条 MySQL 连接，首次使用时创建，
+    // 同时打开的连接不超过 PoolMaxConnections=8，池满时新线程最多等 PoolWaitMs=2000。
+    // 空闲超过 PoolHealthCheckSec=30 秒的连接先 SELECT 1 确认可用，失效则重连；
+    // 空闲超过 PoolIdleSec=300 秒的连接关闭 (线程需有事件循环)；线程结束时自动注销。
+    // 下面的业务接口都走调用线程自己的连接，可以在任意线程并发调用。
+    // 数据库不可用时 (最近一次建立连接失败) 直接返回无效连接而不阻塞，由 connectToDb() 负责重试。
+    // reopened 返回这条连接自上次取用后是否重新建立过 (之前预编译的语句已失效)
+    QSqlDatabase threadConnection(bool *reopened = nullptr);
+    // 关闭当前线程的连接 (如写入出错、怀疑连接已断)，下次取用时重连
+    void releaseThreadConnection();
+    struct PoolStats {
+        int threads = 0;            // 登记了连接的线程数
+        int open = 0;
+        int max = 0;
+        quint64 opened = 0;         // 累计建立连接次数
+        quint64 healthFailures = 0;
+        quint64 idleClosed = 0;
+        quint64 waitTimeouts = 0;
+    };
+    PoolStats poolStats() const;
+    // 长期占用连接的线程 (如每条船一个遥测写线程) 较多时，把池上限提高到至少 connections
+    // (不超过 64)，返回调整后的上限
+    int reservePoolConnections(int connections);
+
+    // 使用嵌入式后端时返回该船的存储对象 (首次使用时打开；线程安全，写线程直接追加)，否则为 nullptr
+    TsdbStore *embeddedStore(int vesselId = 0);
 
     // --- 2. 业务接口 (增删改查) ---
-    // 插入一条日志 (注意：根据之前的修改，我们只有4个字段，去掉了位置)
-    bool insertLog(const QString& time, double speed, double accel, double dist);
+    // 遥测记录只由 TelemetryWriter 批量写入 (连同帧关联和汇总)，这里没有单条写入接口
+
+    // 某条船的历史数据按 id 翻页 ((vessel_id, id, ...) 覆盖索引范围扫描，不回表，翻到多深都一样快)，
+    // 结果均按 id 降序
+    // id < beforeId 中最新的 limit 条 (beforeId 取 INT_MAX 即第一页)
+    QVector<LogRow> getLogsBefore(int vesselId, int beforeId, int limit);
+    // id > afterId 中最旧的 limit 条 (往回翻页)
+    QVector<LogRow> getLogsAfter(int vesselId, int afterId, int limit);
+    // 同上，使用调用方自己的连接 (其他线程)
+    static QVector<LogRow> queryLogsBefore(const QSqlDatabase &db, int vesselId, int beforeId, int limit);
+    static QVector<LogRow> queryLogsAfter(const QSqlDatabase &db, int vesselId, int afterId, int limit);
+
+    // 某条日志关联的录像帧，按相机号排序
+    QVector<LogFrameLink> getFrameLinks(int logId);
+
+    // 运动触发录像的事件 (时间范围为 UTC 毫秒)
+    bool insertMotionEvent(int camId, qint64 startMs, qint64 endMs, double peakScore);
 
-    // 获取历史数据 (分页查询)
-    QSqlQuery getHistoryLogs(int limit, int offset);
+    // 某条船 [fromMs, toMs] 内的遥测样本，按时间升序 (走 (vessel_id, log_time_ms, ...) 覆盖索引，只扫相关分区)
+    QVector<TelemetrySample> getLogsInRange(int vesselId, qint64 fromMs, qint64 toMs);
 
-    // 获取数据总条数 (用于计算页码)
-    int getTotalCount();
+    // [fromMs, toMs] 的曲线数据，自动选择汇总级别使点数约为 maxPoints (每像素一点)：
+    // 范围足够小时取原始记录，否则取 ship_log_rollups 中点数不超过 2 * maxPoints 的最细一级。
+    // bucketMs 返回所用桶宽 (原始记录为 0)
+    QVector<TelemetryBucket> getTelemetrySeries(int vesselId, qint64 fromMs, qint64 toMs, int maxPoints,
+                                                qint64 *bucketMs = nullptr);
+    // 上面的级别选择规则：返回 ROLLUP_BUCKET_MS 下标，-1 表示原始记录
+    static int rollupLevelFor(qint64 spanMs, int maxPoints);
+
+    // 某条船的记录总数：取最粗一级汇总的 cnt 之和 (每天一行，不扫原始表)，查询失败返回 -1
+    // 汇总与原始记录在同一事务写入，数目一致；多船写入时的 id 交错、回滚留下的空洞都不影响
+    qint64 getLogCount(int vesselId);
 private:
     ~DBManager();
     explicit DBManager(QObject *parent = nullptr);
@@ -37,7 +156,39 @@ private:
     DBManager(const DBManager&) = delete;
     DBManager& operator=(const DBManager&) = delete;
 
-    QSqlDatabase m_db;
+    // 嵌入式后端：船舶 -> 存储 (m_tsdbMutex 保护；打开后直到 closeDb 才删除，指针可以交给其他线程)
+    std::atomic<bool> m_embedded{false};
+    mutable QMutex m_tsdbMutex;
+    QHash<int, TsdbStore *> m_tsdb;
+
+    struct PooledConnection {
+        QString name;
+        bool open = false;
+        bool reopened = false;      // 建立后尚未被 threadConnection() 报告
+        qint64 lastUsedMs = 0;
+        QTimer *idleTimer = nullptr;
+    };
+    mutable QMutex m_poolMutex;
+    QWaitCondition m_poolSlotFree;
+    QHash<QThread *, PooledConnection> m_pool;
+    int m_openConnections = 0;
+    int m_poolSerial = 0;
+    int m_maxConnections = 8;
+    int m_poolWaitMs = 2000;
+    qint64 m_idleTimeoutMs = 300000;
+    qint64 m_healthCheckMs = 30000;
+    PoolStats m_poolStats;
+    std::atomic<bool> m_available{false};   // 最近一次建立连接是否成功
+    QMutex m_schemaMutex;                   // 建表期间其他线程的 connectToDb 在此等待
+    std::atomic<bool> m_schemaReady{false}; // ensureSchema 已执行完
+
+    PooledConnection &registerThreadLocked(QThread *thread);
+    bool openPooled(QThread *thread, QSqlDatabase &db);
+    void closePooled(QThread *thread, QSqlDatabase &db);
+    void touch(QThread *thread);
+    void dropThreadConnection(QThread *thread);
+
+    static void backfillRollups(const QSqlDatabase &db);
 };
 
 #endif // DBMANAGER_H
@@ -0,0 +1,125 @@
+#include "historycache.h"
+#include <QCoreApplication>
+#include <QSettings>
+#include <QDebug>
+#include <climits>
+
+HistoryPageCache::HistoryPageCache(int pageSize, QObject *parent)
+    : QObject{parent}
+    , m_pageSize(qMax(1, pageSize))
+{
+    QSettings settings(QCoreApplication::applicationDirPath() + "/config.ini", QSettings::IniFormat);
+    settings.beginGroup("Database");
+    m_pages.setMaxCost(qMax(16, settings.value("HistoryCacheKb", 4096).toInt()) * 1024);
+    m_prefetchPages = qBound(0, settings.value("HistoryPrefetchPages", 2).toInt(), 16);
+    settings.endGroup();
+
+    m_worker = new QObject;
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread.setObjectName("HistoryPrefetch");
+    m_thread.start(QThread::LowPriority);
+}
+
+HistoryPageCache::~HistoryPageCache()
+{
+    m_prefetchTicket++;     // 让排队中的预取直接返回
+    // 线程结束时连接池自动关闭该线程的连接
+    m_thread.quit();
+    m_thread.wait();
+}
+
+QVector<LogRow> HistoryPageCache::page(int anchorId)
+{
+    if (Page *cached = m_pages.object(anchorId)) {
+        m_hits++;
+        return cached->rows;
+    }
+    m_misses++;
+    QVector<LogRow> rows = DBManager::instance().getLogsBefore(m_vesselId, anchorId, m_pageSize);
+    insert(anchorId, rows);
+    return rows;
+}
+
+void HistoryPageCache::insert(int anchorId, const QVector<LogRow> &rows)
+{
+    Page *page = new Page;
+    page->rows = rows;
+    m_pages.insert(anchorId, page, qMax(1, int(rows.size() * sizeof(LogRow) + sizeof(Page))));
+}
+
+void HistoryPageCache::invalidateFrom(int firstNewId)
+{
+    m_generation++;
+    const QList<int> anchors = m_pages.keys();
+    for (int anchorId : anchors) {
+        if (anchorId > firstNewId) {
+            m_pages.remove(anchorId);
+        }
+    }
+}
+
+void HistoryPageCache::clear()
+{
+    m_generation++;
+    m_pages.clear();
+}
+
+void HistoryPageCache::setVessel(int vesselId)
+{
+    if (vesselId == m_vesselId) {
+        return;
+    }
+    m_vesselId = vesselId;
+    m_prefetchTicket++;     // 上一条船排队中的预取不再需要
+    clear();
+}
+
+void HistoryPageCache::prefetchAfter(int anchorId)
+{
+    if (m_prefetchPages == 0) {
+        return;
+    }
+    const quint64 ticket = ++m_prefetchTicket;
+    const quint64 generation = m_generation;
+    const int vesselId = m_vesselId;
+
+    // 沿缓存走到第一个缺失的块，从那里开始交给后台
+    int anchor = anchorId;
+    for (int remaining = m_prefetchPages + 1; remaining > 0; remaining--) {
+        Page *cached = m_pages.object(anchor);
+        if (!cached) {
+            QMetaObject::invokeMethod(m_worker, [=](){
+                fetch(ticket, generation, vesselId, anchor, remaining);
+            }, Qt::QueuedConnection);
+            break;
+        }
+        if (cached->rows.size() < m_pageSize) {
+            break;      // 已到最旧的记录
+        }
+        anchor = cached->rows.last().id;
+    }
+}
+
+// ==========================================
+// 以下在预取线程执行
+// ==========================================
+void HistoryPageCache::fetch(quint64 ticket, quint64 generation, int vesselId, int anchorId, int pages)
+{
+    for (int i = 0; i < pages && ticket == m_prefetchTicket; i++) {
+        QVector<LogRow> rows = DBManager::instance().getLogsBefore(vesselId, anchorId, m_pageSize);
+        if (rows.isEmpty() && !DBManager::instance().isConnected()) {
+            break;  // 数据库不可用，空结果不能当作已到最旧
+        }
+        // 结果交回 GUI 线程放入缓存
+        QMetaObject::invokeMethod(this, [=](){
+            if (generation == m_generation) {   // 期间有新数据写入，结果可能已过期
+                insert(anchorId, rows);
+            }
+        }, Qt::QueuedConnection);
+        if (rows.size() < m_pageSize) {
+            break;
+        }
+        anchorId = rows.last().id;
+    }
+}
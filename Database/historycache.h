@@ -0,0 +1,63 @@
+#ifndef HISTORYCACHE_H
+#define HISTORYCACHE_H
+
+#include <QObject>
+#include <QThread>
+#include <QCache>
+#include <atomic>
+#include "dbmanager.h"
+
+/**
+ * @brief 历史记录分块缓存 (一条船)
+ * 一块以锚点 id 标识：锚点为 a 的块 = id < a 的最新 pageSize 条 (最新一块锚点为 INT_MAX)。
+ * 块按占用字节数放进 LRU (QCache)，超过 HistoryCacheKb 时淘汰最久未用的块。
+ * 每取一块后在后台线程 (连接池中该线程自己的连接) 预取其后更旧的 HistoryPrefetchPages 块，下次多数直接命中。
+ * 记录只追加：新写入的 id 都大于已有 id，锚点不大于新 id 的页内容不变，
+ * 只需丢掉锚点在新 id 之上的块 (通常只有最新一块)。
+ * 配置 (config.ini [Database])：HistoryCacheKb=4096  HistoryPrefetchPages=2
+ * 除后台预取外，所有函数在 GUI 线程调用。
+ */
+class HistoryPageCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HistoryPageCache(int pageSize, QObject *parent = nullptr);
+    ~HistoryPageCache();
+
+    // 锚点为 anchorId 的块；未缓存时同步查询 (GUI 线程的连接) 并放入缓存
+    QVector<LogRow> page(int anchorId);
+    // 后台预取 anchorId 之后 (更旧) 的 HistoryPrefetchPages 块
+    void prefetchAfter(int anchorId);
+    // 新写入了 id >= firstNewId 的记录
+    void invalidateFrom(int firstNewId);
+    void clear();
+    // 切换到另一条船的记录 (清空缓存)
+    void setVessel(int vesselId);
+    int vessel() const { return m_vesselId; }
+
+    int hits() const { return m_hits; }
+    int misses() const { return m_misses; }
+
+private:
+    struct Page {
+        QVector<LogRow> rows;
+    };
+
+    int m_pageSize;
+    int m_vesselId = 0;
+    int m_prefetchPages = 2;
+    QCache<int, Page> m_pages;          // 锚点 -> 块，cost 为字节数
+    quint64 m_generation = 0;           // 失效后丢弃还在路上的预取结果
+    int m_hits = 0;
+    int m_misses = 0;
+
+    // --- 预取线程 ---
+    QThread m_thread;
+    QObject *m_worker;
+    std::atomic<quint64> m_prefetchTicket{0};  // 连续翻页时只做最近一次的预取
+
+    void insert(int anchorId, const QVector<LogRow> &rows);
+    void fetch(quint64 ticket, quint64 generation, int vesselId, int anchorId, int pages);
+};
+
+#endif // HISTORYCACHE_H
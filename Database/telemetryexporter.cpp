@@ -0,0 +1,285 @@
+#include "telemetryexporter.h"
+#include "dbmanager.h"
+#include "tsdbstore.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QSettings>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <climits>
+
+namespace {
+
+const int EMBEDDED_BATCH_ROWS = 4096;
+
+/**
+ * @brief 分块写出的 CSV
+ * 行文本先追加到缓冲区，攒够一块整块写出，缓冲区复用不重新分配。
+ * 同一秒内的记录共用格式化好的日期前缀 (逐行 QDateTime::toString 是导出的主要开销)。
+ */
+class CsvChunkWriter
+{
+public:
+    CsvChunkWriter(QFile *file, int chunkBytes)
+        : m_file(file)
+        , m_chunkBytes(chunkBytes)
+    {
+        m_buffer.reserve(chunkBytes + 256);
+        m_buffer.append("id,time,time_ms,speed,accel,dist\n");
+    }
+
+    bool append(const LogRow &row)
+    {
+        const qint64 second = row.timeMs >= 0 ? row.timeMs / 1000 : (row.timeMs - 999) / 1000;
+        if (second != m_prefixSecond) {
+            m_prefixSecond = second;
+            m_prefix = QDateTime::fromMSecsSinceEpoch(second * 1000).toString("yyyy-MM-dd HH:mm:ss").toLatin1();
+        }
+        const int ms = int(row.timeMs - second * 1000);
+        m_buffer.append(QByteArray::number(row.id)).append(',');
+        m_buffer.append(m_prefix).append('.');
+        m_buffer.append(char('0' + ms / 100)).append(char('0' + ms / 10 % 10)).append(char('0' + ms % 10)).append(',');
+        m_buffer.append(QByteArray::number(row.timeMs)).append(',');
+        // 最短的可精确还原的表示，传感器的两位小数原样输出
+        m_buffer.append(QByteArray::number(row.speed, 'g', QLocale::FloatingPointShortest)).append(',');
+        m_buffer.append(QByteArray::number(row.accel, 'g', QLocale::FloatingPointShortest)).append(',');
+        m_buffer.append(QByteArray::number(row.dist, 'g', QLocale::FloatingPointShortest)).append('\n');
+        return m_buffer.size() < m_chunkBytes || flush();
+    }
+
+    bool flush()
+    {
+        if (m_buffer.isEmpty()) {
+            return true;
+        }
+        if (m_file->write(m_buffer) != m_buffer.size()) {
+            return false;
+        }
+        m_bytes += m_buffer.size();
+        m_buffer.resize(0);
+        return true;
+    }
+
+    qint64 bytes() const { return m_bytes; }
+
+private:
+    QFile *m_file;
+    int m_chunkBytes;
+    QByteArray m_buffer;
+    QByteArray m_prefix;
+    qint64 m_prefixSecond = LLONG_MIN;
+    qint64 m_bytes = 0;
+};
+
+// 按记录时间折算进度，只在百分比变化时回调
+class ProgressReporter
+{
+public:
+    ProgressReporter(qint64 fromMs, qint64 toMs, const std::function<void(int)> &fn)
+        : m_fromMs(fromMs), m_spanMs(qMax<qint64>(1, toMs - fromMs)), m_fn(fn) {}
+
+    void update(qint64 timeMs)
+    {
+        if (!m_fn) {
+            return;
+        }
+        const int percent = int(qBound<qint64>(0, (timeMs - m_fromMs) * 100 / m_spanMs, 100));
+        if (percent != m_last) {
+            m_last = percent;
+            m_fn(percent);
+        }
+    }
+
+private:
+    qint64 m_fromMs;
+    qint64 m_spanMs;
+    std::function<void(int)> m_fn;
+    int m_last = -1;
+};
+
+// 从另一条临时连接结束导出连接上正在执行的查询；否则放弃只进游标时驱动要把剩余的行读完才能释放
+void killQuery(qint64 connectionId)
+{
+    const QString name = QString("telemetry_export_kill_%1").arg(connectionId);
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QMYSQL", name);
+        DBManager::configureConnection(db);
+        if (db.open()) {
+            QSqlQuery query(db);
+            if (!query.exec(QString("KILL QUERY %1").arg(connectionId))) {
+                qDebug() << "结束导出查询失败:" << query.lastError().text();
+            }
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(name);
+}
+
+bool exportMysql(const TelemetryExporter::Job &job, CsvChunkWriter &writer, const std::atomic<bool> &cancel,
+                 ProgressReporter &progress, TelemetryExporter::Result *result)
+{
+    QSqlDatabase db = DBManager::instance().threadConnection();
+    if (!db.isOpen()) {
+        result->error = QStringLiteral("数据库未连接");
+        return false;
+    }
+    QSqlQuery query(db);
+    qint64 connectionId = -1;
+    if (query.exec("SELECT CONNECTION_ID()") && query.next()) {
+        connectionId = query.value(0).toLongLong();
+    }
+
+    // 不用 prepare：参数都是整数，直接拼接
+    query.setForwardOnly(true);
+    if (!query.exec(QString("SELECT id, log_time_ms, speed, accel, dist FROM ship_logs "
+                            "WHERE vessel_id = %3 AND log_time_ms BETWEEN %1 AND %2 ORDER BY log_time_ms")
+                        .arg(job.fromMs).arg(job.toMs).arg(job.vesselId))) {
+        result->error = query.lastError().text();
+        return false;
+    }
+    LogRow row;
+    bool writeOk = true;
+    while (!cancel && query.next()) {
+        row.id = query.value(0).toInt();
+        row.timeMs = query.value(1).toLongLong();
+        row.speed = query.value(2).toDouble();
+        row.accel = query.value(3).toDouble();
+        row.dist = query.value(4).toDouble();
+        if (!writer.append(row)) {
+            writeOk = false;
+            break;
+        }
+        result->rows++;
+        progress.update(row.timeMs);
+    }
+    if (cancel || !writeOk) {
+        if (connectionId >= 0) {
+            killQuery(connectionId);
+        }
+        query.finish();
+        return false;
+    }
+    if (query.lastError().isValid()) {
+        result->error = query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool exportEmbedded(const TelemetryExporter::Job &job, TsdbStore *store, CsvChunkWriter &writer,
+                    const std::atomic<bool> &cancel, ProgressReporter &progress, TelemetryExporter::Result *result)
+{
+    qint64 afterId = 0;
+    while (!cancel) {
+        const QVector<LogRow> rows = store->rowsInRange(job.fromMs, job.toMs, afterId, EMBEDDED_BATCH_ROWS);
+        for (const LogRow &row : rows) {
+            if (!writer.append(row)) {
+                return false;
+            }
+        }
+        result->rows += rows.size();
+        if (rows.size() < EMBEDDED_BATCH_ROWS) {
+            return true;
+        }
+        afterId = rows.last().id;
+        progress.update(rows.last().timeMs);
+    }
+    return false;
+}
+
+} // namespace
+
+TelemetryExporter::TelemetryExporter(QObject *parent)
+    : QObject{parent}
+{
+}
+
+TelemetryExporter::~TelemetryExporter()
+{
+    if (m_thread) {
+        m_cancel = true;
+        m_thread->wait();
+    }
+}
+
+bool TelemetryExporter::start(const Job &job)
+{
+    if (m_thread) {
+        return false;
+    }
+    m_cancel = false;
+    QSharedPointer<Result> result(new Result);
+
+    m_thread = QThread::create([=](){
+        *result = exportRange(job, m_cancel, [=](int percent){
+            QMetaObject::invokeMethod(this, [=](){ emit progress(percent); }, Qt::QueuedConnection);
+        });
+    });
+    connect(m_thread, &QThread::finished, this, [=](){
+        m_thread->deleteLater();
+        m_thread = nullptr;
+        emit finished(result->ok, result->rows, job.outPath, result->error);
+    });
+    m_thread->start(QThread::LowPriority);
+    return true;
+}
+
+void TelemetryExporter::cancel()
+{
+    m_cancel = true;
+}
+
+TelemetryExporter::Result TelemetryExporter::exportRange(const Job &job, const std::atomic<bool> &cancel,
+                                                         const std::function<void(int)> &progress)
+{
+    Result result;
+    if (job.toMs < job.fromMs) {
+        result.error = QStringLiteral("结束时间早于开始时间");
+        return result;
+    }
+    TsdbStore *store = job.store ? job.store : DBManager::instance().embeddedStore(job.vesselId);
+    QSettings settings(QCoreApplication::applicationDirPath() + "/config.ini", QSettings::IniFormat);
+    const int chunkBytes = qBound(16, settings.value("Database/ExportChunkKb", 1024).toInt(), 65536) * 1024;
+
+    QDir().mkpath(QFileInfo(job.outPath).absolutePath());
+    const QString partPath = job.outPath + ".part";
+    QFile file(partPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        result.error = file.errorString();
+        return result;
+    }
+    CsvChunkWriter writer(&file, chunkBytes);
+    ProgressReporter reporter(job.fromMs, job.toMs, progress);
+    const bool ok = store ? exportEmbedded(job, store, writer, cancel, reporter, &result)
+                          : exportMysql(job, writer, cancel, reporter, &result);
+
+    if (cancel) {
+        result.error = QStringLiteral("已取消");
+    } else if (ok && !writer.flush()) {
+        result.error = file.errorString();
+    } else if (!ok && result.error.isEmpty()) {
+        result.error = file.errorString();
+    }
+    file.close();
+    if (cancel || !result.error.isEmpty()) {
+        QFile::remove(partPath);
+        return result;
+    }
+    QFile::remove(job.outPath);
+    if (!QFile::rename(partPath, job.outPath)) {
+        QFile::remove(partPath);
+        result.error = QStringLiteral("cannot rename to %1").arg(job.outPath);
+        return result;
+    }
+    result.bytes = writer.bytes();
+    result.ok = true;
+    if (progress) {
+        progress(100);
+    }
+    return result;
+}
@@ -0,0 +1,61 @@
+#ifndef TELEMETRYEXPORTER_H
+#define TELEMETRYEXPORTER_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <atomic>
+#include <functional>
+
+class TsdbStore;
+
+/**
+ * @brief 遥测历史批量导出 (后台任务)
+ * 把一条船 [fromMs, toMs] 内的遥测按时间顺序写成 CSV：id,time,time_ms,speed,accel,dist
+ *   mysql     只进游标 + 不预编译的语句，Qt 的 MySQL 驱动此时用 mysql_use_result 边读边取，
+ *             结果集不在客户端整个缓存 (预编译语句的结果总是整个取回)
+ *   embedded  从 TsdbStore 按 id 分批解码，每批只短暂持读锁，不影响同时写入
+ * 文本攒够 ExportChunkKb=1024 (config.ini [Database]) 后整块写出，内存占用与导出条数无关。
+ * 先写到 <文件>.part，完成后改名；取消或出错时删除。导出线程为低优先级，可随时取消。
+ */
+class TelemetryExporter : public QObject
+{
+    Q_OBJECT
+public:
+    struct Job {
+        qint64 fromMs = 0;
+        qint64 toMs = 0;
+        QString outPath;
+        int vesselId = 0;
+        TsdbStore *store = nullptr;     // 为空时按 DBManager 当前后端 (基准测试传入自己的存储)
+    };
+
+    struct Result {
+        bool ok = false;
+        qint64 rows = 0;
+        qint64 bytes = 0;
+        QString error;
+    };
+
+    explicit TelemetryExporter(QObject *parent = nullptr);
+    ~TelemetryExporter();
+
+    // 已有任务在运行时返回 false
+    bool start(const Job &job);
+    void cancel();
+    bool isRunning() const { return m_thread != nullptr; }
+
+    // 在调用线程同步导出；progress 为 0~100，只在百分比变化时调用
+    static Result exportRange(const Job &job, const std::atomic<bool> &cancel,
+                              const std::function<void(int)> &progress = std::function<void(int)>());
+
+signals:
+    void progress(int percent);
+    void finished(bool ok, qint64 rows, const QString &path, const QString &error);
+
+private:
+    QThread *m_thread = nullptr;
+    std::atomic<bool> m_cancel{false};
+};
+
+#endif // TELEMETRYEXPORTER_H
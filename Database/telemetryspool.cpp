@@ -0,0 +1,146 @@
+#include "telemetryspool.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QDebug>
+#include <cstring>
+
+TelemetrySpool::TelemetrySpool(const QString &path, qint64 maxBytes)
+    : m_file(path)
+    , m_maxBytes(maxBytes)
+{
+}
+
+bool TelemetrySpool::open()
+{
+    QDir().mkpath(QFileInfo(m_file.fileName()).absolutePath());
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qDebug() << "遥测暂存文件打开失败:" << m_file.errorString();
+        return false;
+    }
+
+    SpoolFormat::Header header;
+    if (m_file.read(reinterpret_cast<char *>(&header), sizeof(header)) != qint64(sizeof(header))
+        || std::memcmp(header.magic, SpoolFormat::MAGIC, sizeof(header.magic)) != 0
+        || header.readOffset < qint64(sizeof(header)) || header.readOffset > m_file.size()) {
+        m_file.resize(0);
+        m_readOffset = m_size = sizeof(header);
+        return writeHeader();
+    }
+
+    // 从读位置起校验一遍，截掉末尾写了一半的记录
+    m_readOffset = header.readOffset;
+    m_size = m_readOffset;
+    m_file.seek(m_readOffset);
+    TelemetryRow row;
+    while (readRecord(&row)) {
+        m_size = m_file.pos();
+    }
+    if (m_size < m_file.size()) {
+        qDebug() << "遥测暂存文件末尾不完整，截掉" << m_file.size() - m_size << "字节";
+        m_file.resize(m_size);
+    }
+    if (pendingBytes() > 0) {
+        qDebug() << "遥测暂存文件中有" << pendingBytes() << "字节待补写入库";
+    }
+    return true;
+}
+
+bool TelemetrySpool::writeHeader()
+{
+    SpoolFormat::Header header;
+    std::memcpy(header.magic, SpoolFormat::MAGIC, sizeof(header.magic));
+    header.readOffset = m_readOffset;
+    return m_file.seek(0)
+           && m_file.write(reinterpret_cast<const char *>(&header), sizeof(header)) == qint64(sizeof(header))
+           && m_file.flush();
+}
+
+qint64 TelemetrySpool::pendingBytes() const
+{
+    return m_size - m_readOffset;
+}
+
+bool TelemetrySpool::readRecord(TelemetryRow *row)
+{
+    SpoolFormat::Record record;
+    if (m_file.read(reinterpret_cast<char *>(&record), sizeof(record)) != qint64(sizeof(record))
+        || record.frameCount > SpoolFormat::MAX_FRAMES) {
+        return false;
+    }
+    row->timeMs = record.timeMs;
+    row->speed = record.speed;
+    row->accel = record.accel;
+    row->dist = record.dist;
+    row->frames.resize(int(record.frameCount));
+    for (LogFrameLink &link : row->frames) {
+        SpoolFormat::Frame frame;
+        if (m_file.read(reinterpret_cast<char *>(&frame), sizeof(frame)) != qint64(sizeof(frame))) {
+            return false;
+        }
+        link.camId = frame.camId;
+        link.seq = frame.seq;
+        link.frameMs = frame.frameMs;
+    }
+    return true;
+}
+
+bool TelemetrySpool::append(const QVector<TelemetryRow> &rows)
+{
+    if (!m_file.isOpen()) {
+        return false;
+    }
+    QByteArray bytes;
+    for (const TelemetryRow &row : rows) {
+        SpoolFormat::Record record;
+        record.timeMs = row.timeMs;
+        record.speed = row.speed;
+        record.accel = row.accel;
+        record.dist = row.dist;
+        record.frameCount = quint32(qMin(row.frames.size(), int(SpoolFormat::MAX_FRAMES)));
+        bytes.append(reinterpret_cast<const char *>(&record), sizeof(record));
+        for (quint32 i = 0; i < record.frameCount; i++) {
+            const LogFrameLink &link = row.frames[int(i)];
+            SpoolFormat::Frame frame;
+            frame.camId = link.camId;
+            frame.seq = link.seq;
+            frame.frameMs = link.frameMs;
+            bytes.append(reinterpret_cast<const char *>(&frame), sizeof(frame));
+        }
+    }
+    if (pendingBytes() + bytes.size() > m_maxBytes) {
+        return false;
+    }
+    if (!m_file.seek(m_size) || m_file.write(bytes) != bytes.size() || !m_file.flush()) {
+        qDebug() << "遥测暂存写入失败:" << m_file.errorString();
+        m_file.resize(m_size);
+        return false;
+    }
+    m_size += bytes.size();
+    return true;
+}
+
+QVector<TelemetryRow> TelemetrySpool::peek(int maxRows, qint64 *nextOffset)
+{
+    QVector<TelemetryRow> rows;
+    *nextOffset = m_readOffset;
+    if (!m_file.isOpen() || !m_file.seek(m_readOffset)) {
+        return rows;
+    }
+    TelemetryRow row;
+    while (rows.size() < maxRows && m_file.pos() < m_size && readRecord(&row)) {
+        rows.append(row);
+        *nextOffset = m_file.pos();
+    }
+    return rows;
+}
+
+bool TelemetrySpool::commit(qint64 nextOffset)
+{
+    m_readOffset = qBound(m_readOffset, nextOffset, m_size);
+    if (m_readOffset == m_size) {
+        // 全部补完：截断，文件不会一直变大
+        m_readOffset = m_size = sizeof(SpoolFormat::Header);
+        m_file.resize(m_size);
+    }
+    return writeHeader();
+}
@@ -0,0 +1,70 @@
+#ifndef TELEMETRYSPOOL_H
+#define TELEMETRYSPOOL_H
+
+#include <QFile>
+#include "telemetrywriter.h"
+
+/**
+ * @brief 数据库不可用期间的遥测暂存文件
+ * 文件头 + 只追加的记录；文件头里的 readOffset 指向第一条尚未补写入库的记录，
+ * 每补写一批推进一次，全部补完后截断文件。中途退出或掉电时最多重复补写最后一批。
+ * 只在遥测写线程使用，不加锁。
+ */
+namespace SpoolFormat {
+
+static const char MAGIC[8] = {'U', 'V', 'S', 'S', 'P', 'O', 'O', 'L'};
+static const quint32 MAX_FRAMES = 64;   // 单条记录关联帧数上限，超过视为损坏
+
+#pragma pack(push, 1)
+struct Header {
+    char magic[8];
+    qint64 readOffset;
+};
+
+struct Record {
+    qint64 timeMs;
+    double speed;
+    double accel;
+    double dist;
+    quint32 frameCount;     // 后接 frameCount 个 Frame
+};
+
+struct Frame {
+    qint32 camId;
+    quint64 seq;
+    qint64 frameMs;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(Header) == 16, "SpoolFormat::Header layout");
+static_assert(sizeof(Record) == 36, "SpoolFormat::Record layout");
+static_assert(sizeof(Frame) == 20, "SpoolFormat::Frame layout");
+
+} // namespace SpoolFormat
+
+class TelemetrySpool
+{
+public:
+    TelemetrySpool(const QString &path, qint64 maxBytes);
+
+    bool open();
+    // 超过 maxBytes 时不写并返回 false
+    bool append(const QVector<TelemetryRow> &rows);
+    // 从读位置起最多 maxRows 条，不移动读位置；nextOffset 为这批之后的位置
+    QVector<TelemetryRow> peek(int maxRows, qint64 *nextOffset);
+    // 这批已入库：推进读位置，全部读完时清空文件
+    bool commit(qint64 nextOffset);
+    bool isEmpty() const { return pendingBytes() == 0; }
+    qint64 pendingBytes() const;
+
+private:
+    QFile m_file;
+    qint64 m_maxBytes;
+    qint64 m_readOffset = sizeof(SpoolFormat::Header);
+    qint64 m_size = 0;      // 最后一条完整记录之后的位置
+
+    bool writeHeader();
+    bool readRecord(TelemetryRow *row);
+};
+
+#endif // TELEMETRYSPOOL_H
@@ -0,0 +1,593 @@
+#include "telemetrywriter.h"
+#include "tsdbstore.h"
+#include "telemetryspool.h"
+#include <QCoreApplication>
+#include <QSettings>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QMap>
+#include <QSqlError>
+#include <QDebug>
+#include <climits>
+
+static const int RATE_WINDOW_MS = 5000;     // rowsPerSec 的统计窗口
+static const qint64 PARTITION_CHECK_MS = 6 * 3600 * 1000;
+static const int MAX_REPLAY_REJECTS = 3;    // 同一批暂存记录连续被数据库拒绝的次数上限
+
+static int readQueueCapacity()
+{
+    QSettings settings(QCoreApplication::applicationDirPath() + "/config.ini", QSettings::IniFormat);
+    return qBound(64, settings.value("Database/WriterQueueCapacity", 4096).toInt(), 1 << 20);
+}
+
+TelemetryWriter::TelemetryWriter(int vesselId, QObject *parent)
+    : QObject{parent}
+    , m_vesselId(vesselId)
+    , m_queue(readQueueCapacity())
+{
+    QSettings settings(QCoreApplication::applicationDirPath() + "/config.ini", QSettings::IniFormat);
+    settings.beginGroup("Database");
+    // 批大小取 2 的幂，正好对应一条预编译语句
+    int batch = qBound(1, settings.value("WriterBatchRows", 256).toInt(), 4096);
+    m_batchRows = 1;
+    while (m_batchRows * 2 <= batch) {
+        m_batchRows *= 2;
+    }
+    m_flushIntervalMs = qMax(50, settings.value("WriterFlushMs", 1000).toInt());
+    m_replayRows = qMax(m_batchRows, settings.value("SpoolReplayRows", 1024).toInt());
+    m_maxRetryDelayMs = qBound(1, settings.value("ReconnectMaxSec", 30).toInt(), 3600) * 1000;
+    // 0 号船沿用单船版本的暂存文件名，升级前没补写完的记录照常补写
+    const QString spoolPath = settings.value("SpoolDir", QCoreApplication::applicationDirPath() + "/spool").toString()
+                              + (vesselId == 0 ? QString("/telemetry.spool")
+                                               : QString("/telemetry_vessel_%1.spool").arg(vesselId));
+    const qint64 spoolMaxBytes = qMax<qint64>(1, settings.value("SpoolMaxMb", 256).toLongLong()) << 20;
+    settings.endGroup();
+
+    m_worker = new QObject;
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread.setObjectName(QString("TelemetryWriter-%1").arg(vesselId));
+    m_thread.start();
+
+    // 连接、暂存文件和定时器都属于写线程
+    QMetaObject::invokeMethod(m_worker, [=](){
+        m_rateWindowStartMs = QDateTime::currentMSecsSinceEpoch();
+        if (!DBManager::instance().embeddedStore(m_vesselId)) {
+            m_spool = new TelemetrySpool(spoolPath, spoolMaxBytes);
+            if (!m_spool->open()) {
+                delete m_spool;
+                m_spool = nullptr;
+            }
+            m_badSpool = new TelemetrySpool(spoolPath + ".bad", spoolMaxBytes);
+            if (!m_badSpool->open()) {
+                delete m_badSpool;
+                m_badSpool = nullptr;
+            }
+        }
+        ensureOpen();
+        QTimer *timer = new QTimer(m_worker);
+        connect(timer, &QTimer::timeout, m_worker, [=](){ flush(); });
+        timer->start(m_flushIntervalMs);
+    }, Qt::QueuedConnection);
+}
+
+TelemetryWriter::~TelemetryWriter()
+{
+    // 写完队列中剩余的记录 (写不进数据库的留在暂存文件，下次启动补写)
+    QMetaObject::invokeMethod(m_worker, [=](){
+        flush();
+        closeConnection();
+        delete m_spool;
+        m_spool = nullptr;
+        delete m_badSpool;
+        m_badSpool = nullptr;
+    }, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+bool TelemetryWriter::submit(const TelemetryRow &row)
+{
+    if (!m_queue.push(row)) {
+        m_dropped++;
+        return false;
+    }
+    // 攒够一批立即写，不等定时器；已经排了一次就不重复排
+    if (m_queue.size() >= m_batchRows && !m_flushScheduled.exchange(true)) {
+        QMetaObject::invokeMethod(m_worker, [=](){ flush(); }, Qt::QueuedConnection);
+    }
+    return true;
+}
+
+TelemetryWriter::Stats TelemetryWriter::stats() const
+{
+    QMutexLocker locker(&m_statsMutex);
+    Stats stats = m_stats;
+    stats.queueDepth = m_queue.size();
+    stats.rowsDropped = m_dropped.load();
+    return stats;
+}
+
+// ==========================================
+// 以下在写线程执行
+// ==========================================
+bool TelemetryWriter::ensureOpen()
+{
+    if (DBManager::instance().embeddedStore(m_vesselId)) {
+        return true;
+    }
+    bool reopened = false;
+    QSqlDatabase db = DBManager::instance().threadConnection(&reopened);
+    if (!db.isOpen()) {
+        // 退避期内不重连，否则每次写都要阻塞一个连接超时
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        if (now < m_retryAtMs) {
+            return false;
+        }
+        if (!DBManager::instance().connectToDb()) {
+            m_retryDelayMs = m_retryDelayMs == 0 ? 1000 : qMin(m_retryDelayMs * 2, m_maxRetryDelayMs);
+            m_retryAtMs = now + m_retryDelayMs;
+            qDebug() << "遥测写入连接失败，" << m_retryDelayMs / 1000 << "秒后重试";
+            setConnected(false);
+            return false;
+        }
+        db = DBManager::instance().threadConnection(&reopened);
+        if (!db.isOpen()) {
+            return false;   // 连接池已满
+        }
+    }
+    // 连接重建过 (重连、健康检查失败或空闲关闭)，旧的预编译语句不能再用
+    if (reopened) {
+        clearStatements();
+    }
+    m_db = db;
+    m_retryDelayMs = 0;
+    m_retryAtMs = 0;
+    // 长时间运行时提前建好下个月的分区 (表结构在 connectToDb 时已就绪)
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now - m_partitionCheckMs >= PARTITION_CHECK_MS) {
+        m_partitionCheckMs = now;
+        DBManager::ensurePartitions(m_db);
+    }
+    setConnected(true);
+    return true;
+}
+
+void TelemetryWriter::setConnected(bool connected)
+{
+    if (m_connState == int(connected)) {
+        return;
+    }
+    m_connState = int(connected);
+    {
+        QMutexLocker locker(&m_statsMutex);
+        m_stats.connected = connected;
+    }
+    emit connectionChanged(connected);
+}
+
+void TelemetryWriter::clearStatements()
+{
+    delete m_idQuery;
+    m_idQuery = nullptr;
+    qDeleteAll(m_logStatements);
+    qDeleteAll(m_frameStatements);
+    qDeleteAll(m_rollupStatements);
+    m_logStatements.clear();
+    m_frameStatements.clear();
+    m_rollupStatements.clear();
+}
+
+void TelemetryWriter::closeConnection()
+{
+    clearStatements();
+    m_db = QSqlDatabase();
+    DBManager::instance().releaseThreadConnection();
+}
+
+void TelemetryWriter::flush()
+{
+    m_flushScheduled = false;
+    // 先补写暂存记录：暂存的都比队列里的早，先入库才能让 id 顺序与时间顺序一致
+    replaySpool(m_replayRows);
+    int queuedBehind = 0;
+    while (m_queue.size() > 0) {
+        QVector<TelemetryRow> rows;
+        rows.reserve(m_batchRows);
+        TelemetryRow row;
+        while (rows.size() < m_batchRows && m_queue.pop(&row)) {
+            rows.append(row);
+        }
+
+        QElapsedTimer cost;
+        cost.start();
+        int firstId = 0;
+        int lastId = 0;
+        bool ok = false;
+        // 暂存还没补完时实时记录排到暂存文件末尾，按原顺序补写
+        bool spooled = m_spool && !m_spool->isEmpty() && m_spool->append(rows);
+        if (spooled) {
+            queuedBehind += rows.size();
+        } else {
+            ok = writeBatch(rows, &firstId, &lastId);
+            // 写不进数据库的转存，队列里剩下的也会依次转存 (退避期内 ensureOpen 直接返回)
+            spooled = !ok && m_spool && m_spool->append(rows);
+        }
+        qint64 us = cost.nsecsElapsed() / 1000;
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        {
+            QMutexLocker locker(&m_statsMutex);
+            if (ok) {
+                m_stats.rowsWritten += quint64(rows.size());
+                m_rateWindowRows += quint64(rows.size());
+            } else if (spooled) {
+                m_stats.rowsSpooled += quint64(rows.size());
+            } else {
+                m_stats.rowsFailed += quint64(rows.size());
+            }
+            m_stats.lastFlushUs = us;
+            m_stats.maxFlushUs = qMax(m_stats.maxFlushUs, us);
+            if (now - m_rateWindowStartMs >= RATE_WINDOW_MS) {
+                m_stats.rowsPerSec = m_rateWindowRows * 1000.0 / double(now - m_rateWindowStartMs);
+                m_rateWindowStartMs = now;
+                m_rateWindowRows = 0;
+            }
+        }
+        if (ok) {
+            emit batchWritten(rows.size(), us, firstId, lastId);
+        } else if (!spooled) {
+            // 无法转存时不在这里反复重试，剩余记录等下一次定时写
+            break;
+        }
+    }
+    // 排到暂存文件里的实时记录本次就补写，不受补写额度限制，暂存不会越积越多
+    if (queuedBehind > 0) {
+        replaySpool(queuedBehind);
+    }
+    if (m_spool) {
+        QMutexLocker locker(&m_statsMutex);
+        m_stats.spoolPendingBytes = m_spool->pendingBytes();
+    }
+}
+
+// 数据库恢复后按原顺序补写暂存记录，每次最多 budget 条。
+// 连接正常但同一批连续被拒绝 (数据本身写不进去) 时移到 .bad 文件，不让它堵住后面的记录
+void TelemetryWriter::replaySpool(int budget)
+{
+    if (!m_spool || m_spool->isEmpty() || !ensureOpen()) {
+        return;
+    }
+    while (budget > 0 && !m_spool->isEmpty()) {
+        qint64 nextOffset = 0;
+        const QVector<TelemetryRow> rows = m_spool->peek(qMin(m_batchRows, budget), &nextOffset);
+        if (rows.isEmpty()) {
+            qDebug() << "遥测暂存文件损坏，丢弃剩余" << m_spool->pendingBytes() << "字节";
+            m_spool->commit(LLONG_MAX);
+            break;
+        }
+        QElapsedTimer cost;
+        cost.start();
+        int firstId = 0;
+        int lastId = 0;
+        bool rejected = false;
+        if (!writeBatch(rows, &firstId, &lastId, &rejected)) {
+            if (!rejected) {
+                m_replayRejects = 0;
+                break;
+            }
+            if (++m_replayRejects < MAX_REPLAY_REJECTS) {
+                break;
+            }
+            m_replayRejects = 0;
+            const bool kept = m_badSpool && m_badSpool->append(rows);
+            qDebug() << "遥测暂存记录多次写入被拒绝，" << rows.size() << "条"
+                     << (kept ? "移到 .bad 文件" : "丢弃");
+            m_spool->commit(nextOffset);
+            QMutexLocker locker(&m_statsMutex);
+            m_stats.rowsFailed += quint64(rows.size());
+            budget -= rows.size();
+            continue;
+        }
+        m_replayRejects = 0;
+        m_spool->commit(nextOffset);
+        const qint64 us = cost.nsecsElapsed() / 1000;
+        {
+            QMutexLocker locker(&m_statsMutex);
+            m_stats.rowsWritten += quint64(rows.size());
+            m_stats.rowsReplayed += quint64(rows.size());
+        }
+        emit batchWritten(rows.size(), us, firstId, lastId);
+        budget -= rows.size();
+    }
+}
+
+// 取 rows 行的多行 INSERT (首次使用时预编译)
+QSqlQuery *TelemetryWriter::statement(QHash<int, QSqlQuery *> &cache, int rows, const QString &head,
+                                      const QString &tuple, const QString &tail)
+{
+    QSqlQuery *query = cache.value(rows);
+    if (query) {
+        return query;
+    }
+    QStringList tuples;
+    for (int i = 0; i < rows; i++) {
+        tuples << tuple;
+    }
+    query = new QSqlQuery(m_db);
+    if (!query->prepare(head + tuples.join(",") + tail)) {
+        qDebug() << "预编译失败:" << query->lastError().text();
+        delete query;
+        return nullptr;
+    }
+    cache.insert(rows, query);
+    return query;
+}
+
+// 本船 id >= firstId 的 rows 条记录即刚插入的这一块
+bool TelemetryWriter::readInsertedIds(qint64 firstId, int rows, QVector<qint64> *ids, QString *error)
+{
+    if (!m_idQuery) {
+        m_idQuery = new QSqlQuery(m_db);
+        if (!m_idQuery->prepare("SELECT id FROM ship_logs WHERE vessel_id = ? AND id >= ? ORDER BY id LIMIT ?")) {
+            *error = m_idQuery->lastError().text();
+            delete m_idQuery;
+            m_idQuery = nullptr;
+            return false;
+        }
+    }
+    m_idQuery->bindValue(0, m_vesselId);
+    m_idQuery->bindValue(1, firstId);
+    m_idQuery->bindValue(2, rows);
+    if (!m_idQuery->exec()) {
+        *error = m_idQuery->lastError().text();
+        return false;
+    }
+    ids->reserve(rows);
+    while (m_idQuery->next()) {
+        ids->append(m_idQuery->value(0).toLongLong());
+    }
+    m_idQuery->finish();
+    if (ids->size() != rows) {
+        *error = QString("读回的 id 数 %1 与插入行数 %2 不符").arg(ids->size()).arg(rows);
+        return false;
+    }
+    return true;
+}
+
+bool TelemetryWriter::writeBatch(const QVector<TelemetryRow> &batch, int *firstId, int *lastId, bool *rejected)
+{
+    if (batch.isEmpty()) {
+        return true;
+    }
+    // 原始记录和汇总用同一份过滤后的值
+    QVector<TelemetryRow> rows = batch;
+    for (TelemetryRow &row : rows) {
+        DBManager::sanitizeTelemetry(row.speed, row.accel, row.dist);
+    }
+
+    if (TsdbStore *store = DBManager::instance().embeddedStore(m_vesselId)) {
+        return writeEmbedded(store, rows, firstId, lastId);
+    }
+
+    if (!ensureOpen()) {
+        if (!m_failing) {
+            m_failing = true;
+            emit writeFailed("数据库不可用");
+        }
+        return false;
+    }
+
+    QString error;
+    bool ok = m_db.transaction();
+    // 按 2 的幂拆块：256 行以内最多用到 9 条不同的预编译语句
+    for (int done = 0, chunk = m_batchRows; ok && done < rows.size(); ) {
+        while (chunk > rows.size() - done) {
+            chunk /= 2;
+        }
+        QSqlQuery *logQuery = statement(m_logStatements, chunk,
+                                        "INSERT INTO ship_logs (vessel_id, log_time, log_time_ms, speed, accel, dist) VALUES ",
+                                        "(?, ?, ?, ?, ?, ?)");
+        if (!logQuery) {
+            ok = false;
+            break;
+        }
+        for (int i = 0; i < chunk; i++) {
+            const TelemetryRow &row = rows[done + i];
+            logQuery->bindValue(i * 6, m_vesselId);
+            logQuery->bindValue(i * 6 + 1, QDateTime::fromMSecsSinceEpoch(row.timeMs).toString("yyyy-MM-dd HH:mm:ss"));
+            logQuery->bindValue(i * 6 + 2, row.timeMs);
+            logQuery->bindValue(i * 6 + 3, row.speed);
+            logQuery->bindValue(i * 6 + 4, row.accel);
+            logQuery->bindValue(i * 6 + 5, row.dist);
+        }
+        if (!logQuery->exec()) {
+            error = logQuery->lastError().text();
+            ok = false;
+            break;
+        }
+
+        // 其他船的写线程同时插入时自增 id 可能穿插 (innodb_autoinc_lock_mode=2，或 auto_increment_increment>1)，
+        // 不能按 LAST_INSERT_ID 顺推：在事务内按本船读回这一块的 id (本船只有本线程写入，id 随行序递增)
+        QVector<qint64> ids;
+        if (!readInsertedIds(logQuery->lastInsertId().toLongLong(), chunk, &ids, &error)) {
+            ok = false;
+            break;
+        }
+        if (done == 0) {
+            *firstId = int(ids.first());
+        }
+        *lastId = int(ids.last());
+        struct Link { qint64 logId; LogFrameLink frame; };
+        QVector<Link> links;
+        for (int i = 0; i < chunk; i++) {
+            for (const LogFrameLink &frame : rows[done + i].frames) {
+                links.append({ids[i], frame});
+            }
+        }
+        for (int linkDone = 0, linkChunk = m_batchRows; ok && linkDone < links.size(); ) {
+            while (linkChunk > links.size() - linkDone) {
+                linkChunk /= 2;
+            }
+            QSqlQuery *frameQuery = statement(m_frameStatements, linkChunk,
+                                              "INSERT INTO ship_log_frames (log_id, cam_id, frame_seq, frame_time_ms) VALUES ",
+                                              "(?, ?, ?, ?)");
+            if (!frameQuery) {
+                ok = false;
+                break;
+            }
+            for (int i = 0; i < linkChunk; i++) {
+                const Link &link = links[linkDone + i];
+                frameQuery->bindValue(i * 4, link.logId);
+                frameQuery->bindValue(i * 4 + 1, link.frame.camId);
+                frameQuery->bindValue(i * 4 + 2, link.frame.seq);
+                frameQuery->bindValue(i * 4 + 3, link.frame.frameMs);
+            }
+            if (!frameQuery->exec()) {
+                error = frameQuery->lastError().text();
+                ok = false;
+                break;
+            }
+            linkDone += linkChunk;
+        }
+        done += chunk;
+    }
+    if (ok) {
+        ok = writeRollups(rows, &error);
+    }
+
+    if (ok && m_db.commit()) {
+        m_failing = false;
+        return true;
+    }
+    if (error.isEmpty()) {
+        error = m_db.lastError().text();
+    }
+    m_db.rollback();
+    qDebug() << "遥测批量写入失败:" << error;
+    // 连接仍然可用说明是这批数据被拒绝；否则连接已断开：丢掉预编译语句，下次重新连接
+    const bool alive = QSqlQuery(m_db).exec("SELECT 1");
+    if (alive) {
+        if (rejected) {
+            *rejected = true;
+        }
+    } else {
+        closeConnection();
+    }
+    if (!m_failing) {
+        m_failing = true;
+        emit writeFailed(error);
+    }
+    return false;
+}
+
+// 嵌入式存储：整批一次追加 (帧关联与汇总不适用)
+bool TelemetryWriter::writeEmbedded(TsdbStore *store, const QVector<TelemetryRow> &rows, int *firstId, int *lastId)
+{
+    QVector<TelemetrySample> samples;
+    samples.reserve(rows.size());
+    for (const TelemetryRow &row : rows) {
+        TelemetrySample sample;
+        sample.timeMs = row.timeMs;
+        sample.speed = row.speed;
+        sample.accel = row.accel;
+        sample.dist = row.dist;
+        samples.append(sample);
+    }
+    qint64 first = 0;
+    qint64 last = 0;
+    if (!store->append(samples, &first, &last)) {
+        if (!m_failing) {
+            m_failing = true;
+            emit writeFailed("嵌入式存储写入失败");
+        }
+        return false;
+    }
+    m_failing = false;
+    *firstId = int(first);
+    *lastId = int(last);
+    return true;
+}
+
+// 本批记录先在内存中按 (级别, 桶) 合并，每个桶只写一行
+bool TelemetryWriter::writeRollups(const QVector<TelemetryRow> &rows, QString *error)
+{
+    struct Agg {
+        int count = 0;
+        double speedMin = 0, speedMax = 0, speedSum = 0;
+        double accelMin = 0, accelMax = 0, accelSum = 0;
+        double distMin = 0, distMax = 0, distSum = 0;
+    };
+    QMap<QPair<int, qint64>, Agg> aggs;
+    for (const TelemetryRow &row : rows) {
+        for (int level = 0; level < ROLLUP_LEVELS; level++) {
+            qint64 bucket = row.timeMs - row.timeMs % ROLLUP_BUCKET_MS[level];
+            Agg &agg = aggs[qMakePair(level, bucket)];
+            if (agg.count == 0) {
+                agg.speedMin = agg.speedMax = row.speed;
+                agg.accelMin = agg.accelMax = row.accel;
+                agg.distMin = agg.distMax = row.dist;
+            }
+            agg.count++;
+            agg.speedMin = qMin(agg.speedMin, row.speed);
+            agg.speedMax = qMax(agg.speedMax, row.speed);
+            agg.speedSum += row.speed;
+            agg.accelMin = qMin(agg.accelMin, row.accel);
+            agg.accelMax = qMax(agg.accelMax, row.accel);
+            agg.accelSum += row.accel;
+            agg.distMin = qMin(agg.distMin, row.dist);
+            agg.distMax = qMax(agg.distMax, row.dist);
+            agg.distSum += row.dist;
+        }
+    }
+
+    const QList<QPair<int, qint64>> keys = aggs.keys();
+    for (int done = 0, chunk = m_batchRows; done < keys.size(); ) {
+        while (chunk > keys.size() - done) {
+            chunk /= 2;
+        }
+        QSqlQuery *query = statement(m_rollupStatements, chunk,
+                                     "INSERT INTO ship_log_rollups (vessel_id, level, bucket_ms, cnt, "
+                                     "speed_min, speed_max, speed_sum, accel_min, accel_max, accel_sum, "
+                                     "dist_min, dist_max, dist_sum) VALUES ",
+                                     "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)",
+                                     " ON DUPLICATE KEY UPDATE cnt = cnt + VALUES(cnt), "
+                                     "speed_min = LEAST(speed_min, VALUES(speed_min)), "
+                                     "speed_max = GREATEST(speed_max, VALUES(speed_max)), "
+                                     "speed_sum = speed_sum + VALUES(speed_sum), "
+                                     "accel_min = LEAST(accel_min, VALUES(accel_min)), "
+                                     "accel_max = GREATEST(accel_max, VALUES(accel_max)), "
+                                     "accel_sum = accel_sum + VALUES(accel_sum), "
+                                     "dist_min = LEAST(dist_min, VALUES(dist_min)), "
+                                     "dist_max = GREATEST(dist_max, VALUES(dist_max)), "
+                                     "dist_sum = dist_sum + VALUES(dist_sum)");
+        if (!query) {
+            return false;
+        }
+        for (int i = 0; i < chunk; i++) {
+            const QPair<int, qint64> &key = keys[done + i];
+            const Agg &agg = aggs[key];
+            const int base = i * 13;
+            query->bindValue(base, m_vesselId);
+            query->bindValue(base + 1, key.first);
+            query->bindValue(base + 2, key.second);
+            query->bindValue(base + 3, agg.count);
+            query->bindValue(base + 4, agg.speedMin);
+            query->bindValue(base + 5, agg.speedMax);
+            query->bindValue(base + 6, agg.speedSum);
+            query->bindValue(base + 7, agg.accelMin);
+            query->bindValue(base + 8, agg.accelMax);
+            query->bindValue(base + 9, agg.accelSum);
+            query->bindValue(base + 10, agg.distMin);
+            query->bindValue(base + 11, agg.distMax);
+            query->bindValue(base + 12, agg.distSum);
+        }
+        if (!query->exec()) {
+            *error = query->lastError().text();
+            return false;
+        }
+        done += chunk;
+    }
+    return true;
+}
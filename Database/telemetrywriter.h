@@ -0,0 +1,130 @@
+#ifndef TELEMETRYWRITER_H
+#define TELEMETRYWRITER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QHash>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <atomic>
+#include "dbmanager.h"
+#include "spscqueue.h"
+
+class TsdbStore;
+class TelemetrySpool;
+
+// 一条待写入的遥测记录
+struct TelemetryRow {
+    qint64 timeMs = 0;
+    double speed = 0;
+    double accel = 0;
+    double dist = 0;
+    QVector<LogFrameLink> frames;
+};
+
+/**
+ * @brief 遥测异步批量写入
+ * GUI 线程 submit() 只把记录放进无锁队列；写线程使用连接池中自己的连接，
+ * 攒够 WriterBatchRows 条或每隔 WriterFlushMs 把队列中的记录合成多行 INSERT，
+ * 一批一个事务。多行语句按 2 的幂行数预编译并复用，同一批拆成若干块执行。
+ * 同一事务内按各级桶宽合并这批记录，以 ON DUPLICATE KEY UPDATE 累加到 ship_log_rollups。
+ * 使用嵌入式后端 (DBManager::embeddedStore()) 时整批追加到该船的 TsdbStore，不建数据库连接。
+ * 每条船一个实例，各有自己的写线程和池中连接，多船并发写入互不等待
+ * (每个写线程长期占一条池连接，DataView 按船数调高连接池上限)；写线程每隔 6 小时补齐 ship_logs 的月分区。
+ *
+ * 数据库连不上或写入失败时，这批记录转存到本地暂存文件 (TelemetrySpool)，不丢弃；
+ * 重连按 1 秒起、每次翻倍、最长 ReconnectMaxSec 退避，退避期内直接转存，不阻塞在连接超时上。
+ * 连上后每次定时写先补写最多 SpoolReplayRows 条暂存记录 (按批、按原顺序)，暂存没补完时
+ * 实时记录接在暂存文件末尾一起补写，入库顺序 (即 id 顺序) 与时间顺序一致。
+ * 连接正常而同一批暂存记录连续被拒绝 3 次时，移到 <暂存文件>.bad 不再补写，避免堵住后面的记录。
+ * 连接状态变化时发出 connectionChanged()。
+ * 配置 (config.ini [Database])：
+ *   WriterBatchRows=256  WriterFlushMs=1000  WriterQueueCapacity=4096
+ *   SpoolDir=<程序目录>/spool  SpoolMaxMb=256  SpoolReplayRows=1024  ReconnectMaxSec=30
+ * 暂存文件：0 号船 telemetry.spool，其余 telemetry_vessel_<id>.spool。
+ * submit() 只能在一个线程调用 (单生产者)，其余函数线程安全。
+ */
+class TelemetryWriter : public QObject
+{
+    Q_OBJECT
+public:
+    struct Stats {
+        int queueDepth = 0;
+        quint64 rowsWritten = 0;
+        quint64 rowsDropped = 0;    // 队列满，未入队
+        quint64 rowsFailed = 0;     // 写库失败且暂存文件已满，整批丢弃
+        quint64 rowsSpooled = 0;    // 写库失败，转存到暂存文件
+        quint64 rowsReplayed = 0;   // 从暂存文件补写入库
+        qint64 spoolPendingBytes = 0;
+        bool connected = false;
+        qint64 lastFlushUs = 0;
+        qint64 maxFlushUs = 0;
+        double rowsPerSec = 0;      // 最近一段时间的平均写入速率
+    };
+
+    explicit TelemetryWriter(int vesselId = 0, QObject *parent = nullptr);
+    ~TelemetryWriter();
+
+    int vesselId() const { return m_vesselId; }
+
+    // 入队，队列满时返回 false (不阻塞)
+    bool submit(const TelemetryRow &row);
+    Stats stats() const;
+
+signals:
+    // 一批写入完成 (在写线程发出)，[firstId, lastId] 为这批记录在 ship_logs 中的 id 范围 (其中可能夹着其他船的 id)
+    void batchWritten(int rows, qint64 flushUs, int firstId, int lastId);
+    // 写库开始失败时发出一次，恢复之前不重复
+    void writeFailed(const QString &errorMsg);
+    // 写线程的数据库连接建立/断开 (在写线程发出)；连上时表结构已就绪
+    void connectionChanged(bool connected);
+
+private:
+    int m_vesselId = 0;
+    int m_batchRows = 256;
+    int m_flushIntervalMs = 1000;
+    SpscQueue<TelemetryRow> m_queue;
+    std::atomic<bool> m_flushScheduled{false};
+
+    mutable QMutex m_statsMutex;
+    Stats m_stats;
+    std::atomic<quint64> m_dropped{0};
+    qint64 m_rateWindowStartMs = 0;
+    quint64 m_rateWindowRows = 0;
+
+    // --- 写线程 ---
+    QThread m_thread;
+    QObject *m_worker;
+    QSqlDatabase m_db;                          // 取自连接池
+    QHash<int, QSqlQuery *> m_logStatements;     // 行数 -> 预编译的多行 INSERT
+    QHash<int, QSqlQuery *> m_frameStatements;
+    QHash<int, QSqlQuery *> m_rollupStatements;
+    QSqlQuery *m_idQuery = nullptr;             // 读回刚插入的 id
+    bool m_failing = false;
+    int m_connState = -1;               // -1 未知，0 断开，1 已连接
+    qint64 m_retryAtMs = 0;             // 退避期内不重连
+    int m_retryDelayMs = 0;
+    int m_maxRetryDelayMs = 30000;
+    TelemetrySpool *m_spool = nullptr;
+    TelemetrySpool *m_badSpool = nullptr;       // 被数据库拒绝的暂存记录，不再补写
+    int m_replayRows = 1024;
+    int m_replayRejects = 0;            // 暂存文件首批连续被拒绝的次数
+    qint64 m_partitionCheckMs = 0;      // 上次补齐分区的时间
+
+    void flush();
+    void replaySpool(int budget);
+    void setConnected(bool connected);
+    bool ensureOpen();
+    void closeConnection();
+    void clearStatements();
+    // 失败且连接仍可用 (这批数据被拒绝) 时 *rejected 置 true
+    bool writeBatch(const QVector<TelemetryRow> &batch, int *firstId, int *lastId, bool *rejected = nullptr);
+    bool readInsertedIds(qint64 firstId, int rows, QVector<qint64> *ids, QString *error);
+    bool writeEmbedded(TsdbStore *store, const QVector<TelemetryRow> &rows, int *firstId, int *lastId);
+    bool writeRollups(const QVector<TelemetryRow> &rows, QString *error);
+    QSqlQuery *statement(QHash<int, QSqlQuery *> &cache, int rows, const QString &head, const QString &tuple,
+                         const QString &tail = QString());
+};
+
+#endif // TELEMETRYWRITER_H
@@ -0,0 +1,667 @@
+#include "tsdbstore.h"
+#include <QDir>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QDebug>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// 高位在前的位流
+class BitWriter
+{
+public:
+    void write(quint64 value, int bits)
+    {
+        while (bits > 0) {
+            if (m_bitPos == 0) {
+                m_bytes.append(char(0));
+            }
+            const int space = 8 - m_bitPos;
+            const int take = qMin(space, bits);
+            const quint8 part = quint8((value >> (bits - take)) & ((1u << take) - 1));
+            m_bytes.data()[m_bytes.size() - 1] |= char(part << (space - take));
+            m_bitPos = (m_bitPos + take) & 7;
+            bits -= take;
+        }
+    }
+    const QByteArray &bytes() const { return m_bytes; }
+
+private:
+    QByteArray m_bytes;
+    int m_bitPos = 0;       // 最后一个字节已用的位数 (0 表示已写满)
+};
+
+class BitReader
+{
+public:
+    BitReader(const uchar *data, qint64 bytes) : m_data(data), m_bits(bytes * 8) {}
+
+    quint64 read(int bits)
+    {
+        if (m_pos + bits > m_bits) {
+            m_overrun = true;
+            m_pos = m_bits;
+            return 0;
+        }
+        quint64 value = 0;
+        while (bits > 0) {
+            const int offset = int(m_pos & 7);
+            const int avail = 8 - offset;
+            const int take = qMin(avail, bits);
+            const quint8 part = quint8((m_data[m_pos >> 3] >> (avail - take)) & ((1u << take) - 1));
+            value = (value << take) | part;
+            m_pos += take;
+            bits -= take;
+        }
+        return value;
+    }
+    bool overrun() const { return m_overrun; }
+
+private:
+    const uchar *m_data;
+    qint64 m_bits;
+    qint64 m_pos = 0;
+    bool m_overrun = false;
+};
+
+inline qint64 signExtend(quint64 value, int bits)
+{
+    return qint64(value << (64 - bits)) >> (64 - bits);
+}
+
+inline quint64 doubleBits(double v)
+{
+    quint64 bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+inline double bitsDouble(quint64 bits)
+{
+    double v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+// 二阶差分分档：控制位 0 / 10 / 110 / 1110 / 1111，后接对应位数的补码
+void encodeTimestamps(const QVector<TelemetrySample> &samples, BitWriter *out)
+{
+    qint64 prev = samples[0].timeMs;
+    qint64 prevDelta = 0;
+    out->write(quint64(prev), 64);
+    for (int i = 1; i < samples.size(); i++) {
+        const qint64 delta = samples[i].timeMs - prev;
+        const qint64 dod = delta - prevDelta;
+        if (dod == 0) {
+            out->write(0, 1);
+        } else if (dod >= -64 && dod <= 63) {
+            out->write(0x2, 2);
+            out->write(quint64(dod), 7);
+        } else if (dod >= -256 && dod <= 255) {
+            out->write(0x6, 3);
+            out->write(quint64(dod), 9);
+        } else if (dod >= -2048 && dod <= 2047) {
+            out->write(0xe, 4);
+            out->write(quint64(dod), 12);
+        } else {
+            out->write(0xf, 4);
+            out->write(quint64(dod), 64);
+        }
+        prev = samples[i].timeMs;
+        prevDelta = delta;
+    }
+}
+
+void decodeTimestamps(BitReader &in, TelemetrySample *out, int count)
+{
+    qint64 prev = qint64(in.read(64));
+    qint64 prevDelta = 0;
+    out[0].timeMs = prev;
+    for (int i = 1; i < count; i++) {
+        qint64 dod = 0;
+        if (in.read(1)) {
+            if (!in.read(1)) {
+                dod = signExtend(in.read(7), 7);
+            } else if (!in.read(1)) {
+                dod = signExtend(in.read(9), 9);
+            } else if (!in.read(1)) {
+                dod = signExtend(in.read(12), 12);
+            } else {
+                dod = qint64(in.read(64));
+            }
+        }
+        prevDelta += dod;
+        prev += prevDelta;
+        out[i].timeMs = prev;
+    }
+}
+
+// XOR 浮点压缩：与前值相同写 0；否则 1 + (0 沿用上次的有效位窗口 | 1 + 前导零 5 位 + 有效位数-1 6 位) + 有效位
+void encodeValues(const QVector<TelemetrySample> &samples, double TelemetrySample::*field, BitWriter *out)
+{
+    quint64 prev = doubleBits(samples[0].*field);
+    int prevLead = -1;
+    int prevTrail = 0;
+    out->write(prev, 64);
+    for (int i = 1; i < samples.size(); i++) {
+        const quint64 bits = doubleBits(samples[i].*field);
+        const quint64 x = bits ^ prev;
+        prev = bits;
+        if (x == 0) {
+            out->write(0, 1);
+            continue;
+        }
+        out->write(1, 1);
+        const int lead = qMin(31, int(qCountLeadingZeroBits(x)));
+        const int trail = int(qCountTrailingZeroBits(x));
+        if (prevLead >= 0 && lead >= prevLead && trail >= prevTrail) {
+            out->write(0, 1);
+            out->write(x >> prevTrail, 64 - prevLead - prevTrail);
+        } else {
+            const int significant = 64 - lead - trail;
+            out->write(1, 1);
+            out->write(quint64(lead), 5);
+            out->write(quint64(significant - 1), 6);
+            out->write(x >> trail, significant);
+            prevLead = lead;
+            prevTrail = trail;
+        }
+    }
+}
+
+void decodeValues(BitReader &in, TelemetrySample *out, int count, double TelemetrySample::*field)
+{
+    quint64 prev = in.read(64);
+    int lead = 0;
+    int trail = 0;
+    out[0].*field = bitsDouble(prev);
+    for (int i = 1; i < count; i++) {
+        if (in.read(1)) {
+            if (in.read(1)) {
+                lead = int(in.read(5));
+                trail = 64 - lead - (int(in.read(6)) + 1);
+            }
+            prev ^= in.read(64 - lead - trail) << trail;
+        }
+        out[i].*field = bitsDouble(prev);
+    }
+}
+
+double TelemetrySample::*const VALUE_FIELDS[TsdbFormat::COLUMNS - 1] = {
+    &TelemetrySample::speed, &TelemetrySample::accel, &TelemetrySample::dist
+};
+
+QByteArray encodeChunk(const QVector<TelemetrySample> &samples)
+{
+    BitWriter columns[TsdbFormat::COLUMNS];
+    encodeTimestamps(samples, &columns[0]);
+    for (int c = 1; c < TsdbFormat::COLUMNS; c++) {
+        encodeValues(samples, VALUE_FIELDS[c - 1], &columns[c]);
+    }
+
+    TsdbFormat::ChunkHeader header;
+    header.magic = TsdbFormat::CHUNK_MAGIC;
+    header.count = quint32(samples.size());
+    header.firstMs = samples.first().timeMs;
+    header.lastMs = samples.last().timeMs;
+    QByteArray chunk(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (int c = 0; c < TsdbFormat::COLUMNS; c++) {
+        header.columnBytes[c] = quint32(columns[c].bytes().size());
+        chunk.append(columns[c].bytes());
+    }
+    std::memcpy(chunk.data(), &header, sizeof(header));
+    return chunk;
+}
+
+LogRow toLogRow(qint64 id, const TelemetrySample &sample)
+{
+    LogRow row;
+    row.id = int(id);
+    row.timeMs = sample.timeMs;
+    row.speed = sample.speed;
+    row.accel = sample.accel;
+    row.dist = sample.dist;
+    return row;
+}
+
+} // namespace
+
+TsdbStore::TsdbStore(const QString &dir, int chunkSamples)
+    : m_dir(dir)
+    , m_chunkSamples(qBound(16, chunkSamples, 65536))
+{
+}
+
+TsdbStore::~TsdbStore()
+{
+    close();
+}
+
+bool TsdbStore::isOpen() const
+{
+    QReadLocker locker(&m_lock);
+    return m_dataFile.isOpen();
+}
+
+bool TsdbStore::open(QString *error)
+{
+    QWriteLocker locker(&m_lock);
+    if (m_dataFile.isOpen()) {
+        return true;
+    }
+    if (!QDir().mkpath(m_dir)) {
+        if (error) *error = QString("无法创建目录 %1").arg(m_dir);
+        return false;
+    }
+    m_dataFile.setFileName(m_dir + "/telemetry.tsd");
+    m_walFile.setFileName(m_dir + "/telemetry.wal");
+    if (!m_dataFile.open(QIODevice::ReadWrite) || !m_walFile.open(QIODevice::ReadWrite)) {
+        if (error) *error = QString("无法打开 %1").arg(m_dataFile.isOpen() ? m_walFile.fileName() : m_dataFile.fileName());
+        closeFiles();
+        return false;
+    }
+    if (!loadChunks(error)) {
+        closeFiles();
+        return false;
+    }
+    replayWal();
+    remap();
+    return true;
+}
+
+void TsdbStore::close()
+{
+    QWriteLocker locker(&m_lock);
+    if (!m_dataFile.isOpen()) {
+        return;
+    }
+    // 不足一块的记录也封存，下次启动不必重放
+    if (!m_active.isEmpty() && sealActive()) {
+        rewriteWal();
+    }
+    closeFiles();
+}
+
+void TsdbStore::closeFiles()
+{
+    if (m_map) {
+        m_dataFile.unmap(m_map);
+        m_map = nullptr;
+        m_mapSize = 0;
+    }
+    m_dataFile.close();
+    m_walFile.close();
+    m_chunks.clear();
+    m_active.clear();
+    m_count = 0;
+    m_lastMs = LLONG_MIN;
+}
+
+// 逐块读取块头建立索引；末尾不完整的块 (写到一半掉电) 截掉
+bool TsdbStore::loadChunks(QString *error)
+{
+    TsdbFormat::FileHeader fileHeader;
+    if (m_dataFile.size() == 0) {
+        std::memcpy(fileHeader.magic, TsdbFormat::MAGIC, sizeof(fileHeader.magic));
+        fileHeader.version = TsdbFormat::VERSION;
+        fileHeader.reserved = 0;
+        if (m_dataFile.write(reinterpret_cast<const char *>(&fileHeader), sizeof(fileHeader)) != qint64(sizeof(fileHeader))
+            || !m_dataFile.flush()) {
+            if (error) *error = m_dataFile.errorString();
+            return false;
+        }
+        return true;
+    }
+    if (m_dataFile.read(reinterpret_cast<char *>(&fileHeader), sizeof(fileHeader)) != qint64(sizeof(fileHeader))
+        || std::memcmp(fileHeader.magic, TsdbFormat::MAGIC, sizeof(fileHeader.magic)) != 0
+        || fileHeader.version != TsdbFormat::VERSION) {
+        if (error) *error = QString("%1 不是遥测数据文件").arg(m_dataFile.fileName());
+        return false;
+    }
+
+    const qint64 size = m_dataFile.size();
+    qint64 pos = sizeof(fileHeader);
+    while (pos + qint64(sizeof(TsdbFormat::ChunkHeader)) <= size) {
+        TsdbFormat::ChunkHeader header;
+        if (!m_dataFile.seek(pos)
+            || m_dataFile.read(reinterpret_cast<char *>(&header), sizeof(header)) != qint64(sizeof(header))
+            || header.magic != TsdbFormat::CHUNK_MAGIC || header.count == 0) {
+            break;
+        }
+        qint64 bytes = sizeof(header);
+        for (int c = 0; c < TsdbFormat::COLUMNS; c++) {
+            bytes += header.columnBytes[c];
+        }
+        if (pos + bytes > size) {
+            break;
+        }
+        ChunkInfo chunk;
+        chunk.offset = pos;
+        chunk.firstMs = header.firstMs;
+        chunk.lastMs = header.lastMs;
+        chunk.firstId = m_count + 1;
+        chunk.count = int(header.count);
+        m_chunks.append(chunk);
+        m_count += chunk.count;
+        m_lastMs = chunk.lastMs;
+        pos += bytes;
+    }
+    if (pos < size) {
+        qWarning() << "遥测数据文件末尾不完整，截掉" << size - pos << "字节";
+        m_dataFile.resize(pos);
+    }
+    return true;
+}
+
+// 把 .wal 中尚未封存的记录放回内存
+void TsdbStore::replayWal()
+{
+    TsdbFormat::WalHeader header;
+    m_walFile.seek(0);
+    if (m_walFile.read(reinterpret_cast<char *>(&header), sizeof(header)) != qint64(sizeof(header))
+        || std::memcmp(header.magic, TsdbFormat::WAL_MAGIC, sizeof(header.magic)) != 0) {
+        rewriteWal();
+        return;
+    }
+    const QByteArray bytes = m_walFile.readAll();
+    const int records = bytes.size() / int(sizeof(TelemetrySample));
+    const TelemetrySample *samples = reinterpret_cast<const TelemetrySample *>(bytes.constData());
+    // 封块后、清空 .wal 前掉电时，开头的部分已在数据文件中
+    const int skip = int(qBound<qint64>(0, m_count + 1 - header.firstId, records));
+    for (int i = skip; i < records; i++) {
+        TelemetrySample sample = samples[i];
+        sample.timeMs = qMax(sample.timeMs, m_lastMs);
+        m_active.append(sample);
+        m_lastMs = sample.timeMs;
+        m_count++;
+    }
+    if (skip > 0 || bytes.size() % int(sizeof(TelemetrySample)) != 0) {
+        rewriteWal();
+    }
+}
+
+bool TsdbStore::rewriteWal()
+{
+    TsdbFormat::WalHeader header;
+    std::memcpy(header.magic, TsdbFormat::WAL_MAGIC, sizeof(header.magic));
+    header.firstId = m_count - m_active.size() + 1;
+    m_walFile.resize(0);
+    m_walFile.seek(0);
+    bool ok = m_walFile.write(reinterpret_cast<const char *>(&header), sizeof(header)) == qint64(sizeof(header));
+    if (ok && !m_active.isEmpty()) {
+        const qint64 bytes = qint64(m_active.size()) * qint64(sizeof(TelemetrySample));
+        ok = m_walFile.write(reinterpret_cast<const char *>(m_active.constData()), bytes) == bytes;
+    }
+    return m_walFile.flush() && ok;
+}
+
+// 把内存中的记录压缩成一块追加到数据文件
+bool TsdbStore::sealActive()
+{
+    const QByteArray chunk = encodeChunk(m_active);
+    const qint64 pos = m_dataFile.size();
+    if (!m_dataFile.seek(pos) || m_dataFile.write(chunk) != chunk.size() || !m_dataFile.flush()) {
+        qWarning() << "遥测数据块写入失败:" << m_dataFile.errorString();
+        m_dataFile.resize(pos);
+        return false;
+    }
+    ChunkInfo info;
+    info.offset = pos;
+    info.firstMs = m_active.first().timeMs;
+    info.lastMs = m_active.last().timeMs;
+    info.firstId = m_count - m_active.size() + 1;
+    info.count = m_active.size();
+    m_chunks.append(info);
+    m_active.clear();
+    remap();
+    return true;
+}
+
+void TsdbStore::remap()
+{
+    if (m_map) {
+        m_dataFile.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_mapSize = m_dataFile.size();
+    m_map = m_dataFile.map(0, m_mapSize);
+    if (!m_map) {
+        qWarning() << "遥测数据文件映射失败:" << m_dataFile.errorString();
+        m_mapSize = 0;
+    }
+}
+
+bool TsdbStore::append(const QVector<TelemetrySample> &samples, qint64 *firstId, qint64 *lastId)
+{
+    QWriteLocker locker(&m_lock);
+    if (!m_dataFile.isOpen()) {
+        return false;
+    }
+    if (samples.isEmpty()) {
+        return true;
+    }
+
+    QVector<TelemetrySample> ordered = samples;
+    qint64 lastMs = m_lastMs;
+    for (TelemetrySample &sample : ordered) {
+        sample.timeMs = qMax(sample.timeMs, lastMs);
+        lastMs = sample.timeMs;
+    }
+
+    // 先写 .wal，再放进内存
+    const qint64 bytes = qint64(ordered.size()) * qint64(sizeof(TelemetrySample));
+    if (!m_walFile.seek(m_walFile.size())
+        || m_walFile.write(reinterpret_cast<const char *>(ordered.constData()), bytes) != bytes
+        || !m_walFile.flush()) {
+        qWarning() << "遥测日志写入失败:" << m_walFile.errorString();
+        return false;
+    }
+
+    if (firstId) *firstId = m_count + 1;
+    bool sealed = false;
+    for (const TelemetrySample &sample : ordered) {
+        m_active.append(sample);
+        m_count++;
+        if (m_active.size() >= m_chunkSamples) {
+            sealed = sealActive() || sealed;
+        }
+    }
+    m_lastMs = lastMs;
+    if (lastId) *lastId = m_count;
+    // 封块写入失败时记录仍在内存和 .wal 中，下次写满时再试
+    if (sealed) {
+        rewriteWal();
+    }
+    return true;
+}
+
+void TsdbStore::decodeChunk(const ChunkInfo &chunk, QVector<TelemetrySample> *out) const
+{
+    if (!m_map || chunk.offset + qint64(sizeof(TsdbFormat::ChunkHeader)) > m_mapSize) {
+        return;
+    }
+    TsdbFormat::ChunkHeader header;
+    std::memcpy(&header, m_map + chunk.offset, sizeof(header));
+
+    const int base = out->size();
+    out->resize(base + chunk.count);
+    TelemetrySample *samples = out->data() + base;
+    const uchar *column = m_map + chunk.offset + sizeof(header);
+    bool ok = true;
+    for (int c = 0; c < TsdbFormat::COLUMNS && ok; c++) {
+        if (column + header.columnBytes[c] > m_map + m_mapSize) {
+            ok = false;
+            break;
+        }
+        BitReader reader(column, header.columnBytes[c]);
+        if (c == 0) {
+            decodeTimestamps(reader, samples, chunk.count);
+        } else {
+            decodeValues(reader, samples, chunk.count, VALUE_FIELDS[c - 1]);
+        }
+        ok = !reader.overrun();
+        column += header.columnBytes[c];
+    }
+    if (!ok) {
+        qWarning() << "遥测数据块损坏，偏移" << chunk.offset;
+        out->resize(base);
+    }
+}
+
+QVector<TelemetrySample> TsdbStore::range(qint64 fromMs, qint64 toMs) const
+{
+    QReadLocker locker(&m_lock);
+    QVector<TelemetrySample> result;
+    if (fromMs > toMs) {
+        return result;
+    }
+    // 第一个 lastMs >= fromMs 的块起，到 firstMs > toMs 为止
+    auto it = std::lower_bound(m_chunks.constBegin(), m_chunks.constEnd(), fromMs,
+                               [](const ChunkInfo &chunk, qint64 ms) { return chunk.lastMs < ms; });
+    QVector<TelemetrySample> decoded;
+    for (; it != m_chunks.constEnd() && it->firstMs <= toMs; ++it) {
+        decoded.clear();
+        decodeChunk(*it, &decoded);
+        for (const TelemetrySample &sample : decoded) {
+            if (sample.timeMs >= fromMs && sample.timeMs <= toMs) {
+                result.append(sample);
+            }
+        }
+    }
+    for (const TelemetrySample &sample : m_active) {
+        if (sample.timeMs >= fromMs && sample.timeMs <= toMs) {
+            result.append(sample);
+        }
+    }
+    return result;
+}
+
+QVector<TelemetrySample> TsdbStore::samplesById(qint64 firstId, qint64 lastId) const
+{
+    QVector<TelemetrySample> result;
+    firstId = qMax<qint64>(1, firstId);
+    lastId = qMin(lastId, m_count);
+    if (firstId > lastId) {
+        return result;
+    }
+    result.reserve(int(lastId - firstId + 1));
+    // 最后一个 firstId 不大于所求起点的块
+    auto it = std::upper_bound(m_chunks.constBegin(), m_chunks.constEnd(), firstId,
+                               [](qint64 id, const ChunkInfo &chunk) { return id < chunk.firstId; });
+    if (it != m_chunks.constBegin()) {
+        --it;
+    }
+    QVector<TelemetrySample> decoded;
+    for (; it != m_chunks.constEnd() && it->firstId <= lastId; ++it) {
+        decoded.clear();
+        decodeChunk(*it, &decoded);
+        const qint64 from = qMax(firstId, it->firstId) - it->firstId;
+        const qint64 to = qMin(lastId, it->firstId + decoded.size() - 1) - it->firstId;
+        for (qint64 i = from; i <= to; i++) {
+            result.append(decoded[int(i)]);
+        }
+    }
+    const qint64 activeFirstId = m_count - m_active.size() + 1;
+    for (qint64 id = qMax(firstId, activeFirstId); id <= lastId; id++) {
+        result.append(m_active[int(id - activeFirstId)]);
+    }
+    return result;
+}
+
+QVector<LogRow> TsdbStore::logsBefore(qint64 beforeId, int limit) const
+{
+    QReadLocker locker(&m_lock);
+    QVector<LogRow> rows;
+    const qint64 lastId = qMin(beforeId - 1, m_count);
+    const qint64 firstId = lastId - limit + 1;
+    const QVector<TelemetrySample> samples = samplesById(firstId, lastId);
+    const qint64 startId = lastId - samples.size() + 1;
+    rows.reserve(samples.size());
+    for (int i = samples.size() - 1; i >= 0; i--) {
+        rows.append(toLogRow(startId + i, samples[i]));
+    }
+    return rows;
+}
+
+QVector<LogRow> TsdbStore::logsAfter(qint64 afterId, int limit) const
+{
+    QReadLocker locker(&m_lock);
+    QVector<LogRow> rows;
+    const qint64 firstId = qMax<qint64>(1, afterId + 1);
+    const QVector<TelemetrySample> samples = samplesById(firstId, firstId + limit - 1);
+    rows.reserve(samples.size());
+    for (int i = samples.size() - 1; i >= 0; i--) {
+        rows.append(toLogRow(firstId + i, samples[i]));
+    }
+    return rows;
+}
+
+QVector<LogRow> TsdbStore::rowsInRange(qint64 fromMs, qint64 toMs, qint64 afterId, int limit) const
+{
+    QReadLocker locker(&m_lock);
+    QVector<LogRow> rows;
+    if (fromMs > toMs || limit <= 0) {
+        return rows;
+    }
+    // 从“含 afterId + 1 的块”和“第一个 lastMs >= fromMs 的块”中靠后的一个开始
+    auto byTime = std::lower_bound(m_chunks.constBegin(), m_chunks.constEnd(), fromMs,
+                                   [](const ChunkInfo &chunk, qint64 ms) { return chunk.lastMs < ms; });
+    auto byId = std::upper_bound(m_chunks.constBegin(), m_chunks.constEnd(), afterId + 1,
+                                 [](qint64 id, const ChunkInfo &chunk) { return id < chunk.firstId; });
+    if (byId != m_chunks.constBegin()) {
+        --byId;
+    }
+    bool pastEnd = false;
+    QVector<TelemetrySample> decoded;
+    for (auto it = qMax(byTime, byId); it != m_chunks.constEnd() && !pastEnd && rows.size() < limit; ++it) {
+        if (it->firstMs > toMs) {
+            pastEnd = true;
+            break;
+        }
+        decoded.clear();
+        decodeChunk(*it, &decoded);
+        for (int i = 0; i < decoded.size() && rows.size() < limit; i++) {
+            const qint64 id = it->firstId + i;
+            if (id <= afterId || decoded[i].timeMs < fromMs) {
+                continue;
+            }
+            if (decoded[i].timeMs > toMs) {
+                pastEnd = true;
+                break;
+            }
+            rows.append(toLogRow(id, decoded[i]));
+        }
+    }
+    const qint64 activeFirstId = m_count - m_active.size() + 1;
+    for (int i = 0; i < m_active.size() && !pastEnd && rows.size() < limit; i++) {
+        const qint64 id = activeFirstId + i;
+        if (id <= afterId || m_active[i].timeMs < fromMs) {
+            continue;
+        }
+        if (m_active[i].timeMs > toMs) {
+            break;
+        }
+        rows.append(toLogRow(id, m_active[i]));
+    }
+    return rows;
+}
+
+qint64 TsdbStore::count() const
+{
+    QReadLocker locker(&m_lock);
+    return m_count;
+}
+
+TsdbStore::Stats TsdbStore::stats() const
+{
+    QReadLocker locker(&m_lock);
+    Stats stats;
+    stats.chunks = m_chunks.size();
+    stats.samples = m_count;
+    stats.fileBytes = m_mapSize;
+    stats.openSamples = m_active.size();
+    return stats;
+}
@@ -0,0 +1,128 @@
+#ifndef TSDBSTORE_H
+#define TSDBSTORE_H
+
+#include <QFile>
+#include <QReadWriteLock>
+#include <QVector>
+#include <climits>
+#include "dbmanager.h"
+
+/**
+ * @brief 嵌入式遥测存储的文件格式 (telemetry.tsd)
+ * 文件头 + 若干块，块只追加不修改；每块 = ChunkHeader + 4 列压缩数据首尾相接：
+ *   时间戳    首值 64 位，之后为二阶差分 (delta-of-delta) 变长编码，
+ *             等间隔采样每条 1 bit，抖动在 ±63 ms 内每条 9 bit
+ *   速度/加速度/位移  首值 64 位，之后与前值 XOR：相同 1 bit，
+ *             否则只存中间的有效位 (Gorilla 浮点压缩)
+ * 位流按高位在前写入，每列末尾补齐到整字节。
+ */
+namespace TsdbFormat {
+
+static const char MAGIC[8] = {'U', 'V', 'S', 'T', 'S', 'D', 'B', '1'};
+static const quint32 VERSION = 1;
+static const quint32 CHUNK_MAGIC = 0x4b4e4843;     // "CHNK"
+static const char WAL_MAGIC[8] = {'U', 'V', 'S', 'T', 'W', 'A', 'L', '1'};
+static const int COLUMNS = 4;
+
+#pragma pack(push, 1)
+struct FileHeader {
+    char magic[8];
+    quint32 version;
+    quint32 reserved;
+};
+
+struct ChunkHeader {
+    quint32 magic;
+    quint32 count;                  // 样本数
+    qint64 firstMs;
+    qint64 lastMs;
+    quint32 columnBytes[COLUMNS];   // 时间戳、速度、加速度、位移各列字节数
+};
+
+// telemetry.wal：未封块记录的原样副本，文件头 + 若干 TelemetrySample
+struct WalHeader {
+    char magic[8];
+    qint64 firstId;                 // 第一条记录的序号，重放时跳过已封存的部分
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FileHeader) == 16, "TsdbFormat::FileHeader layout");
+static_assert(sizeof(ChunkHeader) == 40, "TsdbFormat::ChunkHeader layout");
+static_assert(sizeof(WalHeader) == 16, "TsdbFormat::WalHeader layout");
+static_assert(sizeof(TelemetrySample) == 32, "TelemetrySample layout");
+
+} // namespace TsdbFormat
+
+/**
+ * @brief 嵌入式遥测存储 (不依赖 MySQL)
+ * 已封存的块整体 mmap 读取；块索引 (时间范围 + 起始序号) 常驻内存，
+ * 按时间或序号查询时二分找到相关的块，只解压这些块。
+ * 未写满的块放在内存中，同时原样追加到 telemetry.wal，启动时重放；封块后清空 .wal。
+ * 记录的 id 即从 1 开始的写入序号 (与 ship_logs 的自增 id 用法一致)。
+ * 时间戳须单调不减，早于上一条的按上一条的时间记录。
+ * 所有公有函数线程安全 (读写锁)。
+ */
+class TsdbStore
+{
+public:
+    struct Stats {
+        int chunks = 0;
+        qint64 samples = 0;
+        qint64 fileBytes = 0;   // 数据文件大小 (已封存的块)
+        int openSamples = 0;    // 内存中未封块的条数
+    };
+
+    explicit TsdbStore(const QString &dir, int chunkSamples = 1024);
+    ~TsdbStore();
+
+    bool open(QString *error = nullptr);
+    void close();               // 封存当前块并关闭文件
+    bool isOpen() const;
+
+    // 追加一批记录；firstId/lastId 返回这批的序号范围
+    bool append(const QVector<TelemetrySample> &samples, qint64 *firstId = nullptr, qint64 *lastId = nullptr);
+
+    // [fromMs, toMs] 内的记录，按时间升序
+    QVector<TelemetrySample> range(qint64 fromMs, qint64 toMs) const;
+    // 与 DBManager::getLogsBefore/After 语义相同 (结果按 id 降序)
+    QVector<LogRow> logsBefore(qint64 beforeId, int limit) const;
+    QVector<LogRow> logsAfter(qint64 afterId, int limit) const;
+    // [fromMs, toMs] 内 id > afterId 的最多 limit 条，按 id 升序；
+    // 以上一批最后的 id 作为下一次的 afterId 即可分批遍历任意大的范围 (每次只短暂持锁)
+    QVector<LogRow> rowsInRange(qint64 fromMs, qint64 toMs, qint64 afterId, int limit) const;
+    qint64 count() const;
+    Stats stats() const;
+
+private:
+    struct ChunkInfo {
+        qint64 offset = 0;      // 块头在文件中的位置
+        qint64 firstMs = 0;
+        qint64 lastMs = 0;
+        qint64 firstId = 0;
+        int count = 0;
+    };
+
+    QString m_dir;
+    int m_chunkSamples;
+    mutable QReadWriteLock m_lock;
+    QFile m_dataFile;
+    QFile m_walFile;
+    uchar *m_map = nullptr;
+    qint64 m_mapSize = 0;
+    QVector<ChunkInfo> m_chunks;
+    QVector<TelemetrySample> m_active;  // 未封块的记录
+    qint64 m_count = 0;
+    qint64 m_lastMs = LLONG_MIN;
+
+    bool loadChunks(QString *error);
+    void replayWal();
+    bool sealActive();
+    bool rewriteWal();
+    void remap();
+    void decodeChunk(const ChunkInfo &chunk, QVector<TelemetrySample> *out) const;
+    // 序号 [firstId, lastId] 的记录，按序号升序
+    QVector<TelemetrySample> samplesById(qint64 firstId, qint64 lastId) const;
+    void closeFiles();
+};
+
+#endif // TSDBSTORE_H
@@ -0,0 +1,418 @@
+#include "clipexporter.h"
+#include "playbackengine.h"
+#include "mkvwriter.h"
+#include "segmentformat.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QSharedPointer>
+#include <functional>
+
+#ifdef HAVE_LIBAV
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+#endif
+
+namespace {
+
+// 顺序遍历某路相机在 [startMs, endMs] 内的帧；fn 返回 false 时停止
+// 同一时刻只映射一个分段，帧数据直接指向映射内存
+bool forEachFrame(const QString &rootDir, int camId, qint64 startMs, qint64 endMs,
+                  const std::function<bool(const QByteArray &, qint64)> &fn)
+{
+    static const int PREFETCH_FRAMES = 100;
+    const QVector<SegmentInfo> segments = PlaybackEngine::scanSegments(rootDir, camId);
+    for (const SegmentInfo &info : segments) {
+        if (info.lastMs < startMs || info.firstMs > endMs) {
+            continue;
+        }
+        MappedSegment segment(info.segPath);
+        if (!segment.open()) {
+            continue;
+        }
+        int i = segment.indexAtOrBefore(startMs - 1) + 1;
+        for (; i < segment.frameCount(); i++) {
+            qint64 ts = segment.record(i).timestampMs;
+            if (ts > endMs) {
+                break;
+            }
+            if (i % PREFETCH_FRAMES == 0) {
+                segment.prefetch(i, i + PREFETCH_FRAMES);
+            }
+            if (!fn(segment.frameView(i), ts)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+#ifdef HAVE_LIBAV
+/**
+ * @brief H.264/MP4 编码输出 (libavcodec + libavformat)
+ * 时间基 1 ms，按录像时间戳写 pts (可变帧率)；编码器开启帧/片级多线程。
+ */
+class Mp4Encoder
+{
+public:
+    ~Mp4Encoder() { release(); }
+
+    bool open(const QString &path, QSize size, QString *error)
+    {
+        // YUV420P 要求宽高为偶数
+        m_size = QSize(size.width() & ~1, size.height() & ~1);
+        QByteArray path8 = QFile::encodeName(path);
+        if (avformat_alloc_output_context2(&m_fmt, nullptr, "mp4", path8.constData()) < 0 || !m_fmt) {
+            *error = QStringLiteral("cannot create mp4 muxer");
+            return false;
+        }
+        const AVCodec *codec = avcodec_find_encoder_by_name("libx264");
+        if (!codec) {
+            codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+        }
+        if (!codec) {
+            codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+        }
+        if (!codec) {
+            *error = QStringLiteral("no H.264/MPEG-4 encoder available");
+            return false;
+        }
+        m_stream = avformat_new_stream(m_fmt, nullptr);
+        m_ctx = avcodec_alloc_context3(codec);
+        if (!m_stream || !m_ctx) {
+            *error = QStringLiteral("out of memory");
+            return false;
+        }
+        m_ctx->width = m_size.width();
+        m_ctx->height = m_size.height();
+        m_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+        m_ctx->time_base = AVRational{1, 1000};
+        m_ctx->gop_size = 50;
+        m_ctx->thread_count = 0;    // 自动，按 CPU 核数
+        m_ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        if (m_fmt->oformat->flags & AVFMT_GLOBALHEADER) {
+            m_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        }
+        av_opt_set(m_ctx->priv_data, "preset", "veryfast", 0);
+        if (avcodec_open2(m_ctx, codec, nullptr) < 0
+            || avcodec_parameters_from_context(m_stream->codecpar, m_ctx) < 0) {
+            *error = QStringLiteral("cannot open encoder");
+            return false;
+        }
+        m_stream->time_base = m_ctx->time_base;
+        if (avio_open(&m_fmt->pb, path8.constData(), AVIO_FLAG_WRITE) < 0
+            || avformat_write_header(m_fmt, nullptr) < 0) {
+            *error = QStringLiteral("cannot write mp4 header");
+            return false;
+        }
+        m_headerWritten = true;
+
+        m_frame = av_frame_alloc();
+        m_packet = av_packet_alloc();
+        m_sws = sws_getContext(m_size.width(), m_size.height(), AV_PIX_FMT_RGB24,
+                               m_size.width(), m_size.height(), AV_PIX_FMT_YUV420P,
+                               SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!m_frame || !m_packet || !m_sws) {
+            *error = QStringLiteral("out of memory");
+            return false;
+        }
+        m_frame->format = AV_PIX_FMT_YUV420P;
+        m_frame->width = m_size.width();
+        m_frame->height = m_size.height();
+        if (av_frame_get_buffer(m_frame, 0) < 0) {
+            *error = QStringLiteral("out of memory");
+            return false;
+        }
+        return true;
+    }
+
+    bool writeFrame(const QImage &image, qint64 ptsMs, QString *error)
+    {
+        QImage rgb = image.convertToFormat(QImage::Format_RGB888);
+        if (rgb.size() != m_size) {
+            rgb = rgb.scaled(m_size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+        if (av_frame_make_writable(m_frame) < 0) {
+            *error = QStringLiteral("encoder frame busy");
+            return false;
+        }
+        const uint8_t *src[1] = {rgb.constBits()};
+        const int srcStride[1] = {int(rgb.bytesPerLine())};
+        sws_scale(m_sws, src, srcStride, 0, m_size.height(), m_frame->data, m_frame->linesize);
+        // pts 必须严格递增
+        m_frame->pts = qMax(ptsMs, m_lastPts + 1);
+        m_lastPts = m_frame->pts;
+        return encode(m_frame, error);
+    }
+
+    bool close(QString *error)
+    {
+        bool ok = encode(nullptr, error);
+        if (m_headerWritten) {
+            ok = av_write_trailer(m_fmt) == 0 && ok;
+        }
+        release();
+        return ok;
+    }
+
+private:
+    QSize m_size;
+    AVFormatContext *m_fmt = nullptr;
+    AVStream *m_stream = nullptr;
+    AVCodecContext *m_ctx = nullptr;
+    AVFrame *m_frame = nullptr;
+    AVPacket *m_packet = nullptr;
+    SwsContext *m_sws = nullptr;
+    bool m_headerWritten = false;
+    qint64 m_lastPts = -1;
+
+    bool encode(AVFrame *frame, QString *error)
+    {
+        if (avcodec_send_frame(m_ctx, frame) < 0) {
+            *error = QStringLiteral("encode failed");
+            return false;
+        }
+        while (avcodec_receive_packet(m_ctx, m_packet) == 0) {
+            av_packet_rescale_ts(m_packet, m_ctx->time_base, m_stream->time_base);
+            m_packet->stream_index = m_stream->index;
+            if (av_interleaved_write_frame(m_fmt, m_packet) < 0) {
+                *error = QStringLiteral("write failed");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void release()
+    {
+        sws_freeContext(m_sws);
+        m_sws = nullptr;
+        av_packet_free(&m_packet);
+        av_frame_free(&m_frame);
+        avcodec_free_context(&m_ctx);
+        if (m_fmt) {
+            if (m_fmt->pb) {
+                avio_closep(&m_fmt->pb);
+            }
+            avformat_free_context(m_fmt);
+            m_fmt = nullptr;
+        }
+        m_headerWritten = false;
+    }
+};
+#endif // HAVE_LIBAV
+
+} // namespace
+
+ClipExporter::ClipExporter(const QString &rootDir, QObject *parent)
+    : QObject{parent}
+    , m_rootDir(rootDir)
+{
+}
+
+ClipExporter::~ClipExporter()
+{
+    if (m_thread) {
+        m_cancel = true;
+        m_thread->wait();
+    }
+}
+
+bool ClipExporter::canEncodeMp4()
+{
+#ifdef HAVE_LIBAV
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ClipExporter::start(const Job &job)
+{
+    if (m_thread) {
+        return false;
+    }
+    m_cancel = false;
+    m_lastPercent = -1;
+    QSharedPointer<Result> result(new Result);
+
+    m_thread = QThread::create([=](){
+        run(job, result.data());
+    });
+    connect(m_thread, &QThread::finished, this, [=](){
+        m_thread->deleteLater();
+        m_thread = nullptr;
+        emit finished(result->ok, result->files, result->error);
+    });
+    m_thread->start(QThread::LowPriority);
+    return true;
+}
+
+void ClipExporter::cancel()
+{
+    m_cancel = true;
+}
+
+// ==========================================
+// 导出线程
+// ==========================================
+void ClipExporter::run(const Job &job, Result *result)
+{
+    if (job.format == Mp4H264 && !canEncodeMp4()) {
+        result->error = QStringLiteral("MP4 导出未启用 (需以 CONFIG+=libav 编译)");
+        return;
+    }
+    if (!QDir().mkpath(job.outDir)) {
+        result->error = QStringLiteral("cannot create %1").arg(job.outDir);
+        return;
+    }
+
+    // 先只读索引统计总帧数，用于进度
+    qint64 total = 0;
+    for (int camId : job.camIds) {
+        total += countFrames(camId, job.startMs, job.endMs);
+    }
+    if (total == 0) {
+        result->error = QStringLiteral("所选时间范围内没有录像");
+        return;
+    }
+
+    qint64 done = 0;
+    for (int camId : job.camIds) {
+        QString path;
+        QString error;
+        bool ok = exportCamera(job, camId, &done, total, &path, &error);
+        if (m_cancel) {
+            // 取消：删除本次已生成的全部文件
+            QFile::remove(path);
+            for (const QString &file : result->files) {
+                QFile::remove(file);
+            }
+            result->files.clear();
+            result->error = QStringLiteral("已取消");
+            return;
+        }
+        if (!ok) {
+            QFile::remove(path);
+            result->error = QStringLiteral("相机 %1: %2").arg(camId).arg(error);
+            return;
+        }
+        if (!path.isEmpty()) {
+            result->files.append(path);
+        }
+    }
+    result->ok = true;
+}
+
+qint64 ClipExporter::countFrames(int camId, qint64 startMs, qint64 endMs) const
+{
+    qint64 count = 0;
+    const QVector<SegmentInfo> segments = PlaybackEngine::scanSegments(m_rootDir, camId);
+    for (const SegmentInfo &info : segments) {
+        if (info.lastMs < startMs || info.firstMs > endMs) {
+            continue;
+        }
+        MappedSegment segment(info.segPath);
+        if (segment.open()) {
+            count += segment.indexAtOrBefore(endMs) - segment.indexAtOrBefore(startMs - 1);
+        }
+    }
+    return count;
+}
+
+bool ClipExporter::exportCamera(const Job &job, int camId, qint64 *done, qint64 total,
+                                QString *outPath, QString *error)
+{
+    if (countFrames(camId, job.startMs, job.endMs) == 0) {
+        return true;    // 这一路在该时段没有录像，跳过
+    }
+    QDateTime start = QDateTime::fromMSecsSinceEpoch(job.startMs);
+    QDateTime end = QDateTime::fromMSecsSinceEpoch(job.endMs);
+    QString name = QString("%1_%2-%3.%4").arg(SegmentFormat::cameraDirName(camId),
+                                              start.toString("yyyyMMdd_HHmmss"), end.toString("HHmmss"),
+                                              job.format == Mp4H264 ? "mp4" : "mkv");
+    *outPath = QDir(job.outDir).filePath(name);
+
+    if (job.format == MkvCopy) {
+        MkvWriter writer;
+        if (!writer.open(*outPath)) {
+            *error = writer.errorString();
+            return false;
+        }
+        bool ok = forEachFrame(m_rootDir, camId, job.startMs, job.endMs,
+                               [&](const QByteArray &jpeg, qint64 ts) {
+            if (m_cancel || !writer.writeFrame(jpeg.constData(), jpeg.size(), ts)) {
+                return false;
+            }
+            reportProgress(++*done, total);
+            return true;
+        });
+        bool closed = writer.close();
+        if (!ok || !closed) {
+            *error = writer.errorString();
+            return false;
+        }
+        return true;
+    }
+
+#ifdef HAVE_LIBAV
+    Mp4Encoder encoder;
+    bool opened = false;
+    qint64 firstMs = 0;
+    bool ok = forEachFrame(m_rootDir, camId, job.startMs, job.endMs,
+                           [&](const QByteArray &jpeg, qint64 ts) {
+        if (m_cancel) {
+            return false;
+        }
+        QImage image = QImage::fromData(jpeg, "JPG");
+        if (image.isNull()) {
+            reportProgress(++*done, total);
+            return true;    // 损坏的帧跳过
+        }
+        if (!opened) {
+            if (!encoder.open(*outPath, image.size(), error)) {
+                return false;
+            }
+            opened = true;
+            firstMs = ts;
+        }
+        if (!encoder.writeFrame(image, ts - firstMs, error)) {
+            return false;
+        }
+        reportProgress(++*done, total);
+        return true;
+    });
+    if (!opened) {
+        if (error->isEmpty()) {
+            *error = QStringLiteral("no decodable frames");
+        }
+        return false;
+    }
+    QString closeError;
+    bool closed = encoder.close(&closeError);
+    if (!ok || !closed) {
+        if (error->isEmpty()) {
+            *error = closeError;
+        }
+        return false;
+    }
+    return true;
+#else
+    *error = QStringLiteral("MP4 export not built");
+    return false;
+#endif
+}
+
+void ClipExporter::reportProgress(qint64 done, qint64 total)
+{
+    int percent = int(done * 100 / total);
+    // 只在百分比变化时跨线程通知，避免淹没 GUI 事件队列
+    if (m_lastPercent.exchange(percent) != percent) {
+        QMetaObject::invokeMethod(this, [=](){ emit progress(percent); }, Qt::QueuedConnection);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef CLIPEXPORTER_H
+#define CLIPEXPORTER_H
+
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QStringList>
+#include <atomic>
+
+/**
+ * @brief 录像片段导出 (后台任务)
+ * 按相机 + 时间范围从本地录像中取帧，每路相机导出一个文件：
+ *   MkvCopy  MJPEG 原样封装进 Matroska，不解码不编码，速度只受磁盘限制
+ *   Mp4H264  解码后用 libavcodec 重新编码为 H.264/MP4 (编码器自带线程池)，
+ *            需以 CONFIG+=libav 编译，否则不可用
+ * 读取走内存映射，逐帧顺序处理，内存占用与导出时长无关。
+ * 导出线程为低优先级，不影响实时画面；可随时取消，取消时删除未完成的文件。
+ */
+class ClipExporter : public QObject
+{
+    Q_OBJECT
+public:
+    enum Format {
+        MkvCopy,
+        Mp4H264
+    };
+
+    struct Job {
+        QVector<int> camIds;
+        qint64 startMs = 0;
+        qint64 endMs = 0;
+        QString outDir;
+        Format format = MkvCopy;
+    };
+
+    explicit ClipExporter(const QString &rootDir, QObject *parent = nullptr);
+    ~ClipExporter();
+
+    static bool canEncodeMp4();
+
+    // 已有任务在运行时返回 false
+    bool start(const Job &job);
+    void cancel();
+    bool isRunning() const { return m_thread != nullptr; }
+
+signals:
+    void progress(int percent);
+    void finished(bool ok, const QStringList &files, const QString &error);
+
+private:
+    QString m_rootDir;
+    QThread *m_thread = nullptr;
+    std::atomic<bool> m_cancel{false};
+    std::atomic<int> m_lastPercent{-1};
+
+    struct Result {
+        bool ok = false;
+        QStringList files;
+        QString error;
+    };
+
+    // --- 以下在导出线程执行 ---
+    void run(const Job &job, Result *result);
+    bool exportCamera(const Job &job, int camId, qint64 *done, qint64 total, QString *outPath, QString *error);
+    qint64 countFrames(int camId, qint64 startMs, qint64 endMs) const;
+    void reportProgress(qint64 done, qint64 total);
+};
+
+#endif // CLIPEXPORTER_H
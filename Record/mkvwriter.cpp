@@ -0,0 +1,325 @@
+#include "mkvwriter.h"
+#include "jpegutil.h"
+#include <QtEndian>
+#include <cstring>
+
+// ==========================================
+// EBML 编码
+// ==========================================
+namespace {
+
+// Matroska 元素 ID (已含长度标记位)
+enum : quint32 {
+    ID_EBML = 0x1A45DFA3, ID_EBMLVersion = 0x4286, ID_EBMLReadVersion = 0x42F7,
+    ID_EBMLMaxIDLength = 0x42F2, ID_EBMLMaxSizeLength = 0x42F3,
+    ID_DocType = 0x4282, ID_DocTypeVersion = 0x4287, ID_DocTypeReadVersion = 0x4285,
+    ID_Segment = 0x18538067,
+    ID_SeekHead = 0x114D9B74, ID_Seek = 0x4DBB, ID_SeekID = 0x53AB, ID_SeekPosition = 0x53AC,
+    ID_Info = 0x1549A966, ID_TimestampScale = 0x2AD7B1, ID_Duration = 0x4489,
+    ID_MuxingApp = 0x4D80, ID_WritingApp = 0x5741,
+    ID_Tracks = 0x1654AE6B, ID_TrackEntry = 0xAE, ID_TrackNumber = 0xD7, ID_TrackUID = 0x73C5,
+    ID_TrackType = 0x83, ID_FlagLacing = 0x9C, ID_CodecID = 0x86,
+    ID_Video = 0xE0, ID_PixelWidth = 0xB0, ID_PixelHeight = 0xBA,
+    ID_Cluster = 0x1F43B675, ID_Timestamp = 0xE7, ID_SimpleBlock = 0xA3,
+    ID_Cues = 0x1C53BB6B, ID_CuePoint = 0xBB, ID_CueTime = 0xB3,
+    ID_CueTrackPositions = 0xB7, ID_CueTrack = 0xF7, ID_CueClusterPosition = 0xF1
+};
+
+void putId(QByteArray &out, quint32 id)
+{
+    int bytes = id > 0xFFFFFF ? 4 : id > 0xFFFF ? 3 : id > 0xFF ? 2 : 1;
+    for (int i = bytes - 1; i >= 0; i--) {
+        out.append(char((id >> (8 * i)) & 0xFF));
+    }
+}
+
+// 变长整数，取能容纳的最短长度 (全 1 保留给 "未知大小")
+void putSize(QByteArray &out, quint64 size)
+{
+    int len = 1;
+    while (len < 8 && size >= (quint64(1) << (7 * len)) - 1) {
+        len++;
+    }
+    quint64 v = size | (quint64(1) << (7 * len));
+    for (int i = len - 1; i >= 0; i--) {
+        out.append(char((v >> (8 * i)) & 0xFF));
+    }
+}
+
+void putUInt(QByteArray &out, quint32 id, quint64 value, int fixedBytes = 0)
+{
+    int bytes = fixedBytes;
+    if (bytes == 0) {
+        bytes = 1;
+        while (bytes < 8 && (value >> (8 * bytes)) != 0) {
+            bytes++;
+        }
+    }
+    putId(out, id);
+    putSize(out, quint64(bytes));
+    for (int i = bytes - 1; i >= 0; i--) {
+        out.append(char((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void putFloat(QByteArray &out, quint32 id, double value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putUInt(out, id, bits, 8);
+}
+
+void putString(QByteArray &out, quint32 id, const QByteArray &value)
+{
+    putId(out, id);
+    putSize(out, quint64(value.size()));
+    out.append(value);
+}
+
+void putMaster(QByteArray &out, quint32 id, const QByteArray &body)
+{
+    putId(out, id);
+    putSize(out, quint64(body.size()));
+    out.append(body);
+}
+
+QByteArray idBytes(quint32 id)
+{
+    QByteArray out;
+    putId(out, id);
+    return out;
+}
+
+QByteArray bigEndian64(quint64 value)
+{
+    QByteArray out(8, '\0');
+    qToBigEndian(value, out.data());
+    return out;
+}
+
+} // namespace
+
+// ==========================================
+// MkvWriter
+// ==========================================
+MkvWriter::~MkvWriter()
+{
+    if (m_file.isOpen()) {
+        close();
+    }
+}
+
+bool MkvWriter::open(const QString &path)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_headerWritten = false;
+    m_cluster.clear();
+    m_cues.clear();
+    return true;
+}
+
+bool MkvWriter::writeHeader(const QSize &size)
+{
+    QByteArray out;
+
+    QByteArray ebml;
+    putUInt(ebml, ID_EBMLVersion, 1);
+    putUInt(ebml, ID_EBMLReadVersion, 1);
+    putUInt(ebml, ID_EBMLMaxIDLength, 4);
+    putUInt(ebml, ID_EBMLMaxSizeLength, 8);
+    putString(ebml, ID_DocType, "matroska");
+    putUInt(ebml, ID_DocTypeVersion, 4);
+    putUInt(ebml, ID_DocTypeReadVersion, 2);
+    putMaster(out, ID_EBML, ebml);
+
+    // Segment 大小先写 8 字节占位，结束时回填
+    putId(out, ID_Segment);
+    m_segmentSizePos = m_file.pos() + out.size();
+    out.append(char(0x01));
+    out.append(7, char(0xFF));
+    m_segmentDataPos = m_file.pos() + out.size();
+
+    // --- SeekHead：位置都用 8 字节定长，Cues 的位置结束时回填 ---
+    QByteArray info;
+    putUInt(info, ID_TimestampScale, 1000000);  // 1 ms
+    QByteArray infoHead = info;
+    putFloat(info, ID_Duration, 0.0);
+    putString(info, ID_MuxingApp, "UVSS MkvWriter");
+    putString(info, ID_WritingApp, "Underwater video surveillance system");
+
+    QByteArray video;
+    putUInt(video, ID_PixelWidth, quint64(size.width()));
+    putUInt(video, ID_PixelHeight, quint64(size.height()));
+    QByteArray track;
+    putUInt(track, ID_TrackNumber, 1);
+    putUInt(track, ID_TrackUID, 1);
+    putUInt(track, ID_TrackType, 1);            // video
+    putUInt(track, ID_FlagLacing, 0);
+    putString(track, ID_CodecID, "V_MJPEG");
+    putMaster(track, ID_Video, video);
+    QByteArray tracks;
+    putMaster(tracks, ID_TrackEntry, track);
+
+    auto seekEntry = [](quint32 id, quint64 pos) {
+        QByteArray seek;
+        putString(seek, ID_SeekID, idBytes(id));
+        putUInt(seek, ID_SeekPosition, pos, 8);
+        QByteArray entry;
+        putMaster(entry, ID_Seek, seek);
+        return entry;
+    };
+    // 每个 Seek 条目长度固定，可先算出 SeekHead 总长
+    const int seekHeadSize = [&]() {
+        QByteArray probe;
+        QByteArray body = seekEntry(ID_Info, 0) + seekEntry(ID_Tracks, 0) + seekEntry(ID_Cues, 0);
+        putMaster(probe, ID_SeekHead, body);
+        return probe.size();
+    }();
+    QByteArray infoElement;
+    putMaster(infoElement, ID_Info, info);
+    const quint64 infoPos = quint64(seekHeadSize);
+    const quint64 tracksPos = infoPos + quint64(infoElement.size());
+
+    QByteArray seekBody = seekEntry(ID_Info, infoPos) + seekEntry(ID_Tracks, tracksPos) + seekEntry(ID_Cues, 0);
+    // Cues 的 SeekPosition 负载是 SeekHead 的最后 8 字节
+    m_cuesSeekPos = m_segmentDataPos + seekHeadSize - 8;
+    putMaster(out, ID_SeekHead, seekBody);
+
+    // Duration 负载位置：Info 头 + TimestampScale 之后，再跳过 Duration 的 ID 与长度
+    QByteArray infoPrefix;
+    putId(infoPrefix, ID_Info);
+    putSize(infoPrefix, quint64(info.size()));
+    m_durationPos = m_file.pos() + out.size() + infoPrefix.size() + infoHead.size() + 3;
+    out.append(infoElement);
+    putMaster(out, ID_Tracks, tracks);
+
+    if (!writeAll(out)) {
+        return false;
+    }
+    m_headerWritten = true;
+    return true;
+}
+
+bool MkvWriter::writeFrame(const char *jpeg, int size, qint64 timestampMs)
+{
+    if (!m_headerWritten) {
+        QSize frameSize;
+        if (JpegUtil::parseSize(jpeg, size, &frameSize) != JpegUtil::Found) {
+            m_error = QStringLiteral("invalid JPEG frame");
+            return false;
+        }
+        if (!writeHeader(frameSize)) {
+            return false;
+        }
+        m_firstMs = timestampMs;
+        m_clusterMs = timestampMs;
+    }
+    if (timestampMs < m_lastMs) {
+        timestampMs = m_lastMs;
+    }
+    if (!m_cluster.isEmpty()
+        && (timestampMs - m_clusterMs >= CLUSTER_MS || m_cluster.size() + size > CLUSTER_BYTES)) {
+        if (!flushCluster()) {
+            return false;
+        }
+    }
+    if (m_cluster.isEmpty()) {
+        m_clusterMs = timestampMs;
+    }
+
+    // SimpleBlock：轨道号 (vint) + int16 相对时间 + 标志 + 数据
+    putId(m_cluster, ID_SimpleBlock);
+    putSize(m_cluster, quint64(size) + 4);
+    m_cluster.append(char(0x81));
+    qint16 relative = qint16(timestampMs - m_clusterMs);
+    m_cluster.append(char((relative >> 8) & 0xFF));
+    m_cluster.append(char(relative & 0xFF));
+    m_cluster.append(char(0x80));       // 关键帧
+    m_cluster.append(jpeg, size);
+    m_lastMs = timestampMs;
+    return true;
+}
+
+bool MkvWriter::flushCluster()
+{
+    if (m_cluster.isEmpty()) {
+        return true;
+    }
+    CuePoint cue;
+    cue.timeMs = m_clusterMs - m_firstMs;
+    cue.clusterPos = m_file.pos() - m_segmentDataPos;
+    m_cues.append(cue);
+
+    QByteArray timestamp;
+    putUInt(timestamp, ID_Timestamp, quint64(cue.timeMs));
+    QByteArray head;
+    putId(head, ID_Cluster);
+    putSize(head, quint64(timestamp.size() + m_cluster.size()));
+    head.append(timestamp);
+    bool ok = writeAll(head) && writeAll(m_cluster);
+    m_cluster.clear();
+    return ok;
+}
+
+bool MkvWriter::close()
+{
+    if (!m_file.isOpen()) {
+        return false;
+    }
+    bool ok = true;
+    if (m_headerWritten) {
+        ok = flushCluster();
+
+        QByteArray cuesBody;
+        for (const CuePoint &cue : m_cues) {
+            QByteArray positions;
+            putUInt(positions, ID_CueTrack, 1);
+            putUInt(positions, ID_CueClusterPosition, quint64(cue.clusterPos));
+            QByteArray point;
+            putUInt(point, ID_CueTime, quint64(cue.timeMs));
+            putMaster(point, ID_CueTrackPositions, positions);
+            putMaster(cuesBody, ID_CuePoint, point);
+        }
+        qint64 cuesPos = m_file.pos() - m_segmentDataPos;
+        QByteArray cues;
+        putMaster(cues, ID_Cues, cuesBody);
+        ok = ok && writeAll(cues);
+
+        // 回填 Segment 大小、Cues 位置和时长
+        qint64 segmentSize = m_file.pos() - m_segmentDataPos;
+        ok = ok && patch(m_segmentSizePos, bigEndian64(quint64(segmentSize) | (quint64(1) << 56)));
+        ok = ok && patch(m_cuesSeekPos, bigEndian64(quint64(cuesPos)));
+        double duration = double(m_lastMs - m_firstMs);
+        quint64 bits;
+        std::memcpy(&bits, &duration, sizeof(bits));
+        ok = ok && patch(m_durationPos, bigEndian64(bits));
+    } else {
+        m_error = QStringLiteral("no frames written");
+        ok = false;
+    }
+    m_file.close();
+    return ok;
+}
+
+bool MkvWriter::writeAll(const QByteArray &data)
+{
+    if (m_file.write(data) != data.size()) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool MkvWriter::patch(qint64 pos, const QByteArray &data)
+{
+    qint64 end = m_file.pos();
+    bool ok = m_file.seek(pos) && m_file.write(data) == data.size() && m_file.seek(end);
+    if (!ok) {
+        m_error = m_file.errorString();
+    }
+    return ok;
+}
@@ -0,0 +1,56 @@
+#ifndef MKVWRITER_H
+#define MKVWRITER_H
+
+#include <QFile>
+#include <QSize>
+#include <QVector>
+#include <QByteArray>
+
+/**
+ * @brief 最小 Matroska 封装器 (MJPEG 直接拷贝，不重新编码)
+ * 只有一条 V_MJPEG 视频轨，每帧一个 SimpleBlock (都是关键帧)，时间基 1 ms。
+ * 帧先攒进一个 Cluster 缓冲 (最长 CLUSTER_MS / CLUSTER_BYTES)，满了才落盘，
+ * 内存占用与导出长度无关；结束时补写 Cues、Segment 大小和 Duration，生成的文件可拖动定位。
+ */
+class MkvWriter
+{
+public:
+    MkvWriter() = default;
+    ~MkvWriter();
+
+    bool open(const QString &path);
+    // 第一帧决定画面尺寸并写文件头；timestampMs 须单调不减
+    bool writeFrame(const char *jpeg, int size, qint64 timestampMs);
+    bool close();
+    QString errorString() const { return m_error; }
+
+private:
+    static const qint64 CLUSTER_MS = 5000;          // SimpleBlock 相对时间为 int16，须远小于 32767
+    static const int CLUSTER_BYTES = 4 << 20;
+
+    struct CuePoint {
+        qint64 timeMs;
+        qint64 clusterPos;      // 相对 Segment 数据起点
+    };
+
+    QFile m_file;
+    QString m_error;
+    bool m_headerWritten = false;
+    qint64 m_segmentSizePos = 0;    // 需要回填的位置 (文件偏移)
+    qint64 m_segmentDataPos = 0;
+    qint64 m_durationPos = 0;
+    qint64 m_cuesSeekPos = 0;
+    qint64 m_firstMs = 0;
+    qint64 m_lastMs = 0;
+
+    QByteArray m_cluster;           // 当前 Cluster 内的 SimpleBlock
+    qint64 m_clusterMs = 0;
+    QVector<CuePoint> m_cues;
+
+    bool writeHeader(const QSize &size);
+    bool flushCluster();
+    bool writeAll(const QByteArray &data);
+    bool patch(qint64 pos, const QByteArray &data);
+};
+
+#endif // MKVWRITER_H
@@ -0,0 +1,597 @@
+#include "playbackengine.h"
+#include <QDir>
+#include <QDirIterator>
+#include <algorithm>
+#include <cstring>
+
+#if defined(Q_OS_UNIX)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// ==========================================
+// MappedSegment
+// ==========================================
+MappedSegment::MappedSegment(const QString &segPath)
+    : m_segFile(segPath)
+    , m_idxFile(SegmentFormat::indexPathForSegment(segPath))
+{
+}
+
+MappedSegment::~MappedSegment()
+{
+    unmap();
+}
+
+void MappedSegment::unmap()
+{
+    if (m_segMap) {
+        m_segFile.unmap(m_segMap);
+        m_segMap = nullptr;
+    }
+    if (m_idxMap) {
+        m_idxFile.unmap(m_idxMap);
+        m_idxMap = nullptr;
+    }
+    m_records = nullptr;
+    m_count = 0;
+    m_segSize = 0;
+}
+
+bool MappedSegment::open()
+{
+    if (!m_segFile.isOpen() && !m_segFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    if (!m_idxFile.isOpen() && !m_idxFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    return refresh();
+}
+
+bool MappedSegment::refresh()
+{
+    unmap();
+
+    const qint64 headerSize = sizeof(SegmentFormat::IndexHeader);
+    const qint64 recordSize = sizeof(SegmentFormat::IndexRecord);
+    qint64 idxSize = m_idxFile.size();
+    m_segSize = m_segFile.size();
+    if (idxSize < headerSize + recordSize || m_segSize <= 0) {
+        return false;
+    }
+
+    m_idxMap = m_idxFile.map(0, idxSize);
+    m_segMap = m_segFile.map(0, m_segSize);
+    if (!m_idxMap || !m_segMap) {
+        unmap();
+        return false;
+    }
+
+    const SegmentFormat::IndexHeader *header = reinterpret_cast<const SegmentFormat::IndexHeader *>(m_idxMap);
+    if (std::memcmp(header->magic, SegmentFormat::INDEX_MAGIC, sizeof(header->magic)) != 0
+        || header->recordSize != recordSize) {
+        unmap();
+        return false;
+    }
+
+    m_records = reinterpret_cast<const SegmentFormat::IndexRecord *>(m_idxMap + headerSize);
+    int count = int((idxSize - headerSize) / recordSize);
+    // 写入中的分段：只认数据已经完整落在 .seg 里的帧
+    while (count > 0 && m_records[count - 1].offset + m_records[count - 1].size > quint64(m_segSize)) {
+        count--;
+    }
+    m_count = count;
+    if (m_count == 0) {
+        unmap();
+        return false;
+    }
+    return true;
+}
+
+int MappedSegment::indexAtOrBefore(qint64 tsMs) const
+{
+    const SegmentFormat::IndexRecord *end = m_records + m_count;
+    const SegmentFormat::IndexRecord *it = std::upper_bound(m_records, end, tsMs,
+        [](qint64 ts, const SegmentFormat::IndexRecord &r){ return ts < r.timestampMs; });
+    return int(it - m_records) - 1;
+}
+
+QByteArray MappedSegment::frameData(int i) const
+{
+    const SegmentFormat::IndexRecord &r = m_records[i];
+    // 拷贝一份：显示控件可能在映射释放之后才解码
+    return QByteArray(reinterpret_cast<const char *>(m_segMap + r.offset), int(r.size));
+}
+
+QByteArray MappedSegment::frameView(int i) const
+{
+    const SegmentFormat::IndexRecord &r = m_records[i];
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(m_segMap + r.offset), int(r.size));
+}
+
+void MappedSegment::prefetch(int first, int last) const
+{
+#if defined(Q_OS_UNIX)
+    first = qBound(0, first, m_count - 1);
+    last = qBound(0, last, m_count - 1);
+    if (first > last) {
+        std::swap(first, last);
+    }
+    static const quint64 pageSize = quint64(sysconf(_SC_PAGESIZE));
+    quint64 begin = m_records[first].offset & ~(pageSize - 1);
+    quint64 end = m_records[last].offset + m_records[last].size;
+    madvise(m_segMap + begin, size_t(end - begin), MADV_WILLNEED);
+#else
+    Q_UNUSED(first);
+    Q_UNUSED(last);
+#endif
+}
+
+// ==========================================
+// PlaybackEngine
+// ==========================================
+PlaybackEngine::PlaybackEngine(QObject *parent)
+    : QObject{parent}
+{
+    m_timer = new QTimer(this);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    m_timer->setInterval(10);
+    connect(m_timer, &QTimer::timeout, this, &PlaybackEngine::onTick);
+}
+
+PlaybackEngine::~PlaybackEngine()
+{
+    close();
+}
+
+/**
+ * @brief 读取一个分段的概要
+ * 只读索引文件头和首尾两条记录，不读帧数据。
+ */
+static bool readSegmentInfo(const QString &idxPath, SegmentInfo *info)
+{
+    const qint64 headerSize = sizeof(SegmentFormat::IndexHeader);
+    const qint64 recordSize = sizeof(SegmentFormat::IndexRecord);
+
+    QFile file(idxPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    SegmentFormat::IndexHeader header;
+    if (file.read(reinterpret_cast<char *>(&header), headerSize) != headerSize
+        || std::memcmp(header.magic, SegmentFormat::INDEX_MAGIC, sizeof(header.magic)) != 0
+        || header.recordSize != recordSize) {
+        return false;
+    }
+    int frames = int((file.size() - headerSize) / recordSize);
+    if (frames <= 0) {
+        return false;
+    }
+    SegmentFormat::IndexRecord first, last;
+    file.read(reinterpret_cast<char *>(&first), recordSize);
+    file.seek(headerSize + qint64(frames - 1) * recordSize);
+    file.read(reinterpret_cast<char *>(&last), recordSize);
+
+    info->segPath = idxPath.left(idxPath.size() - 4) + ".seg";
+    info->firstMs = first.timestampMs;
+    info->lastMs = last.timestampMs;
+    info->frames = frames;
+    return true;
+}
+
+/**
+ * @brief 扫描某路相机的全部分段
+ * 每个分段只读索引文件头和首尾两条记录，不读帧数据。
+ */
+QVector<SegmentInfo> PlaybackEngine::scanSegments(const QString &rootDir, int camId)
+{
+    QVector<SegmentInfo> list;
+    QDirIterator it(QDir(rootDir).filePath(SegmentFormat::cameraDirName(camId)), QStringList() << "*.idx",
+                    QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        SegmentInfo info;
+        if (readSegmentInfo(it.next(), &info)) {
+            list.append(info);
+        }
+    }
+    std::sort(list.begin(), list.end(), [](const SegmentInfo &a, const SegmentInfo &b){
+        return a.firstMs < b.firstMs;
+    });
+    return list;
+}
+
+bool PlaybackEngine::openCamera(int camId, bool seekToStart)
+{
+    close();
+    m_segments = scanSegments(m_rootDir, camId);
+    if (m_segments.isEmpty()) {
+        return false;
+    }
+    m_camId = camId;
+    emit rangeChanged(startMs(), endMs());
+    if (seekToStart) {
+        seek(startMs());
+    }
+    return true;
+}
+
+void PlaybackEngine::close()
+{
+    pause();
+    qDeleteAll(m_mapped);
+    m_mapped.clear();
+    m_mappedLru.clear();
+    m_segments.clear();
+    m_camId = -1;
+    m_rescanClock.invalidate();
+    m_curSegment = -1;
+    m_curFrame = -1;
+    m_positionMs = 0;
+}
+
+MappedSegment *PlaybackEngine::segment(int segIndex)
+{
+    MappedSegment *mapped = m_mapped.value(segIndex, nullptr);
+    if (mapped) {
+        m_mappedLru.removeOne(segIndex);
+        m_mappedLru.append(segIndex);
+        return mapped;
+    }
+
+    mapped = new MappedSegment(m_segments[segIndex].segPath);
+    if (!mapped->open()) {
+        delete mapped;
+        return nullptr;
+    }
+    m_mapped.insert(segIndex, mapped);
+    m_mappedLru.append(segIndex);
+
+    // 只保留最近用到的几个映射，长时间归档也不会占满地址空间
+    while (m_mappedLru.size() > MAX_MAPPED_SEGMENTS) {
+        int victim = m_mappedLru.takeFirst();
+        if (victim == m_curSegment || victim == segIndex) {
+            m_mappedLru.append(victim);
+            continue;
+        }
+        delete m_mapped.take(victim);
+    }
+    return mapped;
+}
+
+int PlaybackEngine::segmentAtOrBefore(qint64 tsMs) const
+{
+    auto it = std::upper_bound(m_segments.begin(), m_segments.end(), tsMs,
+        [](qint64 ts, const SegmentInfo &s){ return ts < s.firstMs; });
+    return int(it - m_segments.begin()) - 1;
+}
+
+bool PlaybackEngine::locate(qint64 tsMs, int *segIndex, int *frameIndex)
+{
+    if (m_segments.isEmpty()) {
+        return false;
+    }
+    int s = qMax(0, segmentAtOrBefore(tsMs));
+    MappedSegment *mapped = segment(s);
+    if (!mapped) {
+        return false;
+    }
+    *segIndex = s;
+    *frameIndex = qMax(0, mapped->indexAtOrBefore(tsMs));
+    return true;
+}
+
+void PlaybackEngine::showFrame(int segIndex, int frameIndex)
+{
+    if (segIndex == m_curSegment && frameIndex == m_curFrame) {
+        return;
+    }
+    MappedSegment *mapped = segment(segIndex);
+    if (!mapped || frameIndex < 0 || frameIndex >= mapped->frameCount()) {
+        return;
+    }
+    m_curSegment = segIndex;
+    m_curFrame = frameIndex;
+    const SegmentFormat::IndexRecord &r = mapped->record(frameIndex);
+    emit frameReady(mapped->frameData(frameIndex), r.timestampMs, r.seq);
+}
+
+void PlaybackEngine::prefetchAhead()
+{
+    MappedSegment *mapped = m_mapped.value(m_curSegment, nullptr);
+    if (!mapped) {
+        return;
+    }
+    int n = int(PREFETCH_FRAMES * qMax(1.0, qAbs(m_speed)));
+    if (m_speed >= 0) {
+        mapped->prefetch(m_curFrame, m_curFrame + n);
+        int remain = m_curFrame + n - (mapped->frameCount() - 1);
+        if (remain > 0 && m_curSegment + 1 < m_segments.size()) {
+            if (MappedSegment *next = segment(m_curSegment + 1)) {
+                next->prefetch(0, remain);
+            }
+        }
+    } else {
+        mapped->prefetch(m_curFrame - n, m_curFrame);
+        int remain = n - m_curFrame;
+        if (remain > 0 && m_curSegment > 0) {
+            if (MappedSegment *prev = segment(m_curSegment - 1)) {
+                prev->prefetch(prev->frameCount() - 1 - remain, prev->frameCount() - 1);
+            }
+        }
+    }
+}
+
+/**
+ * @brief 播放到末尾时跟上仍在写入的录像
+ * 平时只重读最后一个分段的索引看它是否增长；录像换了新分段时它才会停止增长，
+ * 此时再扫描整个目录，且限制扫描频率，避免每个 tick 都遍历全部索引文件。
+ */
+bool PlaybackEngine::refreshTail()
+{
+    if (m_segments.isEmpty()) {
+        return false;
+    }
+    int oldLast = m_segments.size() - 1;
+    SegmentInfo tail;
+    if (readSegmentInfo(SegmentFormat::indexPathForSegment(m_segments[oldLast].segPath), &tail)
+        && tail.lastMs > endMs()) {
+        m_segments[oldLast] = tail;
+    } else {
+        if (m_rescanClock.isValid() && m_rescanClock.elapsed() < RESCAN_INTERVAL_MS) {
+            return false;
+        }
+        m_rescanClock.start();
+        QVector<SegmentInfo> list = scanSegments(m_rootDir, m_camId);
+        if (list.isEmpty() || list.last().lastMs <= endMs()) {
+            return false;
+        }
+        // 录像端会从头部淘汰旧分段，已有下标可能整体前移
+        QString tailPath = m_segments[oldLast].segPath;
+        adoptSegments(list);
+        oldLast = -1;
+        for (int i = m_segments.size() - 1; i >= 0; i--) {
+            if (m_segments[i].segPath == tailPath) {
+                oldLast = i;
+                break;
+            }
+        }
+    }
+    // 原来的最后一个分段可能仍在增长，重新映射
+    if (MappedSegment *mapped = m_mapped.value(oldLast, nullptr)) {
+        mapped->refresh();
+    }
+    emit rangeChanged(startMs(), endMs());
+    return true;
+}
+
+/**
+ * @brief 换用重新扫描得到的分段列表
+ * 映射缓存、LRU 与当前分段都按下标记录，这里按路径换算到新下标；
+ * 已被淘汰删除的分段释放映射。
+ */
+void PlaybackEngine::adoptSegments(const QVector<SegmentInfo> &list)
+{
+    QHash<QString, int> newIndex;
+    for (int i = 0; i < list.size(); i++) {
+        newIndex.insert(list[i].segPath, i);
+    }
+    QHash<int, int> remap;      // 旧下标 -> 新下标
+    QHash<int, MappedSegment *> mapped;
+    for (auto it = m_mapped.begin(); it != m_mapped.end(); ++it) {
+        int idx = newIndex.value(m_segments[it.key()].segPath, -1);
+        if (idx < 0) {
+            delete it.value();
+            continue;
+        }
+        remap.insert(it.key(), idx);
+        mapped.insert(idx, it.value());
+    }
+    QList<int> lru;
+    for (int oldIdx : m_mappedLru) {
+        if (remap.contains(oldIdx)) {
+            lru.append(remap.value(oldIdx));
+        }
+    }
+    if (m_curSegment >= 0) {
+        int idx = newIndex.value(m_segments[m_curSegment].segPath, -1);
+        m_curSegment = idx;
+        if (idx < 0) {
+            m_curFrame = -1;
+        }
+    }
+    m_mapped = mapped;
+    m_mappedLru = lru;
+    m_segments = list;
+}
+
+void PlaybackEngine::seek(qint64 tsMs)
+{
+    if (m_segments.isEmpty()) {
+        return;
+    }
+    m_positionMs = qBound(startMs(), tsMs, endMs());
+    int s = 0, f = 0;
+    if (locate(qint64(m_positionMs), &s, &f)) {
+        m_curFrame = -1;    // 强制刷新当前画面
+        showFrame(s, f);
+        prefetchAhead();
+    }
+    m_tickClock.restart();
+    emit positionChanged(qint64(m_positionMs));
+}
+
+void PlaybackEngine::play()
+{
+    if (m_segments.isEmpty() || m_timer->isActive()) {
+        return;
+    }
+    if (m_speed > 0 && qint64(m_positionMs) >= endMs()) {
+        seek(startMs());
+    } else if (m_speed < 0 && qint64(m_positionMs) <= startMs()) {
+        seek(endMs());
+    }
+    m_tickClock.start();
+    m_timer->start();
+    emit playingChanged(true);
+}
+
+void PlaybackEngine::pause()
+{
+    if (!m_timer->isActive()) {
+        return;
+    }
+    m_timer->stop();
+    emit playingChanged(false);
+}
+
+void PlaybackEngine::setSpeed(double speed)
+{
+    if (qFuzzyIsNull(speed)) {
+        return;
+    }
+    m_speed = speed;
+    m_tickClock.restart();
+    prefetchAhead();
+}
+
+void PlaybackEngine::stepFrame(int delta)
+{
+    pause();
+    if (m_curSegment < 0) {
+        return;
+    }
+    int s = m_curSegment;
+    int f = m_curFrame + delta;
+    while (true) {
+        MappedSegment *mapped = segment(s);
+        if (!mapped) {
+            return;
+        }
+        if (f >= mapped->frameCount()) {
+            if (s + 1 >= m_segments.size()) {
+                f = mapped->frameCount() - 1;
+                break;
+            }
+            f -= mapped->frameCount();
+            s++;
+        } else if (f < 0) {
+            if (s == 0) {
+                f = 0;
+                break;
+            }
+            s--;
+            MappedSegment *prev = segment(s);
+            if (!prev) {
+                return;
+            }
+            f += prev->frameCount();
+        } else {
+            break;
+        }
+    }
+    showFrame(s, f);
+    m_positionMs = segment(s)->record(f).timestampMs;
+    emit positionChanged(qint64(m_positionMs));
+}
+
+void PlaybackEngine::onTick()
+{
+    qint64 dt = m_tickClock.restart();
+    m_positionMs += dt * m_speed;
+
+    // 跳过分段之间的空档 (相机离线/未录像的时段)
+    if (m_curSegment >= 0) {
+        if (m_speed > 0 && m_curSegment + 1 < m_segments.size()
+            && m_positionMs > m_segments[m_curSegment].lastMs
+            && m_positionMs < m_segments[m_curSegment + 1].firstMs) {
+            m_positionMs = m_segments[m_curSegment + 1].firstMs;
+        } else if (m_speed < 0 && m_curSegment > 0
+                   && m_positionMs < m_segments[m_curSegment].firstMs
+                   && m_positionMs > m_segments[m_curSegment - 1].lastMs) {
+            m_positionMs = m_segments[m_curSegment - 1].lastMs;
+        }
+    }
+
+    bool reachedEnd = false;
+    if (m_speed > 0 && m_positionMs >= endMs()) {
+        // 录像仍在写入时继续跟随，否则停在最后一帧
+        reachedEnd = !refreshTail();
+        m_positionMs = qMin(m_positionMs, double(endMs()));
+    } else if (m_speed < 0 && m_positionMs <= startMs()) {
+        reachedEnd = true;
+        m_positionMs = startMs();
+    }
+
+    int s = 0, f = 0;
+    if (locate(qint64(m_positionMs), &s, &f)) {
+        bool crossed = (s != m_curSegment);
+        showFrame(s, f);
+        if (crossed || f % 10 == 0) {
+            prefetchAhead();
+        }
+    }
+    emit positionChanged(qint64(m_positionMs));
+
+    if (reachedEnd) {
+        pause();
+    }
+}
+
+// ==========================================
+// 外部时钟驱动
+// ==========================================
+void PlaybackEngine::requestPosition(qint64 tsMs)
+{
+    m_requestedMs = tsMs;
+    if (!m_requestScheduled.exchange(true)) {
+        QMetaObject::invokeMethod(this, [=](){
+            m_requestScheduled = false;
+            displayNearest(m_requestedMs);
+        }, Qt::QueuedConnection);
+    }
+}
+
+double PlaybackEngine::framePeriodMs() const
+{
+    int frames = 0;
+    for (const SegmentInfo &info : m_segments) {
+        frames += info.frames;
+    }
+    qint64 span = 0;
+    for (const SegmentInfo &info : m_segments) {
+        span += info.lastMs - info.firstMs;
+    }
+    return frames > m_segments.size() ? double(span) / (frames - m_segments.size()) : 0;
+}
+
+void PlaybackEngine::displayNearest(qint64 tsMs)
+{
+    if (m_segments.isEmpty() || tsMs < startMs() || tsMs > endMs()) {
+        return; // 本路在该时刻没有录像，保持上一帧
+    }
+    int s = 0, f = 0;
+    if (!locate(tsMs, &s, &f)) {
+        return;
+    }
+    // at-or-before 与其后一帧比较，取时间更近的一帧
+    MappedSegment *mapped = segment(s);
+    int ns = s, nf = f + 1;
+    if (nf >= mapped->frameCount()) {
+        ns = s + 1;
+        nf = 0;
+    }
+    if (ns < m_segments.size()) {
+        MappedSegment *next = segment(ns);
+        if (next && next->record(nf).timestampMs - tsMs < tsMs - mapped->record(f).timestampMs) {
+            s = ns;
+            f = nf;
+        }
+    }
+    bool crossed = (s != m_curSegment);
+    m_positionMs = tsMs;
+    showFrame(s, f);
+    if (crossed || f % 10 == 0) {
+        prefetchAhead();
+    }
+}
@@ -0,0 +1,139 @@
+#ifndef PLAYBACKENGINE_H
+#define PLAYBACKENGINE_H
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+#include <QVector>
+#include <QHash>
+#include <QList>
+#include <QElapsedTimer>
+#include <atomic>
+#include "segmentformat.h"
+
+// 一个录像分段的概要 (扫描目录时只读索引头尾，不读数据)
+struct SegmentInfo {
+    QString segPath;
+    qint64 firstMs = 0;
+    qint64 lastMs = 0;
+    int frames = 0;
+};
+
+/**
+ * @brief 内存映射的单个录像分段
+ * .seg 与 .idx 都用 QFile::map 映射，取帧只是一次指针偏移 + 拷贝，
+ * 定位用索引上的二分查找。仍在写入的分段可调用 refresh() 重新映射以看到新帧。
+ */
+class MappedSegment
+{
+public:
+    explicit MappedSegment(const QString &segPath);
+    ~MappedSegment();
+
+    bool open();
+    bool refresh();
+    bool isOpen() const { return m_records != nullptr; }
+
+    int frameCount() const { return m_count; }
+    const SegmentFormat::IndexRecord &record(int i) const { return m_records[i]; }
+    // 时间戳 <= tsMs 的最后一帧，全部晚于 tsMs 时返回 -1
+    int indexAtOrBefore(qint64 tsMs) const;
+    QByteArray frameData(int i) const;
+    // 不拷贝，直接指向映射内存，仅在本对象存活期间有效 (导出等顺序读取用)
+    QByteArray frameView(int i) const;
+    // 提示内核预读 [first, last] 帧所在的页 (仅 Unix，其它平台为空操作)
+    void prefetch(int first, int last) const;
+
+private:
+    QFile m_segFile;
+    QFile m_idxFile;
+    uchar *m_segMap = nullptr;
+    uchar *m_idxMap = nullptr;
+    qint64 m_segSize = 0;
+    const SegmentFormat::IndexRecord *m_records = nullptr;
+    int m_count = 0;
+
+    void unmap();
+};
+
+/**
+ * @brief 录像回放引擎
+ * 打开某路相机的全部分段后，以毫秒时间轴作为播放位置：
+ * 定位 = 分段二分 + 帧索引二分，O(log n)，与归档长度无关；
+ * 播放时按倍速推进位置 (负值为倒放)，单帧步进直接移动帧下标。
+ * 输出的是原始 JPEG，交给与实时画面相同的显示控件解码。
+ */
+class PlaybackEngine : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PlaybackEngine(QObject *parent = nullptr);
+    ~PlaybackEngine();
+
+    void setRootDir(const QString &dir) { m_rootDir = dir; }
+    static QVector<SegmentInfo> scanSegments(const QString &rootDir, int camId);
+
+    // 打开某路相机的录像，seekToStart 时定位到最早一帧 (外部时钟驱动时不需要)
+    bool openCamera(int camId, bool seekToStart = true);
+    void close();
+    int cameraId() const { return m_camId; }
+
+    qint64 startMs() const { return m_segments.isEmpty() ? 0 : m_segments.first().firstMs; }
+    qint64 endMs() const { return m_segments.isEmpty() ? 0 : m_segments.last().lastMs; }
+    qint64 positionMs() const { return qint64(m_positionMs); }
+    bool isPlaying() const { return m_timer->isActive(); }
+    double speed() const { return m_speed; }
+
+public slots:
+    void seek(qint64 tsMs);
+    void play();
+    void pause();
+    void setSpeed(double speed);    // 1.0 正常，2.0 两倍速，-1.0 倒放
+    void stepFrame(int delta);      // 暂停并前后移动 delta 帧
+
+public:
+    // --- 外部主时钟驱动 (多路同步回放) ---
+    // 线程安全：只记录目标时间，引擎所在线程空闲时处理最新的一个，忙时自动合并
+    void requestPosition(qint64 tsMs);
+    // 估算平均帧间隔 (毫秒)，没有录像时返回 0
+    double framePeriodMs() const;
+
+signals:
+    void frameReady(const QByteArray &jpeg, qint64 timestampMs, quint64 seq);
+    void positionChanged(qint64 tsMs);
+    void playingChanged(bool playing);
+    void rangeChanged(qint64 startMs, qint64 endMs);
+
+private:
+    static const int MAX_MAPPED_SEGMENTS = 4;   // 同时保持映射的分段数
+    static const int PREFETCH_FRAMES = 50;      // 播放方向上预读的帧数 (按倍速放大)
+    static const int RESCAN_INTERVAL_MS = 1000; // 跟随写入时重新扫描目录的最小间隔
+
+    QString m_rootDir;
+    int m_camId = -1;
+    QVector<SegmentInfo> m_segments;            // 按起始时间排序
+    QHash<int, MappedSegment *> m_mapped;       // 分段下标 -> 映射
+    QList<int> m_mappedLru;                     // 最近使用在尾部
+
+    QTimer *m_timer;
+    QElapsedTimer m_tickClock;
+    QElapsedTimer m_rescanClock;                // 上次扫描目录的时间
+    double m_speed = 1.0;
+    double m_positionMs = 0;    // 倍速推进会产生小数毫秒
+    int m_curSegment = -1;
+    int m_curFrame = -1;
+    std::atomic<qint64> m_requestedMs{0};
+    std::atomic<bool> m_requestScheduled{false};
+
+    MappedSegment *segment(int segIndex);
+    int segmentAtOrBefore(qint64 tsMs) const;
+    bool locate(qint64 tsMs, int *segIndex, int *frameIndex);
+    void showFrame(int segIndex, int frameIndex);
+    void prefetchAhead();
+    void adoptSegments(const QVector<SegmentInfo> &list);
+    bool refreshTail();     // 播放到末尾时重新扫描，跟上仍在写入的录像
+    void onTick();
+    void displayNearest(qint64 tsMs);   // 显示时间上最近的一帧，与当前相同则保持
+};
+
+#endif // PLAYBACKENGINE_H
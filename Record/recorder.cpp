@@ -0,0 +1,787 @@
+#include "recorder.h"
+#include <QCoreApplication>
+#include <QSettings>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QDir>
+#include <QTimer>
+#include <QMutexLocker>
+#include <QDirIterator>
+#include <QStorageInfo>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static const qint64 WRITE_ALIGN = 4096;         // 整块写入的文件偏移对齐
+static const int QUOTA_CHECK_MS = 10000;        // 没有分段关闭时的配额检查间隔
+
+// 把文件数据 (不含元数据) 刷到磁盘
+static void syncFileData(QFile *file)
+{
+    file->flush();
+#if defined(Q_OS_WIN)
+    _commit(file->handle());
+#elif defined(Q_OS_LINUX)
+    ::fdatasync(file->handle());
+#else
+    ::fsync(file->handle());
+#endif
+}
+
+// 为文件预留磁盘空间但不改变文件长度，读方看到的大小仍是实际写入的数据
+static void preallocateFile(QFile *file, qint64 bytes)
+{
+#if defined(Q_OS_WIN)
+    FILE_ALLOCATION_INFO info;
+    info.AllocationSize.QuadPart = bytes;
+    SetFileInformationByHandle(HANDLE(_get_osfhandle(file->handle())), FileAllocationInfo, &info, sizeof(info));
+#elif defined(Q_OS_LINUX)
+    ::fallocate(file->handle(), FALLOC_FL_KEEP_SIZE, 0, bytes);
+#else
+    Q_UNUSED(file)
+    Q_UNUSED(bytes)
+#endif
+}
+
+static qint64 segmentFilesSize(const QString &segPath)
+{
+    return QFileInfo(segPath).size() + QFileInfo(SegmentFormat::indexPathForSegment(segPath)).size()
+           + QFileInfo(SegmentFormat::thumbPathForSegment(segPath)).size();
+}
+
+Recorder::Recorder(QObject *parent)
+    : QObject{parent}
+{
+    QString configPath = QCoreApplication::applicationDirPath() + "/config.ini";
+    QSettings settings(configPath, QSettings::IniFormat);
+    settings.beginGroup("Recording");
+    m_enabled = settings.value("Enabled", false).toBool();
+    m_rootDir = settings.value("RootDir", QCoreApplication::applicationDirPath() + "/recordings").toString();
+    m_segmentMs = qMax(1, settings.value("SegmentSeconds", 60).toInt()) * 1000ll;
+    m_segmentMaxBytes = quint64(qMax(1, settings.value("SegmentMaxMb", 256).toInt())) << 20;
+    m_flushIntervalMs = qMax(10, settings.value("FlushIntervalMs", 250).toInt());
+    m_syncIntervalMs = qMax(0, settings.value("SyncIntervalMs", 2000).toInt());
+    m_maxPendingBytes = qint64(qMax(1, settings.value("MaxPendingMb", 64).toInt())) << 20;
+    m_thumbIntervalMs = qMax(0, settings.value("ThumbIntervalMs", 2000).toInt());
+    int thumbWidth = qBound(16, settings.value("ThumbWidth", 160).toInt(), 1024);
+    m_motionMode = settings.value("Mode", "continuous").toString().compare("motion", Qt::CaseInsensitive) == 0;
+    m_preRollMs = qMax(0, settings.value("PreRollSeconds", 5).toInt()) * 1000ll;
+    m_postRollMs = qMax(1, settings.value("PostRollSeconds", 10).toInt()) * 1000ll;
+    m_preRollBudgetBytes = qint64(qMax(1, settings.value("PreRollBudgetMb", 128).toInt())) << 20;
+    m_preallocate = settings.value("Preallocate", true).toBool();
+    m_writeChunkBytes = qBound(4, settings.value("WriteChunkKb", 1024).toInt(), 65536) * 1024;
+    m_spareSegments = qMax(0, settings.value("SpareSegments", 8).toInt());
+    m_cameraQuotaBytes = qint64(qMax(0.0, settings.value("CameraQuotaGb", 0).toDouble()) * (1ll << 30));
+    m_totalQuotaBytes = qint64(qMax(0.0, settings.value("TotalQuotaGb", 0).toDouble()) * (1ll << 30));
+    m_minFreeBytes = qint64(qMax(0.0, settings.value("MinFreeGb", 5).toDouble()) * (1ll << 30));
+    settings.endGroup();
+
+    if (m_thumbIntervalMs > 0) {
+        m_thumbWriter = new ThumbnailWriter(thumbWidth, m_thumbIntervalMs, this);
+    }
+
+    if (m_motionMode) {
+        m_motionTimer = new QTimer(this);
+        connect(m_motionTimer, &QTimer::timeout, this, [=](){ closeEvents(false); });
+        m_motionTimer->start(500);
+    }
+
+    m_worker = new QObject;
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread.setObjectName("Recorder");
+    m_thread.start();
+
+    // 定时器必须在写线程中创建
+    QMetaObject::invokeMethod(m_worker, [=](){
+        m_syncClock.start();
+        m_quotaClock.start();
+        scanStorage();
+        enforceQuota();
+        QTimer *timer = new QTimer(m_worker);
+        connect(timer, &QTimer::timeout, m_worker, [=](){ flush(); });
+        timer->start(m_flushIntervalMs);
+    }, Qt::QueuedConnection);
+}
+
+Recorder::~Recorder()
+{
+    // 写完队列中剩余的帧并关闭所有分段
+    QMetaObject::invokeMethod(m_worker, [=](){
+        flush();
+        closeAll();
+    }, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void Recorder::setEnabled(bool enabled)
+{
+    if (!enabled) {
+        // 正在进行的事件先记下来，已写入的录像仍能按事件查到
+        closeEvents(true);
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_enabled == enabled) {
+            return;
+        }
+        m_enabled = enabled;
+        if (!enabled) {
+            m_motion.clear();
+            m_preRollBytes = 0;
+        }
+    }
+    if (!enabled) {
+        QMetaObject::invokeMethod(m_worker, [=](){
+            flush();
+            closeAll();
+        }, Qt::QueuedConnection);
+    }
+}
+
+void Recorder::submitFrame(int camId, const QByteArray &jpeg)
+{
+    if (jpeg.isEmpty()) {
+        return;
+    }
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QMutexLocker locker(&m_mutex);
+    if (!m_enabled) {
+        return;
+    }
+    PendingFrame frame;
+    frame.seq = m_nextSeq[camId]++;
+    frame.timestampMs = now;
+    frame.data = jpeg;
+
+    if (m_motionMode) {
+        MotionState &motion = m_motion[camId];
+        if (now > motion.recordUntilMs) {
+            // 没有运动：只进预录缓冲，按时长和全局预算裁掉最旧的帧
+            motion.preRoll.enqueue(frame);
+            motion.preRollBytes += jpeg.size();
+            m_preRollBytes += jpeg.size();
+            while (!motion.preRoll.isEmpty()
+                   && (now - motion.preRoll.head().timestampMs > m_preRollMs
+                       || m_preRollBytes > m_preRollBudgetBytes)) {
+                qint64 size = motion.preRoll.dequeue().data.size();
+                motion.preRollBytes -= size;
+                m_preRollBytes -= size;
+            }
+            return;
+        }
+        motion.lastRecordedMs = now;
+    }
+    enqueueLocked(camId, frame);
+}
+
+// 调用方持有 m_mutex
+void Recorder::enqueueLocked(int camId, const PendingFrame &frame, bool force)
+{
+    if (!force && m_pendingBytes + frame.data.size() > m_maxPendingBytes) {
+        // 磁盘跟不上时宁可丢帧也不无限占用内存；序号照常递增，回放可据此发现缺口
+        m_stats.framesDropped++;
+        return;
+    }
+    m_pending[camId].append(frame);
+    m_pendingBytes += frame.data.size();
+
+    FrameRef &latest = m_latest[camId];
+    latest.seq = frame.seq;
+    latest.timestampMs = frame.timestampMs;
+}
+
+void Recorder::triggerMotion(int camId, double score)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QMutexLocker locker(&m_mutex);
+    if (!m_enabled || !m_motionMode) {
+        return;
+    }
+    MotionState &motion = m_motion[camId];
+    motion.recordUntilMs = now + m_postRollMs;
+    if (motion.eventStartMs < 0) {
+        // 新事件：先把预录的帧按顺序写入
+        motion.peakScore = score;
+        motion.eventStartMs = motion.preRoll.isEmpty() ? now : motion.preRoll.head().timestampMs;
+        motion.lastRecordedMs = motion.eventStartMs;
+        while (!motion.preRoll.isEmpty()) {
+            PendingFrame frame = motion.preRoll.dequeue();
+            motion.lastRecordedMs = frame.timestampMs;
+            enqueueLocked(camId, frame, true);
+        }
+        m_preRollBytes -= motion.preRollBytes;
+        motion.preRollBytes = 0;
+    } else {
+        motion.peakScore = qMax(motion.peakScore, score);
+    }
+}
+
+void Recorder::closeEvents(bool all)
+{
+    struct Event {
+        int camId;
+        qint64 startMs;
+        qint64 endMs;
+        double peak;
+    };
+    QVector<Event> events;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    {
+        QMutexLocker locker(&m_mutex);
+        for (auto it = m_motion.begin(); it != m_motion.end(); ++it) {
+            MotionState &motion = it.value();
+            if (motion.eventStartMs >= 0 && (all || now > motion.recordUntilMs)) {
+                events.append({it.key(), motion.eventStartMs, motion.lastRecordedMs, motion.peakScore});
+                motion.eventStartMs = -1;
+                motion.peakScore = 0;
+            }
+        }
+    }
+    for (const Event &event : events) {
+        emit motionEvent(event.camId, event.startMs, event.endMs, event.peak);
+    }
+}
+
+void Recorder::setSegmentProtected(const QString &segPath, bool protect)
+{
+    QMetaObject::invokeMethod(m_worker, [=](){
+        QString keepPath = SegmentFormat::keepPathForSegment(segPath);
+        if (protect) {
+            QFile keep(keepPath);
+            keep.open(QIODevice::WriteOnly);
+        } else {
+            QFile::remove(keepPath);
+        }
+        for (QMap<qint64, StoredSegment> &segments : m_stored) {
+            for (StoredSegment &stored : segments) {
+                if (stored.segPath == segPath) {
+                    stored.keep = protect;
+                }
+            }
+        }
+        if (!protect) {
+            m_quotaDirty = true;
+        }
+    }, Qt::QueuedConnection);
+}
+
+Recorder::Stats Recorder::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    Stats stats = m_stats;
+    if (!m_writeLatencyUs.isEmpty()) {
+        QVector<qint64> sorted = m_writeLatencyUs;
+        std::sort(sorted.begin(), sorted.end());
+        auto at = [&](double p) { return sorted[qMin(sorted.size() - 1, int(p * sorted.size()))]; };
+        stats.writeP50Us = at(0.50);
+        stats.writeP95Us = at(0.95);
+        stats.writeP99Us = at(0.99);
+        stats.writeMaxUs = sorted.last();
+    }
+    return stats;
+}
+
+void Recorder::recordWriteLatency(qint64 us)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_writeLatencyUs.size() < WRITE_LATENCY_SAMPLES) {
+        m_writeLatencyUs.append(us);
+    } else {
+        m_writeLatencyUs[m_writeLatencyPos] = us;
+        m_writeLatencyPos = (m_writeLatencyPos + 1) % WRITE_LATENCY_SAMPLES;
+    }
+}
+
+QHash<int, Recorder::FrameRef> Recorder::latestFrames() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_latest;
+}
+
+// ==========================================
+// 以下在写线程执行
+// ==========================================
+bool Recorder::openSegment(int camId, qint64 createdMs, Segment *out)
+{
+    QString base = QDir(m_rootDir).filePath(SegmentFormat::segmentBaseName(camId, createdMs));
+    QDir().mkpath(QFileInfo(base).absolutePath());
+
+    // 备用池里有旧文件就改名复用：已分配的磁盘块原地覆盖写，旧数据在关闭时截掉
+    // 数据自己攒成整块再写，不经过 QFile 的缓冲
+    const bool reused = takeSpare(base + ".seg");
+    QFile *seg = new QFile(base + ".seg");
+    QFile *idx = new QFile(base + ".idx");
+    QIODevice::OpenMode segMode = reused ? QIODevice::ReadWrite : (QIODevice::WriteOnly | QIODevice::Truncate);
+    if (!seg->open(segMode | QIODevice::Unbuffered)
+        || !idx->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        emit writeError(camId, seg->isOpen() ? idx->errorString() : seg->errorString());
+        delete seg;
+        delete idx;
+        return false;
+    }
+
+    SegmentFormat::IndexHeader header;
+    std::memcpy(header.magic, SegmentFormat::INDEX_MAGIC, sizeof(header.magic));
+    header.version = SegmentFormat::INDEX_VERSION;
+    header.cameraId = quint32(camId);
+    header.createdMs = createdMs;
+    header.recordSize = sizeof(SegmentFormat::IndexRecord);
+    header.reserved = 0;
+    idx->write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (m_preallocate) {
+        preallocateFile(seg, qint64(m_segmentMaxBytes));
+    }
+    if (reused) {
+        QMutexLocker locker(&m_mutex);
+        m_stats.segmentsReused++;
+    }
+
+    out->seg = seg;
+    out->idx = idx;
+    out->createdMs = createdMs;
+    out->firstMs = createdMs;
+    out->lastMs = createdMs;
+    out->bytes = 0;
+    out->frames = 0;
+    out->dirty = true;
+    return true;
+}
+
+void Recorder::closeSegment(int camId)
+{
+    auto it = m_segments.find(camId);
+    if (it == m_segments.end()) {
+        return;
+    }
+    Segment segment = it.value();
+    m_segments.erase(it);
+
+    // 写出剩余数据，截掉复用文件的旧数据和多余的预分配空间
+    writeOut(camId, segment, true);
+    segment.seg->resize(qint64(segment.bytesOnDisk));
+
+    // 先落盘数据再落盘索引：索引永远不会指向不存在的数据
+    syncFileData(segment.seg);
+    syncFileData(segment.idx);
+    QString segPath = segment.seg->fileName();
+    QString idxPath = segment.idx->fileName();
+    if (m_thumbWriter) {
+        m_thumbWriter->closeSegment(segPath);
+    }
+    segment.seg->close();
+    segment.idx->close();
+    delete segment.seg;
+    delete segment.idx;
+
+    if (segment.frames == 0) {
+        QFile::remove(segPath);
+        QFile::remove(idxPath);
+        return;
+    }
+
+    StoredSegment stored;
+    stored.segPath = segPath;
+    stored.bytes = segmentFilesSize(segPath);
+    m_stored[camId].insert(segment.createdMs, stored);
+    m_storedBytes[camId] += stored.bytes;
+    m_quotaDirty = true;
+    emit segmentClosed(camId, segPath, segment.firstMs, segment.lastMs, segment.frames);
+}
+
+void Recorder::closeAll()
+{
+    const QList<int> cams = m_segments.keys();
+    for (int camId : cams) {
+        closeSegment(camId);
+    }
+    QMutexLocker locker(&m_mutex);
+    m_stats.openSegments = 0;
+}
+
+bool Recorder::writeBatch(int camId, Segment &segment, const QByteArray &payload, const QByteArray &records)
+{
+    if (payload.isEmpty()) {
+        return true;
+    }
+    segment.payloadBuf.append(payload);
+    segment.recordBuf.append(records);
+    return writeOut(camId, segment, false);
+}
+
+// 把攒下的数据写出到 .seg：平时只在攒够 WriteChunkKb 时写，且写到 4 KB 对齐的偏移为止；
+// drain 时 (sync/关闭) 全部写出。然后追加数据已完整写出的那些帧的索引
+bool Recorder::writeOut(int camId, Segment &segment, bool drain)
+{
+    qint64 len = segment.payloadBuf.size();
+    if (!drain) {
+        if (len < m_writeChunkBytes) {
+            return true;
+        }
+        qint64 alignedEnd = qint64(segment.bytesOnDisk + quint64(len)) / WRITE_ALIGN * WRITE_ALIGN;
+        len = alignedEnd - qint64(segment.bytesOnDisk);
+    }
+    if (len > 0) {
+        QElapsedTimer cost;
+        cost.start();
+        if (segment.seg->write(segment.payloadBuf.constData(), len) != len) {
+            emit writeError(camId, segment.seg->errorString());
+            return false;
+        }
+        recordWriteLatency(cost.nsecsElapsed() / 1000);
+        segment.payloadBuf.remove(0, int(len));
+        segment.bytesOnDisk += quint64(len);
+        segment.dirty = true;
+    }
+
+    const int recordSize = sizeof(SegmentFormat::IndexRecord);
+    int ready = 0;
+    while (ready + recordSize <= segment.recordBuf.size()) {
+        SegmentFormat::IndexRecord record;
+        std::memcpy(&record, segment.recordBuf.constData() + ready, sizeof(record));
+        if (record.offset + record.size > segment.bytesOnDisk) {
+            break;
+        }
+        ready += recordSize;
+    }
+    if (ready > 0) {
+        if (segment.idx->write(segment.recordBuf.constData(), ready) != ready) {
+            emit writeError(camId, segment.idx->errorString());
+            return false;
+        }
+        segment.recordBuf.remove(0, ready);
+    }
+    return true;
+}
+
+void Recorder::flush()
+{
+    QHash<int, QVector<PendingFrame>> batch;
+    {
+        QMutexLocker locker(&m_mutex);
+        batch.swap(m_pending);
+        m_pendingBytes = 0;
+    }
+
+    QElapsedTimer cost;
+    cost.start();
+    quint64 frames = 0;
+    quint64 bytes = 0;
+    quint64 dropped = 0;
+
+    for (auto it = batch.begin(); it != batch.end(); ++it) {
+        const int camId = it.key();
+        const QVector<PendingFrame> &list = it.value();
+        QByteArray payload;
+        QByteArray records;
+
+        for (int i = 0; i < list.size(); i++) {
+            const PendingFrame &frame = list[i];
+            auto segIt = m_segments.find(camId);
+            bool rotate = segIt == m_segments.end()
+                          || frame.timestampMs - segIt->createdMs >= m_segmentMs
+                          || segIt->bytes + quint64(frame.data.size()) > m_segmentMaxBytes;
+            if (rotate) {
+                if (segIt != m_segments.end()) {
+                    writeBatch(camId, *segIt, payload, records);
+                    payload.clear();
+                    records.clear();
+                    closeSegment(camId);
+                }
+                Segment segment;
+                if (!openSegment(camId, frame.timestampMs, &segment)) {
+                    // 打不开新分段 (磁盘满、权限等)：这一批剩下的帧丢弃，每次故障只记一次日志
+                    dropped += quint64(list.size() - i);
+                    if (!m_openFailing) {
+                        m_openFailing = true;
+                        qDebug() << "相机" << camId << "无法创建录像分段，丢弃待写帧";
+                    }
+                    break;
+                }
+                m_openFailing = false;
+                segIt = m_segments.insert(camId, segment);
+            }
+
+            SegmentFormat::IndexRecord record;
+            record.seq = frame.seq;
+            record.timestampMs = frame.timestampMs;
+            record.offset = segIt->bytes;
+            record.size = quint32(frame.data.size());
+            record.flags = 0;
+            records.append(reinterpret_cast<const char *>(&record), sizeof(record));
+            payload.append(frame.data);
+
+            // 按间隔挑帧交给缩略图线程 (解码不在本线程进行)
+            if (m_thumbWriter && (segIt->lastThumbMs < 0
+                                  || frame.timestampMs - segIt->lastThumbMs >= m_thumbIntervalMs)) {
+                m_thumbWriter->submit(segIt->seg->fileName(), segIt->createdMs, frame.timestampMs,
+                                      frame.seq, frame.data);
+                segIt->lastThumbMs = frame.timestampMs;
+            }
+            if (segIt->frames == 0) {
+                segIt->firstMs = frame.timestampMs;
+            }
+            segIt->lastMs = frame.timestampMs;
+            segIt->bytes += frame.data.size();
+            segIt->frames++;
+            frames++;
+            bytes += frame.data.size();
+        }
+
+        auto segIt = m_segments.find(camId);
+        if (segIt != m_segments.end()) {
+            writeBatch(camId, *segIt, payload, records);
+        }
+    }
+
+    // 空闲的分段 (相机断流) 超过一个分段时长后关闭，回放侧即可看到完整文件
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const QList<int> cams = m_segments.keys();
+    for (int camId : cams) {
+        if (now - m_segments.value(camId).lastMs >= m_segmentMs) {
+            closeSegment(camId);
+        }
+    }
+
+    if (m_syncClock.elapsed() >= m_syncIntervalMs) {
+        syncDirty();
+        m_syncClock.restart();
+    }
+
+    if (m_quotaDirty || m_quotaClock.elapsed() >= QUOTA_CHECK_MS) {
+        enforceQuota();
+    }
+
+    if (dropped > 0) {
+        QMutexLocker locker(&m_mutex);
+        m_stats.framesDropped += dropped;
+    }
+    if (frames > 0) {
+        qint64 us = cost.nsecsElapsed() / 1000;
+        QMutexLocker locker(&m_mutex);
+        m_stats.framesWritten += frames;
+        m_stats.bytesWritten += bytes;
+        m_stats.lastFlushUs = us;
+        m_stats.maxFlushUs = qMax(m_stats.maxFlushUs, us);
+        m_stats.openSegments = m_segments.size();
+    }
+}
+
+void Recorder::syncDirty()
+{
+    for (auto it = m_segments.begin(); it != m_segments.end(); ++it) {
+        Segment &segment = it.value();
+        // 不满一块的尾巴也写出去，回放侧最多晚 SyncIntervalMs 看到
+        writeOut(it.key(), segment, true);
+        if (!segment.dirty) {
+            continue;
+        }
+        syncFileData(segment.seg);
+        syncFileData(segment.idx);
+        segment.dirty = false;
+    }
+}
+
+// ==========================================
+// 存储配额 (写线程)
+// ==========================================
+void Recorder::scanStorage()
+{
+    m_stored.clear();
+    m_storedBytes.clear();
+    m_spare.clear();
+    m_spareBytes = 0;
+
+    const QString spareDir = QDir(m_rootDir).filePath(".spare");
+    QDirIterator spareIt(spareDir, QStringList() << "*.seg", QDir::Files);
+    m_spareCounter = 0;
+    while (spareIt.hasNext()) {
+        QString path = spareIt.next();
+        m_spare.append(path);
+        m_spareBytes += QFileInfo(path).size();
+        // 池中文件被取走后编号不连续，新编号从现有最大值之后开始，避免改名时撞上已有文件
+        bool ok = false;
+        int n = QFileInfo(path).completeBaseName().mid(6).toInt(&ok);
+        if (ok) {
+            m_spareCounter = qMax(m_spareCounter, n + 1);
+        }
+    }
+
+    // <RootDir>/camNN/yyyyMMdd/camNN_yyyyMMdd_HHmmss_zzz.seg
+    // 只扫相机目录：<RootDir>/clips 下导出的片段同样是 camNN_*.seg，不能被配额当成录像删掉
+    const QStringList camDirs = QDir(m_rootDir).entryList(QStringList() << "cam??", QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &camDir : camDirs) {
+        QDirIterator it(QDir(m_rootDir).filePath(camDir), QStringList() << "cam*.seg",
+                        QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            QString path = it.next();
+            QString name = QFileInfo(path).completeBaseName();
+            bool ok = false;
+            int camId = name.mid(3, 2).toInt(&ok);
+            QDateTime created = QDateTime::fromString(name.mid(6), "yyyyMMdd_HHmmss_zzz");
+            if (!ok || !created.isValid() || SegmentFormat::cameraDirName(camId) != camDir) {
+                continue;
+            }
+            StoredSegment stored;
+            stored.segPath = path;
+            stored.bytes = segmentFilesSize(path);
+            stored.keep = QFile::exists(SegmentFormat::keepPathForSegment(path));
+            m_stored[camId].insert(created.toMSecsSinceEpoch(), stored);
+            m_storedBytes[camId] += stored.bytes;
+        }
+    }
+}
+
+void Recorder::enforceQuota()
+{
+    m_quotaDirty = false;
+    m_quotaClock.restart();
+
+    // 单相机配额：删下的文件可以进备用池，总占用不变
+    if (m_cameraQuotaBytes > 0) {
+        QList<int> cams = m_storedBytes.keys();
+        for (auto it = m_segments.constBegin(); it != m_segments.constEnd(); ++it) {
+            if (!cams.contains(it.key())) {
+                cams.append(it.key());
+            }
+        }
+        for (int camId : cams) {
+            qint64 open = m_segments.contains(camId) ? qint64(m_segments.value(camId).bytes) : 0;
+            while (m_storedBytes.value(camId) + open > m_cameraQuotaBytes && evictOldest(camId, true)) {
+            }
+        }
+    }
+
+    // 总配额和剩余空间：必须真正释放磁盘，先清备用池，再删最旧的分段
+    QStorageInfo storage(m_rootDir);
+    auto usedBytes = [&]() {
+        qint64 used = m_spareBytes;
+        for (qint64 bytes : m_storedBytes) {
+            used += bytes;
+        }
+        for (const Segment &segment : m_segments) {
+            used += qint64(segment.bytes);
+        }
+        return used;
+    };
+    auto overLimit = [&]() {
+        storage.refresh();
+        return (m_totalQuotaBytes > 0 && usedBytes() > m_totalQuotaBytes)
+               || (m_minFreeBytes > 0 && storage.isValid() && storage.bytesAvailable() < m_minFreeBytes);
+    };
+    bool exhausted = false;
+    while (overLimit()) {
+        if (!m_spare.isEmpty()) {
+            QString path = m_spare.takeFirst();
+            m_spareBytes -= QFileInfo(path).size();
+            QFile::remove(path);
+            continue;
+        }
+        if (!evictOldest(-1, false)) {
+            exhausted = true;
+            break;
+        }
+    }
+
+    qint64 freeBytes = storage.isValid() ? storage.bytesAvailable() : 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stats.usedBytes = usedBytes();
+        m_stats.freeBytes = freeBytes;
+        m_stats.headroomBytes = freeBytes - m_minFreeBytes;
+    }
+    if (exhausted && freeBytes < m_minFreeBytes) {
+        if (!m_storageLowReported) {
+            m_storageLowReported = true;
+            emit storageLow(freeBytes, m_minFreeBytes);
+        }
+    } else {
+        m_storageLowReported = false;
+    }
+}
+
+// 删除 camId (-1 为所有相机中) 最旧的一个未保护分段；没有可删的返回 false
+bool Recorder::evictOldest(int camId, bool recycle)
+{
+    int victimCam = -1;
+    QMap<qint64, StoredSegment>::iterator victim;
+    for (auto camIt = m_stored.begin(); camIt != m_stored.end(); ++camIt) {
+        if (camId >= 0 && camIt.key() != camId) {
+            continue;
+        }
+        for (auto it = camIt->begin(); it != camIt->end(); ++it) {
+            if (it->keep) {
+                continue;
+            }
+            if (victimCam < 0 || it.key() < victim.key()) {
+                victimCam = camIt.key();
+                victim = it;
+            }
+            break;
+        }
+    }
+    if (victimCam < 0) {
+        return false;
+    }
+
+    StoredSegment stored = victim.value();
+    m_stored[victimCam].erase(victim);
+    m_storedBytes[victimCam] -= stored.bytes;
+
+    QFile::remove(SegmentFormat::indexPathForSegment(stored.segPath));
+    QFile::remove(SegmentFormat::thumbPathForSegment(stored.segPath));
+    if (!(recycle && releaseToSpare(stored.segPath)) && !QFile::remove(stored.segPath)) {
+        // 正被回放映射 (Windows 下无法删除)：留在盘上，下次启动扫描时再清理
+        qWarning() << "Recorder: cannot remove" << stored.segPath;
+    }
+    QDir().rmdir(QFileInfo(stored.segPath).absolutePath());     // 当天目录空了就删掉
+
+    QMutexLocker locker(&m_mutex);
+    m_stats.segmentsEvicted++;
+    return true;
+}
+
+bool Recorder::takeSpare(const QString &segPath)
+{
+    while (!m_spare.isEmpty()) {
+        QString path = m_spare.takeFirst();
+        m_spareBytes -= QFileInfo(path).size();
+        if (QFile::rename(path, segPath)) {
+            return true;
+        }
+        QFile::remove(path);
+    }
+    return false;
+}
+
+bool Recorder::releaseToSpare(const QString &segPath)
+{
+    if (m_spare.size() >= m_spareSegments) {
+        return false;
+    }
+    QDir root(m_rootDir);
+    root.mkpath(".spare");
+    QString path = root.filePath(QString(".spare/spare_%1.seg").arg(m_spareCounter++));
+    if (!QFile::rename(segPath, path)) {
+        return false;
+    }
+    // 关闭分段时已截掉多余的预分配空间，进池的文件重新预留到分段上限，复用时不必再分配
+    if (m_preallocate) {
+        QFile file(path);
+        if (file.open(QIODevice::ReadWrite)) {
+            preallocateFile(&file, qint64(m_segmentMaxBytes));
+        }
+    }
+    m_spare.append(path);
+    m_spareBytes += QFileInfo(path).size();
+    return true;
+}
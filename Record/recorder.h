@@ -0,0 +1,207 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QHash>
+#include <QVector>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QTimer>
+#include <QMap>
+#include <QStringList>
+#include "segmentformat.h"
+#include "thumbnailatlas.h"
+
+/**
+ * @brief 本地连续录像 (每路相机一组分段文件)
+ * GUI 线程只把收到的 JPEG 放进待写队列 (隐式共享，不拷贝数据)，
+ * 写线程按 FlushIntervalMs 批量取走：同一相机的一批帧合并成一次 .seg 写入和一次 .idx 写入。
+ * 每隔 SyncIntervalMs 对有新数据的分段做一次 fdatasync (Windows 为 _commit)，
+ * 掉电最多丢失这段时间内的数据。
+ * 配置 (config.ini [Recording])：
+ *   Enabled=false  RootDir=<程序目录>/recordings  SegmentSeconds=60  SegmentMaxMb=256
+ *   FlushIntervalMs=250  SyncIntervalMs=2000  MaxPendingMb=64
+ *   ThumbIntervalMs=2000  ThumbWidth=160   缩略图轨道 (ThumbIntervalMs=0 关闭)
+ *   Mode=continuous|motion  PreRollSeconds=5  PostRollSeconds=10  PreRollBudgetMb=128
+ *   Preallocate=true  WriteChunkKb=1024  SpareSegments=8
+ *   CameraQuotaGb=0  TotalQuotaGb=0  MinFreeGb=5   (配额为 0 表示不限)
+ * motion 模式下平时只把帧留在内存预录缓冲里，检测方调用 triggerMotion() 后
+ * 先写入预录的帧 (不受 MaxPendingMb 限制，整段预录都会落盘)，再持续录到最后一次触发之后
+ * PostRollSeconds；每段录像对应一个运动事件，停止录像时进行中的事件随即结束。
+ *
+ * 存储管理：新分段按 SegmentMaxMb 预分配磁盘空间 (不改变文件长度)，数据攒够 WriteChunkKb
+ * 后按 4 KB 对齐整块顺序写出 (无缓冲)，索引只在对应数据写出之后才追加。
+ * 超出单相机/总配额或剩余空间低于 MinFreeGb 时，按创建时间删除最旧的未保护分段
+ * (有 .keep 标记的不删)；被删的 .seg 先放进 <RootDir>/.spare 备用池 (最多 SpareSegments 个)，
+ * 新分段优先改名复用这些文件，磁盘块原地覆盖写，减少碎片和反复分配。
+ */
+class Recorder : public QObject
+{
+    Q_OBJECT
+public:
+    struct Stats {
+        quint64 framesWritten = 0;
+        quint64 bytesWritten = 0;
+        quint64 framesDropped = 0;  // 写线程跟不上、待写队列超限或无法创建分段时丢弃
+        int openSegments = 0;
+        qint64 lastFlushUs = 0;     // 最近一次批量写耗时
+        qint64 maxFlushUs = 0;
+        // 单次整块写入耗时分位数 (最近 WRITE_LATENCY_SAMPLES 次)
+        qint64 writeP50Us = 0;
+        qint64 writeP95Us = 0;
+        qint64 writeP99Us = 0;
+        qint64 writeMaxUs = 0;
+        // 存储空间 (最近一次配额检查时)
+        qint64 usedBytes = 0;       // 录像 + 备用池
+        qint64 freeBytes = 0;       // 所在磁盘剩余空间
+        qint64 headroomBytes = 0;   // freeBytes - MinFreeGb，小于 0 说明清理已无法腾出空间
+        quint64 segmentsEvicted = 0;
+        quint64 segmentsReused = 0;
+    };
+
+    // 某路相机的一帧录像 (序号 + 时间戳)
+    struct FrameRef {
+        quint64 seq = 0;
+        qint64 timestampMs = 0;
+    };
+
+    explicit Recorder(QObject *parent = nullptr);
+    ~Recorder();
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+    QString rootDir() const { return m_rootDir; }
+    bool isMotionTriggered() const { return m_motionMode; }
+
+    // 线程安全；camId 0 为全景
+    void submitFrame(int camId, const QByteArray &jpeg);
+    Stats stats() const;
+    // 各相机最近写入队列的一帧，用于把遥测等外部数据对齐到录像帧
+    QHash<int, FrameRef> latestFrames() const;
+    // 运动触发模式：检测到运动时调用 (线程安全)，score 记录事件内的峰值
+    void triggerMotion(int camId, double score);
+    // 保护/取消保护某个已关闭的分段，保护的分段不会被配额清理删除 (线程安全)
+    void setSegmentProtected(const QString &segPath, bool protect);
+
+signals:
+    // 分段关闭 (轮转/空闲/停止)，可用于刷新回放列表
+    void segmentClosed(int camId, const QString &segPath, qint64 firstMs, qint64 lastMs, int frames);
+    void writeError(int camId, const QString &errorMsg);
+    // 运动事件结束 (后录时间耗尽)，时间范围为实际写入的第一帧与最后一帧
+    void motionEvent(int camId, qint64 startMs, qint64 endMs, double peakScore);
+    // 已删光所有可删分段，剩余空间仍低于 MinFreeGb (恢复之前只报告一次)
+    void storageLow(qint64 freeBytes, qint64 minFreeBytes);
+
+private:
+    struct PendingFrame {
+        quint64 seq;
+        qint64 timestampMs;
+        QByteArray data;
+    };
+
+    struct Segment {
+        QFile *seg = nullptr;
+        QFile *idx = nullptr;
+        qint64 createdMs = 0;
+        qint64 firstMs = 0;
+        qint64 lastMs = 0;
+        quint64 bytes = 0;
+        int frames = 0;
+        bool dirty = false;     // 上次 sync 之后是否有新写入
+        qint64 lastThumbMs = -1;
+        quint64 bytesOnDisk = 0;    // 已写出到 .seg 的字节数 (bytes 减去 payloadBuf)
+        QByteArray payloadBuf;      // 尚未写出的数据
+        QByteArray recordBuf;       // 尚未写出的索引 (数据写出后才写)
+    };
+
+    // 已关闭、可被清理的分段
+    struct StoredSegment {
+        QString segPath;
+        qint64 bytes = 0;       // .seg + .idx + .thm
+        bool keep = false;
+    };
+
+    // 运动触发模式下每路相机的状态 (m_mutex 保护)
+    struct MotionState {
+        QQueue<PendingFrame> preRoll;
+        qint64 preRollBytes = 0;
+        qint64 recordUntilMs = -1;  // 在此之前的帧直接写盘
+        qint64 eventStartMs = -1;   // <0 表示当前没有事件
+        qint64 lastRecordedMs = 0;
+        double peakScore = 0;
+    };
+
+    // --- 配置 ---
+    bool m_enabled = false;
+    QString m_rootDir;
+    qint64 m_segmentMs = 60000;
+    quint64 m_segmentMaxBytes = 256ull << 20;
+    int m_flushIntervalMs = 250;
+    int m_syncIntervalMs = 2000;
+    qint64 m_maxPendingBytes = 64ll << 20;
+    int m_thumbIntervalMs = 2000;
+    ThumbnailWriter *m_thumbWriter = nullptr;
+    bool m_motionMode = false;
+    qint64 m_preRollMs = 5000;
+    qint64 m_postRollMs = 10000;
+    qint64 m_preRollBudgetBytes = 128ll << 20;
+    bool m_preallocate = true;
+    int m_writeChunkBytes = 1 << 20;
+    int m_spareSegments = 8;
+    qint64 m_cameraQuotaBytes = 0;
+    qint64 m_totalQuotaBytes = 0;
+    qint64 m_minFreeBytes = 5ll << 30;
+
+    // --- 生产者侧 (m_mutex 保护) ---
+    mutable QMutex m_mutex;
+    QHash<int, QVector<PendingFrame>> m_pending;
+    QHash<int, quint64> m_nextSeq;
+    QHash<int, FrameRef> m_latest;
+    QHash<int, MotionState> m_motion;
+    qint64 m_preRollBytes = 0;          // 所有相机预录缓冲合计
+    QTimer *m_motionTimer = nullptr;    // GUI 线程：结束后录已到期的事件
+    // force：不受 MaxPendingMb 限制 (预录帧本来就在内存里，转入待写队列不增加占用)
+    void enqueueLocked(int camId, const PendingFrame &frame, bool force = false);
+    // 结束 (all 为 false 时只结束已过录制期的) 运动事件，在锁外发出 motionEvent
+    void closeEvents(bool all);
+    qint64 m_pendingBytes = 0;
+    Stats m_stats;
+    static const int WRITE_LATENCY_SAMPLES = 1024;
+    QVector<qint64> m_writeLatencyUs;   // 环形
+    int m_writeLatencyPos = 0;
+    void recordWriteLatency(qint64 us);
+
+    // --- 写线程 ---
+    QThread m_thread;
+    QObject *m_worker;
+    QHash<int, Segment> m_segments;     // 仅在写线程访问
+    QElapsedTimer m_syncClock;
+    // 存储目录 (仅在写线程访问)
+    QHash<int, QMap<qint64, StoredSegment>> m_stored;   // 相机 -> 创建时间 -> 分段
+    QHash<int, qint64> m_storedBytes;
+    QStringList m_spare;                // 备用池中的文件
+    qint64 m_spareBytes = 0;
+    int m_spareCounter = 0;
+    bool m_quotaDirty = false;
+    bool m_openFailing = false;         // 创建分段失败中 (只记一次日志)
+    bool m_storageLowReported = false;
+    QElapsedTimer m_quotaClock;
+
+    void flush();
+    void syncDirty();
+    void closeSegment(int camId);
+    void closeAll();
+    bool openSegment(int camId, qint64 createdMs, Segment *out);
+    bool writeBatch(int camId, Segment &segment, const QByteArray &payload, const QByteArray &records);
+    bool writeOut(int camId, Segment &segment, bool drain);
+    void scanStorage();
+    void enforceQuota();
+    bool evictOldest(int camId, bool recycle);
+    bool takeSpare(const QString &segPath);
+    bool releaseToSpare(const QString &segPath);
+};
+
+#endif // RECORDER_H
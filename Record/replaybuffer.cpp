@@ -0,0 +1,140 @@
+#include "replaybuffer.h"
+#include "segmentformat.h"
+#include <QCoreApplication>
+#include <QSettings>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QThread>
+#include <QSharedPointer>
+#include <cstring>
+
+ReplayBuffer::ReplayBuffer(QObject *parent)
+    : QObject{parent}
+{
+    QString configPath = QCoreApplication::applicationDirPath() + "/config.ini";
+    QSettings settings(configPath, QSettings::IniFormat);
+    m_windowMs = qMax(1, settings.value("Replay/WindowSeconds", 30).toInt()) * 1000ll;
+    m_budgetBytes = qint64(qMax(1, settings.value("Replay/BudgetMb", 256).toInt())) << 20;
+}
+
+void ReplayBuffer::push(int camId, const QByteArray &jpeg)
+{
+    if (jpeg.isEmpty()) {
+        return;
+    }
+    CameraRing &ring = m_rings[camId];
+    Frame frame;
+    frame.seq = ring.nextSeq++;
+    frame.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    frame.data = jpeg;
+    ring.frames.enqueue(frame);
+    m_totalBytes += jpeg.size();
+
+    // 时间窗口：只裁本路
+    while (!ring.frames.isEmpty() && frame.timestampMs - ring.frames.head().timestampMs > m_windowMs) {
+        m_totalBytes -= ring.frames.dequeue().data.size();
+    }
+    // 内存预算：全局淘汰最旧的帧，某路码率高也不会挤占其它相机的全部窗口
+    while (m_totalBytes > m_budgetBytes) {
+        evictOldest();
+    }
+}
+
+void ReplayBuffer::evictOldest()
+{
+    CameraRing *oldest = nullptr;
+    for (CameraRing &ring : m_rings) {
+        if (!ring.frames.isEmpty()
+            && (!oldest || ring.frames.head().timestampMs < oldest->frames.head().timestampMs)) {
+            oldest = &ring;
+        }
+    }
+    if (!oldest) {
+        m_totalBytes = 0;
+        return;
+    }
+    m_totalBytes -= oldest->frames.dequeue().data.size();
+}
+
+QVector<ReplayBuffer::Frame> ReplayBuffer::frames(int camId) const
+{
+    auto it = m_rings.constFind(camId);
+    if (it == m_rings.constEnd()) {
+        return QVector<Frame>();
+    }
+    return QVector<Frame>(it->frames.begin(), it->frames.end());
+}
+
+void ReplayBuffer::saveClip(int camId, const QVector<Frame> &frames, const QString &rootDir)
+{
+    struct Result {
+        bool ok = false;
+        QString segPath;
+        QString error;
+    };
+    QSharedPointer<Result> result(new Result);
+
+    QThread *thread = QThread::create([=](){
+        result->ok = writeClip(camId, frames, rootDir, &result->segPath, &result->error);
+    });
+    connect(thread, &QThread::finished, this, [=](){
+        emit clipSaved(camId, result->segPath, frames.size(), result->ok, result->error);
+    });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start(QThread::LowPriority);
+}
+
+// 与连续录像相同的分段格式，可直接用回放引擎打开
+bool ReplayBuffer::writeClip(int camId, const QVector<Frame> &frames, const QString &rootDir,
+                             QString *segPath, QString *error)
+{
+    if (frames.isEmpty()) {
+        *error = QStringLiteral("no frames buffered");
+        return false;
+    }
+    QString base = QDir(rootDir).filePath(SegmentFormat::segmentBaseName(camId, frames.first().timestampMs));
+    QDir().mkpath(QFileInfo(base).absolutePath());
+
+    QFile seg(base + ".seg");
+    QFile idx(base + ".idx");
+    if (!seg.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || !idx.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        *error = seg.isOpen() ? idx.errorString() : seg.errorString();
+        return false;
+    }
+
+    SegmentFormat::IndexHeader header;
+    std::memcpy(header.magic, SegmentFormat::INDEX_MAGIC, sizeof(header.magic));
+    header.version = SegmentFormat::INDEX_VERSION;
+    header.cameraId = quint32(camId);
+    header.createdMs = frames.first().timestampMs;
+    header.recordSize = sizeof(SegmentFormat::IndexRecord);
+    header.reserved = 0;
+
+    QByteArray records;
+    records.reserve(int(sizeof(header) + frames.size() * sizeof(SegmentFormat::IndexRecord)));
+    records.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    quint64 offset = 0;
+    for (const Frame &frame : frames) {
+        if (seg.write(frame.data) != frame.data.size()) {
+            *error = seg.errorString();
+            return false;
+        }
+        SegmentFormat::IndexRecord record;
+        record.seq = frame.seq;
+        record.timestampMs = frame.timestampMs;
+        record.offset = offset;
+        record.size = quint32(frame.data.size());
+        record.flags = 0;
+        records.append(reinterpret_cast<const char *>(&record), sizeof(record));
+        offset += frame.data.size();
+    }
+    if (idx.write(records) != records.size()) {
+        *error = idx.errorString();
+        return false;
+    }
+    *segPath = seg.fileName();
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef REPLAYBUFFER_H
+#define REPLAYBUFFER_H
+
+#include <QObject>
+#include <QHash>
+#include <QQueue>
+#include <QVector>
+#include <QByteArray>
+
+/**
+ * @brief 即时回看缓冲 (每路相机最近若干秒的压缩帧)
+ * 只保存收到的 JPEG 原始数据 (隐式共享，不拷贝、不解码)，
+ * 所有相机共用一个内存预算：超出时淘汰全局最旧的一帧；另按时间窗口裁掉过旧的帧。
+ * 在 GUI 线程使用。
+ * 配置 (config.ini [Replay])：WindowSeconds=30  BudgetMb=256
+ */
+class ReplayBuffer : public QObject
+{
+    Q_OBJECT
+public:
+    struct Frame {
+        quint64 seq = 0;
+        qint64 timestampMs = 0;
+        QByteArray data;
+    };
+
+    explicit ReplayBuffer(QObject *parent = nullptr);
+
+    void push(int camId, const QByteArray &jpeg);
+    // 冻结当前窗口 (回看期间新帧与淘汰不影响已取出的数据)
+    QVector<Frame> frames(int camId) const;
+    qint64 totalBytes() const { return m_totalBytes; }
+    qint64 budgetBytes() const { return m_budgetBytes; }
+
+    // 把一段帧写成录像分段 (.seg + .idx)，在后台线程执行，结果经 clipSaved 返回
+    void saveClip(int camId, const QVector<Frame> &frames, const QString &rootDir);
+
+signals:
+    void clipSaved(int camId, const QString &segPath, int frames, bool ok, const QString &error);
+
+private:
+    struct CameraRing {
+        QQueue<Frame> frames;
+        quint64 nextSeq = 0;
+    };
+
+    QHash<int, CameraRing> m_rings;
+    qint64 m_totalBytes = 0;
+    qint64 m_budgetBytes = 256ll << 20;
+    qint64 m_windowMs = 30000;
+
+    void evictOldest();
+    static bool writeClip(int camId, const QVector<Frame> &frames, const QString &rootDir,
+                          QString *segPath, QString *error);
+};
+
+#endif // REPLAYBUFFER_H
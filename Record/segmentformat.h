@@ -0,0 +1,81 @@
+#ifndef SEGMENTFORMAT_H
+#define SEGMENTFORMAT_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QDateTime>
+
+/**
+ * @brief 录像分段文件格式
+ * 每路相机按时间切分成若干段，每段两个文件：
+ *   xxx.seg  收到的 JPEG 负载原样首尾相接 (不加任何封装，可直接按偏移取帧)
+ *   xxx.idx  定长索引：文件头 + 每帧一条 IndexRecord，按时间递增
+ *   xxx.thm  (可选) 缩略图轨道，见 thumbnailatlas.h
+ *   xxx.keep (可选) 空标记文件，存在时该段不会被配额清理删除
+ * 目录结构：<RootDir>/camNN/yyyyMMdd/camNN_yyyyMMdd_HHmmss_zzz.seg
+ * 相机号 0 为全景。
+ */
+namespace SegmentFormat {
+
+static const char INDEX_MAGIC[8] = {'U', 'V', 'S', 'I', 'D', 'X', '0', '1'};
+static const quint32 INDEX_VERSION = 1;
+
+#pragma pack(push, 1)
+struct IndexHeader {
+    char magic[8];
+    quint32 version;
+    quint32 cameraId;
+    qint64 createdMs;       // 分段创建时间 (UTC 毫秒)
+    quint32 recordSize;     // sizeof(IndexRecord)，便于以后扩展字段
+    quint32 reserved;
+};
+
+struct IndexRecord {
+    quint64 seq;            // 相机内递增帧序号 (跨分段连续)
+    qint64 timestampMs;     // 客户端收到该帧的时间 (UTC 毫秒)
+    quint64 offset;         // 在 .seg 中的字节偏移
+    quint32 size;           // JPEG 字节数
+    quint32 flags;          // 预留
+};
+#pragma pack(pop)
+
+static_assert(sizeof(IndexHeader) == 32, "IndexHeader layout");
+static_assert(sizeof(IndexRecord) == 32, "IndexRecord layout");
+
+inline QString cameraDirName(int camId)
+{
+    return QString("cam%1").arg(camId, 2, 10, QChar('0'));
+}
+
+// 分段基础名 (不含扩展名)，按创建时间命名，字典序即时间序
+inline QString segmentBaseName(int camId, qint64 createdMs)
+{
+    QDateTime t = QDateTime::fromMSecsSinceEpoch(createdMs);
+    return QString("%1/%2/%1_%3").arg(cameraDirName(camId), t.toString("yyyyMMdd"),
+                                      t.toString("yyyyMMdd_HHmmss_zzz"));
+}
+
+inline QString indexPathForSegment(const QString &segPath)
+{
+    QString path = segPath;
+    path.chop(4);
+    return path + ".idx";
+}
+
+inline QString thumbPathForSegment(const QString &segPath)
+{
+    QString path = segPath;
+    path.chop(4);
+    return path + ".thm";
+}
+
+inline QString keepPathForSegment(const QString &segPath)
+{
+    QString path = segPath;
+    path.chop(4);
+    return path + ".keep";
+}
+
+} // namespace SegmentFormat
+
+#endif // SEGMENTFORMAT_H
@@ -0,0 +1,164 @@
+#include "syncplayback.h"
+
+SyncPlayback::SyncPlayback(QObject *parent)
+    : QObject{parent}
+{
+    m_timer = new QTimer(this);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    m_timer->setInterval(10);
+    connect(m_timer, &QTimer::timeout, this, [=](){
+        m_positionMs += m_tickClock.restart() * m_speed;
+        bool reachedEnd = false;
+        if (m_speed > 0 && m_positionMs >= m_endMs) {
+            m_positionMs = m_endMs;
+            reachedEnd = true;
+        } else if (m_speed < 0 && m_positionMs <= m_startMs) {
+            m_positionMs = m_startMs;
+            reachedEnd = true;
+        }
+        broadcast();
+        if (reachedEnd) {
+            pause();
+        }
+    });
+}
+
+SyncPlayback::~SyncPlayback()
+{
+    close();
+}
+
+bool SyncPlayback::open(const QVector<int> &camIds)
+{
+    close();
+    bool any = false;
+    m_stepMs = 0;
+    for (int slot = 0; slot < camIds.size(); slot++) {
+        Stream stream;
+        stream.camId = camIds[slot];
+
+        // 先在当前线程打开 (扫描索引)，再移入独立线程
+        PlaybackEngine *engine = new PlaybackEngine;
+        engine->setRootDir(m_rootDir);
+        if (engine->openCamera(stream.camId, false)) {
+            if (!any || engine->startMs() < m_startMs) m_startMs = engine->startMs();
+            if (!any || engine->endMs() > m_endMs) m_endMs = engine->endMs();
+            double period = engine->framePeriodMs();
+            if (period > 0 && (m_stepMs <= 0 || period < m_stepMs)) {
+                m_stepMs = period;
+            }
+            stream.startMs = engine->startMs();
+            stream.endMs = engine->endMs();
+            any = true;
+        }
+        stream.thread = new QThread(this);
+        stream.engine = engine;
+        engine->moveToThread(stream.thread);
+        connect(stream.thread, &QThread::finished, engine, &QObject::deleteLater);
+        connect(engine, &PlaybackEngine::frameReady, this, [=](const QByteArray &jpeg, qint64 ts, quint64){
+            if (slot < m_streams.size() && m_streams[slot].engine == engine) {
+                m_streams[slot].lastShownMs = ts;
+                emit frameReady(slot, jpeg, ts);
+                updateSkew();
+            }
+        });
+        stream.thread->start();
+        m_streams.append(stream);
+    }
+    if (m_stepMs <= 0) {
+        m_stepMs = 40;
+    }
+    if (!any) {
+        close();
+        return false;
+    }
+    emit rangeChanged(m_startMs, m_endMs);
+    seek(m_startMs);
+    return true;
+}
+
+void SyncPlayback::close()
+{
+    pause();
+    for (Stream &stream : m_streams) {
+        stream.thread->quit();
+        stream.thread->wait();
+        delete stream.thread;
+    }
+    m_streams.clear();
+    m_startMs = 0;
+    m_endMs = 0;
+    m_positionMs = 0;
+}
+
+void SyncPlayback::broadcast()
+{
+    qint64 ts = qint64(m_positionMs);
+    // 各引擎在自己的线程里并行定位；忙碌的引擎只处理最新的时刻
+    for (const Stream &stream : m_streams) {
+        stream.engine->requestPosition(ts);
+    }
+    emit positionChanged(ts);
+}
+
+void SyncPlayback::updateSkew()
+{
+    qint64 pos = qint64(m_positionMs);
+    qint64 skew = 0;
+    for (const Stream &stream : m_streams) {
+        // 主时钟落在某路录像范围之外时该路保持最后画面，不计入偏差
+        if (stream.lastShownMs >= 0 && pos >= stream.startMs && pos <= stream.endMs) {
+            skew = qMax(skew, qAbs(stream.lastShownMs - pos));
+        }
+    }
+    emit skewChanged(skew);
+}
+
+void SyncPlayback::seek(qint64 tsMs)
+{
+    if (m_streams.isEmpty()) {
+        return;
+    }
+    m_positionMs = qBound(m_startMs, tsMs, m_endMs);
+    m_tickClock.restart();
+    broadcast();
+}
+
+void SyncPlayback::play()
+{
+    if (m_streams.isEmpty() || m_timer->isActive()) {
+        return;
+    }
+    if (m_speed > 0 && m_positionMs >= m_endMs) {
+        m_positionMs = m_startMs;
+    } else if (m_speed < 0 && m_positionMs <= m_startMs) {
+        m_positionMs = m_endMs;
+    }
+    m_tickClock.start();
+    m_timer->start();
+    emit playingChanged(true);
+}
+
+void SyncPlayback::pause()
+{
+    if (!m_timer->isActive()) {
+        return;
+    }
+    m_timer->stop();
+    emit playingChanged(false);
+}
+
+void SyncPlayback::setSpeed(double speed)
+{
+    if (qFuzzyIsNull(speed)) {
+        return;
+    }
+    m_speed = speed;
+    m_tickClock.restart();
+}
+
+void SyncPlayback::stepFrame(int delta)
+{
+    pause();
+    seek(qint64(m_positionMs + delta * m_stepMs));
+}
@@ -0,0 +1,75 @@
+#ifndef SYNCPLAYBACK_H
+#define SYNCPLAYBACK_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QElapsedTimer>
+#include "playbackengine.h"
+
+/**
+ * @brief 多路同步回放
+ * 每路相机一个 PlaybackEngine，各自运行在独立线程；本对象持有唯一的主时钟，
+ * 每个节拍把同一时刻广播给所有引擎，引擎各自选取时间上最近的帧 (不变则保持，落后则跳帧)，
+ * 因此各路画面之间的偏差不超过一个帧间隔。
+ * 定位请求在各引擎线程中并行执行，某一路冷数据缺页不会拖慢其它路。
+ */
+class SyncPlayback : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SyncPlayback(QObject *parent = nullptr);
+    ~SyncPlayback();
+
+    void setRootDir(const QString &dir) { m_rootDir = dir; }
+
+    // 打开一组相机 (slot 下标与 camIds 顺序一致)，任一路有录像即返回 true
+    bool open(const QVector<int> &camIds);
+    void close();
+
+    qint64 startMs() const { return m_startMs; }
+    qint64 endMs() const { return m_endMs; }
+    qint64 positionMs() const { return qint64(m_positionMs); }
+    bool isPlaying() const { return m_timer->isActive(); }
+
+public slots:
+    void seek(qint64 tsMs);
+    void play();
+    void pause();
+    void setSpeed(double speed);
+    void stepFrame(int delta);  // 按各路中最小的帧间隔移动主时钟
+
+signals:
+    void frameReady(int slot, const QByteArray &jpeg, qint64 timestampMs);
+    void positionChanged(qint64 tsMs);
+    void playingChanged(bool playing);
+    void rangeChanged(qint64 startMs, qint64 endMs);
+    // 最近一次各路显示帧与主时钟的最大偏差 (毫秒)
+    void skewChanged(qint64 skewMs);
+
+private:
+    struct Stream {
+        int camId = 0;
+        QThread *thread = nullptr;
+        PlaybackEngine *engine = nullptr;
+        qint64 lastShownMs = -1;
+        qint64 startMs = 0;     // 打开时记录，引擎移入线程后不再跨线程读取
+        qint64 endMs = -1;
+    };
+
+    QString m_rootDir;
+    QVector<Stream> m_streams;
+    QTimer *m_timer;
+    QElapsedTimer m_tickClock;
+    double m_speed = 1.0;
+    double m_positionMs = 0;
+    qint64 m_startMs = 0;
+    qint64 m_endMs = 0;
+    double m_stepMs = 40;
+
+    void broadcast();
+    void updateSkew();
+};
+
+#endif // SYNCPLAYBACK_H
@@ -0,0 +1,184 @@
+#include "thumbnailatlas.h"
+#include "segmentformat.h"
+#include "frameanalysis.h"
+#include <cstring>
+
+// ==========================================
+// ThumbnailWriter
+// ==========================================
+ThumbnailWriter::ThumbnailWriter(int thumbWidth, int intervalMs, QObject *parent)
+    : QObject{parent}
+    , m_thumbWidth(thumbWidth)
+    , m_intervalMs(intervalMs)
+{
+    m_worker = new QObject;
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread.setObjectName("ThumbnailWriter");
+    m_thread.start(QThread::LowPriority);
+}
+
+ThumbnailWriter::~ThumbnailWriter()
+{
+    m_thread.quit();
+    m_thread.wait();
+    for (Track &track : m_tracks) {
+        delete track.file;
+    }
+}
+
+void ThumbnailWriter::submit(const QString &segPath, qint64 segmentCreatedMs, qint64 timestampMs, quint64 seq,
+                             const QByteArray &jpeg)
+{
+    QMetaObject::invokeMethod(m_worker, [=](){
+        doSubmit(segPath, segmentCreatedMs, timestampMs, seq, jpeg);
+    }, Qt::QueuedConnection);
+}
+
+void ThumbnailWriter::closeSegment(const QString &segPath)
+{
+    QMetaObject::invokeMethod(m_worker, [=](){ doClose(segPath); }, Qt::QueuedConnection);
+}
+
+// --- 以下在生成线程执行 ---
+void ThumbnailWriter::doSubmit(const QString &segPath, qint64 segmentCreatedMs, qint64 timestampMs, quint64 seq,
+                               const QByteArray &jpeg)
+{
+    QImage thumb = FrameAnalysis::decodeThumbnail(jpeg, 8);
+    if (thumb.isNull()) {
+        return;
+    }
+
+    Track &track = m_tracks[segPath];
+    if (!track.file) {
+        // 第一张决定本分段的缩略图尺寸 (保持画面比例，高度取偶数)
+        track.width = m_thumbWidth;
+        track.height = qMax(2, (m_thumbWidth * thumb.height() / thumb.width() + 1) & ~1);
+        track.file = new QFile(SegmentFormat::thumbPathForSegment(segPath));
+        if (!track.file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            delete track.file;
+            m_tracks.remove(segPath);
+            return;
+        }
+        ThumbFormat::Header header;
+        std::memcpy(header.magic, ThumbFormat::MAGIC, sizeof(header.magic));
+        header.version = ThumbFormat::VERSION;
+        header.width = quint16(track.width);
+        header.height = quint16(track.height);
+        header.intervalMs = quint32(m_intervalMs);
+        header.recordSize = ThumbFormat::recordSize(track.width, track.height);
+        header.createdMs = segmentCreatedMs;
+        track.file->write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+
+    if (thumb.width() != track.width || thumb.height() != track.height) {
+        thumb = thumb.scaled(track.width, track.height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    QByteArray record(int(ThumbFormat::recordSize(track.width, track.height)), '\0');
+    ThumbFormat::RecordHeader rh;
+    rh.timestampMs = timestampMs;
+    rh.seq = seq;
+    std::memcpy(record.data(), &rh, sizeof(rh));
+    char *pixels = record.data() + sizeof(rh);
+    for (int y = 0; y < track.height; y++) {
+        std::memcpy(pixels + qint64(y) * track.width, thumb.constScanLine(y), size_t(track.width));
+    }
+    track.file->write(record);
+    track.file->flush();    // 让回放侧尽快看到 (不要求落盘)
+}
+
+void ThumbnailWriter::doClose(const QString &segPath)
+{
+    Track track = m_tracks.take(segPath);
+    if (track.file) {
+        track.file->close();
+        delete track.file;
+    }
+}
+
+// ==========================================
+// ThumbnailAtlas
+// ==========================================
+ThumbnailAtlas::ThumbnailAtlas(const QString &thmPath)
+    : m_file(thmPath)
+{
+}
+
+ThumbnailAtlas::~ThumbnailAtlas()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+    }
+}
+
+bool ThumbnailAtlas::open()
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    qint64 size = m_file.size();
+    if (size < qint64(sizeof(ThumbFormat::Header))) {
+        return false;
+    }
+    m_map = m_file.map(0, size);
+    if (!m_map) {
+        return false;
+    }
+    m_header = reinterpret_cast<const ThumbFormat::Header *>(m_map);
+    if (std::memcmp(m_header->magic, ThumbFormat::MAGIC, sizeof(m_header->magic)) != 0
+        || m_header->recordSize != ThumbFormat::recordSize(m_header->width, m_header->height)) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+        m_header = nullptr;
+        return false;
+    }
+    m_count = int((size - qint64(sizeof(ThumbFormat::Header))) / m_header->recordSize);
+    return true;
+}
+
+QSize ThumbnailAtlas::thumbSize() const
+{
+    return m_header ? QSize(m_header->width, m_header->height) : QSize();
+}
+
+const ThumbFormat::RecordHeader *ThumbnailAtlas::record(int i) const
+{
+    return reinterpret_cast<const ThumbFormat::RecordHeader *>(
+        m_map + sizeof(ThumbFormat::Header) + qint64(i) * m_header->recordSize);
+}
+
+qint64 ThumbnailAtlas::timestampAt(int i) const
+{
+    return record(i)->timestampMs;
+}
+
+int ThumbnailAtlas::indexForTime(qint64 tsMs) const
+{
+    if (m_count == 0) {
+        return -1;
+    }
+    // 记录大致等间隔：先按间隔直接算出位置，再向前后修正几步
+    qint64 first = timestampAt(0);
+    int i = 0;
+    if (m_header->intervalMs > 0 && tsMs > first) {
+        i = int(qMin<qint64>((tsMs - first) / m_header->intervalMs, m_count - 1));
+    }
+    while (i > 0 && timestampAt(i) > tsMs) {
+        i--;
+    }
+    while (i + 1 < m_count && timestampAt(i + 1) <= tsMs) {
+        i++;
+    }
+    return i;
+}
+
+QImage ThumbnailAtlas::thumbAt(int i) const
+{
+    if (i < 0 || i >= m_count) {
+        return QImage();
+    }
+    const uchar *pixels = reinterpret_cast<const uchar *>(record(i)) + sizeof(ThumbFormat::RecordHeader);
+    QImage view(pixels, m_header->width, m_header->height, m_header->width, QImage::Format_Grayscale8);
+    return view.copy();
+}
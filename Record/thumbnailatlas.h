@@ -0,0 +1,110 @@
+#ifndef THUMBNAILATLAS_H
+#define THUMBNAILATLAS_H
+
+#include <QObject>
+#include <QThread>
+#include <QHash>
+#include <QFile>
+#include <QImage>
+
+/**
+ * @brief 录像分段的缩略图轨道 (.thm)
+ * 文件头 + 定长记录；每条记录 = 时间戳 + 帧序号 + 一张固定尺寸的灰度缩略图，
+ * 记录按时间递增且大致等间隔，按时间取图只需一次除法 + 少量邻近修正。
+ * 整个文件可直接 mmap，悬停预览不打开任何原始帧。
+ */
+namespace ThumbFormat {
+
+static const char MAGIC[8] = {'U', 'V', 'S', 'T', 'H', 'M', '0', '1'};
+static const quint32 VERSION = 1;
+
+#pragma pack(push, 1)
+struct Header {
+    char magic[8];
+    quint32 version;
+    quint16 width;          // 缩略图尺寸 (像素)，同一文件内固定
+    quint16 height;
+    quint32 intervalMs;     // 采样间隔
+    quint32 recordSize;     // 单条记录字节数 (含对齐)
+    qint64 createdMs;       // 所属分段创建时间
+};
+
+struct RecordHeader {
+    qint64 timestampMs;
+    quint64 seq;
+    // 后接 width * height 字节 Grayscale8 像素，行间无填充
+};
+#pragma pack(pop)
+
+static_assert(sizeof(Header) == 32, "ThumbFormat::Header layout");
+static_assert(sizeof(RecordHeader) == 16, "ThumbFormat::RecordHeader layout");
+
+inline quint32 recordSize(int width, int height)
+{
+    return (quint32(sizeof(RecordHeader)) + quint32(width) * quint32(height) + 7u) & ~7u;
+}
+
+} // namespace ThumbFormat
+
+/**
+ * @brief 缩略图轨道生成器 (低优先级后台线程)
+ * 录像写线程按间隔挑出帧投递进来，这里做 1/8 DCT 缩放解码并追加写入 .thm，
+ * 不占用录像写线程，也不碰 GUI 线程。所有公有函数线程安全。
+ */
+class ThumbnailWriter : public QObject
+{
+    Q_OBJECT
+public:
+    ThumbnailWriter(int thumbWidth, int intervalMs, QObject *parent = nullptr);
+    ~ThumbnailWriter();
+
+    void submit(const QString &segPath, qint64 segmentCreatedMs, qint64 timestampMs, quint64 seq,
+                const QByteArray &jpeg);
+    void closeSegment(const QString &segPath);
+
+private:
+    struct Track {
+        QFile *file = nullptr;
+        int width = 0;
+        int height = 0;
+    };
+
+    int m_thumbWidth;
+    int m_intervalMs;
+    QThread m_thread;
+    QObject *m_worker;
+    QHash<QString, Track> m_tracks;     // 仅在生成线程访问
+
+    void doSubmit(const QString &segPath, qint64 segmentCreatedMs, qint64 timestampMs, quint64 seq,
+                  const QByteArray &jpeg);
+    void doClose(const QString &segPath);
+};
+
+/**
+ * @brief 只读映射一个 .thm 文件
+ */
+class ThumbnailAtlas
+{
+public:
+    explicit ThumbnailAtlas(const QString &thmPath);
+    ~ThumbnailAtlas();
+
+    bool open();
+    int count() const { return m_count; }
+    QSize thumbSize() const;
+    qint64 timestampAt(int i) const;
+    // 时间上不晚于 tsMs 的最后一张 (都晚于时取第一张)，没有缩略图时返回 -1
+    int indexForTime(qint64 tsMs) const;
+    // 深拷贝一张缩略图
+    QImage thumbAt(int i) const;
+
+private:
+    QFile m_file;
+    uchar *m_map = nullptr;
+    const ThumbFormat::Header *m_header = nullptr;
+    int m_count = 0;
+
+    const ThumbFormat::RecordHeader *record(int i) const;
+};
+
+#endif // THUMBNAILATLAS_H
@@ -10,24 +10,81 @@ CONFIG += c++11
 
 SOURCES += \
     Database/dbmanager.cpp \
+    Database/historycache.cpp \
+    Database/telemetryexporter.cpp \
+    Database/telemetryspool.cpp \
+    Database/telemetrywriter.cpp \
+    Database/tsdbstore.cpp \
+    Record/clipexporter.cpp \
+    Record/mkvwriter.cpp \
+    Record/playbackengine.cpp \
+    Record/recorder.cpp \
+    Record/replaybuffer.cpp \
+    Record/syncplayback.cpp \
+    Record/thumbnailatlas.cpp \
+    autoexposure.cpp \
     cameraclient.cpp \
+    cameraregistry.cpp \
     dataview.cpp \
+    exportbench.cpp \
+    frameanalysis.cpp \
+    frameanalyzer.cpp \
     headerbar.cpp \
+    healthmonitor.cpp \
+    historymodel.cpp \
+    ingestbench.cpp \
+    jpegutil.cpp \
     main.cpp \
     mainwindow.cpp \
+    mjpegparser.cpp \
+    playbackview.cpp \
+    replaysource.cpp \
     rulerwidget.cpp \
+    snapshotwriter.cpp \
+    streamhealth.cpp \
+    tsdbbench.cpp \
     videopanorama.cpp \
     websocketclient.cpp \
     streamvideowidget.cpp
 
 HEADERS += \
     Database/dbmanager.h \
+    Database/historycache.h \
+    Database/telemetryexporter.h \
+    Database/telemetryspool.h \
+    Database/telemetrywriter.h \
+    Database/tsdbstore.h \
+    Record/clipexporter.h \
+    Record/mkvwriter.h \
+    Record/playbackengine.h \
+    Record/recorder.h \
+    Record/replaybuffer.h \
+    Record/segmentformat.h \
+    Record/syncplayback.h \
+    Record/thumbnailatlas.h \
+    autoexposure.h \
     cameraclient.h \
+    cameraregistry.h \
     dataview.h \
+    exportbench.h \
+    frameanalysis.h \
+    frameanalyzer.h \
     frameprocessor.h \
     headerbar.h \
+    healthmonitor.h \
+    historymodel.h \
+    ingestbench.h \
+    jpegutil.h \
     mainwindow.h \
+    mjpegparser.h \
+    playbackview.h \
+    replaysource.h \
+    ringbuffer.h \
     rulerwidget.h \
+    snapshotwriter.h \
+    spscqueue.h \
+    streamhealth.h \
+    tsdbbench.h \
     videopanorama.h \
     websocketclient.h \
     streamvideowidget.h
@@ -43,6 +100,15 @@ qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
+# MP4 (H.264) 导出需要 FFmpeg 开发库：qmake CONFIG+=libav
+libav {
+    DEFINES += HAVE_LIBAV
+    LIBS += -lavformat -lavcodec -lswscale -lavutil
+}
+
+# 导出基准测试读取进程峰值内存
+win32: LIBS += -lpsapi
+
 RESOURCES += \
     res.qrc
 
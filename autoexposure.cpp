@@ -0,0 +1,113 @@
+#include "autoexposure.h"
+#include <QCoreApplication>
+#include <QSettings>
+#include <QtMath>
+
+AutoExposureController::AutoExposureController(int camId, QObject *parent)
+    : QObject{parent}
+    , m_camId(camId)
+{
+    QString configPath = QCoreApplication::applicationDirPath() + "/config.ini";
+    QSettings settings(configPath, QSettings::IniFormat);
+    m_targetLuma    = settings.value("AutoExposure/TargetLuma", 110).toDouble();
+    m_lockBand      = settings.value("AutoExposure/LockBand", 6).toDouble();
+    m_unlockBand    = qMax(m_lockBand, settings.value("AutoExposure/UnlockBand", 16).toDouble());
+    m_settleMs      = settings.value("AutoExposure/SettleMs", 600).toInt();
+    m_maxStepRatio  = qMax(1.01, settings.value("AutoExposure/MaxStepRatio", 1.3).toDouble());
+    m_maxGainStep   = settings.value("AutoExposure/MaxGainStep", 2.0).toDouble();
+    m_minExposureUs = settings.value("AutoExposure/MinExposureUs", 100).toDouble();
+    m_maxExposureUs = settings.value("AutoExposure/MaxExposureUs", 33000).toDouble();
+    m_maxGain       = settings.value("AutoExposure/MaxGain", 24).toDouble();
+}
+
+QString AutoExposureController::stateText(State state)
+{
+    switch (state) {
+    case Off:        return "关闭";
+    case Converging: return "调节中";
+    case Locked:     return "已锁定";
+    case Limited:    return "已到极限";
+    }
+    return QString();
+}
+
+void AutoExposureController::setEnabled(bool enabled, double exposureUs, double gain)
+{
+    if (!enabled) {
+        setState(Off);
+        return;
+    }
+    m_exposureUs = qBound(m_minExposureUs, exposureUs, m_maxExposureUs);
+    m_gain = qBound(0.0, gain, m_maxGain);
+    m_sinceCommand.invalidate();
+    setState(Converging);
+}
+
+void AutoExposureController::setState(State state)
+{
+    if (m_state == state) {
+        return;
+    }
+    m_state = state;
+    emit stateChanged(m_camId, state);
+}
+
+void AutoExposureController::onLumaStats(int camId, const LumaStats &stats)
+{
+    if (camId != m_camId || m_state == Off || stats.count == 0) {
+        return;
+    }
+    m_lastMean = stats.mean;
+
+    // 速率限制：上一次调整还没在画面上生效前不再下发
+    if (m_sinceCommand.isValid() && m_sinceCommand.elapsed() < m_settleMs) {
+        return;
+    }
+
+    // 大面积过曝时均值会被饱和截断，按偏亮处理
+    double mean = stats.mean;
+    if (stats.brightFraction > 0.05) {
+        mean = qMax(mean, m_targetLuma + m_unlockBand + 1);
+    }
+    double err = m_targetLuma - mean;
+
+    // 滞回：收敛时进入小区间才锁定，锁定后误差超出大区间才重新调节
+    if (m_state == Locked && qAbs(err) <= m_unlockBand) {
+        return;
+    }
+    if (qAbs(err) <= m_lockBand) {
+        setState(Locked);
+        return;
+    }
+
+    double ratio = qBound(1.0 / m_maxStepRatio, m_targetLuma / qMax(mean, 1.0), m_maxStepRatio);
+    double gainStep = qBound(-m_maxGainStep, 20.0 * std::log10(ratio), m_maxGainStep);
+
+    if (ratio > 1.0) {
+        // 变亮：先加曝光，曝光到顶再加增益
+        if (m_exposureUs < m_maxExposureUs) {
+            m_exposureUs = qMin(m_maxExposureUs, m_exposureUs * ratio);
+            emit requestExposure(m_camId, m_exposureUs);
+        } else if (m_gain < m_maxGain) {
+            m_gain = qMin(m_maxGain, m_gain + gainStep);
+            emit requestGain(m_camId, m_gain);
+        } else {
+            setState(Limited);
+            return;
+        }
+    } else {
+        // 变暗：先降增益 (噪声更低)，增益归零后再缩短曝光
+        if (m_gain > 0) {
+            m_gain = qMax(0.0, m_gain + gainStep);
+            emit requestGain(m_camId, m_gain);
+        } else if (m_exposureUs > m_minExposureUs) {
+            m_exposureUs = qMax(m_minExposureUs, m_exposureUs * ratio);
+            emit requestExposure(m_camId, m_exposureUs);
+        } else {
+            setState(Limited);
+            return;
+        }
+    }
+    m_sinceCommand.restart();
+    setState(Converging);
+}
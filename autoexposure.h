@@ -0,0 +1,69 @@
+#ifndef AUTOEXPOSURE_H
+#define AUTOEXPOSURE_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include "frameanalysis.h"
+
+/**
+ * @brief 单路相机的客户端闭环自动曝光/增益
+ * 以实时画面的平均亮度为反馈，优先调整曝光时间，曝光到达上限后再加增益
+ * (变暗时先降增益)。每步调整幅度和下发频率都有限制，并用双阈值滞回避免在
+ * 目标附近来回抖动。
+ */
+class AutoExposureController : public QObject
+{
+    Q_OBJECT
+public:
+    enum State {
+        Off,        // 未启用
+        Converging, // 正在向目标亮度收敛
+        Locked,     // 已进入目标区间，保持不动
+        Limited     // 曝光和增益都已到达边界，无法继续调整
+    };
+    Q_ENUM(State)
+
+    explicit AutoExposureController(int camId, QObject *parent = nullptr);
+
+    int cameraId() const { return m_camId; }
+    State state() const { return m_state; }
+    double exposureUs() const { return m_exposureUs; }
+    double gain() const { return m_gain; }
+    double lastMeanLuma() const { return m_lastMean; }
+    static QString stateText(State state);
+
+    // 以当前手动设置值为起点启用
+    void setEnabled(bool enabled, double exposureUs, double gain);
+    bool isEnabled() const { return m_state != Off; }
+
+public slots:
+    void onLumaStats(int camId, const LumaStats &stats);
+
+signals:
+    void requestExposure(int camId, double exposureUs);
+    void requestGain(int camId, double gain);
+    void stateChanged(int camId, AutoExposureController::State state);
+
+private:
+    int m_camId;
+    State m_state = Off;
+    double m_exposureUs = 20000;
+    double m_gain = 0;
+    double m_lastMean = 0;
+    QElapsedTimer m_sinceCommand;   // 距上次下发命令的时间 (等待相机生效)
+
+    // --- 参数 (config.ini [AutoExposure]) ---
+    double m_targetLuma = 110;
+    double m_lockBand = 6;          // |误差| 小于此值进入 Locked
+    double m_unlockBand = 16;       // Locked 状态下 |误差| 超过此值才重新调整
+    int m_settleMs = 600;           // 两次下发之间的最小间隔
+    double m_maxStepRatio = 1.3;    // 单步曝光最大变化倍数
+    double m_maxGainStep = 2.0;     // 单步增益最大变化 (dB)
+    double m_minExposureUs = 100;
+    double m_maxExposureUs = 33000;
+    double m_maxGain = 24;
+
+    void setState(State state);
+};
+
+#endif // AUTOEXPOSURE_H
@@ -1,6 +1,9 @@
 #include "cameraclient.h"
 #include <QJsonArray>
 #include <QVariant>
+#include <QUrlQuery>
+#include <QSharedPointer>
+#include "jpegutil.h"
 
 static PipelineStatus parsePipelineStatus(const QJsonObject &json) {
     PipelineStatus status;
@@ -79,9 +82,40 @@ void CameraClient::setBaseUrl(const QString &url)
     }
 }
 
+/**
+ * @brief 预连接服务主机
+ * QNetworkAccessManager 按主机维护 HTTP/1.1 keep-alive 连接池，
+ * 提前握手可以让第一次控制/健康查询免去建连耗时。
+ */
+void CameraClient::warmUp()
+{
+    QUrl url(m_baseUrl);
+    if (!url.isValid() || url.host().isEmpty()) {
+        return;
+    }
+    // https 服务要预先完成 TLS 握手，普通 TCP 连接对加密请求没有用
+    if (url.scheme().compare("https", Qt::CaseInsensitive) == 0) {
+#ifndef QT_NO_SSL
+        m_manager->connectToHostEncrypted(url.host(), quint16(url.port(443)));
+#endif
+        return;
+    }
+    m_manager->connectToHost(url.host(), quint16(url.port(80)));
+}
+
 // ==========================================
 // 辅助函数
 // ==========================================
+QNetworkRequest CameraClient::createRequest(const QString &endpoint) const
+{
+    QNetworkRequest request(QUrl(m_baseUrl + endpoint));
+    request.setRawHeader("Connection", "keep-alive");
+    if (m_requestTimeoutMs > 0) {
+        request.setTransferTimeout(m_requestTimeoutMs);
+    }
+    return request;
+}
+
 QJsonObject CameraClient::createBaseJson(bool isGlobal, int cameraId)
 {
     QJsonObject json;
@@ -94,12 +128,11 @@ QJsonObject CameraClient::createBaseJson(bool isGlobal, int cameraId)
     return json;
 }
 
-void CameraClient::sendPostRequest(const QString &endpoint, const QJsonObject &json)
+void CameraClient::sendPostRequest(const QString &endpoint, const QJsonObject &json, bool background)
 {
-    QUrl url(m_baseUrl + endpoint);
-    QNetworkRequest request(url);
+    QNetworkRequest request = createRequest(endpoint);
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    qDebug()<<"url:"<<url;
+    qDebug()<<"url:"<<request.url();
     QJsonDocument doc(json);
     qDebug() << "发送 POST 数据:" << doc.toJson(QJsonDocument::Compact); // 加上这一行
     QByteArray postData = doc.toJson();
@@ -116,6 +149,10 @@ void CameraClient::sendPostRequest(const QString &endpoint, const QJsonObject &j
         if (reply->error() == QNetworkReply::NoError) {
             QByteArray respData = reply->readAll();
             QJsonDocument respDoc = QJsonDocument::fromJson(respData);
+            if (background) {
+                emit backgroundControlResult(true, endpoint, respDoc.object(), "OK");
+                return;
+            }
             emit controlResult(true, endpoint, respDoc.object(), "OK");
         } else {
             // 1. 读取服务器返回的报错详情 (这是解决 422 的关键)
@@ -130,6 +167,10 @@ void CameraClient::sendPostRequest(const QString &endpoint, const QJsonObject &j
             QString errStr = QString("HTTP Error %1: %2").arg(statusCode).arg(reply->errorString());
 
             // 3. 发送信号通知 UI
+            if (background) {
+                emit backgroundControlResult(false, endpoint, QJsonObject(), errStr);
+                return;
+            }
             emit controlResult(false, endpoint, QJsonObject(), errStr);
         }
     });
@@ -143,7 +184,7 @@ void CameraClient::sendPostRequest(const QString &endpoint, const QJsonObject &j
  */
 void CameraClient::getServiceConfig()
 {
-    QNetworkRequest request(QUrl(m_baseUrl + "/"));
+    QNetworkRequest request = createRequest("/");
     QNetworkReply *reply = m_manager->get(request);
 
     connect(reply, &QNetworkReply::finished, this ,[=](){
@@ -164,7 +205,7 @@ void CameraClient::getServiceConfig()
  */
 void CameraClient::getHealthStatus()
 {
-    QNetworkRequest request(QUrl(m_baseUrl + "/health"));
+    QNetworkRequest request = createRequest("/health");
     QNetworkReply *reply = m_manager->get(request);
 
     connect(reply, &QNetworkReply::finished ,this ,[=](){
@@ -184,7 +225,7 @@ void CameraClient::getHealthStatus()
  */
 void CameraClient::getSnapshot()
 {
-    QNetworkRequest request(QUrl(m_baseUrl + "/snapshot"));
+    QNetworkRequest request = createRequest("/snapshot");
     QNetworkReply *reply = m_manager->get(request);
 
     connect(reply, &QNetworkReply::finished, this, [=]() {
@@ -205,6 +246,124 @@ void CameraClient::getSnapshot()
     });
 }
 
+/**
+ * @brief 设置抓拍写入器 (可由多个客户端共享，各自只处理自己的作业号)
+ */
+void CameraClient::setSnapshotWriter(SnapshotWriter *writer)
+{
+    if (m_writer) {
+        disconnect(m_writer, nullptr, this, nullptr);
+    }
+    m_writer = writer;
+    if (!m_writer) {
+        return;
+    }
+    connect(m_writer, &SnapshotWriter::finished, this,
+            [=](int job, const QString &path, const QSize &size, qint64 bytes, bool ok, const QString &error){
+        if (!m_snapshotTags.contains(job)) return;
+        int tag = m_snapshotTags.value(job);
+        if (!ok) {
+            m_snapshotPreviewJobs.remove(job);
+        }
+        if (!m_snapshotPreviewJobs.contains(job)) {
+            m_snapshotTags.remove(job);
+        }
+        if (ok) {
+            emit snapshotSaved(tag, path, size, bytes);
+        } else {
+            emit snapshotFailed(tag, error.isEmpty() ? QStringLiteral("empty snapshot") : error);
+        }
+    });
+    connect(m_writer, &SnapshotWriter::previewReady, this, [=](int job, const QImage &preview){
+        if (!m_snapshotPreviewJobs.remove(job)) return;
+        emit snapshotPreviewReady(m_snapshotTags.take(job), preview);
+    });
+}
+
+/**
+ * @brief GET /snapshot 流式抓拍到本地文件
+ * 数据块到达即交给 SnapshotWriter 在写线程落盘；图像尺寸从 SOF 头解析，
+ * 只有 previewMaxSide > 0 时才在写线程里缩放解码一张预览图。
+ */
+void CameraClient::fetchSnapshot(int cameraId, const QString &filePath, int tag, int previewMaxSide)
+{
+    if (!m_writer) {
+        emit snapshotFailed(tag, QStringLiteral("snapshot writer not set"));
+        return;
+    }
+    QUrl url(m_baseUrl + "/snapshot");
+    if (cameraId > 0) {
+        // 与控制接口一致，服务端相机号从 0 开始
+        QUrlQuery query;
+        query.addQueryItem("camera_id", QString::number(cameraId - 1));
+        url.setQuery(query);
+    }
+    QNetworkRequest request = createRequest("/snapshot");
+    request.setUrl(url);
+    QNetworkReply *reply = m_manager->get(request);
+
+    int job = m_writer->open(filePath);
+    m_snapshotTags.insert(job, tag);
+    if (previewMaxSide > 0) {
+        m_snapshotPreviewJobs.insert(job);
+    }
+
+    // 头部探测缓冲：只保留到解析出 SOF 为止
+    QSharedPointer<QByteArray> head(new QByteArray);
+    QSharedPointer<QSize> size(new QSize);
+
+    // 数据块直接转交写线程；SOF 解析出尺寸后不再缓存头部
+    auto consume = [=]() -> bool {
+        QByteArray chunk = reply->readAll();
+        if (chunk.isEmpty()) {
+            return true;
+        }
+        if (!size->isValid()) {
+            head->append(chunk);
+            JpegUtil::ParseResult r = JpegUtil::parseSize(*head, size.data());
+            if (r == JpegUtil::Found) {
+                head->clear();
+                emit snapshotHeaderParsed(tag, *size);
+            } else if (r == JpegUtil::Invalid) {
+                return false;
+            }
+        }
+        m_writer->write(job, chunk);
+        return true;
+    };
+
+    connect(reply, &QNetworkReply::readyRead, this, [=](){
+        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (statusCode != 200) {
+            return; // 错误响应体在 finished 中处理
+        }
+        if (!consume()) {
+            reply->abort();
+        }
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [=]() {
+        reply->deleteLater();
+        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (reply->error() == QNetworkReply::NoError && statusCode == 200 && consume() && size->isValid()) {
+            m_writer->finish(job, *size, previewMaxSide);
+            return;
+        }
+        m_writer->abort(job);
+        m_snapshotTags.remove(job);
+        m_snapshotPreviewJobs.remove(job);
+        QString errStr;
+        if (statusCode == 503) {
+            errStr = "Service Unavailable (No Frame)";
+        } else if (reply->error() == QNetworkReply::NoError || reply->error() == QNetworkReply::OperationCanceledError) {
+            errStr = size->isValid() ? reply->errorString() : QStringLiteral("invalid JPEG data");
+        } else {
+            errStr = reply->errorString();
+        }
+        emit snapshotFailed(tag, errStr);
+    });
+}
+
 /**
  * @brief GET /mjpeg 获取最新一帧 JPEG 抓图
  */
@@ -217,7 +376,7 @@ void CameraClient::startMjpegStream()
     QUrl url(getMjpegStreamUrl());
     QNetworkRequest request(url);
     request.setRawHeader("Accept", "multipart/x-mixed-replace");
-    m_mjpegBuffer.clear();
+    m_mjpegParser.clear();
     m_mjpegReply = m_manager->get(request);
 
     connect(m_mjpegReply, &QNetworkReply::readyRead, this, &CameraClient::handleMjpegReadyRead);
@@ -241,7 +400,7 @@ void CameraClient::stopMjpegStream()
     m_mjpegReply->abort();
     m_mjpegReply->deleteLater();
     m_mjpegReply = nullptr;
-    m_mjpegBuffer.clear();
+    m_mjpegParser.clear();
 }
 
 void CameraClient::handleMjpegReadyRead()
@@ -249,68 +408,21 @@ void CameraClient::handleMjpegReadyRead()
     if (!m_mjpegReply) {
         return;
     }
-    m_mjpegBuffer.append(m_mjpegReply->readAll());
-
-    while (true) {
-        int boundaryIdx = m_mjpegBuffer.indexOf("--frame");
-        if (boundaryIdx < 0) {
-            break;
-        }
-        if (boundaryIdx > 0) {
-            m_mjpegBuffer.remove(0, boundaryIdx);
-        }
-
-        int boundaryLineEnd = m_mjpegBuffer.indexOf("\r\n");
-        if (boundaryLineEnd < 0) {
-            break;
-        }
-        int headersStart = boundaryLineEnd + 2;
-        int headersEnd = m_mjpegBuffer.indexOf("\r\n\r\n", headersStart);
-        if (headersEnd < 0) {
-            break;
-        }
-
-        QByteArray headersBytes = m_mjpegBuffer.mid(headersStart, headersEnd - headersStart);
-        QString headersStr = QString::fromLatin1(headersBytes);
-        int contentLength = -1;
-        const auto lines = headersStr.split("\r\n");
-        for (const QString &line : lines) {
-            if (line.startsWith("Content-Length:", Qt::CaseInsensitive)) {
-                contentLength = line.section(':', 1, 1).trimmed().toInt();
-                break;
-            }
-        }
-
-        if (contentLength <= 0) {
-            emit controlResult(false, "/mjpeg", QJsonObject(), QStringLiteral("missing Content-Length"));
-            // 丢弃到头结束，尝试继续
-            m_mjpegBuffer.remove(0, headersEnd + 4);
-            continue;
-        }
-
-        // 跳过头部
-        m_mjpegBuffer.remove(0, headersEnd + 4);
-
-        if (m_mjpegBuffer.size() < contentLength) {
-            // 数据未到齐，等待下一次 readyRead
-            break;
-        }
-
-        QByteArray imageData = m_mjpegBuffer.left(contentLength);
-        m_mjpegBuffer.remove(0, contentLength);
-
-        // 可选跳过帧末尾 CRLF
-        if (m_mjpegBuffer.startsWith("\r\n")) {
-            m_mjpegBuffer.remove(0, 2);
-        }
+    m_mjpegParser.feed(m_mjpegReply->readAll());
 
+    // 解析与回放源 (ReplaySource) 共用 MjpegParser
+    int malformed = m_mjpegParser.malformedParts();
+    QByteArray imageData;
+    while (m_mjpegParser.next(&imageData)) {
         QPixmap pixmap;
         if (pixmap.loadFromData(imageData, "JPEG")) {
             emit mjpegFrameReceived(pixmap);
         } else {
             emit controlResult(false, "/mjpeg", QJsonObject(), QStringLiteral("failed to decode JPEG frame"));
         }
-        // 继续循环解析可能已到达的下一帧
+    }
+    if (m_mjpegParser.malformedParts() != malformed) {
+        emit controlResult(false, "/mjpeg", QJsonObject(), QStringLiteral("malformed multipart frame"));
     }
 }
 
@@ -330,21 +442,21 @@ void CameraClient::setFrameRate(bool isGlobal, int cameraId, double fps)
 /**
  * @brief POST /control/exposure 设置曝光时间 (us)
  */
-void CameraClient::setExposure(bool isGlobal, int cameraId, float exposureUs)
+void CameraClient::setExposure(bool isGlobal, int cameraId, float exposureUs, bool background)
 {
     QJsonObject json = createBaseJson(isGlobal, cameraId);
     json["exposure_us"] = exposureUs;
-    sendPostRequest("/control/exposure", json);
+    sendPostRequest("/control/exposure", json, background);
 }
 
 /**
  * @brief POST /control/gain 设置增益
  */
-void CameraClient::setGain(bool isGlobal, int cameraId, float gain)
+void CameraClient::setGain(bool isGlobal, int cameraId, float gain, bool background)
 {
     QJsonObject json = createBaseJson(isGlobal, cameraId);
     json["gain"] = gain;
-    sendPostRequest("/control/gain", json);
+    sendPostRequest("/control/gain", json, background);
     qDebug() << "Sending POST POST /control/gain";
 }
 
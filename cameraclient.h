@@ -6,6 +6,10 @@
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QPixmap>
+#include <QHash>
+#include <QSet>
+#include "snapshotwriter.h"
+#include "mjpegparser.h"
 
 // --- 子结构：Pipeline 状态 ---
 struct PipelineStatus {
@@ -52,11 +56,20 @@ public:
     explicit CameraClient(QObject *parent = nullptr);
     virtual ~CameraClient();
     void setBaseUrl(const QString &url); // 设置服务地址
+    QString baseUrl() const { return m_baseUrl; }
+    // 单次请求超时 (毫秒)，<=0 表示不限制
+    void setRequestTimeout(int ms) { m_requestTimeoutMs = ms; }
+    // 预先建立到服务的 TCP 连接 (keep-alive 复用)
+    void warmUp();
 
     // --- 基础接口 ---
     void getServiceConfig(); // GET
     void getHealthStatus();      // GET /health
     void getSnapshot();      // GET /snapshot
+    // GET /snapshot 流式落盘：边收边异步写文件，只解析 JPEG 头取尺寸，不在 GUI 线程解码
+    // cameraId 为服务端相机号 (<=0 表示服务默认画面)，tag 原样带回结果信号
+    void fetchSnapshot(int cameraId, const QString &filePath, int tag, int previewMaxSide = 0);
+    void setSnapshotWriter(SnapshotWriter *writer);
     QString getMjpegStreamUrl() const;  // GET /mjpeg
 
     // --- MJPEG 流 ---
@@ -66,10 +79,10 @@ public:
     // --- 参数控制接口 (封装通用的 POST 请求) ---
     // 设置帧率
     void setFrameRate(bool isGlobal, int cameraId, double fps);
-    // 设置曝光
-    void setExposure(bool isGlobal, int cameraId, float exposureUs);
+    // 设置曝光 (background=true 时结果走 backgroundControlResult，不弹窗/不刷新画面)
+    void setExposure(bool isGlobal, int cameraId, float exposureUs, bool background = false);
     // 设置增益
-    void setGain(bool isGlobal, int cameraId, float gain);
+    void setGain(bool isGlobal, int cameraId, float gain, bool background = false);
     // 设置十字光标
     void setCrosshair(bool isGlobal, int cameraId, bool enabled,
                       int x = 0, int y = 0, int size = 20,
@@ -93,6 +106,10 @@ signals:
     void healthInfoReceived(const HealthInfo &info);       // GET /health (Parsed)
     void snapshotReceived(const QPixmap &pixmap);          // GET /snapshot 响应 (图片)
     void mjpegFrameReceived(const QPixmap &pixmap);        // MJPEG 流式帧 (不落盘)
+    void snapshotHeaderParsed(int tag, const QSize &size); // 收到 JPEG 头即可得到尺寸
+    void snapshotSaved(int tag, const QString &path, const QSize &size, qint64 bytes);
+    void snapshotPreviewReady(int tag, const QImage &preview);
+    void snapshotFailed(int tag, const QString &errorMsg);
 
     // --- 控制结果信号 ---
     // success: 请求是否成功
@@ -100,15 +117,23 @@ signals:
     // resultData: 服务器返回的JSON数据 (包含 applied, failed 等信息)
     // errorMsg: 如果失败，具体的错误信息
     void controlResult(bool success, const QString &apiName, const QJsonObject &resultData, const QString &errorMsg);
+    // 后台自动控制 (如自动曝光) 发出的请求结果
+    void backgroundControlResult(bool success, const QString &apiName, const QJsonObject &resultData, const QString &errorMsg);
 private:
     QNetworkAccessManager *m_manager;
     QString m_baseUrl;
+    int m_requestTimeoutMs = 0;
     QNetworkReply *m_mjpegReply = nullptr;
-    QByteArray m_mjpegBuffer;
+    MjpegParser m_mjpegParser;
+    SnapshotWriter *m_writer = nullptr;
+    QHash<int, int> m_snapshotTags;     // writer 作业号 -> tag
+    QSet<int> m_snapshotPreviewJobs;    // 还在等预览的作业
     // 辅助函数：构造基础 JSON (包含 scope 和 camera_id)
     QJsonObject createBaseJson(bool isGlobal, int cameraId);
+    // 辅助函数：构造带超时与 keep-alive 的请求
+    QNetworkRequest createRequest(const QString &endpoint) const;
     // 辅助函数：统一发送 POST 请求
-    void sendPostRequest(const QString &endpoint, const QJsonObject &json);
+    void sendPostRequest(const QString &endpoint, const QJsonObject &json, bool background = false);
     void handleMjpegReadyRead();
 };
 
@@ -0,0 +1,325 @@
+#include "cameraregistry.h"
+#include <QCoreApplication>
+#include <QSettings>
+#include <QTimer>
+#include <QUrl>
+#include <QDir>
+#include <QDateTime>
+#include <QDebug>
+
+CameraRegistry::CameraRegistry(QObject *parent)
+    : QObject{parent}
+{
+    m_snapshotWriter = new SnapshotWriter(this);
+    connect(m_snapshotWriter, &SnapshotWriter::previewReady, this, [=](int job, const QImage &preview){
+        if (m_previewJobs.contains(job)) {
+            emit snapshotPreviewReady(m_previewJobs.take(job), preview);
+        }
+    });
+    loadFromConfig();
+}
+
+/**
+ * @brief 由 ws 订阅地址推导同一服务的 HTTP 控制地址
+ * 例如 "ws://192.168.100.5:8020/ws/subscribe" -> "http://192.168.100.5:8020"
+ */
+QString CameraRegistry::apiUrlFromWsUrl(const QString &wsUrl)
+{
+    QUrl url(wsUrl);
+    if (!url.isValid() || url.host().isEmpty()) {
+        return QString();
+    }
+    QString scheme = (url.scheme() == "wss") ? "https" : "http";
+    QString api = QString("%1://%2").arg(scheme, url.host());
+    if (url.port() > 0) {
+        api += QString(":%1").arg(url.port());
+    }
+    return api;
+}
+
+/**
+ * @brief 读取 config.ini 建立 相机 -> 服务 映射
+ * [Services]
+ *   DefaultApi=http://127.0.0.1:8020   未配置相机地址时使用
+ *   RequestTimeoutMs=3000              单主机请求超时
+ * [Cameras]
+ *   CamN=ws://host:port/ws/subscribe   控制地址默认由此推导
+ *   CamNApi=http://host:port           (可选) 显式指定控制地址
+ *   CamNIndex=N                        (可选) 在该服务上的相机号，默认等于全局号
+ */
+void CameraRegistry::loadFromConfig()
+{
+    QString configPath = QCoreApplication::applicationDirPath() + "/config.ini";
+    QSettings settings(configPath, QSettings::IniFormat);
+
+    QString defaultApi = settings.value("Services/DefaultApi", "http://127.0.0.1:8020").toString();
+    m_timeoutMs = settings.value("Services/RequestTimeoutMs", 3000).toInt();
+
+    m_endpoints.clear();
+    for (int camId = 1; camId <= CAMERA_COUNT; camId++) {
+        QString key = QString("Cameras/Cam%1").arg(camId);
+
+        CameraEndpoint ep;
+        ep.cameraId = camId;
+        ep.wsUrl = settings.value(key, "ws://192.168.100.5:8020/ws/subscribe").toString();
+        ep.localId = settings.value(key + "Index", camId).toInt();
+
+        QString api = settings.value(key + "Api").toString();
+        if (api.isEmpty() && settings.contains(key)) {
+            api = apiUrlFromWsUrl(ep.wsUrl);
+        }
+        if (api.isEmpty()) {
+            api = defaultApi;
+        }
+        if (api.endsWith("/")) {
+            api.chop(1);
+        }
+        ep.hostKey = api;
+        m_endpoints.insert(camId, ep);
+        ensureClient(api);
+    }
+
+    // 清理不再被任何相机引用的主机
+    QSet<QString> used;
+    for (const CameraEndpoint &ep : m_endpoints) {
+        used.insert(ep.hostKey);
+    }
+    for (const QString &host : m_hostOrder) {
+        if (!used.contains(host)) {
+            m_clients.take(host)->deleteLater();
+        }
+    }
+    m_hostOrder.clear();
+    for (const CameraEndpoint &ep : m_endpoints) {
+        if (!m_hostOrder.contains(ep.hostKey)) {
+            m_hostOrder.append(ep.hostKey);
+        }
+    }
+
+    for (CameraClient *api : m_clients) {
+        api->setRequestTimeout(m_timeoutMs);
+    }
+    qDebug() << "相机服务主机:" << m_hostOrder;
+}
+
+CameraClient *CameraRegistry::ensureClient(const QString &hostKey)
+{
+    CameraClient *api = m_clients.value(hostKey, nullptr);
+    if (api) {
+        return api;
+    }
+
+    api = new CameraClient(this);
+    api->setBaseUrl(hostKey);
+    api->setRequestTimeout(m_timeoutMs);
+    api->setSnapshotWriter(m_snapshotWriter);
+    m_clients.insert(hostKey, api);
+
+    connect(api, &CameraClient::serviceInfoReceived, this, [=](const ServiceInfo &info){
+        emit hostServiceInfoReceived(hostKey, info);
+        completeHost("/", hostKey, true);
+    });
+    connect(api, &CameraClient::healthInfoReceived, this, [=](const HealthInfo &info){
+        emit hostHealthReceived(hostKey, info);
+        completeHost("/health", hostKey, true);
+    });
+    connect(api, &CameraClient::controlResult, this,
+            [=](bool success, const QString &apiName, const QJsonObject &data, const QString &errorMsg){
+        // GET 查询失败单独上报，不走控制结果弹窗
+        if (!success && (apiName == "/" || apiName == "/health")) {
+            emit hostQueryFailed(hostKey, apiName, errorMsg);
+            completeHost(apiName, hostKey, false);
+            return;
+        }
+        QString name = (m_hostOrder.size() > 1) ? QString("%1 %2").arg(hostKey, apiName) : apiName;
+        emit controlResult(success, name, data, errorMsg);
+    });
+    connect(api, &CameraClient::backgroundControlResult, this,
+            [=](bool success, const QString &apiName, const QJsonObject &data, const QString &errorMsg){
+        QString name = (m_hostOrder.size() > 1) ? QString("%1 %2").arg(hostKey, apiName) : apiName;
+        emit backgroundControlResult(success, name, data, errorMsg);
+    });
+
+    // 抓拍的 tag 即全局相机号
+    connect(api, &CameraClient::snapshotHeaderParsed, this, &CameraRegistry::snapshotHeaderParsed);
+    connect(api, &CameraClient::snapshotPreviewReady, this, &CameraRegistry::snapshotPreviewReady);
+    connect(api, &CameraClient::snapshotSaved, this,
+            [=](int camId, const QString &path, const QSize &size, qint64 bytes){
+        emit snapshotSaved(camId, path, size, bytes);
+        completeCapture(camId, true);
+    });
+    connect(api, &CameraClient::snapshotFailed, this, [=](int camId, const QString &errorMsg){
+        emit snapshotFailed(camId, errorMsg);
+        completeCapture(camId, false);
+    });
+
+    api->warmUp();
+    return api;
+}
+
+CameraClient *CameraRegistry::clientForCamera(int cameraId) const
+{
+    if (!m_endpoints.contains(cameraId)) {
+        return m_hostOrder.isEmpty() ? nullptr : m_clients.value(m_hostOrder.first());
+    }
+    return m_clients.value(m_endpoints.value(cameraId).hostKey, nullptr);
+}
+
+QVector<int> CameraRegistry::camerasOnHost(const QString &hostKey) const
+{
+    QVector<int> ids;
+    for (const CameraEndpoint &ep : m_endpoints) {
+        if (ep.hostKey == hostKey) {
+            ids.append(ep.cameraId);
+        }
+    }
+    return ids;
+}
+
+void CameraRegistry::dispatch(bool isGlobal, int cameraId,
+                              const std::function<void(CameraClient *, bool, int)> &fn)
+{
+    if (isGlobal) {
+        for (const QString &host : m_hostOrder) {
+            fn(m_clients.value(host), true, 0);
+        }
+        return;
+    }
+    CameraClient *api = clientForCamera(cameraId);
+    if (!api) {
+        return;
+    }
+    int localId = m_endpoints.contains(cameraId) ? m_endpoints.value(cameraId).localId : cameraId;
+    fn(api, false, localId);
+}
+
+// ==========================================
+// 并行扇出
+// ==========================================
+void CameraRegistry::queryAllHealth()
+{
+    beginFanOut("/health", [](CameraClient *api){ api->getHealthStatus(); });
+}
+
+void CameraRegistry::queryAllServiceInfo()
+{
+    beginFanOut("/", [](CameraClient *api){ api->getServiceConfig(); });
+}
+
+void CameraRegistry::queryHealth(const QString &hostKey)
+{
+    CameraClient *api = client(hostKey);
+    if (api) {
+        api->getHealthStatus();
+    }
+}
+
+void CameraRegistry::beginFanOut(const QString &apiName, const std::function<void(CameraClient *)> &fn)
+{
+    FanOutRound &round = m_rounds[apiName];
+    if (round.pending.isEmpty()) {
+        round.ok = 0;
+        round.fail = 0;
+        round.generation = ++m_roundCounter;
+    }
+    const quint64 generation = round.generation;
+
+    // 所有主机同时发出，请求彼此独立；上一轮仍在等待的主机不重复发送
+    for (const QString &host : m_hostOrder) {
+        if (round.pending.contains(host)) {
+            continue;
+        }
+        round.pending.insert(host);
+        fn(m_clients.value(host));
+    }
+
+    // 兜底：超时后仍未返回的主机按失败计入本轮
+    QTimer::singleShot(m_timeoutMs + 500, this, [=](){
+        if (!m_rounds.contains(apiName) || m_rounds[apiName].generation != generation) {
+            return;
+        }
+        const QSet<QString> stale = m_rounds[apiName].pending;
+        for (const QString &host : stale) {
+            emit hostQueryFailed(host, apiName, QStringLiteral("timeout"));
+            completeHost(apiName, host, false);
+        }
+    });
+}
+
+void CameraRegistry::completeHost(const QString &apiName, const QString &hostKey, bool ok)
+{
+    auto it = m_rounds.find(apiName);
+    if (it == m_rounds.end() || !it->pending.remove(hostKey)) {
+        return;
+    }
+    if (ok) {
+        it->ok++;
+    } else {
+        it->fail++;
+    }
+    if (it->pending.isEmpty()) {
+        int okCount = it->ok;
+        int failCount = it->fail;
+        m_rounds.erase(it);
+        emit fanOutFinished(apiName, okCount, failCount);
+    }
+}
+
+// ==========================================
+// 抓拍
+// ==========================================
+void CameraRegistry::captureSnapshot(int cameraId, const QString &filePath, int previewMaxSide)
+{
+    CameraClient *api = clientForCamera(cameraId);
+    if (!api) {
+        emit snapshotFailed(cameraId, QStringLiteral("no service for camera"));
+        completeCapture(cameraId, false);
+        return;
+    }
+    int localId = m_endpoints.contains(cameraId) ? m_endpoints.value(cameraId).localId : cameraId;
+    api->fetchSnapshot(localId, filePath, cameraId, previewMaxSide);
+}
+
+/**
+ * @brief 所有相机同时抓拍
+ * 请求一次性全部发出，同一主机上的请求由该主机的连接池并行承载；
+ * 每路数据边收边写，内存中只保留 JPEG 头部几百字节。
+ */
+void CameraRegistry::captureAll(const QString &dirPath, int previewMaxSide)
+{
+    if (isCapturingAll()) {
+        return;
+    }
+    m_captureDir = dirPath;
+    m_captureOk = 0;
+    m_captureFail = 0;
+    QString stamp = QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss");
+    QDir dir(dirPath);
+    for (int camId = 1; camId <= CAMERA_COUNT; camId++) {
+        m_capturePending.insert(camId);
+    }
+    for (int camId = 1; camId <= CAMERA_COUNT; camId++) {
+        QString fileName = QString("cam%1_%2.jpg").arg(camId, 2, 10, QChar('0')).arg(stamp);
+        captureSnapshot(camId, dir.filePath(fileName), previewMaxSide);
+    }
+}
+
+void CameraRegistry::requestPreview(int cameraId, const QString &filePath, int maxSide)
+{
+    m_previewJobs.insert(m_snapshotWriter->requestPreview(filePath, maxSide), cameraId);
+}
+
+void CameraRegistry::completeCapture(int cameraId, bool ok)
+{
+    if (!m_capturePending.remove(cameraId)) {
+        return;
+    }
+    if (ok) {
+        m_captureOk++;
+    } else {
+        m_captureFail++;
+    }
+    if (m_capturePending.isEmpty()) {
+        emit captureAllFinished(m_captureDir, m_captureOk, m_captureFail);
+    }
+}
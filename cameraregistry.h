@@ -0,0 +1,111 @@
+#ifndef CAMERAREGISTRY_H
+#define CAMERAREGISTRY_H
+
+#include <QObject>
+#include <QMap>
+#include <QSet>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include <functional>
+#include "cameraclient.h"
+
+// 相机 -> 服务端点 的映射
+struct CameraEndpoint {
+    int cameraId = 0;       // 全局相机号 (1-13)
+    int localId = 0;        // 在所属服务上的相机号 (发送给服务时仍按 1 起算)
+    QString hostKey;        // 所属服务的基础地址，例如 "http://192.168.100.5:8020"
+    QString wsUrl;          // 视频订阅地址
+};
+
+/**
+ * @brief 多服务端点注册表
+ * 根据 config.ini 把 13 路相机映射到各自的采集服务上，每个服务主机只创建
+ * 一个 CameraClient (即一个 QNetworkAccessManager 连接池，keep-alive 复用)。
+ * 健康/配置查询会并行扇出到所有主机，每个主机单独计时超时。
+ */
+class CameraRegistry : public QObject
+{
+    Q_OBJECT
+public:
+    static const int CAMERA_COUNT = 13;
+
+    explicit CameraRegistry(QObject *parent = nullptr);
+
+    // 读取 config.ini 重新建立映射
+    void loadFromConfig();
+
+    QStringList hosts() const { return m_hostOrder; }
+    CameraClient *client(const QString &hostKey) const { return m_clients.value(hostKey, nullptr); }
+    CameraClient *clientForCamera(int cameraId) const;
+    CameraEndpoint endpoint(int cameraId) const { return m_endpoints.value(cameraId); }
+    QVector<int> camerasOnHost(const QString &hostKey) const;
+    int requestTimeoutMs() const { return m_timeoutMs; }
+
+    // 按作用域把控制命令路由到对应服务：
+    // 全局作用域 -> 每个主机各发一次；单相机 -> 所属主机 + 本地相机号
+    void dispatch(bool isGlobal, int cameraId,
+                  const std::function<void(CameraClient *api, bool isGlobal, int localId)> &fn);
+
+    // --- 并行扇出查询 ---
+    void queryAllHealth();
+    void queryAllServiceInfo();
+    void queryHealth(const QString &hostKey);
+
+    // --- 抓拍 (流式落盘，不在 GUI 线程解码) ---
+    // previewMaxSide > 0 时额外在写线程生成一张缩放预览
+    void captureSnapshot(int cameraId, const QString &filePath, int previewMaxSide = 0);
+    // 13 路同时抓拍到 dirPath/camNN_<时间>.jpg，全部返回后发出 captureAllFinished
+    void captureAll(const QString &dirPath, int previewMaxSide = 0);
+    bool isCapturingAll() const { return !m_capturePending.isEmpty(); }
+    // 对已保存的抓拍按需生成预览，结果经 snapshotPreviewReady 返回
+    void requestPreview(int cameraId, const QString &filePath, int maxSide);
+
+signals:
+    void hostServiceInfoReceived(const QString &hostKey, const ServiceInfo &info);
+    void hostHealthReceived(const QString &hostKey, const HealthInfo &info);
+    void hostQueryFailed(const QString &hostKey, const QString &apiName, const QString &errorMsg);
+    // 一轮扇出全部返回 (成功/失败/超时) 后发出
+    void fanOutFinished(const QString &apiName, int okCount, int failCount);
+
+    // 控制接口结果 (多主机时 apiName 前会带上主机地址)
+    void controlResult(bool success, const QString &apiName, const QJsonObject &resultData, const QString &errorMsg);
+    void backgroundControlResult(bool success, const QString &apiName, const QJsonObject &resultData, const QString &errorMsg);
+
+    // 抓拍结果 (按全局相机号)
+    void snapshotHeaderParsed(int cameraId, const QSize &size);
+    void snapshotSaved(int cameraId, const QString &path, const QSize &size, qint64 bytes);
+    void snapshotPreviewReady(int cameraId, const QImage &preview);
+    void snapshotFailed(int cameraId, const QString &errorMsg);
+    void captureAllFinished(const QString &dirPath, int okCount, int failCount);
+
+private:
+    struct FanOutRound {
+        QSet<QString> pending;
+        int ok = 0;
+        int fail = 0;
+        quint64 generation = 0;
+    };
+
+    QMap<QString, CameraClient*> m_clients;   // hostKey -> client
+    QStringList m_hostOrder;
+    QMap<int, CameraEndpoint> m_endpoints;    // cameraId -> endpoint
+    QMap<QString, FanOutRound> m_rounds;      // apiName -> 当前轮次
+    quint64 m_roundCounter = 0;
+    int m_timeoutMs = 3000;
+
+    SnapshotWriter *m_snapshotWriter;         // 所有主机共用一个写线程
+    QSet<int> m_capturePending;               // captureAll 中尚未返回的相机
+    QHash<int, int> m_previewJobs;            // 预览作业号 -> 相机号
+    QString m_captureDir;
+    int m_captureOk = 0;
+    int m_captureFail = 0;
+
+    static QString apiUrlFromWsUrl(const QString &wsUrl);
+    CameraClient *ensureClient(const QString &hostKey);
+    void beginFanOut(const QString &apiName, const std::function<void(CameraClient *api)> &fn);
+    void completeHost(const QString &apiName, const QString &hostKey, bool ok);
+    void completeCapture(int cameraId, bool ok);
+};
+
+#endif // CAMERAREGISTRY_H
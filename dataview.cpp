@@ -7,15 +7,21 @@
 #include "Database/dbmanager.h"
 #include <QSettings>
 #include <QCoreApplication>
+#include <QtMath>
+#include <QDir>
+#include <QDateTime>
+#include <QLabel>
+#include <QDateTimeEdit>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QProgressDialog>
 #include "videopanorama.h"
 
 DataView::DataView(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::DataView)
     , m_timeCount(0)
-    , m_velocity(0)
-    , m_acceleration(0)
-    , m_displacement(0)
 {
     ui->setupUi(this);
 
@@ -35,6 +41,7 @@ DataView::DataView(QWidget *parent)
 
     initTableStyles();  // 准备表格
     initChartStyles();  // 准备图表
+    initVessels();      // 船舶列表
 
     // 读取保存间隔（秒）默认 5s
     {
@@ -49,48 +56,49 @@ DataView::DataView(QWidget *parent)
     m_simTimer = new QTimer(this);
     connect(m_simTimer, &QTimer::timeout, this, [=](){
 
-        // --- A. 模拟物理计算 ---
-        // 随机生成加速度 (-2 到 2 之间)
-        double randomAcc = QRandomGenerator::global()->bounded(-20, 20) / 10.0;
-        m_acceleration = randomAcc;
+        // --- A. 模拟物理计算 (每条船各自计算) ---
+        for (VesselState &vessel : m_vessels) {
+            // 随机生成加速度 (-2 到 2 之间)
+            vessel.acceleration = QRandomGenerator::global()->bounded(-20, 20) / 10.0;
 
-        // 速度 v = v0 + at
-        m_velocity += m_acceleration;
-        if(m_velocity < 0) m_velocity = 0;
-        if(m_velocity > 100) m_velocity = 100;
+            // 速度 v = v0 + at
+            vessel.velocity += vessel.acceleration;
+            if(vessel.velocity < 0) vessel.velocity = 0;
+            if(vessel.velocity > 100) vessel.velocity = 100;
 
-        // 位移 s = s0 + vt
-        double deltaS = m_velocity * 0.5; // 0.5秒的时间片
-        m_displacement += deltaS;
-        // m_position = m_displacement + 0; // 假设初始位置是10
+            // 位移 s = s0 + vt
+            double deltaS = vessel.velocity * 0.5; // 0.5秒的时间片
+            vessel.displacement += deltaS;
+        }
+        const VesselState current = m_vessels.value(m_currentVessel);
 
         m_timeCount += 0.5; // X轴时间增加
 
-        // --- B. 更新表格数据 ---
+        // --- B. 更新表格数据 (当前船) ---
         // 假设表格顺序：速度、加速度、位移、位置
         if(ui->tableWidget->rowCount() >= 3) {
-            ui->tableWidget->item(0, 1)->setText(QString::number(m_velocity, 'f', 1));
-            ui->tableWidget->item(1, 1)->setText(QString::number(m_acceleration, 'f', 1));
-            ui->tableWidget->item(2, 1)->setText(QString::number(m_displacement, 'f', 1));
+            ui->tableWidget->item(0, 1)->setText(QString::number(current.velocity, 'f', 1));
+            ui->tableWidget->item(1, 1)->setText(QString::number(current.acceleration, 'f', 1));
+            ui->tableWidget->item(2, 1)->setText(QString::number(current.displacement, 'f', 1));
         }
 
         // --- C. 更新图表数据 ---
         // 1. 速度图表
-        m_seriesSpeed->append(m_timeCount, m_velocity);
+        m_seriesSpeed->append(m_timeCount, current.velocity);
         if(m_timeCount > 20) {
             m_axisX_Speed->setMax(m_timeCount); // 让最大值跟随时间增加
             m_axisX_Speed->setMin(0);           // 强制最小值永远保持 0
         }
 
         // 2. 位移图表
-        m_seriesDist->append(m_timeCount, m_displacement);
+        m_seriesDist->append(m_timeCount, current.displacement);
         if(m_timeCount > 20) {
             m_axisX_Dist->setMax(m_timeCount);  // 让最大值跟随时间增加
             m_axisX_Dist->setMin(0);            // 强制最小值永远保持 0
         }
         // 动态调整Y轴范围 (因为位移是一直增加的)
-        if(m_displacement > m_axisY_Dist->max()) {
-            m_axisY_Dist->setMax(m_displacement + 50);
+        if(current.displacement > m_axisY_Dist->max()) {
+            m_axisY_Dist->setMax(current.displacement + 50);
         }
 
         // 刷新仅更新图表与表格展示，不直接入库
@@ -108,26 +116,24 @@ DataView::DataView(QWidget *parent)
     m_saveTimer->start();
 
     /**********************历史信息统计***************************************/
-    // 初始化分页变量
-    m_historyCurrentPage = 1;
-    m_historyPageSize = 10; // 假设一页显示10行，根据您UI的高度调整
-
     // 启动数据库
     initDatabase();
 
-    // 连接历史翻页按钮信号
-    connect(ui->btnHisPrev, &QPushButton::clicked, this, [=](){
-        if(m_historyCurrentPage > 1) {
-            m_historyCurrentPage--;
-            loadHistoryData();
-        }
-    });
-
-    connect(ui->btnHisNext, &QPushButton::clicked, this, [=](){
-        if(m_historyCurrentPage < m_historyTotalPages) {
-            m_historyCurrentPage++;
-            loadHistoryData();
-        }
+    // 历史记录：滚动到底自动加载更早的记录
+    m_historyModel = new HistoryModel(this);
+    m_historyModel->setVessel(m_currentVessel);
+    ui->tableHistory->setModel(m_historyModel);
+    ui->tableHistory->setSelectionBehavior(QAbstractItemView::SelectRows);
+    ui->tableHistory->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    ui->tableHistory->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    ui->tableHistory->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    // 行高固定，视图不必逐行测量
+    ui->tableHistory->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    connect(m_historyModel, &QAbstractItemModel::rowsInserted, this, [=](){ updateHistoryInfo(); });
+    connect(m_historyModel, &QAbstractItemModel::modelReset, this, [=](){ updateHistoryInfo(); });
+    m_telemetryExporter = new TelemetryExporter(this);
+    connect(m_telemetryExporter, &TelemetryExporter::finished, this, [=](){
+        ui->btnExportHistory->setEnabled(true);
     });
 
 
@@ -165,21 +171,37 @@ DataView::DataView(QWidget *parent)
             m_currentVideoPageIndex = pageIndex;
             emit sigSwitchVideoMode(pageIndex);
         }
+        updateHealthTracking(m_currentVideoPageIndex);
     });
 
 
     /**********************settingPage***************************************/
     // ===============================================
-    // 1. 初始化相机接口客户端
+    // 1. 初始化相机服务注册表 (按 config.ini 映射到各采集服务)
     // ===============================================
-    m_api = new CameraClient(this);
-    m_api->setBaseUrl("http://127.0.0.1:8020");
+    m_registry = new CameraRegistry(this);
 
     // 2. 连接通用结果信号 -> 处理回调函数
-    connect(m_api, &CameraClient::controlResult, this, &DataView::onApiResult);
+    connect(m_registry, &CameraRegistry::controlResult, this, &DataView::onApiResult);
+    connect(m_registry, &CameraRegistry::hostQueryFailed, this, &DataView::onHostQueryFailed);
 
-    // 3. 连接抓拍图片信号 -> 显示图片
-    connect(m_api, &CameraClient::snapshotReceived, this, &DataView::onSnapshotReceived);
+    // 3. 连接抓拍信号 -> 本地流式保存结果 / 预览
+    for (const QString &host : m_registry->hosts()) {
+        connect(m_registry->client(host), &CameraClient::snapshotReceived, this, &DataView::onSnapshotReceived);
+    }
+    connect(m_registry, &CameraRegistry::snapshotSaved, this, &DataView::onSnapshotSaved);
+    connect(m_registry, &CameraRegistry::snapshotFailed, this, &DataView::onSnapshotFailed);
+    connect(m_registry, &CameraRegistry::snapshotPreviewReady, this, &DataView::onSnapshotPreviewReady);
+    connect(m_registry, &CameraRegistry::captureAllFinished, this, [=](const QString &dirPath, int okCount, int failCount){
+        ui->btnSnapshotAll->setEnabled(true);
+        QString msg = QString("全部抓拍完成: 成功 %1 / 失败 %2\n保存目录: %3").arg(okCount).arg(failCount).arg(dirPath);
+        ui->txtApiLog->append(msg);
+        if (failCount == 0) {
+            QMessageBox::information(this, "抓拍完成", msg);
+        } else {
+            QMessageBox::warning(this, "抓拍完成", msg);
+        }
+    });
 
     // 4. 初始化UI控件的默认值 (可选，提升体验)
     ui->dsbFps->setRange(1, 120); ui->dsbFps->setValue(25);
@@ -195,23 +217,93 @@ DataView::DataView(QWidget *parent)
     // ===============================================
 
     // --- 新增: GET与Health测试按钮 ---
-    connect(ui->btnget, &QPushButton::clicked, this, [=](){ m_api->getServiceConfig(); });
-    connect(ui->btnhealth, &QPushButton::clicked, this, [=](){ m_api->getHealthStatus(); });
+    connect(ui->btnget, &QPushButton::clicked, this, [=](){ m_registry->queryAllServiceInfo(); });
+    connect(ui->btnhealth, &QPushButton::clicked, this, [=](){
+        m_healthLogPending = true;
+        m_registry->queryAllHealth();
+    });
 
     // 连接获取配置的成功信号 -> 更新UI
-    connect(m_api, &CameraClient::serviceInfoReceived, this, &DataView::onServiceInfoReceived);
-    connect(m_api, &CameraClient::healthInfoReceived, this, &DataView::onHealthInfoReceived);
+    connect(m_registry, &CameraRegistry::hostServiceInfoReceived, this, &DataView::onServiceInfoReceived);
+    connect(m_registry, &CameraRegistry::hostHealthReceived, this, &DataView::onHealthInfoReceived);
+    connect(m_registry, &CameraRegistry::fanOutFinished, this, [=](const QString &apiName, int okCount, int failCount){
+        if (m_registry->hosts().size() > 1) {
+            ui->txtApiLog->append(QString("%1 查询完成: 成功 %2 / 失败 %3").arg(apiName).arg(okCount).arg(failCount));
+        }
+        if (apiName == "/health") {
+            m_healthLogPending = false;
+        }
+    });
+
+    // 后台健康遥测：自适应轮询 + 环形缓冲 -> 图表
+    m_healthMonitor = new HealthMonitor(m_registry, this);
+    initHealthChart();
+    connect(m_healthMonitor, &HealthMonitor::sampleAdded, this, [=](const QString &host, const HealthSample &){
+        updateHealthChart(host);
+    });
+    connect(m_healthMonitor, &HealthMonitor::stallChanged, this, [=](const QString &host, bool stalled){
+        ui->txtApiLog->append(stalled ? QString("警告 [%1]: 编码序号停止增长，推流可能卡顿").arg(host)
+                                      : QString("恢复 [%1]: 编码序号恢复增长").arg(host));
+    });
+
+    // 发送请求 (并行扇出到所有服务主机)
+    m_registry->queryAllServiceInfo();
+    m_healthLogPending = true;
+    m_registry->queryAllHealth();
+    m_healthMonitor->start();
+
+    // ===============================================
+    // 实时帧分析线程 + 自动曝光
+    // ===============================================
+    m_analysisThread = new QThread(this);
+    m_analyzer = new FrameAnalyzer;
+    m_analyzer->moveToThread(m_analysisThread);
+    connect(m_analysisThread, &QThread::finished, m_analyzer, &QObject::deleteLater);
+    m_analysisThread->start();
+    initAutoExposure();
+    initStreamHealth();
+
+    // ===============================================
+    // 本地连续录像
+    // ===============================================
+    m_recorder = new Recorder(this);
+    connect(m_recorder, &Recorder::writeError, this, [=](int camId, const QString &errorMsg){
+        ui->txtApiLog->append(QString("相机 %1 录像写入失败: %2").arg(camId).arg(errorMsg));
+    });
+    connect(m_recorder, &Recorder::storageLow, this, [=](qint64 freeBytes, qint64 minFreeBytes){
+        ui->txtApiLog->append(QString("录像磁盘空间不足: 剩余 %1 MB (要求 %2 MB)，可清理的录像已全部删除")
+                                  .arg(freeBytes >> 20).arg(minFreeBytes >> 20));
+    });
+    if (m_recorder->isEnabled() && m_recorder->isMotionTriggered()) {
+        initMotionTrigger();
+    }
+
+    // 视频回放页 (读取本地录像)
+    QVBoxLayout *playbackLayout = new QVBoxLayout(ui->pagePlayback);
+    playbackLayout->setContentsMargins(0, 0, 0, 0);
+    m_playbackView = new PlaybackView(m_recorder->rootDir(), ui->pagePlayback);
+    playbackLayout->addWidget(m_playbackView, 1);
+    initPlaybackChart();
 
-    // 发送请求
-    m_api->getServiceConfig();
-    m_api->getHealthStatus();
+    // 点击历史记录，跳到该时刻录像
+    connect(ui->tableHistory, &QTableView::clicked, this, [=](const QModelIndex &index){
+        openHistoryRow(index.row());
+    });
 }
 
 DataView::~DataView()
 {
+    m_analysisThread->quit();
+    m_analysisThread->wait();
     delete ui;
 }
 
+void DataView::onLiveFrame(int camId, const QByteArray &data)
+{
+    m_analyzer->submitFrame(camId, data);
+    m_recorder->submitFrame(camId, data);
+}
+
 // 初始化表格 (保持您之前的样式，这里只做数据结构准备)
 void DataView::initTableStyles()
 {
@@ -330,6 +422,246 @@ void DataView::initChartStyles()
     layout2->addWidget(chartView2);
 }
 
+// 运动触发录像：分析线程给出每路的变化面积，超过阈值即触发 (延长) 录像
+// 配置 (config.ini [Motion])：Threshold=12  MinAreaPercent=1.0  IntervalMs=200
+// 单路覆盖：Cam5Threshold / Cam5MinAreaPercent / Cam5Mask ("x,y,w,h;..." 归一化坐标的忽略区域)，Cam0 为全景
+void DataView::initMotionTrigger()
+{
+    QString configPath = QCoreApplication::applicationDirPath() + "/config.ini";
+    QSettings settings(configPath, QSettings::IniFormat);
+    settings.beginGroup("Motion");
+    int defaultThreshold = settings.value("Threshold", 12).toInt();
+    double defaultMinArea = settings.value("MinAreaPercent", 1.0).toDouble();
+    m_analyzer->setMotionIntervalMs(qMax(20, settings.value("IntervalMs", 200).toInt()));
+
+    for (int camId = 0; camId <= CameraRegistry::CAMERA_COUNT; camId++) {
+        QString key = QString("Cam%1").arg(camId);
+        MotionParams params;
+        params.threshold = qBound(1, settings.value(key + "Threshold", defaultThreshold).toInt(), 255);
+        const QStringList rects = settings.value(key + "Mask").toString().split(';', Qt::SkipEmptyParts);
+        for (const QString &rect : rects) {
+            QStringList v = rect.split(',');
+            if (v.size() == 4) {
+                params.masks.append(QRectF(v[0].toDouble(), v[1].toDouble(), v[2].toDouble(), v[3].toDouble()));
+            }
+        }
+        m_motionMinFraction[camId] = qMax(0.0, settings.value(key + "MinAreaPercent", defaultMinArea).toDouble()) / 100.0;
+        m_analyzer->setMotionParams(camId, params);
+        m_analyzer->setFeature(camId, FrameAnalyzer::MotionFeature, true);
+    }
+    settings.endGroup();
+
+    connect(m_analyzer, &FrameAnalyzer::motionMeasured, this, [=](int camId, double changedFraction){
+        if (changedFraction > 0 && changedFraction >= m_motionMinFraction.value(camId, 0.01)) {
+            m_recorder->triggerMotion(camId, changedFraction);
+        }
+    });
+    connect(m_recorder, &Recorder::motionEvent, this, [=](int camId, qint64 startMs, qint64 endMs, double peakScore){
+        DBManager::instance().insertMotionEvent(camId, startMs, endMs, peakScore);
+    });
+}
+
+// 每路相机一个自动曝光控制器，统计结果来自分析线程
+void DataView::initAutoExposure()
+{
+    for (int camId = 1; camId <= CameraRegistry::CAMERA_COUNT; camId++) {
+        AutoExposureController *ae = new AutoExposureController(camId, this);
+        m_aeControllers.insert(camId, ae);
+
+        connect(m_analyzer, &FrameAnalyzer::lumaStatsReady, ae, &AutoExposureController::onLumaStats);
+        // 自动控制命令走后台通道：不弹窗，也不触发画面重连
+        connect(ae, &AutoExposureController::requestExposure, this, [=](int id, double us){
+            m_registry->dispatch(false, id, [=](CameraClient *api, bool, int localId){
+                api->setExposure(false, localId, us, true);
+            });
+        });
+        connect(ae, &AutoExposureController::requestGain, this, [=](int id, double gain){
+            m_registry->dispatch(false, id, [=](CameraClient *api, bool, int localId){
+                api->setGain(false, localId, gain, true);
+            });
+        });
+        connect(ae, &AutoExposureController::stateChanged, this, [=](int id, AutoExposureController::State state){
+            if (state == AutoExposureController::Limited) {
+                ui->txtApiLog->append(QString("相机 %1 自动曝光已到达曝光/增益上限").arg(id));
+            }
+            updateAeStateLabel();
+        });
+    }
+
+    connect(m_analyzer, &FrameAnalyzer::lumaStatsReady, this, [=](int camId, const LumaStats &){
+        if (camId == ui->sbTargetCamId->value()) {
+            updateAeStateLabel();
+        }
+    });
+    connect(m_registry, &CameraRegistry::backgroundControlResult, this,
+            [=](bool success, const QString &apiName, const QJsonObject &, const QString &errorMsg){
+        if (!success) {
+            ui->txtApiLog->append(QString("自动控制失败 API: %1 错误信息: %2").arg(apiName, errorMsg));
+        }
+    });
+
+    // 勾选：对目标相机 (或全局作用域下的全部相机) 启用闭环
+    connect(ui->chkAutoExposure, &QCheckBox::toggled, this, [=](bool on){
+        QList<int> targets;
+        if (ui->chkGlobalScope->isChecked()) {
+            targets = m_aeControllers.keys();
+        } else {
+            targets.append(ui->sbTargetCamId->value());
+        }
+        for (int camId : targets) {
+            m_aeControllers[camId]->setEnabled(on, ui->dsbExposure->value(), ui->dsbGain->value());
+            m_analyzer->setFeature(camId, FrameAnalyzer::LumaFeature, on);
+        }
+        updateAeStateLabel();
+    });
+    connect(ui->sbTargetCamId, QOverload<int>::of(&QSpinBox::valueChanged), this, [=](int){
+        updateAeStateLabel();
+    });
+}
+
+void DataView::updateAeStateLabel()
+{
+    AutoExposureController *ae = m_aeControllers.value(ui->sbTargetCamId->value(), nullptr);
+    if (!ae) {
+        return;
+    }
+    // 同步勾选框，但不触发 toggled
+    ui->chkAutoExposure->blockSignals(true);
+    ui->chkAutoExposure->setChecked(ae->isEnabled());
+    ui->chkAutoExposure->blockSignals(false);
+
+    if (!ae->isEnabled()) {
+        ui->lblAeState->setText("自动曝光: 关闭");
+        return;
+    }
+    ui->lblAeState->setText(QString("自动曝光: %1  亮度 %2  曝光 %3 us  增益 %4")
+                            .arg(AutoExposureController::stateText(ae->state()))
+                            .arg(ae->lastMeanLuma(), 0, 'f', 0)
+                            .arg(ae->exposureUs(), 0, 'f', 0)
+                            .arg(ae->gain(), 0, 'f', 1));
+}
+
+// 画面健康：分析线程逐帧给出指标，StreamHealthTracker 去抖后上报状态
+void DataView::initStreamHealth()
+{
+    QString configPath = QCoreApplication::applicationDirPath() + "/config.ini";
+    QSettings settings(configPath, QSettings::IniFormat);
+    m_monitorAllCameras = settings.value("Cameras/KeepAllStreams", false).toBool();
+
+    m_streamHealth = new StreamHealthTracker(this);
+    connect(m_analyzer, &FrameAnalyzer::healthMetricsReady, m_streamHealth, &StreamHealthTracker::onMetrics);
+    connect(m_streamHealth, &StreamHealthTracker::healthStateChanged, this,
+            [=](int camId, StreamHealthTracker::State state){
+        // 在相机按钮上标出异常状态
+        QPushButton *btn = findChild<QPushButton*>(QString("btnCam%1").arg(camId));
+        if (btn) {
+            if (state == StreamHealthTracker::Ok) {
+                btn->setText(QString("相机%1").arg(camId));
+                btn->setToolTip(QString());
+            } else {
+                btn->setText(QString("相机%1\n%2").arg(camId).arg(StreamHealthTracker::stateText(state)));
+                btn->setToolTip(QString("画面异常: %1").arg(StreamHealthTracker::stateText(state)));
+            }
+        }
+
+        StreamHealthMetrics m = m_streamHealth->lastMetrics(camId);
+        ui->txtApiLog->append(QString("相机 %1 画面状态: %2 (亮度 %3, 对比度 %4, 帧差 %5, 清晰度 %6)")
+                              .arg(camId)
+                              .arg(StreamHealthTracker::stateText(state))
+                              .arg(m.mean, 0, 'f', 1)
+                              .arg(m.stddev, 0, 'f', 1)
+                              .arg(m.diffEnergy, 0, 'f', 2)
+                              .arg(m.sharpness, 0, 'f', 0));
+    });
+
+    updateHealthTracking(m_currentVideoPageIndex);
+}
+
+void DataView::updateHealthTracking(int pageIndex)
+{
+    int first = 1, last = CameraRegistry::CAMERA_COUNT;
+    if (!m_monitorAllCameras) {
+        // 只有当前显示的三路在接收数据
+        first = (pageIndex > 0) ? (pageIndex - 1) * 3 + 1 : 0;
+        last = (pageIndex > 0) ? qMin(first + 2, CameraRegistry::CAMERA_COUNT) : -1;
+    }
+    for (int camId = 1; camId <= CameraRegistry::CAMERA_COUNT; camId++) {
+        bool tracked = (camId >= first && camId <= last);
+        m_streamHealth->setTracked(camId, tracked);
+        m_analyzer->setFeature(camId, FrameAnalyzer::HealthFeature, tracked);
+    }
+}
+
+// 设置页日志框下方的编码吞吐曲线 (数据来自 HealthMonitor 的环形缓冲)
+void DataView::initHealthChart()
+{
+    m_chartHealth = new QChart();
+    m_chartHealth->legend()->setVisible(m_registry->hosts().size() > 1);
+    m_chartHealth->legend()->setLabelColor(Qt::white);
+    m_chartHealth->setBackgroundVisible(false);
+    m_chartHealth->setMargins(QMargins(0,0,0,0));
+
+    m_axisX_Health = new QValueAxis();
+    m_axisX_Health->setRange(-60, 0);
+    m_axisX_Health->setTitleText("时间（s）");
+    m_axisX_Health->setTitleBrush(Qt::cyan);
+    m_axisX_Health->setLabelFormat("%.0f");
+    m_axisX_Health->setLabelsColor(Qt::white);
+    m_axisX_Health->setGridLineColor(QColor(255, 255, 255, 30));
+    m_chartHealth->addAxis(m_axisX_Health, Qt::AlignBottom);
+
+    m_axisY_Health = new QValueAxis();
+    m_axisY_Health->setRange(0, 30);
+    m_axisY_Health->setTitleText("编码帧率");
+    m_axisY_Health->setTitleBrush(Qt::cyan);
+    m_axisY_Health->setLabelFormat("%.0f");
+    m_axisY_Health->setLabelsColor(Qt::cyan);
+    m_axisY_Health->setGridLineColor(QColor(255, 255, 255, 30));
+    m_chartHealth->addAxis(m_axisY_Health, Qt::AlignLeft);
+
+    for (const QString &host : m_registry->hosts()) {
+        QLineSeries *series = new QLineSeries();
+        series->setName(QUrl(host).host());
+        m_chartHealth->addSeries(series);
+        series->attachAxis(m_axisX_Health);
+        series->attachAxis(m_axisY_Health);
+        m_seriesHealth.insert(host, series);
+    }
+
+    QChartView *chartView = new QChartView(m_chartHealth);
+    chartView->setRenderHint(QPainter::Antialiasing);
+    chartView->setStyleSheet("background: transparent");
+    chartView->setMinimumHeight(120);
+    ui->txtApiLogLayout->insertWidget(1, chartView);
+}
+
+void DataView::updateHealthChart(const QString &host)
+{
+    QLineSeries *series = m_seriesHealth.value(host, nullptr);
+    const RingBuffer<HealthSample> *samples = m_healthMonitor->samples(host);
+    if (!series || !samples || samples->isEmpty()) {
+        return;
+    }
+
+    // 横轴为相对最新采样的秒数，只画最近 60 秒
+    qint64 now = samples->last().time_ms;
+    QList<QPointF> points;
+    double maxY = 0;
+    for (int i = 0; i < samples->size(); i++) {
+        const HealthSample &hs = samples->at(i);
+        double t = (hs.time_ms - now) / 1000.0;
+        if (t < -60) continue;
+        double y = hs.reachable ? hs.encode_fps : 0;
+        points.append(QPointF(t, y));
+        maxY = qMax(maxY, y);
+    }
+    series->replace(points);
+
+    if (maxY > m_axisY_Health->max()) {
+        m_axisY_Health->setMax(qCeil(maxY * 1.2));
+    }
+}
+
 void DataView::switchTopage(int index)
 {
     ui->stackeContent->setCurrentIndex(index);
@@ -357,85 +689,412 @@ void DataView::switchTopage(int index)
 
     ui->label_2->setText(titleText);
 
+    // 离开回放页时暂停，避免后台继续读盘
+    if (index != 1) {
+        m_playbackView->pause();
+    }
+
     if(index == 3) {
-        // 重置到第一页并加载
-        m_historyCurrentPage = 1;
+        // 补上离开期间新写入的记录
         loadHistoryData();
     }
 }
 
 void DataView::initDatabase()
 {
-    if (!DBManager::instance().connectToDb()) {
+    // 嵌入式存储打开很快，直接打开；MySQL 由写线程先连 (可能要等连接超时)，启动不被阻塞
+    if (DBManager::usesEmbeddedBackend() && !DBManager::instance().connectToDb()) {
         qDebug() << "数据库连接失败，请检查配置";
-        // 这里可以弹窗提示用户
+    }
+
+    // 遥测入库走独立线程和连接，数据库慢或断开都不会卡住界面；断开期间记录转存本地，恢复后补写。
+    // 每条船一个写入器，多船同时入库互不等待
+    if (!DBManager::usesEmbeddedBackend()) {
+        // 写线程各自长期占一条池连接，另给界面查询、历史预取和导出各留一条
+        const int needed = m_vessels.size() + POOL_RESERVED_CONNECTIONS;
+        const int poolMax = DBManager::instance().reservePoolConnections(needed);
+        if (poolMax < needed) {
+            ui->txtApiLog->append(QString("船只数 %1 超过数据库连接池容量 (%2)，历史查询和导出可能要等待连接")
+                                      .arg(m_vessels.size()).arg(poolMax));
+        }
+    }
+    for (auto it = m_vessels.constBegin(); it != m_vessels.constEnd(); ++it) {
+        m_telemetryWriters.insert(it.key(), new TelemetryWriter(it.key(), this));
+    }
+    // 写线程连上之后，界面线程的查询按需从连接池取自己的连接 (各写线程报告的状态合并，只提示一次)
+    auto onConnectionChanged = [=](bool connected){
+        if (connected == m_dbConnected) {
+            return;
+        }
+        m_dbConnected = connected;
+        if (!connected) {
+            ui->txtApiLog->append("数据库不可用，遥测数据暂存本地，恢复后自动补写");
+            return;
+        }
+        ui->txtApiLog->append("数据库已连接");
+        m_historyModel->reload();
+    };
+    for (TelemetryWriter *writer : m_telemetryWriters) {
+        const int vesselId = writer->vesselId();
+        connect(writer, &TelemetryWriter::connectionChanged, this, onConnectionChanged);
+        connect(writer, &TelemetryWriter::batchWritten, this, [=](int, qint64, int firstId){
+            // 历史记录只显示当前船
+            if (vesselId != m_currentVessel) {
+                return;
+            }
+            // 只有新 id 之上的缓存块会变
+            m_historyModel->invalidateFrom(firstId);
+            // 如果当前处于“历史数据查询”页，把新记录加到表格顶部
+            if (ui->stackeContent->currentIndex() == 3) {
+                loadHistoryData();
+            }
+        });
+        connect(writer, &TelemetryWriter::writeFailed, this, [=](const QString &errorMsg){
+            ui->txtApiLog->append(QString("船只 %1 遥测写入数据库失败: %2").arg(vesselId).arg(errorMsg));
+        });
+    }
+    // 写线程可能在上面 connect 之前就已连上
+    QMetaObject::invokeMethod(this, [=](){
+        for (TelemetryWriter *writer : m_telemetryWriters) {
+            if (writer->stats().connected) {
+                onConnectionChanged(true);
+                break;
+            }
+        }
+    }, Qt::QueuedConnection);
+}
+
+void DataView::initVessels()
+{
+    QSettings settings(QCoreApplication::applicationDirPath() + "/config.ini", QSettings::IniFormat);
+    // 逗号分隔的一个值 QSettings 读出来是 QStringList
+    const QStringList ids = settings.value("Vessels/Ids", "0").toStringList();
+    for (const QString &id : ids) {
+        bool ok = false;
+        const int vesselId = id.trimmed().toInt(&ok);
+        // vessel_id 列为 SMALLINT UNSIGNED
+        if (ok && vesselId >= 0 && vesselId <= 65535) {
+            m_vessels.insert(vesselId, VesselState());
+        }
+    }
+    if (m_vessels.isEmpty()) {
+        m_vessels.insert(0, VesselState());
+    }
+    m_currentVessel = m_vessels.firstKey();
+
+    for (auto it = m_vessels.constBegin(); it != m_vessels.constEnd(); ++it) {
+        ui->cbVessel->addItem(QString("船只 %1").arg(it.key()), it.key());
+    }
+    connect(ui->cbVessel, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [=](int index){
+        switchVessel(ui->cbVessel->itemData(index).toInt());
+    });
+}
+
+void DataView::switchVessel(int vesselId)
+{
+    if (vesselId == m_currentVessel || !m_vessels.contains(vesselId)) {
+        return;
+    }
+    m_currentVessel = vesselId;
+
+    // 实时曲线从头画这条船
+    m_timeCount = 0;
+    m_seriesSpeed->clear();
+    m_seriesDist->clear();
+    m_axisX_Speed->setRange(0, 20);
+    m_axisX_Dist->setRange(0, 20);
+    m_axisY_Dist->setRange(0, 100);
+
+    m_historyModel->setVessel(vesselId);
+    // 回放曲线按当前位置重新取数 (还没有回放过时等第一次定位)
+    m_pbLoadedTo = -1;
+    m_pbLoadedFrom = 0;
+    if (m_pbPendingMs > 0) {
+        updatePlaybackChart(m_pbPendingMs);
     }
 }
 
 void DataView::recordDataToDb()
 {
-    QString timeStr = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
-    bool ok = DBManager::instance().insertLog(timeStr, m_velocity, m_acceleration, m_displacement);
-    // 如果当前处于“历史数据查询”页，则在成功插入后刷新表格
-    if (ok && ui->stackeContent->currentIndex() == 3) {
-        loadHistoryData();
+    qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+
+    // 同一时刻各路录像的最近一帧；超过 2 秒没有新帧的相机视为未在录像
+    QVector<LogFrameLink> frames;
+    const QHash<int, Recorder::FrameRef> latest = m_recorder->latestFrames();
+    for (auto it = latest.constBegin(); it != latest.constEnd(); ++it) {
+        if (nowMs - it.value().timestampMs <= 2000) {
+            LogFrameLink link;
+            link.camId = it.key();
+            link.seq = it.value().seq;
+            link.frameMs = it.value().timestampMs;
+            frames.append(link);
+        }
+    }
+
+    // 录像只有一套，帧关联记在每条船的记录上
+    for (auto it = m_vessels.constBegin(); it != m_vessels.constEnd(); ++it) {
+        TelemetryWriter *writer = m_telemetryWriters.value(it.key(), nullptr);
+        if (!writer) {
+            continue;
+        }
+        TelemetryRow row;
+        row.timeMs = nowMs;
+        row.speed = it.value().velocity;
+        row.accel = it.value().acceleration;
+        row.dist = it.value().displacement;
+        row.frames = frames;
+        writer->submit(row);
     }
 }
 
 void DataView::loadHistoryData()
 {
-    // 1. 获取总数
-    m_historyTotalCount = DBManager::instance().getTotalCount();
+    m_historyModel->fetchNewer();
+    updateHistoryInfo();
+}
 
-    // 计算总页数 (向上取整)
-    m_historyTotalPages = (m_historyTotalCount + m_historyPageSize - 1) / m_historyPageSize;
-    if(m_historyTotalPages == 0) m_historyTotalPages = 1;
+void DataView::openHistoryRow(int row)
+{
+    int logId = m_historyModel->logId(row);
+    if (logId < 0) {
+        return;
+    }
+    qint64 logMs = m_historyModel->timeMs(row);
+
+    // 优先当前实时分组里的相机，其次相机号最小的一路；旧记录没有帧关联时按时间定位
+    QVector<LogFrameLink> links = DBManager::instance().getFrameLinks(logId);
+    // 全景页对应相机号 0
+    int groupFirst = m_currentVideoPageIndex > 0 ? (m_currentVideoPageIndex - 1) * 3 + 1 : 0;
+    int groupEnd = m_currentVideoPageIndex > 0 ? groupFirst + 3 : 1;
+    int camId = -1;
+    qint64 frameMs = logMs;
+    for (const LogFrameLink &link : links) {
+        bool inGroup = link.camId >= groupFirst && link.camId < groupEnd;
+        if (camId < 0 || inGroup) {
+            camId = link.camId;
+            frameMs = link.frameMs;
+            if (inGroup) {
+                break;
+            }
+        }
+    }
+    if (camId < 0) {
+        camId = groupFirst;
+    }
 
-    int offset = (m_historyCurrentPage - 1) * m_historyPageSize;
-    QSqlQuery query = DBManager::instance().getHistoryLogs(m_historyPageSize, offset);
+    if (!m_playbackView->openAt(camId, frameMs)) {
+        QMessageBox::information(this, "历史记录", QString("相机 %1 没有该时段的录像").arg(camId));
+        return;
+    }
+    emit sigRequestPage(1);
+}
 
-    // 3. 填充表格
-    ui->tableHistory->setRowCount(0); // 清空旧数据
-    // 设置列头 (只需要设置一次，也可以放在初始化里)
-    ui->tableHistory->setColumnCount(4);
-    ui->tableHistory->setHorizontalHeaderLabels(QStringList() << "时间" << "速度" << "加速度" << "位移" );
-    // 让列宽自适应
-    ui->tableHistory->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+// ==========================================
+// 回放遥测曲线
+// ==========================================
+void DataView::initPlaybackChart()
+{
+    m_seriesPbSpeed = new QLineSeries();
+    m_seriesPbSpeed->setName("速度");
+    m_seriesPbSpeedMin = new QLineSeries(this);
+    m_seriesPbSpeedMax = new QLineSeries(this);
+    m_areaPbSpeed = new QAreaSeries(m_seriesPbSpeedMax, m_seriesPbSpeedMin);
+    m_areaPbSpeed->setPen(Qt::NoPen);
+    m_areaPbSpeed->setBrush(QColor(0, 255, 255, 50));
+    m_seriesPbDist = new QLineSeries();
+    m_seriesPbDist->setName("位移");
+    m_seriesPbDist->setColor(QColor(255, 0, 255));
+    m_seriesPbCursor = new QLineSeries();
+    m_seriesPbCursor->setColor(Qt::yellow);
+
+    m_chartPlayback = new QChart();
+    m_chartPlayback->addSeries(m_areaPbSpeed);
+    m_chartPlayback->addSeries(m_seriesPbSpeed);
+    m_chartPlayback->addSeries(m_seriesPbDist);
+    m_chartPlayback->addSeries(m_seriesPbCursor);
+    m_chartPlayback->legend()->hide();
+    m_chartPlayback->setBackgroundVisible(false);
+    m_chartPlayback->setMargins(QMargins(0,0,0,0));
+
+    m_axisX_Pb = new QDateTimeAxis();
+    m_axisX_Pb->setFormat("HH:mm:ss");
+    m_axisX_Pb->setLabelsColor(Qt::white);
+    m_axisX_Pb->setGridLineColor(QColor(255, 255, 255, 30));
+    m_chartPlayback->addAxis(m_axisX_Pb, Qt::AlignBottom);
+
+    m_axisY_PbSpeed = new QValueAxis();
+    m_axisY_PbSpeed->setRange(0, 100);
+    m_axisY_PbSpeed->setTitleText("速度 (m/s)");
+    m_axisY_PbSpeed->setTitleBrush(Qt::cyan);
+    m_axisY_PbSpeed->setLabelsColor(Qt::cyan);
+    m_axisY_PbSpeed->setGridLineColor(QColor(255, 255, 255, 30));
+    m_chartPlayback->addAxis(m_axisY_PbSpeed, Qt::AlignLeft);
+
+    m_axisY_PbDist = new QValueAxis();
+    m_axisY_PbDist->setRange(0, 100);
+    m_axisY_PbDist->setTitleText("位移 (m)");
+    m_axisY_PbDist->setTitleBrush(QColor(255, 0, 255));
+    m_axisY_PbDist->setLabelsColor(QColor(255, 0, 255));
+    m_axisY_PbDist->setGridLineVisible(false);
+    m_chartPlayback->addAxis(m_axisY_PbDist, Qt::AlignRight);
+
+    m_areaPbSpeed->attachAxis(m_axisX_Pb);
+    m_areaPbSpeed->attachAxis(m_axisY_PbSpeed);
+    m_seriesPbSpeed->attachAxis(m_axisX_Pb);
+    m_seriesPbSpeed->attachAxis(m_axisY_PbSpeed);
+    m_seriesPbDist->attachAxis(m_axisX_Pb);
+    m_seriesPbDist->attachAxis(m_axisY_PbDist);
+    m_seriesPbCursor->attachAxis(m_axisX_Pb);
+    m_seriesPbCursor->attachAxis(m_axisY_PbSpeed);
+
+    m_chartViewPb = new QChartView(m_chartPlayback);
+    m_chartViewPb->setRenderHint(QPainter::Antialiasing);
+    m_chartViewPb->setStyleSheet("background: transparent");
+    m_chartViewPb->setFixedHeight(160);
+    m_chartViewPb->setToolTip("滚轮缩放时间范围");
+    m_chartViewPb->viewport()->installEventFilter(this);
+    ui->pagePlayback->layout()->addWidget(m_chartViewPb);
+
+    // 回放位置每 10 ms 变一次，曲线最多 10 次/秒
+    m_pbChartTimer = new QTimer(this);
+    m_pbChartTimer->setSingleShot(true);
+    m_pbChartTimer->setInterval(100);
+    connect(m_pbChartTimer, &QTimer::timeout, this, [=](){
+        updatePlaybackChart(m_pbPendingMs);
+    });
+    connect(m_playbackView, &PlaybackView::positionChanged, this, [=](qint64 tsMs){
+        m_pbPendingMs = tsMs;
+        if (!m_pbChartTimer->isActive()) {
+            m_pbChartTimer->start();
+        }
+    });
+}
 
-    int row = 0;
-    while(query.next()) {
-        ui->tableHistory->insertRow(row);
-
-        // 逐列填入
-        QDateTime dt = query.value(0).toDateTime();
-        QString dtStr = dt.isValid() ? dt.toLocalTime().toString("yyyy-MM-dd HH:mm:ss")
-                                     : query.value(0).toString();
-        ui->tableHistory->setItem(row, 0, new QTableWidgetItem(dtStr)); // 时间
-        ui->tableHistory->setItem(row, 1, new QTableWidgetItem(QString::number(query.value(1).toDouble(), 'f', 1))); // 速度
-        ui->tableHistory->setItem(row, 2, new QTableWidgetItem(QString::number(query.value(2).toDouble(), 'f', 1))); // 加速度
-        ui->tableHistory->setItem(row, 3, new QTableWidgetItem(QString::number(query.value(3).toDouble(), 'f', 1))); // 位移
-        // ui->tableHistory->setItem(row, 4, new QTableWidgetItem(QString::number(queryData.value(4).toDouble(), 'f', 1))); // 位置
-
-        // 设置居中
-        for(int c=0; c<4; c++) {
-            ui->tableHistory->item(row, c)->setTextAlignment(Qt::AlignCenter);
-            ui->tableHistory->item(row, c)->setForeground(Qt::white); // 确保文字白色
+void DataView::updatePlaybackChart(qint64 tsMs)
+{
+    const qint64 half = m_pbSpanMs / 2;
+    // 已取出的范围两侧各留半个窗口余量，位置接近边缘或缩放后再查一次
+    if (m_pbLoadedTo < m_pbLoadedFrom || m_pbLoadedSpanMs != m_pbSpanMs
+        || tsMs - half < m_pbLoadedFrom || tsMs + half > m_pbLoadedTo) {
+        m_pbLoadedFrom = tsMs - m_pbSpanMs;
+        m_pbLoadedTo = tsMs + m_pbSpanMs;
+        m_pbLoadedSpanMs = m_pbSpanMs;
+        // 取出两个窗口宽度：每个像素约一个点，范围大时由数据库挑汇总级别
+        int points = 2 * qMax(100, int(m_chartPlayback->plotArea().width()));
+        qint64 bucketMs = 0;
+        QVector<TelemetryBucket> buckets =
+            DBManager::instance().getTelemetrySeries(m_currentVessel, m_pbLoadedFrom, m_pbLoadedTo, points, &bucketMs);
+
+        QList<QPointF> speedPoints;
+        QList<QPointF> speedMinPoints;
+        QList<QPointF> speedMaxPoints;
+        QList<QPointF> distPoints;
+        double minDist = 0;
+        double maxDist = 0;
+        for (int i = 0; i < buckets.size(); i++) {
+            const TelemetryBucket &bucket = buckets[i];
+            // 汇总桶画在桶中点
+            qreal x = bucket.timeMs + bucketMs / 2;
+            speedPoints.append(QPointF(x, bucket.speedAvg));
+            speedMinPoints.append(QPointF(x, bucket.speedMin));
+            speedMaxPoints.append(QPointF(x, bucket.speedMax));
+            distPoints.append(QPointF(x, bucket.distAvg));
+            minDist = i == 0 ? bucket.distMin : qMin(minDist, bucket.distMin);
+            maxDist = i == 0 ? bucket.distMax : qMax(maxDist, bucket.distMax);
         }
-        row++;
+        m_seriesPbSpeed->replace(speedPoints);
+        m_seriesPbSpeedMin->replace(speedMinPoints);
+        m_seriesPbSpeedMax->replace(speedMaxPoints);
+        m_areaPbSpeed->setVisible(bucketMs > 0);
+        m_seriesPbDist->replace(distPoints);
+        m_axisY_PbDist->setRange(qFloor(minDist), qMax(qCeil(maxDist), qFloor(minDist) + 10));
+    }
+
+    m_axisX_Pb->setFormat(m_pbSpanMs <= 3600000 ? "HH:mm:ss"
+                          : m_pbSpanMs <= 3 * 86400000ll ? "MM-dd HH:mm" : "yyyy-MM-dd");
+    m_axisX_Pb->setRange(QDateTime::fromMSecsSinceEpoch(tsMs - half), QDateTime::fromMSecsSinceEpoch(tsMs + half));
+    m_seriesPbCursor->replace(QList<QPointF>() << QPointF(tsMs, m_axisY_PbSpeed->min())
+                                                << QPointF(tsMs, m_axisY_PbSpeed->max()));
+}
+
+bool DataView::eventFilter(QObject *watched, QEvent *event)
+{
+    if (m_chartViewPb && watched == m_chartViewPb->viewport() && event->type() == QEvent::Wheel) {
+        // 每格滚轮放大/缩小一倍，以当前回放位置为中心
+        QWheelEvent *wheel = static_cast<QWheelEvent *>(event);
+        qint64 span = wheel->angleDelta().y() > 0 ? m_pbSpanMs / 2 : m_pbSpanMs * 2;
+        m_pbSpanMs = qBound(PLAYBACK_CHART_SPAN_MS, span, PLAYBACK_CHART_MAX_SPAN_MS);
+        updatePlaybackChart(m_pbPendingMs);
+        return true;
     }
+    return QWidget::eventFilter(watched, event);
+}
 
-    // 4. 更新底部页码标签
-    updateHistoryPageInfo();
+void DataView::updateHistoryInfo()
+{
+    ui->lblPageInfo->setText(QString("已加载 %1 / 共 %2 条")
+                                 .arg(m_historyModel->rowCount())
+                                 .arg(qMax<qint64>(m_historyModel->rowCount(), m_historyModel->totalCount())));
 }
 
-void DataView::updateHistoryPageInfo()
+void DataView::on_btnExportHistory_clicked()
 {
-    // 更新 Label 显示，例如 "2 / 15"
-    ui->lblPageInfo->setText(QString("%1 / %2").arg(m_historyCurrentPage).arg(m_historyTotalPages));
+    if (m_telemetryExporter->isRunning()) {
+        return;
+    }
+    // 默认导出最近 24 小时
+    const QDateTime now = QDateTime::currentDateTime();
+    QDialog dialog(this);
+    dialog.setWindowTitle("导出遥测");
+    QDateTimeEdit *editStart = new QDateTimeEdit(now.addDays(-1), &dialog);
+    QDateTimeEdit *editEnd = new QDateTimeEdit(now, &dialog);
+    editStart->setDisplayFormat("yyyy-MM-dd HH:mm:ss");
+    editEnd->setDisplayFormat("yyyy-MM-dd HH:mm:ss");
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    QFormLayout *form = new QFormLayout(&dialog);
+    form->addRow("开始时间", editStart);
+    form->addRow("结束时间", editEnd);
+    form->addRow(buttons);
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
 
-    // 控制按钮状态 (第一页不能点上一页，最后一页不能点下一页)
-    ui->btnHisPrev->setEnabled(m_historyCurrentPage > 1);
-    ui->btnHisNext->setEnabled(m_historyCurrentPage < m_historyTotalPages);
+    TelemetryExporter::Job job;
+    job.vesselId = m_currentVessel;
+    job.fromMs = editStart->dateTime().toMSecsSinceEpoch();
+    job.toMs = editEnd->dateTime().toMSecsSinceEpoch();
+    if (job.toMs <= job.fromMs) {
+        QMessageBox::warning(this, "导出遥测", "结束时间必须晚于开始时间");
+        return;
+    }
+    job.outPath = QString("%1/exports/telemetry_vessel%2_%3-%4.csv")
+                      .arg(QCoreApplication::applicationDirPath(), QString::number(m_currentVessel),
+                           editStart->dateTime().toString("yyyyMMdd_HHmmss"),
+                           editEnd->dateTime().toString("yyyyMMdd_HHmmss"));
+
+    // 非模态进度框：导出期间实时数据照常刷新入库
+    QProgressDialog *progress = new QProgressDialog("正在导出遥测...", "取消", 0, 100, this);
+    progress->setWindowModality(Qt::NonModal);
+    progress->setAttribute(Qt::WA_DeleteOnClose);
+    progress->setMinimumDuration(0);
+    progress->setAutoClose(false);
+    progress->setAutoReset(false);
+    connect(progress, &QProgressDialog::canceled, m_telemetryExporter, &TelemetryExporter::cancel);
+    connect(m_telemetryExporter, &TelemetryExporter::progress, progress, &QProgressDialog::setValue);
+    connect(m_telemetryExporter, &TelemetryExporter::finished, progress,
+            [=](bool ok, qint64 rows, const QString &path, const QString &error){
+        progress->close();
+        if (ok) {
+            QMessageBox::information(this, "导出完成", QString("已导出 %1 条记录到\n%2").arg(rows).arg(path));
+        } else {
+            QMessageBox::warning(this, "导出遥测", "导出失败：" + error);
+        }
+    });
+    ui->btnExportHistory->setEnabled(false);
+    m_telemetryExporter->start(job);
+    progress->show();
 }
 
 // 接口调用结果回调
@@ -483,6 +1142,53 @@ void DataView::onSnapshotReceived(const QPixmap &pixmap)
     // 例如：ui->labelPreview->setPixmap(pixmap);
 }
 
+// 本地抓拍落盘完成 (尺寸来自 JPEG 头，未解码)
+void DataView::onSnapshotSaved(int camId, const QString &path, const QSize &size, qint64 bytes)
+{
+    QString msg = QString("相机 %1 抓拍成功！\n图片尺寸: %2 x %3\n文件大小: %4 KB\n保存路径: %5")
+                      .arg(camId).arg(size.width()).arg(size.height())
+                      .arg(bytes / 1024.0, 0, 'f', 1).arg(QDir::toNativeSeparators(path));
+    if (m_registry->isCapturingAll()) {
+        // 批量抓拍只记日志，最后统一提示
+        ui->txtApiLog->append(msg.replace("\n", " "));
+        return;
+    }
+    if (ui->chkSnapshotPreview->isChecked()) {
+        // 预览由写线程异步缩放解码，到达后再弹窗
+        ui->txtApiLog->append(msg.replace("\n", " "));
+        return;
+    }
+
+    QMessageBox box(QMessageBox::Information, "抓拍完成", msg, QMessageBox::Ok, this);
+    QPushButton *btnPreview = box.addButton("预览", QMessageBox::ActionRole);
+    box.exec();
+    if (box.clickedButton() == btnPreview) {
+        m_registry->requestPreview(camId, path, SNAPSHOT_PREVIEW_SIDE);
+    }
+}
+
+void DataView::onSnapshotFailed(int camId, const QString &errorMsg)
+{
+    QString msg = QString("相机 %1 抓拍失败: %2").arg(camId).arg(errorMsg);
+    ui->txtApiLog->append(msg);
+    if (!m_registry->isCapturingAll()) {
+        QMessageBox::warning(this, "抓拍失败", msg);
+    }
+}
+
+void DataView::onSnapshotPreviewReady(int camId, const QImage &preview)
+{
+    if (preview.isNull()) {
+        ui->txtApiLog->append(QString("相机 %1 抓拍预览解码失败").arg(camId));
+        return;
+    }
+    QLabel *label = new QLabel;
+    label->setAttribute(Qt::WA_DeleteOnClose);
+    label->setWindowTitle(QString("相机 %1 抓拍预览").arg(camId));
+    label->setPixmap(QPixmap::fromImage(preview));
+    label->show();
+}
+
 /********************************接口调用***********************************************/
 // ===============================================
 // 图像采集类设置
@@ -494,7 +1200,9 @@ void DataView::on_btnSetFps_clicked()
     bool isGlobal = ui->chkGlobalScope->isChecked();
     int camId = ui->sbTargetCamId->value();
     double fps = ui->dsbFps->value();
-    m_api->setFrameRate(isGlobal, camId, fps);
+    m_registry->dispatch(isGlobal, camId, [=](CameraClient *api, bool global, int localId){
+        api->setFrameRate(global, localId, fps);
+    });
 }
 
 // 2. 设置曝光
@@ -503,7 +1211,9 @@ void DataView::on_btnSetExposure_clicked()
     bool isGlobal = ui->chkGlobalScope->isChecked();
     int camId = ui->sbTargetCamId->value();
     float exposure = ui->dsbExposure->value();
-    m_api->setExposure(isGlobal, camId, exposure);
+    m_registry->dispatch(isGlobal, camId, [=](CameraClient *api, bool global, int localId){
+        api->setExposure(global, localId, exposure);
+    });
 }
 
 // 3. 设置增益
@@ -512,7 +1222,9 @@ void DataView::on_btnSetGain_clicked()
     bool isGlobal = ui->chkGlobalScope->isChecked();
     int camId = ui->sbTargetCamId->value();
     float gain = ui->dsbGain->value();
-    m_api->setGain(isGlobal, camId, gain);
+    m_registry->dispatch(isGlobal, camId, [=](CameraClient *api, bool global, int localId){
+        api->setGain(global, localId, gain);
+    });
     qDebug() << "按钮被点击了！";
 }
 
@@ -522,7 +1234,9 @@ void DataView::on_btnSetFormat_clicked()
     bool isGlobal = ui->chkGlobalScope->isChecked();
     int camId = ui->sbTargetCamId->value();
     QString format = ui->comboPixelFormat->currentText();
-    m_api->setPixelFormat(isGlobal, camId, format);
+    m_registry->dispatch(isGlobal, camId, [=](CameraClient *api, bool global, int localId){
+        api->setPixelFormat(global, localId, format);
+    });
 }
 
 // 5. 设置缩放
@@ -531,7 +1245,9 @@ void DataView::on_btnSetZoom_clicked()
     bool isGlobal = ui->chkGlobalScope->isChecked();
     int camId = ui->sbTargetCamId->value();
     float factor = ui->dsbZoom->value();
-    m_api->setZoom(isGlobal, camId, factor);
+    m_registry->dispatch(isGlobal, camId, [=](CameraClient *api, bool global, int localId){
+        api->setZoom(global, localId, factor);
+    });
 }
 
 // ===============================================
@@ -544,7 +1260,9 @@ void DataView::on_btnSetTrigMode_clicked()
     bool isGlobal = ui->chkGlobalScope->isChecked();
     int camId = ui->sbTargetCamId->value();
     QString mode = ui->comboTriggerMode->currentText(); // "On" / "Off"
-    m_api->setTriggerMode(isGlobal, camId, mode);
+    m_registry->dispatch(isGlobal, camId, [=](CameraClient *api, bool global, int localId){
+        api->setTriggerMode(global, localId, mode);
+    });
 }
 
 // 7. 设置触发源
@@ -553,7 +1271,9 @@ void DataView::on_btnSetTrigSource_clicked()
     bool isGlobal = ui->chkGlobalScope->isChecked();
     int camId = ui->sbTargetCamId->value();
     QString source = ui->comboTriggerSource->currentText();
-    m_api->setTriggerSource(isGlobal, camId, source);
+    m_registry->dispatch(isGlobal, camId, [=](CameraClient *api, bool global, int localId){
+        api->setTriggerSource(global, localId, source);
+    });
 }
 
 // 8. 设置触发沿
@@ -562,7 +1282,9 @@ void DataView::on_btnSetTrigActive_clicked()
     bool isGlobal = ui->chkGlobalScope->isChecked();
     int camId = ui->sbTargetCamId->value();
     QString edge = ui->comboTriggerActive->currentText();
-    m_api->setTriggerActivation(isGlobal, camId, edge);
+    m_registry->dispatch(isGlobal, camId, [=](CameraClient *api, bool global, int localId){
+        api->setTriggerActivation(global, localId, edge);
+    });
 }
 
 // ===============================================
@@ -581,7 +1303,10 @@ void DataView::on_btnSetCrosshair_clicked()
     int y = 1024;
     int size = 100;
 
-    m_api->setCrosshair(isGlobal, camId, enabled, x, y, size, m_crosshairColor, 2);
+    QColor color = m_crosshairColor;
+    m_registry->dispatch(isGlobal, camId, [=](CameraClient *api, bool global, int localId){
+        api->setCrosshair(global, localId, enabled, x, y, size, color, 2);
+    });
 }
 
 // 10. 抓拍 (获取单帧图片)
@@ -590,21 +1315,43 @@ void DataView::on_btnSnapshot_clicked()
     QString savePath = ui->lineEdit->text().trimmed(); // 获取路径并去空格
 
     if (savePath.isEmpty()) {
-        // --- 模式 A：仅预览 (内存获取) ---
-        m_api->getSnapshot();
-        // 结果会触发 onSnapshotReceived -> 弹窗显示图片
+        // --- 模式 A：本地保存 (边收边写，只解析 JPEG 头取尺寸) ---
+        int camId = ui->sbTargetCamId->value();
+        QString fileName = QString("cam%1_%2.jpg").arg(camId, 2, 10, QChar('0'))
+                               .arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss_zzz"));
+        int previewSide = ui->chkSnapshotPreview->isChecked() ? SNAPSHOT_PREVIEW_SIDE : 0;
+        m_registry->captureSnapshot(camId, QDir(snapshotDir()).filePath(fileName), previewSide);
+        // 结果会触发 onSnapshotSaved / onSnapshotPreviewReady
     } else {
         // --- 模式 B：服务器保存 ---
         // 注意：这个接口不支持 global，必须指定相机ID
         int camId = ui->sbTargetCamId->value();
 
         // 调用保存接口
-        m_api->saveSnapshotToServer(camId, savePath);
+        m_registry->dispatch(false, camId, [=](CameraClient *api, bool, int localId){
+            api->saveSnapshotToServer(localId, savePath);
+        });
 
         // 结果会触发 onApiResult -> 弹窗提示 "操作成功"
     }
 }
 
+// 11. 13 路同时抓拍到本地
+void DataView::on_btnSnapshotAll_clicked()
+{
+    if (m_registry->isCapturingAll()) {
+        return;
+    }
+    ui->btnSnapshotAll->setEnabled(false);
+    // 批量抓拍不生成预览，需要时逐张打开文件查看
+    m_registry->captureAll(snapshotDir());
+}
+
+QString DataView::snapshotDir() const
+{
+    return QCoreApplication::applicationDirPath() + "/snapshots";
+}
+
 void DataView::on_btnPickColor_clicked()
 {
     // 弹出颜色选择对话框，默认选中当前颜色
@@ -621,13 +1368,13 @@ void DataView::on_btnPickColor_clicked()
     }
 }
 
-void DataView::onServiceInfoReceived(const ServiceInfo &info)
+void DataView::onServiceInfoReceived(const QString &host, const ServiceInfo &info)
 {
     // Update FPS spinbox
     ui->dsbFps->setValue(info.config.target_fps);
 
     // Format log message
-    QString msg = QString("=== 服务信息 ===\n"
+    QString msg = QString("=== 服务信息 [%12] ===\n"
                           "Service: %1\n"
                           "Routes: %2\n"
                           "Clients: %3\n"
@@ -645,14 +1392,19 @@ void DataView::onServiceInfoReceived(const ServiceInfo &info)
             .arg(info.pipeline.last_error.isEmpty() ? "None" : info.pipeline.last_error)
             .arg(info.config.camera_count)
             .arg(info.config.target_fps)
-            .arg(info.config.jpeg_quality);
+            .arg(info.config.jpeg_quality)
+            .arg(host);
 
     ui->txtApiLog->append(msg);
 }
 
-void DataView::onHealthInfoReceived(const HealthInfo &info)
+void DataView::onHealthInfoReceived(const QString &host, const HealthInfo &info)
 {
-    QString msg = QString("=== 健康状态 ===\n"
+    // 后台轮询的结果只进图表，不刷屏
+    if (!m_healthLogPending) {
+        return;
+    }
+    QString msg = QString("=== 健康状态 [%7] ===\n"
                           "Clients: %1\n"
                           "FPS: %2\n"
                           "Seq: %3 (TS: %4)\n"
@@ -663,11 +1415,17 @@ void DataView::onHealthInfoReceived(const HealthInfo &info)
             .arg(info.encoded_seq)
             .arg(info.encoded_ts_ns)
             .arg(info.last_error.isEmpty() ? "None" : info.last_error)
-            .arg(info.pipeline.running ? "OK" : "Stopped");
+            .arg(info.pipeline.running ? "OK" : "Stopped")
+            .arg(host);
 
      ui->txtApiLog->append(msg);
 }
 
+void DataView::onHostQueryFailed(const QString &host, const QString &apiName, const QString &errorMsg)
+{
+    ui->txtApiLog->append(QString("查询失败 [%1] API: %2 错误信息: %3").arg(host, apiName, errorMsg));
+}
+
 
 
 
@@ -3,6 +3,7 @@
 
 #include <QWidget>
 #include <QTimer>
+#include <QThread>
 #include <QtCharts>
 #include <QSqlDatabase>
 #include <QSqlQuery>
@@ -10,6 +11,16 @@
 #include <QMessageBox>
 #include <QColorDialog>
 #include "cameraclient.h"
+#include "cameraregistry.h"
+#include "healthmonitor.h"
+#include "frameanalyzer.h"
+#include "autoexposure.h"
+#include "streamhealth.h"
+#include "Record/recorder.h"
+#include "Database/telemetrywriter.h"
+#include "Database/telemetryexporter.h"
+#include "historymodel.h"
+#include "playbackview.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class DataView; }
@@ -26,26 +37,94 @@ class DataView : public QWidget
 public:
     explicit DataView(QWidget *parent = nullptr);
     ~DataView();
+    Recorder *recorder() const { return m_recorder; }
 public slots:
     void switchTopage(int index);
+    // 实时帧旁路 (来自 VideoPanorama)
+    void onLiveFrame(int camId, const QByteArray &data);
 signals:
     // mode: 0=全景, 1=相机分组1(1-3), 2=相机分组2(4-6) 3=相机分组3(7-9) 4=相机分组4(10-12) 5=相机分组5(13)
     void sigSwitchVideoMode(int mode);
+    // 请求切换到某一页 (经顶部导航栏，保持按钮状态一致)
+    void sigRequestPage(int index);
+
+protected:
+    // 回放曲线上滚轮缩放时间范围
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 private:
     Ui::DataView *ui;
-    CameraClient *m_api;
+    CameraRegistry *m_registry; // 相机 -> 服务端点映射 (每主机一个连接池)
+    HealthMonitor *m_healthMonitor; // 后台健康轮询
+    bool m_healthLogPending = false; // 手动查询的健康结果才写入日志框
+
+    // --- 实时帧分析 (独立线程) 与自动曝光 ---
+    QThread *m_analysisThread;
+    FrameAnalyzer *m_analyzer;
+    QMap<int, AutoExposureController*> m_aeControllers; // camId -> 控制器
+    void initAutoExposure();
+    void updateAeStateLabel();
+
+    // --- 画面健康 (冻结/黑屏/失焦/过曝) ---
+    StreamHealthTracker *m_streamHealth;
+    bool m_monitorAllCameras = false;   // Cameras/KeepAllStreams：13 路全部监测
+    void initStreamHealth();
+    void updateHealthTracking(int pageIndex); // 只监测当前显示的相机时随翻页切换
+
+    // --- 本地连续录像 (写线程独立，GUI 线程只入队) ---
+    Recorder *m_recorder;
+    PlaybackView *m_playbackView;       // "视频回放" 页
+    QMap<int, double> m_motionMinFraction;  // camId -> 触发录像所需的变化面积比例
+    void initMotionTrigger();           // Recording/Mode=motion 时启用
+
+    // --- 回放遥测曲线：回放位置驱动，数据取自数据库 (范围大时取汇总表) ---
+    static const qint64 PLAYBACK_CHART_SPAN_MS = 60000;    // 默认显示窗口宽度
+    static const qint64 PLAYBACK_CHART_MAX_SPAN_MS = 62ll * 86400000;   // 滚轮最多缩到约两个月
+    qint64 m_pbSpanMs = PLAYBACK_CHART_SPAN_MS;
+    QChart *m_chartPlayback;
+    QChartView *m_chartViewPb = nullptr;
+    QLineSeries *m_seriesPbSpeed;       // 平均值
+    QLineSeries *m_seriesPbSpeedMin;    // 桶内最小/最大值，画成速度曲线的包络带
+    QLineSeries *m_seriesPbSpeedMax;
+    QAreaSeries *m_areaPbSpeed;
+    QLineSeries *m_seriesPbDist;
+    QLineSeries *m_seriesPbCursor;      // 当前位置竖线
+    QDateTimeAxis *m_axisX_Pb;
+    QValueAxis *m_axisY_PbSpeed;
+    QValueAxis *m_axisY_PbDist;
+    qint64 m_pbLoadedFrom = 0;          // 已从数据库取出的时间范围
+    qint64 m_pbLoadedTo = -1;
+    qint64 m_pbLoadedSpanMs = 0;        // 取数据时的窗口宽度，缩放后需要重取
+    qint64 m_pbPendingMs = 0;
+    QTimer *m_pbChartTimer;             // 合并高频位置更新，只画最新的一次
+    void initPlaybackChart();
+    void updatePlaybackChart(qint64 tsMs);
+    void openHistoryRow(int row);       // 历史记录 -> 对应录像帧
+
+    // --- 本地抓拍 ---
+    QString snapshotDir() const;        // 程序目录/snapshots
+    static const int SNAPSHOT_PREVIEW_SIDE = 800;
     int m_currentVideoPageIndex = 0;
     // --- 模拟数据变量 ---
     double m_timeCount;     // 累计时间 (X轴)
-    double m_velocity;      // 速度
-    double m_acceleration;  // 加速度
-    double m_displacement;  // 位移
+    // 每条船一组 (config.ini [Vessels] Ids=0，逗号分隔的船舶编号)
+    struct VesselState {
+        double velocity = 0;        // 速度
+        double acceleration = 0;    // 加速度
+        double displacement = 0;    // 位移
+    };
+    QMap<int, VesselState> m_vessels;
+    int m_currentVessel = 0;        // 表格、曲线和历史记录显示的船
+    void initVessels();
+    void switchVessel(int vesselId);
 
     // --- 核心组件 ---
     QTimer *m_simTimer;     // 模拟定时器
     QTimer *m_saveTimer;    // 保存到数据库的定时器
     int m_saveIntervalSec;  // 保存间隔（秒）
+    QMap<int, TelemetryWriter*> m_telemetryWriters; // 船舶 -> 写入器，各自在独立线程批量入库
+    static const int POOL_RESERVED_CONNECTIONS = 3;  // 写线程之外：界面、历史预取、导出
+    bool m_dbConnected = false;                     // 写线程报告的最近连接状态
 
     // --- 图表相关成员 ---
     // 左侧：速度曲线
@@ -60,24 +139,30 @@ private:
     QValueAxis *m_axisX_Dist;
     QValueAxis *m_axisY_Dist;
 
+    // 设置页：各服务编码吞吐曲线
+    QChart *m_chartHealth;
+    QValueAxis *m_axisX_Health;
+    QValueAxis *m_axisY_Health;
+    QMap<QString, QLineSeries*> m_seriesHealth; // hostKey -> 曲线
+
     // --- 初始化函数 ---
     void initChartStyles(); // 初始化图表样式
+    void initHealthChart(); // 初始化健康遥测图表
+    void updateHealthChart(const QString &host);
     void initTableStyles(); // 初始化表格样式
 
     // --- 数据库相关变量 ---
     QSqlDatabase m_db;          // 数据库连接对象
 
-    // --- 历史记录分页变量 ---
-    int m_historyCurrentPage;   // 当前第几页 (从1开始)
-    int m_historyPageSize;      // 每页显示多少条 (例如 15条)
-    int m_historyTotalPages;    // 总页数
-    int m_historyTotalCount;    // 总数据量
+    // --- 历史记录 (滚动按需加载，最新在上) ---
+    HistoryModel *m_historyModel = nullptr;
+    TelemetryExporter *m_telemetryExporter = nullptr;  // 按时间范围整段导出 (后台线程)
 
     // --- 辅助函数声明 ---
     void initDatabase();        // 初始化数据库
     void recordDataToDb();      // 存数据
-    void loadHistoryData();     // 读数据(刷新表格)
-    void updateHistoryPageInfo(); // 更新页码显示
+    void loadHistoryData();     // 读数据(把新记录加到表格顶部)
+    void updateHistoryInfo();   // 更新已加载/总条数显示
 
     QColor m_crosshairColor = Qt::red; // 默认红色
 private slots:
@@ -97,12 +182,18 @@ private slots:
     void on_btnSetCrosshair_clicked();
     void on_btnPickColor_clicked();
     void on_btnSnapshot_clicked();
+    void on_btnSnapshotAll_clicked();
+    void on_btnExportHistory_clicked();
 
     // --- 接口回调槽函数 ---
     void onApiResult(bool success, const QString &apiName, const QJsonObject &data, const QString &errorMsg);
     void onSnapshotReceived(const QPixmap &pixmap);
-    void onServiceInfoReceived(const ServiceInfo &info);
-    void onHealthInfoReceived(const HealthInfo &info);
+    void onSnapshotSaved(int camId, const QString &path, const QSize &size, qint64 bytes);
+    void onSnapshotFailed(int camId, const QString &errorMsg);
+    void onSnapshotPreviewReady(int camId, const QImage &preview);
+    void onServiceInfoReceived(const QString &host, const ServiceInfo &info);
+    void onHealthInfoReceived(const QString &host, const HealthInfo &info);
+    void onHostQueryFailed(const QString &host, const QString &apiName, const QString &errorMsg);
 };
 
 #endif // DATAVIEW_H
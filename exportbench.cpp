@@ -0,0 +1,146 @@
+#include "exportbench.h"
+#include "tsdbbench.h"
+#include "Database/dbmanager.h"
+#include "Database/telemetryexporter.h"
+#include "Database/tsdbstore.h"
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <climits>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+namespace ExportBench {
+
+namespace {
+
+const int SEED_BATCH_ROWS = 4096;
+
+// 进程峰值常驻内存 (KB)，不支持的平台返回 -1
+qint64 peakRssKb()
+{
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#if defined(Q_OS_MACOS)
+    return usage.ru_maxrss / 1024;      // macOS 上单位是字节
+#else
+    return usage.ru_maxrss;
+#endif
+#elif defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return -1;
+    }
+    return qint64(counters.PeakWorkingSetSize / 1024);
+#else
+    return -1;
+#endif
+}
+
+QString option(const QStringList &args, const QString &name, const QString &defaultValue = QString())
+{
+    int i = args.indexOf(name);
+    return (i >= 0 && i + 1 < args.size()) ? args[i + 1] : defaultValue;
+}
+
+} // namespace
+
+bool isRequested(const QStringList &args)
+{
+    return args.contains("--bench-export");
+}
+
+int run(const QStringList &args)
+{
+    QTextStream out(stdout);
+    const bool mysql = args.contains("--mysql");
+    QTemporaryDir tempDir;
+    QString outPath = option(args, "--out");
+    if (outPath.isEmpty()) {
+        outPath = tempDir.filePath("export.csv");
+    }
+
+    TelemetryExporter::Job job;
+    job.fromMs = option(args, "--from", "0").toLongLong();
+    job.toMs = option(args, "--to", QString::number(LLONG_MAX)).toLongLong();
+    job.outPath = outPath;
+    job.vesselId = option(args, "--vessel", "0").toInt();
+
+    TsdbStore *store = nullptr;
+    if (mysql) {
+        if (DBManager::usesEmbeddedBackend() || !DBManager::instance().connectToDb()) {
+            out << "mysql: not available (check config.ini [Database])" << Qt::endl;
+            return 2;
+        }
+        out << "source mysql ship_logs" << Qt::endl;
+    } else {
+        // 分批生成分批写入，生成数据本身不占多少内存
+        const qint64 rows = qMax(1000ll, option(args, "--rows", "5000000").toLongLong());
+        const qint64 intervalMs = qMax(10, option(args, "--interval-ms", "1000").toInt());
+        store = new TsdbStore(tempDir.filePath("tsdb"));
+        QString error;
+        if (!store->open(&error)) {
+            out << "embedded: " << error << Qt::endl;
+            delete store;
+            return 2;
+        }
+        TsdbBench::SampleGenerator generator(intervalMs);
+        QVector<TelemetrySample> batch;
+        batch.reserve(SEED_BATCH_ROWS);
+        QElapsedTimer seedTimer;
+        seedTimer.start();
+        for (qint64 done = 0; done < rows; done += batch.size()) {
+            batch.clear();
+            for (qint64 i = 0; i < qMin<qint64>(SEED_BATCH_ROWS, rows - done); i++) {
+                batch.append(generator.next());
+            }
+            store->append(batch);
+        }
+        // 重新打开：导出走 mmap 的已封存块
+        store->close();
+        store->open(&error);
+        job.store = store;
+        out << QString("source embedded  rows %1  seeded in %2 s  store %3 MB")
+                   .arg(rows).arg(seedTimer.elapsed() / 1000.0, 0, 'f', 1)
+                   .arg(store->stats().fileBytes / 1048576.0, 0, 'f', 1) << Qt::endl;
+    }
+
+    const qint64 rssBeforeKb = peakRssKb();
+    std::atomic<bool> cancel{false};
+    QElapsedTimer timer;
+    timer.start();
+    const TelemetryExporter::Result result = TelemetryExporter::exportRange(job, cancel);
+    const qint64 elapsedUs = qMax<qint64>(1, timer.nsecsElapsed() / 1000);
+    const qint64 rssAfterKb = peakRssKb();
+    delete store;
+    if (mysql) {
+        DBManager::instance().closeDb();
+    }
+
+    if (!result.ok) {
+        out << "export failed: " << result.error << Qt::endl;
+        return 1;
+    }
+    out << QString("rows %1  bytes %2 MB  elapsed %3 ms")
+               .arg(result.rows).arg(result.bytes / 1048576.0, 0, 'f', 1).arg(elapsedUs / 1000) << Qt::endl;
+    out << QString("throughput %1 rows/s  %2 MB/s")
+               .arg(result.rows * 1e6 / elapsedUs, 0, 'f', 0)
+               .arg(result.bytes / 1.048576 / elapsedUs, 0, 'f', 1) << Qt::endl;
+    if (rssBeforeKb >= 0) {
+        out << QString("peak rss before %1 MB  after %2 MB  (+%3 MB during export)")
+                   .arg(rssBeforeKb / 1024.0, 0, 'f', 1).arg(rssAfterKb / 1024.0, 0, 'f', 1)
+                   .arg((rssAfterKb - rssBeforeKb) / 1024.0, 0, 'f', 1) << Qt::endl;
+    }
+    out << "output " << outPath << (option(args, "--out").isEmpty() ? " (removed)" : "") << Qt::endl;
+    return 0;
+}
+
+} // namespace ExportBench
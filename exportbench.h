@@ -0,0 +1,27 @@
+#ifndef EXPORTBENCH_H
+#define EXPORTBENCH_H
+
+#include <QStringList>
+
+/**
+ * @brief 遥测导出基准测试 (命令行，不启动主界面)
+ * 生成合成遥测写入临时的嵌入式存储，用 TelemetryExporter 整段导出为 CSV，
+ * 报告导出速率 (rows/s、MB/s) 和导出前后的进程峰值内存，验证内存占用不随条数增长
+ * (读过的存储映射页也计入常驻内存，增量应不超过存储文件大小加上一块写缓冲)。
+ *
+ *   --bench-export        启用
+ *   --rows <n>            合成记录条数 (默认 5000000)
+ *   --interval-ms <n>     记录间隔 (默认 1000)
+ *   --out <file>          导出文件 (默认临时目录，结束后删除)
+ *   --mysql               改为导出 MySQL 中现有的 ship_logs (按 config.ini 连接，不生成数据)
+ *   --vessel <id>         配合 --mysql，导出的船舶 (默认 0)
+ *   --from <ms> --to <ms> 导出的时间范围 (默认全部)
+ */
+namespace ExportBench {
+
+bool isRequested(const QStringList &args);
+int run(const QStringList &args);
+
+} // namespace ExportBench
+
+#endif // EXPORTBENCH_H
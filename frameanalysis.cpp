@@ -0,0 +1,255 @@
+#include "frameanalysis.h"
+#include <QBuffer>
+#include <QImageReader>
+#include <cstring>
+#include <QVarLengthArray>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRAMEANALYSIS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace FrameAnalysis {
+
+static const int DARK_LEVEL = 16;
+static const int BRIGHT_LEVEL = 240;
+
+QImage decodeThumbnail(const QByteArray &jpeg, int scaleDenom, QSize *fullSize)
+{
+    QBuffer buffer;
+    buffer.setData(jpeg);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer, "JPEG");
+    reader.setAutoTransform(false);
+    QSize size = reader.size();
+    if (!size.isValid()) {
+        return QImage();
+    }
+    if (fullSize) {
+        *fullSize = size;
+    }
+    // 向上取整，与 libjpeg 的 scale_denom 输出尺寸一致，避免解码后再做一次缩放
+    if (scaleDenom > 1) {
+        reader.setScaledSize(QSize((size.width() + scaleDenom - 1) / scaleDenom,
+                                   (size.height() + scaleDenom - 1) / scaleDenom));
+    }
+    QImage image = reader.read();
+    if (image.isNull()) {
+        return image;
+    }
+    if (image.format() != QImage::Format_Grayscale8) {
+        image = image.convertToFormat(QImage::Format_Grayscale8);
+    }
+    return image;
+}
+
+void computeLumaStats(const uchar *bits, int width, int height, int stride, int step, LumaStats *out)
+{
+    std::memset(out->histogram, 0, sizeof(out->histogram));
+    out->count = 0;
+    out->mean = 0;
+    out->darkFraction = 0;
+    out->brightFraction = 0;
+    if (!bits || width <= 0 || height <= 0) {
+        return;
+    }
+    if (step < 1) step = 1;
+
+    // 直方图：4 路子直方图交替累加，减少同一计数器上的读写依赖
+    quint32 sub[4][256];
+    std::memset(sub, 0, sizeof(sub));
+
+    for (int y = 0; y < height; y += step) {
+        const uchar *row = bits + qint64(y) * stride;
+        int x = 0;
+        for (; x + 3 * step < width; x += 4 * step) {
+            sub[0][row[x]]++;
+            sub[1][row[x + step]]++;
+            sub[2][row[x + 2 * step]]++;
+            sub[3][row[x + 3 * step]]++;
+        }
+        for (; x < width; x += step) {
+            sub[0][row[x]]++;
+        }
+    }
+
+    // 均值和过/欠曝占比也由直方图得出，与分位数统计的是同一组采样点
+    quint64 sum = 0;
+    quint32 dark = 0, bright = 0;
+    for (int i = 0; i < 256; i++) {
+        out->histogram[i] = sub[0][i] + sub[1][i] + sub[2][i] + sub[3][i];
+        out->count += out->histogram[i];
+        sum += quint64(i) * out->histogram[i];
+        if (i <= DARK_LEVEL) dark += out->histogram[i];
+        if (i >= BRIGHT_LEVEL) bright += out->histogram[i];
+    }
+    if (out->count > 0) {
+        out->mean = double(sum) / out->count;
+        out->darkFraction = double(dark) / out->count;
+        out->brightFraction = double(bright) / out->count;
+    }
+}
+
+#ifdef FRAMEANALYSIS_SSE2
+static inline quint64 horizontalSum64(__m128i v)
+{
+    quint64 lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), v);
+    return lanes[0] + lanes[1];
+}
+
+static inline qint64 horizontalSum32(__m128i v)
+{
+    qint32 lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), v);
+    return qint64(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+}
+#endif
+
+double meanAbsDiff(const uchar *a, const uchar *b, int width, int height, int stride)
+{
+    if (width <= 0 || height <= 0) {
+        return 0;
+    }
+    quint64 total = 0;
+    for (int y = 0; y < height; y++) {
+        const uchar *pa = a + qint64(y) * stride;
+        const uchar *pb = b + qint64(y) * stride;
+        int x = 0;
+#ifdef FRAMEANALYSIS_SSE2
+        __m128i acc = _mm_setzero_si128();
+        for (; x + 16 <= width; x += 16) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pa + x));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pb + x));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+        }
+        total += horizontalSum64(acc);
+#endif
+        for (; x < width; x++) {
+            total += quint64(qAbs(int(pa[x]) - int(pb[x])));
+        }
+    }
+    return double(total) / (qint64(width) * height);
+}
+
+void blockAbsDiff(const uchar *a, const uchar *b, int width, int height, int stride, int blockSize, quint8 *out)
+{
+    if (width <= 0 || height <= 0 || blockSize < 8 || blockSize % 8 != 0) {
+        return;
+    }
+    const int blocksX = (width + blockSize - 1) / blockSize;
+    const int blocksY = (height + blockSize - 1) / blockSize;
+    QVarLengthArray<quint32, 256> sums(blocksX);
+
+    for (int by = 0; by < blocksY; by++) {
+        std::memset(sums.data(), 0, sizeof(quint32) * size_t(blocksX));
+        const int y0 = by * blockSize;
+        const int rows = qMin(blockSize, height - y0);
+        for (int y = y0; y < y0 + rows; y++) {
+            const uchar *pa = a + qint64(y) * stride;
+            const uchar *pb = b + qint64(y) * stride;
+            int x = 0;
+#ifdef FRAMEANALYSIS_SSE2
+            // _mm_sad_epu8 的两个 64 位结果恰好是相邻两组 8 像素的差值和，
+            // 块宽为 8 的倍数，每组都完整落在一个块内
+            for (; x + 16 <= width; x += 16) {
+                __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pa + x));
+                __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pb + x));
+                __m128i sad = _mm_sad_epu8(va, vb);
+                sums[x / blockSize] += quint32(_mm_cvtsi128_si32(sad));
+                sums[(x + 8) / blockSize] += quint32(_mm_cvtsi128_si32(_mm_srli_si128(sad, 8)));
+            }
+#endif
+            for (; x < width; x++) {
+                sums[x / blockSize] += quint32(qAbs(int(pa[x]) - int(pb[x])));
+            }
+        }
+        quint8 *row = out + qint64(by) * blocksX;
+        for (int bx = 0; bx < blocksX; bx++) {
+            int cols = qMin(blockSize, width - bx * blockSize);
+            row[bx] = quint8(sums[bx] / quint32(cols * rows));
+        }
+    }
+}
+
+void meanVariance(const uchar *bits, int width, int height, int stride, double *mean, double *variance)
+{
+    *mean = 0;
+    *variance = 0;
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    quint64 sum = 0;
+    quint64 sumSq = 0;
+    for (int y = 0; y < height; y++) {
+        const uchar *p = bits + qint64(y) * stride;
+        int x = 0;
+#ifdef FRAMEANALYSIS_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        __m128i accSum = zero;
+        __m128i accSq = zero;   // 4 x int32，每行清零，行宽 < 8000 时不会溢出
+        for (; x + 16 <= width; x += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + x));
+            accSum = _mm_add_epi64(accSum, _mm_sad_epu8(v, zero));
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+            accSq = _mm_add_epi32(accSq, _mm_madd_epi16(lo, lo));
+            accSq = _mm_add_epi32(accSq, _mm_madd_epi16(hi, hi));
+        }
+        sum += horizontalSum64(accSum);
+        sumSq += quint64(horizontalSum32(accSq));
+#endif
+        for (; x < width; x++) {
+            sum += p[x];
+            sumSq += quint64(p[x]) * p[x];
+        }
+    }
+    double n = double(width) * height;
+    *mean = sum / n;
+    *variance = qMax(0.0, sumSq / n - (*mean) * (*mean));
+}
+
+double laplacianVariance(const uchar *bits, int width, int height, int stride)
+{
+    if (width < 3 || height < 3) {
+        return 0;
+    }
+    qint64 sum = 0;
+    qint64 sumSq = 0;
+    for (int y = 1; y < height - 1; y++) {
+        const uchar *up = bits + qint64(y - 1) * stride;
+        const uchar *row = bits + qint64(y) * stride;
+        const uchar *down = bits + qint64(y + 1) * stride;
+        int x = 1;
+#ifdef FRAMEANALYSIS_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_set1_epi16(1);
+        __m128i accSum = zero;  // 4 x int32
+        __m128i accSq = zero;   // 4 x int32，每次最多累加 2 * 1020^2，行宽 < 8000 时不会溢出
+        for (; x + 8 <= width - 1; x += 8) {
+            __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(row + x)), zero);
+            __m128i l = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(row + x - 1)), zero);
+            __m128i r = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(row + x + 1)), zero);
+            __m128i u = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(up + x)), zero);
+            __m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(down + x)), zero);
+            __m128i lap = _mm_sub_epi16(_mm_slli_epi16(c, 2),
+                                        _mm_add_epi16(_mm_add_epi16(l, r), _mm_add_epi16(u, d)));
+            accSum = _mm_add_epi32(accSum, _mm_madd_epi16(lap, ones));
+            accSq = _mm_add_epi32(accSq, _mm_madd_epi16(lap, lap));
+        }
+        sum += horizontalSum32(accSum);
+        sumSq += horizontalSum32(accSq);
+#endif
+        for (; x < width - 1; x++) {
+            int lap = 4 * row[x] - row[x - 1] - row[x + 1] - up[x] - down[x];
+            sum += lap;
+            sumSq += qint64(lap) * lap;
+        }
+    }
+    double n = double(width - 2) * (height - 2);
+    double mean = sum / n;
+    return qMax(0.0, sumSq / n - mean * mean);
+}
+
+} // namespace FrameAnalysis
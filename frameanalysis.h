@@ -0,0 +1,59 @@
+#ifndef FRAMEANALYSIS_H
+#define FRAMEANALYSIS_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QMetaType>
+
+// --- 亮度统计结果 ---
+struct LumaStats {
+    quint32 histogram[256];     // 子采样网格上的亮度直方图
+    quint32 count = 0;          // 直方图样本数
+    double mean = 0;            // 平均亮度 (0-255)
+    double darkFraction = 0;    // 欠曝像素占比 (<= 16)
+    double brightFraction = 0;  // 过曝像素占比 (>= 240)
+    qint64 costUs = 0;          // 缩略图解码 + 统计耗时
+};
+
+// --- 画面质量指标 (用于冻结/黑屏/失焦/过曝判断) ---
+struct StreamHealthMetrics {
+    double mean = 0;            // 平均亮度
+    double stddev = 0;          // 亮度标准差 (对比度)
+    double diffEnergy = -1;     // 与上一帧的平均绝对差，<0 表示没有上一帧
+    double sharpness = 0;       // 拉普拉斯响应方差 (越大越清晰)
+    double brightFraction = 0;  // 过曝像素占比
+    qint64 costUs = 0;
+};
+
+/**
+ * @brief 帧分析基础算子
+ * 所有分析都在 DCT 缩放解码出的灰度缩略图上进行，
+ * 行列按网格子采样，热点循环使用 SSE2 (无 SSE2 时回退到标量实现)。
+ */
+namespace FrameAnalysis {
+
+// 利用 JPEG 的 DCT 域缩放直接解出 1/scaleDenom 尺寸的灰度图 (scaleDenom: 1/2/4/8)
+QImage decodeThumbnail(const QByteArray &jpeg, int scaleDenom = 8, QSize *fullSize = nullptr);
+
+// 计算亮度直方图/均值/过欠曝占比；step 为子采样网格间距 (像素)
+void computeLumaStats(const uchar *bits, int width, int height, int stride, int step, LumaStats *out);
+
+// 两帧同尺寸灰度图的平均绝对差
+double meanAbsDiff(const uchar *a, const uchar *b, int width, int height, int stride);
+
+// 分块平均绝对差 (运动检测)：blockSize 须为 8 的倍数，
+// out 按行存放 ceil(width/blockSize) * ceil(height/blockSize) 个块的平均差 (0-255)，边缘块按实际像素数平均
+void blockAbsDiff(const uchar *a, const uchar *b, int width, int height, int stride, int blockSize, quint8 *out);
+
+// 亮度均值与方差
+void meanVariance(const uchar *bits, int width, int height, int stride, double *mean, double *variance);
+
+// 拉普拉斯算子 (4 邻域) 响应的方差，作为清晰度评分
+double laplacianVariance(const uchar *bits, int width, int height, int stride);
+
+} // namespace FrameAnalysis
+
+Q_DECLARE_METATYPE(LumaStats)
+Q_DECLARE_METATYPE(StreamHealthMetrics)
+
+#endif // FRAMEANALYSIS_H
@@ -0,0 +1,203 @@
+#include "frameanalyzer.h"
+#include <QMutexLocker>
+#include <cmath>
+
+FrameAnalyzer::FrameAnalyzer(QObject *parent)
+    : QObject{parent}
+{
+    qRegisterMetaType<LumaStats>("LumaStats");
+    qRegisterMetaType<StreamHealthMetrics>("StreamHealthMetrics");
+    m_clock.start();
+}
+
+void FrameAnalyzer::setFeature(int camId, Feature feature, bool enabled)
+{
+    QMutexLocker locker(&m_mutex);
+    CameraSlot &slot = m_slots[camId];
+    if (enabled) {
+        slot.features |= feature;
+    } else {
+        slot.features &= ~feature;
+    }
+    if (feature == HealthFeature && !enabled) {
+        // 上一帧缩略图归分析线程所有，在线程内清理
+        QMetaObject::invokeMethod(this, [=](){ m_prevThumbs.remove(camId); }, Qt::QueuedConnection);
+    }
+    if (feature == MotionFeature && !enabled) {
+        QMetaObject::invokeMethod(this, [=](){ m_motionStates.remove(camId); }, Qt::QueuedConnection);
+    }
+}
+
+void FrameAnalyzer::setMotionParams(int camId, const MotionParams &params)
+{
+    QMutexLocker locker(&m_mutex);
+    CameraSlot &slot = m_slots[camId];
+    slot.motion = params;
+    slot.motionVersion++;
+}
+
+void FrameAnalyzer::submitFrame(int camId, const QByteArray &jpeg)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_slots.find(camId);
+    if (it == m_slots.end() || it->features == 0) {
+        return;
+    }
+
+    // 只开了按间隔采样的分析 (亮度/运动) 且都未到时间时直接跳过 (不解码)
+    qint64 now = m_clock.elapsed();
+    if (!(it->features & HealthFeature)) {
+        bool lumaDue = (it->features & LumaFeature)
+                       && (it->lastLumaMs < 0 || now - it->lastLumaMs >= m_lumaIntervalMs);
+        bool motionDue = (it->features & MotionFeature)
+                         && (it->lastMotionMs < 0 || now - it->lastMotionMs >= m_motionIntervalMs);
+        if (!lumaDue && !motionDue) {
+            return;
+        }
+    }
+
+    it->pending = jpeg; // QByteArray 隐式共享，不拷贝数据
+    if (!it->scheduled) {
+        it->scheduled = true;
+        QMetaObject::invokeMethod(this, [=](){ processCamera(camId); }, Qt::QueuedConnection);
+    }
+}
+
+void FrameAnalyzer::processCamera(int camId)
+{
+    QByteArray jpeg;
+    int features = 0;
+    MotionParams motionParams;
+    int motionVersion = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        CameraSlot &slot = m_slots[camId];
+        slot.scheduled = false;
+        jpeg = slot.pending;
+        slot.pending.clear();
+        features = slot.features;
+        if (features & LumaFeature) {
+            // 与逐帧分析同时开启时，亮度统计仍按间隔输出
+            qint64 now = m_clock.elapsed();
+            if (slot.lastLumaMs >= 0 && now - slot.lastLumaMs < m_lumaIntervalMs) {
+                features &= ~LumaFeature;
+            } else {
+                slot.lastLumaMs = now;
+            }
+        }
+        if (features & MotionFeature) {
+            qint64 now = m_clock.elapsed();
+            if (slot.lastMotionMs >= 0 && now - slot.lastMotionMs < m_motionIntervalMs) {
+                features &= ~MotionFeature;
+            } else {
+                slot.lastMotionMs = now;
+                motionParams = slot.motion;
+                motionVersion = slot.motionVersion;
+            }
+        }
+    }
+    if (jpeg.isEmpty() || features == 0) {
+        return;
+    }
+
+    QElapsedTimer cost;
+    cost.start();
+    QImage thumb = FrameAnalysis::decodeThumbnail(jpeg, 8);
+    if (thumb.isNull()) {
+        return;
+    }
+    qint64 decodeUs = cost.nsecsElapsed() / 1000;
+
+    if (features & HealthFeature) {
+        QElapsedTimer stageCost;
+        stageCost.start();
+        StreamHealthMetrics metrics;
+        double variance = 0;
+        FrameAnalysis::meanVariance(thumb.constBits(), thumb.width(), thumb.height(),
+                                    thumb.bytesPerLine(), &metrics.mean, &variance);
+        metrics.stddev = std::sqrt(variance);
+        metrics.sharpness = FrameAnalysis::laplacianVariance(thumb.constBits(), thumb.width(), thumb.height(),
+                                                             thumb.bytesPerLine());
+
+        QImage &prev = m_prevThumbs[camId];
+        if (prev.size() == thumb.size() && prev.bytesPerLine() == thumb.bytesPerLine()) {
+            metrics.diffEnergy = FrameAnalysis::meanAbsDiff(prev.constBits(), thumb.constBits(),
+                                                            thumb.width(), thumb.height(), thumb.bytesPerLine());
+        }
+        prev = thumb;
+
+        LumaStats clip;
+        FrameAnalysis::computeLumaStats(thumb.constBits(), thumb.width(), thumb.height(),
+                                        thumb.bytesPerLine(), 4, &clip);
+        metrics.brightFraction = clip.brightFraction;
+        metrics.costUs = decodeUs + stageCost.nsecsElapsed() / 1000;
+        emit healthMetricsReady(camId, metrics);
+    }
+
+    if (features & MotionFeature) {
+        double fraction = measureMotion(camId, thumb, motionParams, motionVersion);
+        if (fraction >= 0) {
+            emit motionMeasured(camId, fraction);
+        }
+    }
+
+    if (features & LumaFeature) {
+        LumaStats stats;
+        FrameAnalysis::computeLumaStats(thumb.constBits(), thumb.width(), thumb.height(),
+                                        thumb.bytesPerLine(), 2, &stats);
+        stats.costUs = cost.nsecsElapsed() / 1000;
+        emit lumaStatsReady(camId, stats);
+    }
+}
+
+// 与上一次运动检测时的缩略图比较 (而不是上一帧)，帧率高时缓慢移动的目标也能累积出差异；
+// 没有可比较的参考图时返回 -1
+double FrameAnalyzer::measureMotion(int camId, const QImage &thumb, const MotionParams &params, int version)
+{
+    MotionState &state = m_motionStates[camId];
+    QImage prev = state.reference;
+    state.reference = thumb;
+    if (prev.size() != thumb.size() || prev.bytesPerLine() != thumb.bytesPerLine()) {
+        return -1;
+    }
+    const int blocksX = (thumb.width() + MOTION_BLOCK - 1) / MOTION_BLOCK;
+    const int blocksY = (thumb.height() + MOTION_BLOCK - 1) / MOTION_BLOCK;
+
+    // 参数或画面尺寸变化时重建屏蔽掩码：块中心落在屏蔽区域内即忽略
+    if (state.version != version || state.blocksX != blocksX || state.blocksY != blocksY) {
+        state.version = version;
+        state.blocksX = blocksX;
+        state.blocksY = blocksY;
+        state.mask.fill(1, blocksX * blocksY);
+        state.diff.resize(blocksX * blocksY);
+        for (int by = 0; by < blocksY; by++) {
+            for (int bx = 0; bx < blocksX; bx++) {
+                QPointF center((bx + 0.5) / blocksX, (by + 0.5) / blocksY);
+                for (const QRectF &rect : params.masks) {
+                    if (rect.contains(center)) {
+                        state.mask[by * blocksX + bx] = 0;
+                        break;
+                    }
+                }
+            }
+        }
+        state.activeBlocks = 0;
+        for (quint8 m : state.mask) {
+            state.activeBlocks += m;
+        }
+    }
+    if (state.activeBlocks == 0) {
+        return 0;
+    }
+
+    FrameAnalysis::blockAbsDiff(prev.constBits(), thumb.constBits(), thumb.width(), thumb.height(),
+                                thumb.bytesPerLine(), MOTION_BLOCK, state.diff.data());
+    int changed = 0;
+    const int n = blocksX * blocksY;
+    for (int i = 0; i < n; i++) {
+        if (state.mask[i] && state.diff[i] > params.threshold) {
+            changed++;
+        }
+    }
+    return double(changed) / state.activeBlocks;
+}
@@ -0,0 +1,86 @@
+#ifndef FRAMEANALYZER_H
+#define FRAMEANALYZER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QRectF>
+#include "frameanalysis.h"
+
+// 运动检测参数 (每路相机)
+struct MotionParams {
+    int threshold = 12;         // 块平均亮度差超过此值视为该块变化 (越小越灵敏)
+    QVector<QRectF> masks;      // 忽略区域，归一化坐标 (0-1)，如水面反光、固定结构
+};
+
+/**
+ * @brief 实时帧分析工作对象 (运行在独立线程)
+ * GUI 线程通过 submitFrame() 投递收到的 JPEG，同一相机未处理的旧帧会被新帧覆盖，
+ * 分析线程忙时自动丢帧，不会堆积。各项分析按相机单独开关。
+ */
+class FrameAnalyzer : public QObject
+{
+    Q_OBJECT
+public:
+    enum Feature {
+        LumaFeature = 0x1,  // 亮度直方图 (自动曝光)
+        HealthFeature = 0x2, // 画面质量 (冻结/黑屏/失焦/过曝)，逐帧
+        MotionFeature = 0x4  // 运动检测 (分块帧差)，按间隔
+    };
+
+    explicit FrameAnalyzer(QObject *parent = nullptr);
+
+    // --- 以下接口线程安全，可在 GUI 线程直接调用 ---
+    void submitFrame(int camId, const QByteArray &jpeg);
+    void setFeature(int camId, Feature feature, bool enabled);
+    void setLumaIntervalMs(int ms) { m_lumaIntervalMs = ms; }
+    void setMotionIntervalMs(int ms) { m_motionIntervalMs = ms; }
+    void setMotionParams(int camId, const MotionParams &params);
+
+signals:
+    void lumaStatsReady(int camId, const LumaStats &stats);
+    void healthMetricsReady(int camId, const StreamHealthMetrics &metrics);
+    // 未屏蔽的块中发生变化的比例 (0-1)
+    void motionMeasured(int camId, double changedFraction);
+
+private:
+    struct CameraSlot {
+        int features = 0;
+        QByteArray pending;         // 最新一帧，未处理前被后续帧覆盖
+        bool scheduled = false;
+        qint64 lastLumaMs = -1;
+        qint64 lastMotionMs = -1;
+        MotionParams motion;
+        int motionVersion = 0;      // 参数变化时递增，分析线程据此重建掩码
+    };
+
+    // 运动检测的分析线程侧状态
+    struct MotionState {
+        QImage reference;           // 上一次检测时的缩略图
+        int version = -1;
+        int blocksX = 0;
+        int blocksY = 0;
+        QVector<quint8> mask;       // 1 = 参与检测
+        int activeBlocks = 0;
+        QVector<quint8> diff;
+    };
+
+    QMutex m_mutex;
+    QHash<int, CameraSlot> m_slots;
+    QElapsedTimer m_clock;
+    int m_lumaIntervalMs = 200;     // 自动曝光不需要逐帧统计
+    int m_motionIntervalMs = 200;
+
+    // 以下仅在分析线程中访问
+    QHash<int, QImage> m_prevThumbs; // 上一帧缩略图 (帧差)
+    QHash<int, MotionState> m_motionStates;
+
+    static const int MOTION_BLOCK = 8;  // 缩略图上 8x8 一块，即原图 64x64
+
+    void processCamera(int camId);  // 在分析线程中执行
+    double measureMotion(int camId, const QImage &thumb, const MotionParams &params, int version);
+};
+
+#endif // FRAMEANALYZER_H
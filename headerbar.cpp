@@ -19,6 +19,7 @@ HeaderBar::HeaderBar(QWidget *parent)
 
     //初始化按钮互斥
     QButtonGroup *group = new QButtonGroup(this);
+    m_pageGroup = group;
     group->addButton(ui->btnPreview,0);
     group->addButton(ui->btnPlayback,1);
     group->addButton(ui->btnSettings,2);
@@ -36,3 +37,12 @@ HeaderBar::~HeaderBar()
 {
     delete ui;
 }
+
+void HeaderBar::setCurrentPage(int index)
+{
+    QAbstractButton *button = m_pageGroup->button(index);
+    if (button) {
+        button->setChecked(true);
+        emit sigPageChanged(index);
+    }
+}
@@ -2,6 +2,7 @@
 #define HEADERBAR_H
 
 #include <QWidget>
+#include <QButtonGroup>
 
 namespace Ui {
 class HeaderBar;
@@ -15,10 +16,14 @@ public:
     explicit HeaderBar(QWidget *parent = nullptr);
     ~HeaderBar();
 
+public slots:
+    void setCurrentPage(int index); // 代码切换页面 (如历史记录跳转回放)，按钮状态同步并发出 sigPageChanged
+
 signals:
     void sigPageChanged(int index); // 发送页面索引信号 (0=预览, 1=回放, 2=设置, 3=历史)
 private:
     Ui::HeaderBar *ui;
+    QButtonGroup *m_pageGroup;
 };
 
 #endif // HEADERBAR_H
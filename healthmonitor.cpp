@@ -0,0 +1,168 @@
+#include "healthmonitor.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QSettings>
+#include <QtMath>
+
+HealthMonitor::HealthMonitor(CameraRegistry *registry, QObject *parent)
+    : QObject{parent}
+    , m_registry(registry)
+{
+    // [Health] MinIntervalMs / MaxIntervalMs / StallMs / HistorySize
+    QString configPath = QCoreApplication::applicationDirPath() + "/config.ini";
+    QSettings settings(configPath, QSettings::IniFormat);
+    m_minIntervalMs = qMax(100, settings.value("Health/MinIntervalMs", 500).toInt());
+    m_maxIntervalMs = qMax(m_minIntervalMs, settings.value("Health/MaxIntervalMs", 10000).toInt());
+    m_stallMs = settings.value("Health/StallMs", 3000).toInt();
+    int historySize = settings.value("Health/HistorySize", 600).toInt();
+
+    for (const QString &host : m_registry->hosts()) {
+        HostState &state = m_hosts[host];
+        state.samples.reset(historySize);
+        state.intervalMs = m_minIntervalMs;
+        state.timer = new QTimer(this);
+        state.timer->setSingleShot(true);
+        connect(state.timer, &QTimer::timeout, this, [=](){ poll(host); });
+    }
+
+    connect(m_registry, &CameraRegistry::hostHealthReceived, this, &HealthMonitor::onHealth);
+    connect(m_registry, &CameraRegistry::hostQueryFailed, this,
+            [=](const QString &host, const QString &apiName, const QString &){ onFailed(host, apiName); });
+}
+
+void HealthMonitor::start()
+{
+    m_running = true;
+    for (auto it = m_hosts.begin(); it != m_hosts.end(); ++it) {
+        it->intervalMs = m_minIntervalMs;
+        it->timer->start(0);
+    }
+}
+
+void HealthMonitor::stop()
+{
+    m_running = false;
+    for (auto it = m_hosts.begin(); it != m_hosts.end(); ++it) {
+        it->timer->stop();
+    }
+}
+
+const RingBuffer<HealthSample> *HealthMonitor::samples(const QString &hostKey) const
+{
+    auto it = m_hosts.constFind(hostKey);
+    return it == m_hosts.constEnd() ? nullptr : &it->samples;
+}
+
+int HealthMonitor::currentIntervalMs(const QString &hostKey) const
+{
+    // value() 会拷贝整个 HostState (含样本环形缓冲)，这里只读一个字段
+    auto it = m_hosts.constFind(hostKey);
+    return it == m_hosts.constEnd() ? 0 : it->intervalMs;
+}
+
+void HealthMonitor::poll(const QString &hostKey)
+{
+    auto it = m_hosts.find(hostKey);
+    if (!m_running || it == m_hosts.end()) {
+        return;
+    }
+    if (it->inFlight) {
+        // 上一次请求尚未返回 (由请求超时兜底)，稍后再试
+        it->timer->start(it->intervalMs);
+        return;
+    }
+    it->inFlight = true;
+    m_registry->queryHealth(hostKey);
+}
+
+void HealthMonitor::onHealth(const QString &hostKey, const HealthInfo &info)
+{
+    HealthSample sample;
+    sample.time_ms = QDateTime::currentMSecsSinceEpoch();
+    sample.fps_ema = info.fps_ema;
+    sample.encoded_seq = info.encoded_seq;
+    sample.encoded_ts_ns = info.encoded_ts_ns;
+    sample.clients = info.clients;
+    sample.pipeline_last_seq = info.pipeline.last_seq;
+    sample.pipeline_running = info.pipeline.running;
+    sample.reachable = true;
+    sample.ok = info.last_error.isEmpty() && info.pipeline.last_error.isEmpty();
+    record(hostKey, sample);
+}
+
+void HealthMonitor::onFailed(const QString &hostKey, const QString &apiName)
+{
+    if (apiName != "/health") {
+        return;
+    }
+    HealthSample sample;
+    sample.time_ms = QDateTime::currentMSecsSinceEpoch();
+    sample.reachable = false;
+    sample.ok = false;
+    record(hostKey, sample);
+}
+
+void HealthMonitor::record(const QString &hostKey, HealthSample sample)
+{
+    auto it = m_hosts.find(hostKey);
+    if (it == m_hosts.end()) {
+        return;
+    }
+    HostState &state = *it;
+    state.inFlight = false;
+
+    bool hasPrev = !state.samples.isEmpty();
+    HealthSample prev = hasPrev ? state.samples.last() : HealthSample();
+
+    // --- 推导编码吞吐与卡顿 ---
+    if (sample.encoded_seq > 0) {
+        if (hasPrev && prev.encoded_seq > 0 && sample.encoded_ts_ns > prev.encoded_ts_ns) {
+            double dtSec = (sample.encoded_ts_ns - prev.encoded_ts_ns) / 1e9;
+            sample.encode_fps = (sample.encoded_seq - prev.encoded_seq) / dtSec;
+        } else if (hasPrev) {
+            sample.encode_fps = 0;
+        }
+        if (!hasPrev || sample.encoded_seq != prev.encoded_seq || state.lastSeqChangeMs == 0) {
+            state.lastSeqChangeMs = sample.time_ms;
+        }
+        sample.stalled = sample.pipeline_running && (sample.time_ms - state.lastSeqChangeMs) > m_stallMs;
+    } else {
+        sample.stalled = state.stalled && !sample.ok;
+    }
+
+    // --- 自适应轮询间隔 ---
+    if (!hasPrev || isSignificantChange(prev, sample)) {
+        state.intervalMs = m_minIntervalMs;
+    } else {
+        state.intervalMs = qMin(m_maxIntervalMs, qCeil(state.intervalMs * 1.5));
+    }
+
+    state.samples.push(sample);
+    emit sampleAdded(hostKey, sample);
+
+    if (sample.stalled != state.stalled) {
+        state.stalled = sample.stalled;
+        emit stallChanged(hostKey, sample.stalled);
+    }
+
+    if (m_running) {
+        state.timer->start(state.intervalMs);
+    }
+}
+
+bool HealthMonitor::isSignificantChange(const HealthSample &prev, const HealthSample &cur) const
+{
+    // 可达性变化立即加速；持续不可达则退避，避免频繁请求一个离线主机
+    if (cur.reachable != prev.reachable) return true;
+    if (!cur.reachable) return false;
+    if (!cur.ok || prev.ok != cur.ok) return true;
+    if (cur.stalled != prev.stalled) return true;
+    if (cur.clients != prev.clients) return true;
+    if (cur.pipeline_running != prev.pipeline_running) return true;
+
+    // 帧率波动超过 5% (至少 0.5 fps) 视为变化
+    double fpsTol = qMax(0.5, prev.fps_ema * 0.05);
+    if (qAbs(cur.fps_ema - prev.fps_ema) > fpsTol) return true;
+    if (qAbs(cur.encode_fps - prev.encode_fps) > qMax(0.5, prev.encode_fps * 0.05)) return true;
+    return false;
+}
@@ -0,0 +1,71 @@
+#ifndef HEALTHMONITOR_H
+#define HEALTHMONITOR_H
+
+#include <QObject>
+#include <QMap>
+#include <QTimer>
+#include "cameraregistry.h"
+#include "ringbuffer.h"
+
+// 单次 /health 采样 (含由相邻两次采样推导出的指标)
+struct HealthSample {
+    qint64 time_ms = 0;         // 本地采样时刻 (epoch ms)
+    double fps_ema = 0;
+    qint64 encoded_seq = 0;
+    qint64 encoded_ts_ns = 0;
+    int clients = 0;
+    qint64 pipeline_last_seq = 0;
+    bool pipeline_running = false;
+    bool reachable = false;     // false 表示本次查询失败 (网络/超时)
+    bool ok = false;            // 服务可达且未报告错误
+    double encode_fps = 0;      // Δencoded_seq / Δencoded_ts_ns
+    bool stalled = false;       // 编码序号长时间不前进
+};
+
+/**
+ * @brief 后台健康遥测
+ * 按服务主机轮询 /health，指标变化或出错时加快频率，稳定时逐步退避。
+ * 每个主机的采样保存在定长环形缓冲区中，可直接用于绘图。
+ */
+class HealthMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HealthMonitor(CameraRegistry *registry, QObject *parent = nullptr);
+
+    void start();
+    void stop();
+
+    QStringList hosts() const { return m_hosts.keys(); }
+    const RingBuffer<HealthSample> *samples(const QString &hostKey) const;
+    int currentIntervalMs(const QString &hostKey) const;
+
+signals:
+    void sampleAdded(const QString &hostKey, const HealthSample &sample);
+    void stallChanged(const QString &hostKey, bool stalled);
+
+private:
+    struct HostState {
+        RingBuffer<HealthSample> samples;
+        QTimer *timer = nullptr;
+        int intervalMs = 0;
+        bool inFlight = false;
+        qint64 lastSeqChangeMs = 0; // encoded_seq 最近一次前进的本地时刻
+        bool stalled = false;
+    };
+
+    CameraRegistry *m_registry;
+    QMap<QString, HostState> m_hosts;
+    int m_minIntervalMs = 500;
+    int m_maxIntervalMs = 10000;
+    int m_stallMs = 3000;
+    bool m_running = false;
+
+    void poll(const QString &hostKey);
+    void onHealth(const QString &hostKey, const HealthInfo &info);
+    void onFailed(const QString &hostKey, const QString &apiName);
+    void record(const QString &hostKey, HealthSample sample);
+    bool isSignificantChange(const HealthSample &prev, const HealthSample &cur) const;
+};
+
+#endif // HEALTHMONITOR_H
@@ -0,0 +1,217 @@
+#include "historymodel.h"
+#include <QDateTime>
+#include <QColor>
+#include <climits>
+
+void HistoryModel::Columns::append(const LogRow &row)
+{
+    ids.append(row.id);
+    timeMs.append(row.timeMs);
+    speed.append(row.speed);
+    accel.append(row.accel);
+    dist.append(row.dist);
+}
+
+void HistoryModel::Columns::clear()
+{
+    ids.clear();
+    timeMs.clear();
+    speed.clear();
+    accel.clear();
+    dist.clear();
+}
+
+HistoryModel::HistoryModel(QObject *parent)
+    : QAbstractTableModel{parent}
+{
+    m_cache = new HistoryPageCache(FETCH_BLOCK, this);
+}
+
+int HistoryModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_newer.size() + m_older.size();
+}
+
+int HistoryModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+const HistoryModel::Columns &HistoryModel::locate(int row, int *i) const
+{
+    if (row < m_newer.size()) {
+        *i = m_newer.size() - 1 - row;
+        return m_newer;
+    }
+    *i = row - m_newer.size();
+    return m_older;
+}
+
+QVariant HistoryModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) {
+        return QVariant();
+    }
+    int i = 0;
+    const Columns &columns = locate(index.row(), &i);
+
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case TimeColumn:
+            return QDateTime::fromMSecsSinceEpoch(columns.timeMs[i]).toString("yyyy-MM-dd HH:mm:ss");
+        case SpeedColumn:
+            return QString::number(columns.speed[i], 'f', 1);
+        case AccelColumn:
+            return QString::number(columns.accel[i], 'f', 1);
+        case DistColumn:
+            return QString::number(columns.dist[i], 'f', 1);
+        }
+        break;
+    case Qt::TextAlignmentRole:
+        return int(Qt::AlignCenter);
+    case Qt::ForegroundRole:
+        return QColor(Qt::white);
+    case Qt::ToolTipRole:
+        if (index.column() == TimeColumn) {
+            return QString("单击跳转到该时刻的录像");
+        }
+        break;
+    case LogIdRole:
+        return columns.ids[i];
+    case TimeMsRole:
+        return columns.timeMs[i];
+    }
+    return QVariant();
+}
+
+QVariant HistoryModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    switch (section) {
+    case TimeColumn:  return QString("时间");
+    case SpeedColumn: return QString("速度");
+    case AccelColumn: return QString("加速度");
+    case DistColumn:  return QString("位移");
+    }
+    return QVariant();
+}
+
+bool HistoryModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !m_atEnd;
+}
+
+void HistoryModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || m_atEnd) {
+        return;
+    }
+    if (rowCount() == 0) {
+        m_totalCount = qMax<qint64>(0, DBManager::instance().getLogCount(vessel()));
+    }
+
+    // 向下一块：比已加载的最旧一条更旧
+    int anchor = INT_MAX;
+    if (m_older.size() > 0) {
+        anchor = m_older.ids.last();
+    } else if (m_newer.size() > 0) {
+        anchor = m_newer.ids.first();
+    }
+    QVector<LogRow> rows = m_cache->page(anchor);
+    m_atEnd = rows.size() < FETCH_BLOCK;
+    if (!rows.isEmpty()) {
+        int first = rowCount();
+        beginInsertRows(QModelIndex(), first, first + rows.size() - 1);
+        for (const LogRow &row : rows) {
+            m_older.append(row);
+        }
+        endInsertRows();
+    }
+    if (!m_atEnd) {
+        m_cache->prefetchAfter(anchor);
+    }
+}
+
+int HistoryModel::newestId() const
+{
+    if (m_newer.size() > 0) {
+        return m_newer.ids.last();
+    }
+    return m_older.size() > 0 ? m_older.ids.first() : 0;
+}
+
+void HistoryModel::fetchNewer()
+{
+    if (rowCount() == 0) {
+        // 还没有加载过 (或表原先为空)：让视图重新按需加载
+        reload();
+        return;
+    }
+    // 新记录通常只有几条，按块向上取到最新为止
+    QVector<LogRow> added;
+    for (int after = newestId(); ; ) {
+        QVector<LogRow> rows = DBManager::instance().getLogsAfter(vessel(), after, FETCH_BLOCK);
+        for (int i = rows.size() - 1; i >= 0; i--) {
+            added.append(rows[i]);
+        }
+        if (rows.size() < FETCH_BLOCK) {
+            break;
+        }
+        after = rows.first().id;
+    }
+    if (added.isEmpty()) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), 0, added.size() - 1);
+    for (const LogRow &row : added) {
+        m_newer.append(row);
+    }
+    endInsertRows();
+    m_totalCount += added.size();
+}
+
+void HistoryModel::reload()
+{
+    beginResetModel();
+    m_newer.clear();
+    m_older.clear();
+    m_atEnd = false;
+    m_totalCount = 0;
+    m_cache->clear();
+    endResetModel();
+}
+
+void HistoryModel::invalidateFrom(int firstNewId)
+{
+    m_cache->invalidateFrom(firstNewId);
+}
+
+void HistoryModel::setVessel(int vesselId)
+{
+    if (vesselId == vessel()) {
+        return;
+    }
+    m_cache->setVessel(vesselId);
+    reload();
+}
+
+int HistoryModel::logId(int row) const
+{
+    if (row < 0 || row >= rowCount()) {
+        return -1;
+    }
+    int i = 0;
+    return locate(row, &i).ids[i];
+}
+
+qint64 HistoryModel::timeMs(int row) const
+{
+    if (row < 0 || row >= rowCount()) {
+        return 0;
+    }
+    int i = 0;
+    return locate(row, &i).timeMs[i];
+}
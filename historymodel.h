@@ -0,0 +1,76 @@
+#ifndef HISTORYMODEL_H
+#define HISTORYMODEL_H
+
+#include <QAbstractTableModel>
+#include "Database/historycache.h"
+
+/**
+ * @brief 历史记录表模型 (ship_logs，最新在上)
+ * 视图滚到底时通过 canFetchMore/fetchMore 按块向更旧的方向加载，块取自 HistoryPageCache，
+ * 取完一块即在后台预取下一块，滚动时基本不等数据库。
+ * 已加载的行按列存放 (id/时间/数值各一个数组)，不为每个单元格建对象，
+ * 文字只在视图请求可见单元格时才格式化。
+ * 新写入的记录由 fetchNewer() 追加到顶部；两端都只追加，不搬移已有数据。
+ * 只显示一条船的记录，setVessel() 切换。
+ */
+class HistoryModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    enum Column { TimeColumn, SpeedColumn, AccelColumn, DistColumn, ColumnCount };
+    enum Role {
+        LogIdRole = Qt::UserRole,           // 日志 id
+        TimeMsRole = Qt::UserRole + 1       // 毫秒时间戳
+    };
+
+    explicit HistoryModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    // 清空后从最新一条重新加载
+    void reload();
+    // 把比已加载的最新一条还新的记录插到顶部
+    void fetchNewer();
+    // 新写入了 id >= firstNewId 的记录 (只让缓存失效，不查询)
+    void invalidateFrom(int firstNewId);
+    // 切换船舶并重新加载
+    void setVessel(int vesselId);
+    int vessel() const { return m_cache->vessel(); }
+
+    int logId(int row) const;
+    qint64 timeMs(int row) const;
+    qint64 totalCount() const { return m_totalCount; }
+
+private:
+    static const int FETCH_BLOCK = 256;     // 每次向下加载的行数
+
+    // 列式存储，只在尾部追加
+    struct Columns {
+        QVector<int> ids;
+        QVector<qint64> timeMs;
+        QVector<double> speed;
+        QVector<double> accel;
+        QVector<double> dist;
+
+        int size() const { return ids.size(); }
+        void append(const LogRow &row);
+        void clear();
+    };
+
+    HistoryPageCache *m_cache;
+    Columns m_newer;    // 打开之后新写入的，最旧在前 (显示时倒序放在顶部)
+    Columns m_older;    // 向下加载的，最新在前
+    bool m_atEnd = false;
+    qint64 m_totalCount = 0;    // 本船记录总数 (打开时查询，之后按新写入累加)
+
+    // 行号 -> 所在数组及下标
+    const Columns &locate(int row, int *i) const;
+    int newestId() const;
+};
+
+#endif // HISTORYMODEL_H
@@ -0,0 +1,192 @@
+#include "ingestbench.h"
+#include "replaysource.h"
+#include "streamvideowidget.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+namespace IngestBench {
+
+namespace {
+
+// 进程累计 CPU 时间 (用户态 + 内核态，微秒)，不支持的平台返回 -1
+qint64 processCpuUs()
+{
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+    return (qint64(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * 1000000
+           + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#elif defined(Q_OS_WIN)
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return -1;
+    }
+    auto toUs = [](const FILETIME &t) {
+        return ((qint64(t.dwHighDateTime) << 32) | t.dwLowDateTime) / 10;
+    };
+    return toUs(kernel) + toUs(user);
+#else
+    return -1;
+#endif
+}
+
+struct Stage {
+    const char *name;
+    QVector<qint64> ns;
+
+    qint64 percentile(double p) const
+    {
+        if (ns.isEmpty()) return 0;
+        return ns[qMin(ns.size() - 1, int(p * ns.size()))];
+    }
+    qint64 mean() const
+    {
+        if (ns.isEmpty()) return 0;
+        qint64 sum = 0;
+        for (qint64 v : ns) sum += v;
+        return sum / ns.size();
+    }
+};
+
+QString option(const QStringList &args, const QString &name, const QString &defaultValue = QString())
+{
+    int i = args.indexOf(name);
+    return (i >= 0 && i + 1 < args.size()) ? args[i + 1] : defaultValue;
+}
+
+} // namespace
+
+bool isRequested(const QStringList &args)
+{
+    return args.contains("--replay");
+}
+
+int run(const QStringList &args)
+{
+    QTextStream out(stdout);
+    const QString path = option(args, "--replay");
+    const bool fast = args.contains("--fast");
+    const bool display = args.contains("--display");
+    const int loops = qMax(1, option(args, "--loops", "1").toInt());
+
+    ReplaySource source;
+    source.setNominalFps(option(args, "--fps", "25").toDouble());
+    QString error;
+    if (path.isEmpty() || !source.open(path, &error)) {
+        out << "replay: cannot open " << path << ": " << error << Qt::endl;
+        return 2;
+    }
+
+    StreamVideoWidget *widget = nullptr;
+    if (display) {
+        widget = new StreamVideoWidget;
+        widget->setAcceptFrames(true);
+        widget->resize(1280, 720);
+        widget->show();
+    }
+
+    Stage read{"read+parse", {}};
+    Stage decode{"decode", {}};
+    Stage show{"display", {}};
+    qint64 bytes = 0;
+    int frames = 0;
+    int decodeErrors = 0;
+    int late = 0;           // 按原始时间播放时落后超过一帧间隔的帧
+
+    QElapsedTimer wall;
+    QElapsedTimer stage;
+    const qint64 cpuStart = processCpuUs();
+    wall.start();
+
+    for (int loop = 0; loop < loops; loop++) {
+        if (loop > 0 && !source.rewind()) {
+            break;
+        }
+        qint64 firstTs = -1;
+        qint64 prevTs = 0;
+        qint64 loopStartMs = wall.elapsed();
+        while (true) {
+            QByteArray jpeg;
+            qint64 ts = 0;
+            stage.start();
+            if (!source.nextFrame(&jpeg, &ts)) {
+                break;
+            }
+            read.ns.append(stage.nsecsElapsed());
+
+            if (!fast) {
+                if (firstTs < 0) firstTs = ts;
+                qint64 dueMs = loopStartMs + (ts - firstTs);
+                qint64 waitMs = dueMs - wall.elapsed();
+                if (waitMs > 0) {
+                    QThread::msleep(quint32(waitMs));
+                } else if (-waitMs > qMax<qint64>(1, ts - prevTs)) {
+                    late++;
+                }
+                prevTs = ts;
+            }
+
+            stage.start();
+            QImage image = QImage::fromData(jpeg, "JPEG");
+            decode.ns.append(stage.nsecsElapsed());
+            if (image.isNull()) {
+                decodeErrors++;
+            }
+
+            if (widget) {
+                stage.start();
+                widget->receiveFrameData(jpeg);
+                QCoreApplication::processEvents();
+                show.ns.append(stage.nsecsElapsed());
+            }
+            bytes += jpeg.size();
+            frames++;
+        }
+    }
+
+    const qint64 wallMs = qMax<qint64>(1, wall.elapsed());
+    const qint64 cpuUs = cpuStart >= 0 ? processCpuUs() - cpuStart : -1;
+    delete widget;
+
+    // --- 报告 ---
+    out << "replay " << path << (source.isSegment() ? " (segment)" : " (multipart)")
+        << (fast ? " as-fast-as-possible" : " original-timing") << ", loops " << loops << Qt::endl;
+    out << QString("frames %1  bytes %2 MB  wall %3 ms  throughput %4 fps  %5 MB/s")
+               .arg(frames).arg(bytes / 1048576.0, 0, 'f', 1).arg(wallMs)
+               .arg(frames * 1000.0 / wallMs, 0, 'f', 1).arg(bytes / 1048.576 / wallMs, 0, 'f', 1) << Qt::endl;
+    if (cpuUs >= 0) {
+        out << QString("cpu %1 ms  (%2% of one core)  %3 us/frame")
+                   .arg(cpuUs / 1000).arg(cpuUs / 10.0 / wallMs, 0, 'f', 1)
+                   .arg(frames > 0 ? cpuUs / frames : 0) << Qt::endl;
+    }
+    if (decodeErrors > 0 || late > 0) {
+        out << "decode errors " << decodeErrors << "  late frames " << late << Qt::endl;
+    }
+    out << QString("%1 %2 %3 %4 %5 %6").arg("stage", -12).arg("mean us", 10).arg("p50 us", 10)
+               .arg("p95 us", 10).arg("p99 us", 10).arg("max us", 10) << Qt::endl;
+    for (Stage *s : {&read, &decode, &show}) {
+        if (s->ns.isEmpty()) {
+            continue;
+        }
+        std::sort(s->ns.begin(), s->ns.end());
+        out << QString("%1 %2 %3 %4 %5 %6").arg(s->name, -12)
+                   .arg(s->mean() / 1000.0, 10, 'f', 1).arg(s->percentile(0.50) / 1000.0, 10, 'f', 1)
+                   .arg(s->percentile(0.95) / 1000.0, 10, 'f', 1).arg(s->percentile(0.99) / 1000.0, 10, 'f', 1)
+                   .arg(s->ns.last() / 1000.0, 10, 'f', 1) << Qt::endl;
+    }
+    return frames > 0 ? 0 : 1;
+}
+
+} // namespace IngestBench
@@ -0,0 +1,24 @@
+#ifndef INGESTBENCH_H
+#define INGESTBENCH_H
+
+#include <QStringList>
+
+/**
+ * @brief 接收链路基准测试 (命令行，不启动主界面)
+ * 用 ReplaySource 回放文件，逐帧经过 解析/读取 -> JPEG 解码 -> (可选) 显示控件，
+ * 分阶段统计耗时分位数、吞吐和进程 CPU 时间，结果可直接对比找出回归。
+ *
+ *   --replay <file>       multipart 抓包文件或录像分段 (.seg)
+ *   --fast                尽快输出 (默认按原始时间)
+ *   --loops <n>           重复次数 (默认 1)
+ *   --fps <n>             multipart 无时间戳时的标称帧率 (默认 25)
+ *   --display             经 StreamVideoWidget 显示 (无显示环境可配合 -platform offscreen)
+ */
+namespace IngestBench {
+
+bool isRequested(const QStringList &args);
+int run(const QStringList &args);
+
+} // namespace IngestBench
+
+#endif // INGESTBENCH_H
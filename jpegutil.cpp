@@ -0,0 +1,53 @@
+#include "jpegutil.h"
+
+namespace JpegUtil {
+
+ParseResult parseSize(const char *data, qint64 len, QSize *size)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(data);
+    if (len < 2) {
+        return NeedMoreData;
+    }
+    if (p[0] != 0xFF || p[1] != 0xD8) {
+        return Invalid;
+    }
+
+    qint64 pos = 2;
+    while (true) {
+        // 标记前可以有任意个 0xFF 填充字节
+        if (pos >= len) return NeedMoreData;
+        if (p[pos] != 0xFF) return Invalid;
+        while (pos < len && p[pos] == 0xFF) pos++;
+        if (pos >= len) return NeedMoreData;
+        uchar marker = p[pos++];
+
+        // 无长度字段的独立标记
+        if (marker == 0xD8 || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            continue;
+        }
+        // SOF 之前遇到扫描数据或结束标记
+        if (marker == 0xDA || marker == 0xD9) {
+            return Invalid;
+        }
+
+        if (pos + 2 > len) return NeedMoreData;
+        int segLen = (p[pos] << 8) | p[pos + 1];
+        if (segLen < 2) return Invalid;
+
+        // SOF0-SOF15，排除 DHT(C4)、JPG(C8)、DAC(CC)
+        bool isSof = marker >= 0xC0 && marker <= 0xCF
+                && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (isSof) {
+            // 长度(2) 精度(1) 高(2) 宽(2)
+            if (pos + 7 > len) return NeedMoreData;
+            int height = (p[pos + 3] << 8) | p[pos + 4];
+            int width = (p[pos + 5] << 8) | p[pos + 6];
+            if (width <= 0 || height <= 0) return Invalid;
+            if (size) *size = QSize(width, height);
+            return Found;
+        }
+        pos += segLen;
+    }
+}
+
+} // namespace JpegUtil
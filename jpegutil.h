@@ -0,0 +1,27 @@
+#ifndef JPEGUTIL_H
+#define JPEGUTIL_H
+
+#include <QByteArray>
+#include <QSize>
+
+/**
+ * @brief JPEG 码流的轻量解析工具 (不解码像素)
+ */
+namespace JpegUtil {
+
+enum ParseResult {
+    NeedMoreData,   // 数据还不够，等后续字节到达后再试
+    Found,
+    Invalid         // 不是 JPEG，或在 SOF 之前就出现了图像数据
+};
+
+// 扫描标记段直到 SOFn，读出图像宽高；只需要文件头部的几百字节
+ParseResult parseSize(const char *data, qint64 len, QSize *size);
+inline ParseResult parseSize(const QByteArray &data, QSize *size)
+{
+    return parseSize(data.constData(), data.size(), size);
+}
+
+} // namespace JpegUtil
+
+#endif // JPEGUTIL_H
@@ -1,11 +1,33 @@
 #include "mainwindow.h"
+#include "ingestbench.h"
+#include "tsdbbench.h"
+#include "exportbench.h"
+#include "Database/dbmanager.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
-    MainWindow w;
-    w.show();
-    return a.exec();
+
+    // 命令行基准测试：不启动主界面，跑完即退出
+    if (IngestBench::isRequested(a.arguments())) {
+        return IngestBench::run(a.arguments());
+    }
+    if (TsdbBench::isRequested(a.arguments())) {
+        return TsdbBench::run(a.arguments());
+    }
+    if (ExportBench::isRequested(a.arguments())) {
+        return ExportBench::run(a.arguments());
+    }
+
+    int ret = 0;
+    {
+        MainWindow w;
+        w.show();
+        ret = a.exec();
+    }
+    // 窗口 (及其中的写线程) 都已销毁，再关闭主线程的连接和嵌入式存储
+    DBManager::instance().closeDb();
+    return ret;
 }
@@ -17,8 +17,16 @@ MainWindow::MainWindow(QWidget *parent)
 
     });
 
+    connect(ui->widgetDataView, &DataView::sigRequestPage,
+            ui->widgetHeader, &HeaderBar::setCurrentPage);
     connect(ui->widgetDataView, &DataView::sigSwitchVideoMode,
             ui->widgetVide0panorama, &VideoPanorama::switchMode);
+    connect(ui->widgetVide0panorama, &VideoPanorama::frameArrived,
+            ui->widgetDataView, &DataView::onLiveFrame);
+    // 录像需要所有相机的数据，不论当前显示哪一页
+    if (ui->widgetDataView->recorder()->isEnabled()) {
+        ui->widgetVide0panorama->setBackgroundStreams(true);
+    }
     
     ui->widgetRuler->setRange(26.0);
     ui->widgetRuler->show();
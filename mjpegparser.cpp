@@ -0,0 +1,117 @@
+#include "mjpegparser.h"
+#include <cstring>
+
+MjpegParser::MjpegParser(const QByteArray &boundary)
+    : m_boundary(boundary)
+{
+}
+
+void MjpegParser::feed(const char *data, int len)
+{
+    compact();
+    m_buffer.append(data, len);
+}
+
+void MjpegParser::clear()
+{
+    m_buffer.clear();
+    m_pos = 0;
+    m_finished = false;
+    m_malformed = 0;
+}
+
+// 已消费部分超过一半 (且足够大) 时才整体前移，均摊 O(1)
+void MjpegParser::compact()
+{
+    if (m_pos > 0 && (m_pos == m_buffer.size() || (m_pos > 64 * 1024 && m_pos * 2 > m_buffer.size()))) {
+        m_buffer.remove(0, m_pos);
+        m_pos = 0;
+    }
+}
+
+// 在分段头中按名称 (不区分大小写) 取值，没有该头时返回空
+static QByteArray headerValue(const char *headers, int len, const char *name)
+{
+    const int nameLen = int(std::strlen(name));
+    int lineStart = 0;
+    while (lineStart < len) {
+        int lineEnd = lineStart;
+        while (lineEnd < len && headers[lineEnd] != '\r' && headers[lineEnd] != '\n') {
+            lineEnd++;
+        }
+        if (lineEnd - lineStart > nameLen && headers[lineStart + nameLen] == ':'
+            && qstrnicmp(headers + lineStart, name, uint(nameLen)) == 0) {
+            return QByteArray(headers + lineStart + nameLen + 1, lineEnd - lineStart - nameLen - 1).trimmed();
+        }
+        lineStart = lineEnd + 1;
+    }
+    return QByteArray();
+}
+
+bool MjpegParser::next(QByteArray *jpeg, qint64 *timestampMs)
+{
+    while (true) {
+        const char *base = m_buffer.constData();
+        const int size = m_buffer.size();
+
+        int boundaryIdx = m_buffer.indexOf(m_boundary, m_pos);
+        if (boundaryIdx < 0) {
+            // 保留末尾可能是半个分界行的字节
+            m_pos = qMax(m_pos, size - m_boundary.size());
+            return false;
+        }
+        int lineEnd = m_buffer.indexOf("\r\n", boundaryIdx);
+        if (lineEnd < 0) {
+            m_pos = boundaryIdx;
+            return false;
+        }
+        int headersStart = lineEnd + 2;
+        int headersEnd = m_buffer.indexOf("\r\n\r\n", headersStart);
+        if (headersEnd < 0) {
+            m_pos = boundaryIdx;
+            return false;
+        }
+        int bodyStart = headersEnd + 4;
+
+        bool hasLength = false;
+        bool hasTimestamp = false;
+        qint64 contentLength = headerValue(base + headersStart, headersEnd - headersStart, "Content-Length")
+                                   .toLongLong(&hasLength);
+        double ts = headerValue(base + headersStart, headersEnd - headersStart, "X-Timestamp").toDouble(&hasTimestamp);
+
+        int bodyEnd = -1;
+        if (hasLength && contentLength > 0) {
+            if (size - bodyStart < contentLength) {
+                m_pos = boundaryIdx;
+                return false;
+            }
+            bodyEnd = bodyStart + int(contentLength);
+        } else {
+            // 没有长度：到下一个分界行为止
+            int nextBoundary = m_buffer.indexOf(m_boundary, bodyStart);
+            if (nextBoundary < 0) {
+                if (!m_finished) {
+                    m_pos = boundaryIdx;
+                    return false;
+                }
+                nextBoundary = size;
+            }
+            bodyEnd = nextBoundary;
+            while (bodyEnd > bodyStart && (base[bodyEnd - 1] == '\n' || base[bodyEnd - 1] == '\r')) {
+                bodyEnd--;
+            }
+        }
+
+        m_pos = bodyEnd;
+        if (bodyEnd - bodyStart < 4 || uchar(base[bodyStart]) != 0xFF || uchar(base[bodyStart + 1]) != 0xD8) {
+            m_malformed++;
+            continue;
+        }
+        *jpeg = QByteArray(base + bodyStart, bodyEnd - bodyStart);
+        if (timestampMs) {
+            // X-Timestamp 常见为带小数的秒，数值较小时按秒换算
+            *timestampMs = !hasTimestamp ? -1 : ts < 1e11 ? qint64(ts * 1000.0) : qint64(ts);
+        }
+        return true;
+    }
+}
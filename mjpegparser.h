@@ -0,0 +1,39 @@
+#ifndef MJPEGPARSER_H
+#define MJPEGPARSER_H
+
+#include <QByteArray>
+
+/**
+ * @brief multipart/x-mixed-replace (MJPEG over HTTP) 增量解析
+ * 网络流与抓包落盘的文件共用同一个解析器：feed() 追加收到的字节，next() 逐个取出完整的 JPEG。
+ * 有 Content-Length 时按长度切分，没有时找下一个分界行；已消费的数据延迟整块丢弃，
+ * 每帧只做一次拷贝 (取出的 JPEG)，不会随帧数反复搬移缓冲区。
+ */
+class MjpegParser
+{
+public:
+    explicit MjpegParser(const QByteArray &boundary = "--frame");
+
+    void feed(const char *data, int len);
+    void feed(const QByteArray &data) { feed(data.constData(), data.size()); }
+    // 数据已全部送入 (文件结尾)：最后一个没有 Content-Length 的分段也可以取出
+    void finish() { m_finished = true; }
+    void clear();
+
+    // 取出下一帧；timestampMs 来自 X-Timestamp 头 (秒或毫秒)，没有时为 -1
+    bool next(QByteArray *jpeg, qint64 *timestampMs = nullptr);
+
+    int malformedParts() const { return m_malformed; }
+    qint64 bufferedBytes() const { return m_buffer.size() - m_pos; }
+
+private:
+    QByteArray m_boundary;
+    QByteArray m_buffer;
+    int m_pos = 0;          // 未消费数据的起点
+    bool m_finished = false;
+    int m_malformed = 0;
+
+    void compact();
+};
+
+#endif // MJPEGPARSER_H
@@ -0,0 +1,495 @@
+#include "playbackview.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QDateTime>
+#include <QDateTimeEdit>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QStyle>
+#include <algorithm>
+
+PlaybackView::PlaybackView(const QString &rootDir, QWidget *parent)
+    : QWidget{parent}
+    , m_rootDir(rootDir)
+{
+    setFocusPolicy(Qt::StrongFocus);
+
+    m_engine = new PlaybackEngine(this);
+    m_engine->setRootDir(m_rootDir);
+    m_sync = new SyncPlayback(this);
+    m_sync->setRootDir(m_rootDir);
+    m_exporter = new ClipExporter(m_rootDir, this);
+
+    // --- 顶部：模式与相机选择 ---
+    m_cbMode = new QComboBox(this);
+    m_cbMode->addItems({"单路回放", "三路同步"});
+    m_cbCamera = new QComboBox(this);
+    m_cbCamera->addItem("全景", 0);
+    for (int camId = 1; camId <= 13; camId++) {
+        m_cbCamera->addItem(QString("相机 %1").arg(camId), camId);
+    }
+    m_cbCamera->setCurrentIndex(1);
+    // 分组与实时页一致：1-3, 4-6, 7-9, 10-12, 13
+    m_cbGroup = new QComboBox(this);
+    for (int group = 1; group <= 5; group++) {
+        int first = (group - 1) * 3 + 1;
+        int last = qMin(first + 2, 13);
+        m_cbGroup->addItem(first == last ? QString("相机 %1").arg(first)
+                                         : QString("相机 %1-%2").arg(first).arg(last), group);
+    }
+    m_cbGroup->hide();
+    m_btnLoad = new QPushButton("加载录像", this);
+    m_btnExport = new QPushButton("导出片段", this);
+    m_btnExport->setEnabled(false);
+
+    QHBoxLayout *topLayout = new QHBoxLayout;
+    topLayout->addWidget(m_cbMode);
+    topLayout->addWidget(m_cbCamera);
+    topLayout->addWidget(m_cbGroup);
+    topLayout->addWidget(m_btnLoad);
+    topLayout->addWidget(m_btnExport);
+    topLayout->addStretch();
+
+    // --- 画面 (最多三路并排) ---
+    QHBoxLayout *videoLayout = new QHBoxLayout;
+    for (int i = 0; i < 3; i++) {
+        QWidget *container = new QWidget(this);
+        QVBoxLayout *vbox = new QVBoxLayout(container);
+        vbox->setContentsMargins(0, 0, 0, 0);
+        m_videos[i] = new StreamVideoWidget(container);
+        m_videos[i]->setAcceptFrames(true);
+        m_videoLabels[i] = new QLabel(container);
+        m_videoLabels[i]->setAlignment(Qt::AlignCenter);
+        m_videoLabels[i]->setStyleSheet("color: white; font-size: 14px; font-weight: bold;");
+        m_videoLabels[i]->setFixedHeight(20);
+        vbox->addWidget(m_videos[i], 1);
+        vbox->addWidget(m_videoLabels[i], 0);
+        videoLayout->addWidget(container, 1);
+    }
+    setTiles(1);
+
+    // --- 进度条 ---
+    m_slider = new QSlider(Qt::Horizontal, this);
+    m_slider->setEnabled(false);
+    m_lblTime = new QLabel("--:--:--", this);
+    m_lblTime->setStyleSheet("color: white;");
+    m_lblSkew = new QLabel(this);
+    m_lblSkew->setStyleSheet("color: rgb(0, 200, 255);");
+    m_slider->setMouseTracking(true);
+    m_slider->installEventFilter(this);
+    m_hoverPreview = new QLabel(this, Qt::ToolTip);
+    m_hoverPreview->setStyleSheet("border: 1px solid rgb(0, 200, 255); background: black;");
+    m_hoverPreview->hide();
+    QHBoxLayout *seekLayout = new QHBoxLayout;
+    seekLayout->addWidget(m_slider, 1);
+    seekLayout->addWidget(m_lblTime);
+    seekLayout->addWidget(m_lblSkew);
+
+    // --- 播放控制 ---
+    m_btnReverse = new QPushButton("倒放", this);
+    m_btnReverse->setCheckable(true);
+    m_btnStepBack = new QPushButton("上一帧", this);
+    m_btnPlay = new QPushButton("播放", this);
+    m_btnStepForward = new QPushButton("下一帧", this);
+    m_cbSpeed = new QComboBox(this);
+    const double speeds[] = {0.25, 0.5, 1, 2, 4, 8, 16};
+    for (double s : speeds) {
+        m_cbSpeed->addItem(QString("%1x").arg(s), s);
+    }
+    m_cbSpeed->setCurrentIndex(2);
+
+    QHBoxLayout *ctrlLayout = new QHBoxLayout;
+    ctrlLayout->addStretch();
+    ctrlLayout->addWidget(m_btnReverse);
+    ctrlLayout->addWidget(m_btnStepBack);
+    ctrlLayout->addWidget(m_btnPlay);
+    ctrlLayout->addWidget(m_btnStepForward);
+    ctrlLayout->addWidget(m_cbSpeed);
+    ctrlLayout->addStretch();
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addLayout(topLayout);
+    layout->addLayout(videoLayout, 1);
+    layout->addLayout(seekLayout);
+    layout->addLayout(ctrlLayout);
+
+    // ===============================================
+    // 信号连接
+    // ===============================================
+    connect(m_cbMode, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [=](int index){
+        m_cbCamera->setVisible(index == 0);
+        m_cbGroup->setVisible(index == 1);
+    });
+    connect(m_btnLoad, &QPushButton::clicked, this, [=](){
+        if (m_cbMode->currentIndex() == 0) {
+            loadCamera(m_cbCamera->currentData().toInt());
+        } else {
+            loadGroup(m_cbGroup->currentData().toInt());
+        }
+    });
+    connect(m_btnExport, &QPushButton::clicked, this, [=](){ exportClip(); });
+    connect(m_btnPlay, &QPushButton::clicked, this, [=](){ togglePlay(); });
+    connect(m_btnStepBack, &QPushButton::clicked, this, [=](){ stepFrame(-1); });
+    connect(m_btnStepForward, &QPushButton::clicked, this, [=](){ stepFrame(1); });
+    connect(m_btnReverse, &QPushButton::toggled, this, [=](){ applySpeed(); });
+    connect(m_cbSpeed, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [=](){ applySpeed(); });
+
+    connect(m_slider, &QSlider::sliderPressed, this, [=](){ m_sliderDragging = true; });
+    connect(m_slider, &QSlider::sliderReleased, this, [=](){
+        m_sliderDragging = false;
+        seekTo(rangeStartMs() + qint64(m_slider->value()) * 1000);
+    });
+    connect(m_slider, &QSlider::sliderMoved, this, [=](int value){
+        // 拖动中实时定位 (二分查找，长录像也不卡)
+        seekTo(rangeStartMs() + qint64(value) * 1000);
+    });
+
+    // 单路与同步共用同一套进度/状态显示
+    auto onRange = [=](qint64 startMs, qint64 endMs){
+        m_slider->setRange(0, int((endMs - startMs) / 1000));
+        m_slider->setEnabled(true);
+    };
+    auto onPosition = [=](qint64 tsMs){
+        if (!m_sliderDragging) {
+            m_slider->setValue(int((tsMs - rangeStartMs()) / 1000));
+        }
+        updateTimeLabel(tsMs);
+        emit positionChanged(tsMs);
+    };
+    auto onPlaying = [=](bool playing){
+        m_btnPlay->setText(playing ? "暂停" : "播放");
+    };
+
+    connect(m_engine, &PlaybackEngine::frameReady, this, [=](const QByteArray &jpeg, qint64, quint64){
+        m_videos[0]->receiveFrameData(jpeg);
+    });
+    connect(m_engine, &PlaybackEngine::rangeChanged, this, [=](qint64 s, qint64 e){ if (!m_syncMode) onRange(s, e); });
+    connect(m_engine, &PlaybackEngine::positionChanged, this, [=](qint64 ts){ if (!m_syncMode) onPosition(ts); });
+    connect(m_engine, &PlaybackEngine::playingChanged, this, [=](bool p){ if (!m_syncMode) onPlaying(p); });
+
+    connect(m_sync, &SyncPlayback::frameReady, this, [=](int slot, const QByteArray &jpeg, qint64){
+        if (slot >= 0 && slot < 3) {
+            m_videos[slot]->receiveFrameData(jpeg);
+        }
+    });
+    connect(m_sync, &SyncPlayback::rangeChanged, this, [=](qint64 s, qint64 e){ if (m_syncMode) onRange(s, e); });
+    connect(m_sync, &SyncPlayback::positionChanged, this, [=](qint64 ts){ if (m_syncMode) onPosition(ts); });
+    connect(m_sync, &SyncPlayback::playingChanged, this, [=](bool p){ if (m_syncMode) onPlaying(p); });
+    connect(m_sync, &SyncPlayback::skewChanged, this, [=](qint64 skewMs){
+        m_lblSkew->setText(QString("同步偏差 %1 ms").arg(skewMs));
+    });
+}
+
+PlaybackView::~PlaybackView()
+{
+    qDeleteAll(m_atlasCache);
+}
+
+void PlaybackView::setTiles(int count)
+{
+    for (int i = 0; i < 3; i++) {
+        m_videos[i]->clearFrame();
+        m_videos[i]->parentWidget()->setVisible(i < count);
+        m_videoLabels[i]->clear();
+    }
+}
+
+void PlaybackView::loadCamera(int camId)
+{
+    int index = m_cbCamera->findData(camId);
+    if (index >= 0 && index != m_cbCamera->currentIndex()) {
+        m_cbCamera->setCurrentIndex(index);
+    }
+    m_cbMode->setCurrentIndex(0);
+    m_sync->close();
+    m_syncMode = false;
+    m_lblSkew->clear();
+    setTiles(1);
+    m_videoLabels[0]->setText(camId == 0 ? QString("全景") : QString("相机 %1").arg(camId));
+    loadHoverSegments(camId);
+    m_loadedCamIds.clear();
+    m_btnExport->setEnabled(false);
+    if (!m_engine->openCamera(camId)) {
+        m_slider->setEnabled(false);
+        m_lblTime->setText("无录像");
+        return;
+    }
+    m_loadedCamIds.append(camId);
+    m_btnExport->setEnabled(true);
+    applySpeed();
+    setFocus();
+}
+
+void PlaybackView::loadGroup(int groupIndex)
+{
+    int index = m_cbGroup->findData(groupIndex);
+    if (index >= 0 && index != m_cbGroup->currentIndex()) {
+        m_cbGroup->setCurrentIndex(index);
+    }
+    m_cbMode->setCurrentIndex(1);
+    m_engine->close();
+    m_syncMode = true;
+
+    QVector<int> camIds;
+    int first = (groupIndex - 1) * 3 + 1;
+    for (int camId = first; camId < first + 3 && camId <= 13; camId++) {
+        camIds.append(camId);
+    }
+    setTiles(camIds.size());
+    for (int i = 0; i < camIds.size(); i++) {
+        m_videoLabels[i]->setText(QString("相机 %1").arg(camIds[i]));
+    }
+    loadHoverSegments(camIds.first());
+    m_loadedCamIds.clear();
+    m_btnExport->setEnabled(false);
+    if (!m_sync->open(camIds)) {
+        m_slider->setEnabled(false);
+        m_lblTime->setText("无录像");
+        return;
+    }
+    m_loadedCamIds = camIds;
+    m_btnExport->setEnabled(true);
+    applySpeed();
+    setFocus();
+}
+
+void PlaybackView::pause()
+{
+    m_engine->pause();
+    m_sync->pause();
+}
+
+bool PlaybackView::openAt(int camId, qint64 tsMs)
+{
+    loadCamera(camId);
+    if (m_loadedCamIds.isEmpty()) {
+        return false;
+    }
+    m_engine->pause();
+    m_engine->seek(tsMs);
+    return true;
+}
+
+qint64 PlaybackView::rangeStartMs() const
+{
+    return m_syncMode ? m_sync->startMs() : m_engine->startMs();
+}
+
+void PlaybackView::seekTo(qint64 tsMs)
+{
+    if (m_syncMode) {
+        m_sync->seek(tsMs);
+    } else {
+        m_engine->seek(tsMs);
+    }
+}
+
+void PlaybackView::togglePlay()
+{
+    if (m_syncMode) {
+        if (m_sync->isPlaying()) m_sync->pause(); else m_sync->play();
+    } else {
+        if (m_engine->isPlaying()) m_engine->pause(); else m_engine->play();
+    }
+}
+
+void PlaybackView::stepFrame(int delta)
+{
+    if (m_syncMode) {
+        m_sync->stepFrame(delta);
+    } else {
+        m_engine->stepFrame(delta);
+    }
+}
+
+void PlaybackView::applySpeed()
+{
+    double speed = m_cbSpeed->currentData().toDouble();
+    if (m_btnReverse->isChecked()) {
+        speed = -speed;
+    }
+    m_engine->setSpeed(speed);
+    m_sync->setSpeed(speed);
+}
+
+void PlaybackView::updateTimeLabel(qint64 tsMs)
+{
+    m_lblTime->setText(QDateTime::fromMSecsSinceEpoch(tsMs).toString("yyyy-MM-dd HH:mm:ss.zzz"));
+}
+
+// 左右方向键逐帧，空格播放/暂停
+void PlaybackView::keyPressEvent(QKeyEvent *event)
+{
+    switch (event->key()) {
+    case Qt::Key_Left:
+        stepFrame(-1);
+        break;
+    case Qt::Key_Right:
+        stepFrame(1);
+        break;
+    case Qt::Key_Space:
+        togglePlay();
+        break;
+    default:
+        QWidget::keyPressEvent(event);
+    }
+}
+
+// ==========================================
+// 片段导出
+// ==========================================
+void PlaybackView::exportClip()
+{
+    if (m_loadedCamIds.isEmpty() || m_exporter->isRunning()) {
+        return;
+    }
+    qint64 endMs = m_syncMode ? m_sync->endMs() : m_engine->endMs();
+    qint64 posMs = m_syncMode ? m_sync->positionMs() : m_engine->positionMs();
+
+    // 默认从当前位置起导出一分钟
+    QDialog dialog(this);
+    dialog.setWindowTitle("导出片段");
+    QDateTimeEdit *editStart = new QDateTimeEdit(QDateTime::fromMSecsSinceEpoch(posMs), &dialog);
+    QDateTimeEdit *editEnd = new QDateTimeEdit(QDateTime::fromMSecsSinceEpoch(qMin(endMs, posMs + 60000)), &dialog);
+    editStart->setDisplayFormat("yyyy-MM-dd HH:mm:ss");
+    editEnd->setDisplayFormat("yyyy-MM-dd HH:mm:ss");
+    QComboBox *cbFormat = new QComboBox(&dialog);
+    cbFormat->addItem("MKV (MJPEG 原样封装，速度快)", ClipExporter::MkvCopy);
+    if (ClipExporter::canEncodeMp4()) {
+        cbFormat->addItem("MP4 (H.264 重新编码，文件小)", ClipExporter::Mp4H264);
+    }
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    QFormLayout *form = new QFormLayout(&dialog);
+    form->addRow("开始时间", editStart);
+    form->addRow("结束时间", editEnd);
+    form->addRow("格式", cbFormat);
+    form->addRow(buttons);
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    ClipExporter::Job job;
+    job.camIds = m_loadedCamIds;
+    job.startMs = editStart->dateTime().toMSecsSinceEpoch();
+    job.endMs = editEnd->dateTime().toMSecsSinceEpoch();
+    job.outDir = m_rootDir + "/exports";
+    job.format = ClipExporter::Format(cbFormat->currentData().toInt());
+    if (job.endMs <= job.startMs) {
+        QMessageBox::warning(this, "导出片段", "结束时间必须晚于开始时间");
+        return;
+    }
+
+    // 非模态进度框：导出期间实时画面与回放照常操作
+    QProgressDialog *progress = new QProgressDialog("正在导出...", "取消", 0, 100, this);
+    progress->setWindowModality(Qt::NonModal);
+    progress->setAttribute(Qt::WA_DeleteOnClose);
+    progress->setMinimumDuration(0);
+    progress->setAutoClose(false);
+    progress->setAutoReset(false);
+    connect(progress, &QProgressDialog::canceled, m_exporter, &ClipExporter::cancel);
+    connect(m_exporter, &ClipExporter::progress, progress, &QProgressDialog::setValue);
+    connect(m_exporter, &ClipExporter::finished, progress, [=](bool ok, const QStringList &files, const QString &error){
+        progress->close();
+        if (ok) {
+            QMessageBox::information(this, "导出完成", QString("已导出 %1 个文件到\n%2\n\n%3")
+                                     .arg(files.size()).arg(job.outDir, files.join("\n")));
+        } else {
+            QMessageBox::warning(this, "导出片段", "导出失败：" + error);
+        }
+    });
+    m_exporter->start(job);
+    progress->show();
+}
+
+// ==========================================
+// 进度条悬停预览
+// ==========================================
+void PlaybackView::loadHoverSegments(int camId)
+{
+    m_hoverSegments = PlaybackEngine::scanSegments(m_rootDir, camId);
+}
+
+ThumbnailAtlas *PlaybackView::atlasFor(int segIndex)
+{
+    QString path = SegmentFormat::thumbPathForSegment(m_hoverSegments[segIndex].segPath);
+    // 最后一个分段可能仍在录制，缩略图还在增长，每次重新映射
+    bool growing = (segIndex == m_hoverSegments.size() - 1);
+    ThumbnailAtlas *atlas = m_atlasCache.value(path, nullptr);
+    if (atlas && !growing) {
+        m_atlasLru.removeOne(path);
+        m_atlasLru.append(path);
+        return atlas;
+    }
+    if (atlas) {
+        m_atlasLru.removeOne(path);
+        delete m_atlasCache.take(path);
+    }
+
+    atlas = new ThumbnailAtlas(path);
+    if (!atlas->open()) {
+        delete atlas;
+        return nullptr;
+    }
+    m_atlasCache.insert(path, atlas);
+    m_atlasLru.append(path);
+    while (m_atlasLru.size() > MAX_CACHED_ATLASES) {
+        delete m_atlasCache.take(m_atlasLru.takeFirst());
+    }
+    return atlas;
+}
+
+void PlaybackView::showHoverPreview(int x)
+{
+    if (!m_slider->isEnabled() || m_hoverSegments.isEmpty()) {
+        m_hoverPreview->hide();
+        return;
+    }
+    int value = QStyle::sliderValueFromPosition(m_slider->minimum(), m_slider->maximum(), x, m_slider->width());
+    qint64 tsMs = rangeStartMs() + qint64(value) * 1000;
+
+    auto it = std::upper_bound(m_hoverSegments.begin(), m_hoverSegments.end(), tsMs,
+        [](qint64 ts, const SegmentInfo &s){ return ts < s.firstMs; });
+    int segIndex = qMax(0, int(it - m_hoverSegments.begin()) - 1);
+    ThumbnailAtlas *atlas = atlasFor(segIndex);
+    int index = atlas ? atlas->indexForTime(tsMs) : -1;
+    if (index < 0) {
+        m_hoverPreview->hide();
+        return;
+    }
+
+    // 缩略图下方标注时间
+    QImage thumb = atlas->thumbAt(index);
+    QPixmap pixmap(thumb.width(), thumb.height() + 16);
+    pixmap.fill(Qt::black);
+    QPainter painter(&pixmap);
+    painter.drawImage(0, 0, thumb);
+    painter.setPen(Qt::white);
+    painter.drawText(QRect(0, thumb.height(), thumb.width(), 16), Qt::AlignCenter,
+                     QDateTime::fromMSecsSinceEpoch(atlas->timestampAt(index)).toString("HH:mm:ss"));
+    painter.end();
+
+    m_hoverPreview->setPixmap(pixmap);
+    m_hoverPreview->adjustSize();
+    QPoint pos = m_slider->mapToGlobal(QPoint(x - m_hoverPreview->width() / 2, -m_hoverPreview->height() - 4));
+    m_hoverPreview->move(pos);
+    m_hoverPreview->show();
+}
+
+bool PlaybackView::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_slider) {
+        if (event->type() == QEvent::MouseMove) {
+            showHoverPreview(static_cast<QMouseEvent *>(event)->pos().x());
+        } else if (event->type() == QEvent::Leave) {
+            m_hoverPreview->hide();
+        }
+    }
+    return QWidget::eventFilter(watched, event);
+}
@@ -0,0 +1,94 @@
+#ifndef PLAYBACKVIEW_H
+#define PLAYBACKVIEW_H
+
+#include <QWidget>
+#include <QComboBox>
+#include <QPushButton>
+#include <QSlider>
+#include <QLabel>
+#include <QKeyEvent>
+#include "streamvideowidget.h"
+#include "Record/playbackengine.h"
+#include "Record/syncplayback.h"
+#include "Record/thumbnailatlas.h"
+#include "Record/clipexporter.h"
+
+/**
+ * @brief 视频回放页
+ * 选择相机后加载本地录像，支持拖动定位、倍速、倒放与逐帧。
+ * "三路同步" 模式按实时页的分组同时回放三路相机，共用一个主时钟。
+ * 画面经 StreamVideoWidget 显示，与实时画面走同一解码路径。
+ */
+class PlaybackView : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit PlaybackView(const QString &rootDir, QWidget *parent = nullptr);
+    ~PlaybackView();
+
+    PlaybackEngine *engine() const { return m_engine; }
+
+public slots:
+    void loadCamera(int camId);
+    void loadGroup(int groupIndex);     // 三路同步，groupIndex 与实时页分组一致 (1 起)
+    void pause();
+    // 打开某路相机并定位到 tsMs 所在的帧 (暂停)，无录像时返回 false
+    bool openAt(int camId, qint64 tsMs);
+
+signals:
+    // 当前回放位置 (单路/同步均发出)，供外部对齐遥测数据
+    void positionChanged(qint64 tsMs);
+
+protected:
+    void keyPressEvent(QKeyEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    QString m_rootDir;
+    PlaybackEngine *m_engine;
+    SyncPlayback *m_sync;
+    bool m_syncMode = false;
+    StreamVideoWidget *m_videos[3];     // 单路只用第一个
+    QLabel *m_videoLabels[3];
+
+    QComboBox *m_cbMode;
+    QComboBox *m_cbCamera;
+    QComboBox *m_cbGroup;
+    QPushButton *m_btnLoad;
+    QPushButton *m_btnExport;
+    QPushButton *m_btnReverse;
+    QPushButton *m_btnStepBack;
+    QPushButton *m_btnPlay;
+    QPushButton *m_btnStepForward;
+    QComboBox *m_cbSpeed;
+    QSlider *m_slider;      // 以秒为单位，相对录像起点
+    QLabel *m_lblTime;
+    QLabel *m_lblSkew;
+    bool m_sliderDragging = false;
+
+    // --- 进度条悬停预览 (读取 .thm 缩略图轨道，不解码原始帧) ---
+    static const int MAX_CACHED_ATLASES = 8;
+    QVector<SegmentInfo> m_hoverSegments;       // 单路为当前相机，同步模式取第一路
+    QHash<QString, ThumbnailAtlas *> m_atlasCache;
+    QList<QString> m_atlasLru;
+    QLabel *m_hoverPreview;
+    void loadHoverSegments(int camId);
+    ThumbnailAtlas *atlasFor(int segIndex);
+    void showHoverPreview(int x);
+
+    // --- 片段导出 ---
+    ClipExporter *m_exporter;
+    QVector<int> m_loadedCamIds;        // 当前已加载的相机
+    void exportClip();
+
+    // 当前模式下的时间轴 (单路: 引擎，同步: 主时钟)
+    qint64 rangeStartMs() const;
+    void seekTo(qint64 tsMs);
+    void togglePlay();
+    void stepFrame(int delta);
+    void setTiles(int count);
+    void applySpeed();
+    void updateTimeLabel(qint64 tsMs);
+};
+
+#endif // PLAYBACKVIEW_H
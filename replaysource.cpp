@@ -0,0 +1,166 @@
+#include "replaysource.h"
+#include <QElapsedTimer>
+
+ReplaySource::ReplaySource(QObject *parent)
+    : QObject{parent}
+{
+}
+
+ReplaySource::~ReplaySource()
+{
+    stop();
+    close();
+}
+
+bool ReplaySource::open(const QString &path, QString *error)
+{
+    close();
+    m_path = path;
+    if (path.endsWith(".seg", Qt::CaseInsensitive)) {
+        m_segment = new MappedSegment(path);
+        if (!m_segment->open()) {
+            delete m_segment;
+            m_segment = nullptr;
+            if (error) *error = QStringLiteral("cannot map segment or index: %1").arg(path);
+            return false;
+        }
+        m_segmentIndex = 0;
+        return true;
+    }
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        if (error) *error = m_file.errorString();
+        return false;
+    }
+    m_parser.clear();
+    m_syntheticMs = 0;
+    return true;
+}
+
+void ReplaySource::close()
+{
+    delete m_segment;
+    m_segment = nullptr;
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+    m_parser.clear();
+}
+
+bool ReplaySource::rewind()
+{
+    if (m_segment) {
+        m_segmentIndex = 0;
+        return true;
+    }
+    if (!m_file.isOpen() || !m_file.seek(0)) {
+        return false;
+    }
+    m_parser.clear();
+    return true;
+}
+
+bool ReplaySource::nextFrame(QByteArray *jpeg, qint64 *timestampMs)
+{
+    if (m_segment) {
+        if (m_segmentIndex >= m_segment->frameCount()) {
+            return false;
+        }
+        *timestampMs = m_segment->record(m_segmentIndex).timestampMs;
+        *jpeg = m_segment->frameData(m_segmentIndex);
+        m_segmentIndex++;
+        return true;
+    }
+
+    // multipart：每次读一块送进解析器，直到解析出一帧
+    while (true) {
+        qint64 ts = -1;
+        if (m_parser.next(jpeg, &ts)) {
+            m_syntheticMs += qint64(1000.0 / m_nominalFps);
+            *timestampMs = ts >= 0 ? ts : m_syntheticMs;
+            return true;
+        }
+        if (m_file.atEnd()) {
+            m_parser.finish();
+            if (m_parser.next(jpeg, &ts)) {
+                m_syntheticMs += qint64(1000.0 / m_nominalFps);
+                *timestampMs = ts >= 0 ? ts : m_syntheticMs;
+                return true;
+            }
+            return false;
+        }
+        QByteArray chunk = m_file.read(READ_CHUNK);
+        if (chunk.isEmpty()) {
+            return false;
+        }
+        m_parser.feed(chunk);
+    }
+}
+
+void ReplaySource::start()
+{
+    if (m_thread) {
+        return;
+    }
+    m_stop = false;
+    QThread *thread = QThread::create([=](){ run(); });
+    // 自行播完时线程对象随后被删除：先清掉指针 (同一线程中排在 deleteLater 之前执行)，
+    // 之后 stop() 不会再 wait 已删除的线程，也可以再次 start()
+    connect(thread, &QThread::finished, this, [=](){
+        if (m_thread == thread) {
+            m_thread = nullptr;
+        }
+    });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    m_thread = thread;
+    m_thread->start();
+}
+
+void ReplaySource::stop()
+{
+    if (!m_thread) {
+        return;
+    }
+    m_stop = true;
+    m_thread->wait();
+    m_thread = nullptr;
+}
+
+// 推送线程：按原始时间戳间隔发出 (相对第一帧)，或不等待直接发出
+void ReplaySource::run()
+{
+    QElapsedTimer clock;
+    clock.start();
+    qint64 firstTs = -1;
+    qint64 lastTs = 0;
+    qint64 loopOffsetMs = 0;
+    int frames = 0;
+    QByteArray jpeg;
+    qint64 ts = 0;
+    while (!m_stop) {
+        if (!nextFrame(&jpeg, &ts)) {
+            if (!m_loop || frames == 0 || !rewind()) {
+                break;
+            }
+            // 下一轮接在上一轮之后，时间轴保持连续
+            loopOffsetMs = firstTs < 0 ? 0 : lastTs + qint64(1000.0 / m_nominalFps);
+            firstTs = -1;
+            continue;
+        }
+        if (firstTs < 0) {
+            firstTs = ts;
+        }
+        lastTs = loopOffsetMs + (ts - firstTs);
+        if (m_pacing == OriginalTiming) {
+            qint64 waitMs = lastTs - clock.elapsed();
+            while (waitMs > 0 && !m_stop) {
+                QThread::msleep(quint32(qMin<qint64>(waitMs, 50)));
+                waitMs = lastTs - clock.elapsed();
+            }
+        }
+        emit sendBynariesToPlayer(jpeg);
+        frames++;
+    }
+    emit finished(frames);
+}
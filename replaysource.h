@@ -0,0 +1,75 @@
+#ifndef REPLAYSOURCE_H
+#define REPLAYSOURCE_H
+
+#include <QObject>
+#include <QFile>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+#include "mjpegparser.h"
+#include "Record/playbackengine.h"
+
+/**
+ * @brief 文件回放帧源 (不需要相机服务)
+ * 输入可以是抓包保存的 MJPEG multipart 流，也可以是本地录像分段 (.seg)：
+ *   multipart 走与 CameraClient 相同的 MjpegParser，分段按索引逐帧读取。
+ * 两种节奏：按原始时间戳播放 (multipart 没有 X-Timestamp 时按 nominalFps)，或尽快输出。
+ * 同步拉取接口 nextFrame() 供基准测试逐阶段计时；start() 在独立线程推送，
+ * 信号与 WebSocketClient::sendBynariesToPlayer 同名同参，可直接接到 StreamVideoWidget。
+ */
+class ReplaySource : public QObject
+{
+    Q_OBJECT
+public:
+    enum Pacing {
+        OriginalTiming,
+        AsFastAsPossible
+    };
+
+    explicit ReplaySource(QObject *parent = nullptr);
+    ~ReplaySource();
+
+    bool open(const QString &path, QString *error = nullptr);
+    void close();
+    bool isSegment() const { return m_segment != nullptr; }
+
+    void setPacing(Pacing pacing) { m_pacing = pacing; }
+    Pacing pacing() const { return m_pacing; }
+    void setNominalFps(double fps) { m_nominalFps = qMax(0.1, fps); }
+    void setLoop(bool loop) { m_loop = loop; }
+
+    // --- 同步拉取 (调用方线程) ---
+    // 读取下一帧；timestampMs 为原始时间 (没有时按 nominalFps 推算)，到结尾返回 false
+    bool nextFrame(QByteArray *jpeg, qint64 *timestampMs);
+    bool rewind();
+
+    // --- 后台推送 ---
+    void start();
+    void stop();
+
+signals:
+    void sendBynariesToPlayer(const QByteArray &data);
+    void finished(int frames);
+
+private:
+    static const int READ_CHUNK = 1 << 20;
+
+    QString m_path;
+    Pacing m_pacing = OriginalTiming;
+    double m_nominalFps = 25;
+    bool m_loop = false;
+
+    // multipart 文件
+    QFile m_file;
+    MjpegParser m_parser;
+    qint64 m_syntheticMs = 0;
+    // 录像分段
+    MappedSegment *m_segment = nullptr;
+    int m_segmentIndex = 0;
+
+    QThread *m_thread = nullptr;
+    std::atomic<bool> m_stop{false};
+    void run();
+};
+
+#endif // REPLAYSOURCE_H
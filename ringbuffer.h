@@ -0,0 +1,53 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <QVector>
+
+/**
+ * @brief 定长环形缓冲区
+ * 写满后覆盖最旧的元素；下标 0 为最旧，size()-1 为最新。
+ * 存储在构造时一次性分配，push 不再产生内存分配。
+ */
+template <typename T>
+class RingBuffer
+{
+public:
+    explicit RingBuffer(int capacity = 0) { reset(capacity); }
+
+    void reset(int capacity)
+    {
+        m_data.clear();
+        m_data.resize(capacity > 0 ? capacity : 1);
+        m_head = 0;
+        m_count = 0;
+    }
+
+    void push(const T &value)
+    {
+        m_data[m_head] = value;
+        m_head = (m_head + 1) % m_data.size();
+        if (m_count < m_data.size()) {
+            m_count++;
+        }
+    }
+
+    void clear() { m_head = 0; m_count = 0; }
+
+    int size() const { return m_count; }
+    int capacity() const { return m_data.size(); }
+    bool isEmpty() const { return m_count == 0; }
+
+    const T &at(int i) const
+    {
+        int start = (m_head - m_count + m_data.size()) % m_data.size();
+        return m_data[(start + i) % m_data.size()];
+    }
+    const T &last() const { return at(m_count - 1); }
+
+private:
+    QVector<T> m_data;
+    int m_head = 0;   // 下一个写入位置
+    int m_count = 0;
+};
+
+#endif // RINGBUFFER_H
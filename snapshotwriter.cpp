@@ -0,0 +1,122 @@
+#include "snapshotwriter.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+
+SnapshotWriter::SnapshotWriter(QObject *parent)
+    : QObject{parent}
+{
+    m_worker = new QObject;
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread.setObjectName("SnapshotWriter");
+    m_thread.start(QThread::LowPriority);
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    m_thread.quit();
+    m_thread.wait();
+    for (Job &job : m_jobs) {
+        delete job.file;
+    }
+}
+
+int SnapshotWriter::open(const QString &path)
+{
+    int job = m_nextJob++;
+    QMetaObject::invokeMethod(m_worker, [=](){ doOpen(job, path); }, Qt::QueuedConnection);
+    return job;
+}
+
+void SnapshotWriter::write(int job, const QByteArray &chunk)
+{
+    QMetaObject::invokeMethod(m_worker, [=](){ doWrite(job, chunk); }, Qt::QueuedConnection);
+}
+
+void SnapshotWriter::finish(int job, const QSize &imageSize, int previewMaxSide)
+{
+    QMetaObject::invokeMethod(m_worker, [=](){ doFinish(job, imageSize, previewMaxSide); }, Qt::QueuedConnection);
+}
+
+void SnapshotWriter::abort(int job)
+{
+    QMetaObject::invokeMethod(m_worker, [=](){ doAbort(job); }, Qt::QueuedConnection);
+}
+
+int SnapshotWriter::requestPreview(const QString &path, int maxSide)
+{
+    int job = m_nextJob++;
+    QMetaObject::invokeMethod(m_worker, [=](){ doPreview(job, path, maxSide); }, Qt::QueuedConnection);
+    return job;
+}
+
+// ==========================================
+// 以下在写线程执行
+// ==========================================
+void SnapshotWriter::doOpen(int job, const QString &path)
+{
+    Job &j = m_jobs[job];
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    j.file = new QFile(path);
+    if (!j.file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        j.error = j.file->errorString();
+    }
+}
+
+void SnapshotWriter::doWrite(int job, const QByteArray &chunk)
+{
+    auto it = m_jobs.find(job);
+    if (it == m_jobs.end() || !it->error.isEmpty()) {
+        return;
+    }
+    if (it->file->write(chunk) != chunk.size()) {
+        it->error = it->file->errorString();
+        return;
+    }
+    it->bytes += chunk.size();
+}
+
+void SnapshotWriter::doFinish(int job, const QSize &imageSize, int previewMaxSide)
+{
+    Job j = m_jobs.take(job);
+    if (!j.file) {
+        return;
+    }
+    QString path = j.file->fileName();
+    j.file->close();
+    delete j.file;
+
+    bool ok = j.error.isEmpty() && j.bytes > 0;
+    if (!ok) {
+        QFile::remove(path);
+    }
+    emit finished(job, path, imageSize, j.bytes, ok, j.error);
+
+    if (ok && previewMaxSide > 0) {
+        doPreview(job, path, previewMaxSide);
+    }
+}
+
+void SnapshotWriter::doAbort(int job)
+{
+    Job j = m_jobs.take(job);
+    if (!j.file) {
+        return;
+    }
+    QString path = j.file->fileName();
+    j.file->close();
+    delete j.file;
+    QFile::remove(path);
+}
+
+void SnapshotWriter::doPreview(int job, const QString &path, int maxSide)
+{
+    // 按目标尺寸缩放解码 (JPEG 走 DCT 域缩放)，避免解出整张大图
+    QImageReader reader(path, "JPEG");
+    QSize size = reader.size();
+    if (size.isValid() && maxSide > 0 && qMax(size.width(), size.height()) > maxSide) {
+        reader.setScaledSize(size.scaled(maxSide, maxSide, Qt::KeepAspectRatio));
+    }
+    emit previewReady(job, reader.read());
+}
@@ -0,0 +1,56 @@
+#ifndef SNAPSHOTWRITER_H
+#define SNAPSHOTWRITER_H
+
+#include <QObject>
+#include <QThread>
+#include <QHash>
+#include <QFile>
+#include <QImage>
+#include <QSize>
+#include <atomic>
+
+/**
+ * @brief 抓拍文件异步写入器
+ * 网络回调里收到的数据块原样投递到写线程落盘，GUI 线程不做文件 IO 也不解码。
+ * 需要预览时才在写线程里按缩放尺寸解码一张小图。
+ * 所有公有函数线程安全 (内部转为排队调用)。
+ */
+class SnapshotWriter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SnapshotWriter(QObject *parent = nullptr);
+    ~SnapshotWriter();
+
+    int open(const QString &path);                        // 返回作业号
+    void write(int job, const QByteArray &chunk);
+    void finish(int job, const QSize &imageSize, int previewMaxSide = 0);
+    void abort(int job);
+
+    // 对已落盘的抓拍按需生成预览 (异步，结果经 previewReady 返回)，返回作业号
+    int requestPreview(const QString &path, int maxSide);
+
+signals:
+    void finished(int job, const QString &path, const QSize &imageSize, qint64 bytes, bool ok, const QString &error);
+    void previewReady(int job, const QImage &preview);
+
+private:
+    struct Job {
+        QFile *file = nullptr;
+        qint64 bytes = 0;
+        QString error;
+    };
+
+    QThread m_thread;
+    QObject *m_worker;              // 驻留写线程的上下文对象
+    std::atomic<int> m_nextJob{1};
+    QHash<int, Job> m_jobs;         // 仅在写线程访问
+
+    void doOpen(int job, const QString &path);
+    void doWrite(int job, const QByteArray &chunk);
+    void doFinish(int job, const QSize &imageSize, int previewMaxSide);
+    void doAbort(int job);
+    void doPreview(int job, const QString &path, int maxSide);
+};
+
+#endif // SNAPSHOTWRITER_H
@@ -0,0 +1,65 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <QVector>
+#include <atomic>
+
+/**
+ * @brief 单生产者单消费者无锁队列
+ * 容量向上取整为 2 的幂，存储在构造时一次性分配；满了 push 返回 false，由调用方决定丢弃或重试。
+ * 只允许一个线程 push、一个线程 pop，size() 任意线程可读 (近似值)。
+ */
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(int capacity)
+    {
+        int size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_data.resize(size);
+        m_slots = m_data.data();
+        m_mask = quint32(size - 1);
+    }
+
+    bool push(const T &value)
+    {
+        quint32 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+            return false;
+        }
+        m_slots[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T *out)
+    {
+        quint32 head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        T &slot = m_slots[head & m_mask];
+        *out = slot;
+        slot = T();     // 释放隐式共享的数据
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    int size() const
+    {
+        return int(m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire));
+    }
+    int capacity() const { return int(m_mask) + 1; }
+
+private:
+    QVector<T> m_data;
+    T *m_slots = nullptr;   // 两个线程都只通过它访问元素，不触发 QVector 的共享检查
+    quint32 m_mask = 0;
+    alignas(64) std::atomic<quint32> m_head{0};    // 消费者写
+    alignas(64) std::atomic<quint32> m_tail{0};    // 生产者写
+};
+
+#endif // SPSCQUEUE_H
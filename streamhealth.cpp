@@ -0,0 +1,106 @@
+#include "streamhealth.h"
+#include <QCoreApplication>
+#include <QSettings>
+
+StreamHealthTracker::StreamHealthTracker(QObject *parent)
+    : QObject{parent}
+{
+    QString configPath = QCoreApplication::applicationDirPath() + "/config.ini";
+    QSettings settings(configPath, QSettings::IniFormat);
+    m_blackMean           = settings.value("StreamHealth/BlackMean", 20).toDouble();
+    m_blackStddev         = settings.value("StreamHealth/BlackStddev", 8).toDouble();
+    m_overexposedFraction = settings.value("StreamHealth/OverexposedFraction", 0.5).toDouble();
+    m_frozenDiff          = settings.value("StreamHealth/FrozenDiff", 0.3).toDouble();
+    m_blurSharpness       = settings.value("StreamHealth/BlurSharpness", 15).toDouble();
+    m_enterMs             = settings.value("StreamHealth/EnterMs", 2000).toInt();
+    m_exitMs              = settings.value("StreamHealth/ExitMs", 1000).toInt();
+    m_noSignalMs          = settings.value("StreamHealth/NoSignalMs", 3000).toInt();
+
+    // 断流时不会再有指标进来，由看门狗判定“无信号”
+    m_watchdog = new QTimer(this);
+    m_watchdog->setInterval(1000);
+    connect(m_watchdog, &QTimer::timeout, this, [=](){
+        for (auto it = m_cameras.begin(); it != m_cameras.end(); ++it) {
+            if (it->lastFrame.isValid() && it->lastFrame.elapsed() > m_noSignalMs && it->state != NoSignal) {
+                it->state = NoSignal;
+                it->candidate = NoSignal;
+                emit healthStateChanged(it.key(), NoSignal);
+            }
+        }
+    });
+    m_watchdog->start();
+}
+
+QString StreamHealthTracker::stateText(State state)
+{
+    switch (state) {
+    case Ok:          return "正常";
+    case Black:       return "黑屏";
+    case Overexposed: return "过曝";
+    case Frozen:      return "冻结";
+    case Blurred:     return "模糊";
+    case NoSignal:    return "无信号";
+    }
+    return QString();
+}
+
+void StreamHealthTracker::setTracked(int camId, bool tracked)
+{
+    if (!tracked) {
+        if (m_cameras.contains(camId) && m_cameras.value(camId).state != Ok) {
+            emit healthStateChanged(camId, Ok);
+        }
+        m_cameras.remove(camId);
+        return;
+    }
+    if (!m_cameras.contains(camId)) {
+        CameraState &cam = m_cameras[camId];
+        cam.lastFrame.start();
+        cam.candidateSince.start();
+    }
+}
+
+StreamHealthTracker::State StreamHealthTracker::classify(const StreamHealthMetrics &m) const
+{
+    if (m.mean < m_blackMean && m.stddev < m_blackStddev) {
+        return Black;
+    }
+    if (m.brightFraction > m_overexposedFraction) {
+        return Overexposed;
+    }
+    if (m.diffEnergy >= 0 && m.diffEnergy < m_frozenDiff) {
+        return Frozen;
+    }
+    // 低对比度的纯水体画面本身就没有边缘，不据此判断失焦
+    if (m.stddev > m_blackStddev * 2 && m.sharpness < m_blurSharpness) {
+        return Blurred;
+    }
+    return Ok;
+}
+
+void StreamHealthTracker::onMetrics(int camId, const StreamHealthMetrics &metrics)
+{
+    auto it = m_cameras.find(camId);
+    if (it == m_cameras.end()) {
+        return;
+    }
+    it->last = metrics;
+    it->lastFrame.restart();
+    update(camId, *it, classify(metrics));
+}
+
+void StreamHealthTracker::update(int camId, CameraState &cam, State candidate)
+{
+    if (candidate != cam.candidate) {
+        cam.candidate = candidate;
+        cam.candidateSince.restart();
+    }
+    if (candidate == cam.state) {
+        return;
+    }
+    int holdMs = (candidate == Ok) ? m_exitMs : m_enterMs;
+    if (cam.candidateSince.elapsed() >= holdMs) {
+        cam.state = candidate;
+        emit healthStateChanged(camId, candidate);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef STREAMHEALTH_H
+#define STREAMHEALTH_H
+
+#include <QObject>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "frameanalysis.h"
+
+/**
+ * @brief 每路相机的画面健康状态判定
+ * 输入分析线程给出的逐帧指标，按阈值得到候选状态，再做去抖：
+ * 异常需持续 EnterMs 才上报，恢复需持续 ExitMs 才解除，避免单帧抖动误报。
+ */
+class StreamHealthTracker : public QObject
+{
+    Q_OBJECT
+public:
+    // 多个条件同时满足时按此顺序取优先级最高的一个
+    enum State {
+        Ok,
+        Black,          // 黑屏 (亮度低且无对比度)
+        Overexposed,    // 大面积过曝
+        Frozen,         // 画面冻结 (帧差接近 0)
+        Blurred,        // 失焦/起雾 (拉普拉斯方差过低)
+        NoSignal        // 长时间没有收到帧
+    };
+    Q_ENUM(State)
+
+    explicit StreamHealthTracker(QObject *parent = nullptr);
+
+    State state(int camId) const { return m_cameras.value(camId).state; }
+    StreamHealthMetrics lastMetrics(int camId) const { return m_cameras.value(camId).last; }
+    static QString stateText(State state);
+
+    // 开始/停止跟踪某路相机
+    void setTracked(int camId, bool tracked);
+
+public slots:
+    void onMetrics(int camId, const StreamHealthMetrics &metrics);
+
+signals:
+    void healthStateChanged(int camId, StreamHealthTracker::State state);
+
+private:
+    struct CameraState {
+        State state = Ok;           // 已上报状态
+        State candidate = Ok;       // 当前帧判定结果
+        QElapsedTimer candidateSince;
+        QElapsedTimer lastFrame;
+        StreamHealthMetrics last;
+    };
+
+    QHash<int, CameraState> m_cameras;
+    QTimer *m_watchdog;
+
+    // --- 阈值 (config.ini [StreamHealth]) ---
+    double m_blackMean = 20;
+    double m_blackStddev = 8;
+    double m_overexposedFraction = 0.5;
+    double m_frozenDiff = 0.3;
+    double m_blurSharpness = 15;
+    int m_enterMs = 2000;
+    int m_exitMs = 1000;
+    int m_noSignalMs = 3000;
+
+    State classify(const StreamHealthMetrics &m) const;
+    void update(int camId, CameraState &cam, State candidate);
+};
+
+#endif // STREAMHEALTH_H
@@ -0,0 +1,322 @@
+#include "tsdbbench.h"
+#include "Database/dbmanager.h"
+#include "Database/tsdbstore.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+
+namespace TsdbBench {
+
+namespace {
+
+const int BATCH_ROWS = 256;     // 与 TelemetryWriter 默认批大小一致
+const int PAGE_ROWS = 100;      // 与历史页每次取的行数同量级
+
+struct QueryKind {
+    QString name;
+    qint64 spanMs;              // 0 表示按 id 翻页
+    QVector<qint64> starts;     // 时间范围起点或翻页锚点
+};
+
+struct Latency {
+    QVector<qint64> us;
+    qint64 rows = 0;
+
+    qint64 percentile(double p) const
+    {
+        if (us.isEmpty()) return 0;
+        return us[qMin(us.size() - 1, int(p * us.size()))];
+    }
+    double mean() const
+    {
+        if (us.isEmpty()) return 0;
+        qint64 sum = 0;
+        for (qint64 v : us) sum += v;
+        return double(sum) / us.size();
+    }
+};
+
+struct Result {
+    QString backend;
+    qint64 ingestUs = 0;
+    qint64 bytes = -1;
+    QVector<Latency> queries;   // 与 QueryKind 一一对应
+};
+
+QString option(const QStringList &args, const QString &name, const QString &defaultValue = QString())
+{
+    int i = args.indexOf(name);
+    return (i >= 0 && i + 1 < args.size()) ? args[i + 1] : defaultValue;
+}
+
+QVector<TelemetrySample> generate(int rows, qint64 intervalMs)
+{
+    SampleGenerator generator(intervalMs);
+    QVector<TelemetrySample> samples;
+    samples.reserve(rows);
+    for (int i = 0; i < rows; i++) {
+        samples.append(generator.next());
+    }
+    return samples;
+}
+
+QVector<QueryKind> planQueries(const QVector<TelemetrySample> &samples, int count)
+{
+    QRandomGenerator rng(7);
+    const qint64 firstMs = samples.first().timeMs;
+    const qint64 dataSpan = samples.last().timeMs - firstMs;
+    QVector<QueryKind> kinds;
+    const QPair<QString, qint64> spans[] = {
+        qMakePair(QString("range 1 min"), 60000ll),
+        qMakePair(QString("range 1 h"), 3600000ll),
+        qMakePair(QString("range 1 day"), 86400000ll),
+    };
+    for (const auto &span : spans) {
+        if (span.second > dataSpan) {
+            continue;
+        }
+        QueryKind kind;
+        kind.name = span.first;
+        kind.spanMs = span.second;
+        for (int i = 0; i < count; i++) {
+            kind.starts.append(firstMs + qint64(rng.bounded(double(dataSpan - span.second))));
+        }
+        kinds.append(kind);
+    }
+    QueryKind page;
+    page.name = QString("page %1 rows").arg(PAGE_ROWS);
+    for (int i = 0; i < count; i++) {
+        page.starts.append(qint64(rng.bounded(samples.size())) + 2);   // beforeId，至少取到 1 条
+    }
+    kinds.append(page);
+    return kinds;
+}
+
+Result runEmbedded(const QVector<TelemetrySample> &samples, const QVector<QueryKind> &kinds, const QString &dir)
+{
+    Result result;
+    result.backend = "embedded";
+    TsdbStore store(dir);
+    QString error;
+    if (!store.open(&error)) {
+        QTextStream(stdout) << "embedded: " << error << Qt::endl;
+        return result;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int done = 0; done < samples.size(); done += BATCH_ROWS) {
+        store.append(samples.mid(done, BATCH_ROWS));
+    }
+    store.close();
+    result.ingestUs = timer.nsecsElapsed() / 1000;
+    // 重新打开：查询走 mmap 的已封存块，同时验证索引重建
+    store.open(&error);
+    result.bytes = store.stats().fileBytes;
+
+    for (const QueryKind &kind : kinds) {
+        Latency latency;
+        for (qint64 start : kind.starts) {
+            timer.start();
+            const int rows = kind.spanMs > 0 ? store.range(start, start + kind.spanMs).size()
+                                             : store.logsBefore(start, PAGE_ROWS).size();
+            latency.us.append(timer.nsecsElapsed() / 1000);
+            latency.rows += rows;
+        }
+        result.queries.append(latency);
+    }
+    return result;
+}
+
+Result runMysql(const QVector<TelemetrySample> &samples, const QVector<QueryKind> &kinds)
+{
+    Result result;
+    result.backend = "mysql";
+    QTextStream out(stdout);
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QMYSQL", "tsdb_bench");
+        DBManager::configureConnection(db);
+        if (!db.open()) {
+            out << "mysql: " << db.lastError().text() << Qt::endl;
+        } else {
+            // 与 ship_logs 相同的结构和索引
+            QSqlQuery query(db);
+            query.exec("DROP TABLE IF EXISTS bench_ship_logs");
+            if (!query.exec("CREATE TABLE bench_ship_logs("
+                            "id INT AUTO_INCREMENT PRIMARY KEY,"
+                            "log_time DATETIME,"
+                            "log_time_ms BIGINT,"
+                            "speed DOUBLE,"
+                            "accel DOUBLE,"
+                            "dist DOUBLE,"
+                            "INDEX idx_bench_time_ms (log_time_ms))")) {
+                out << "mysql: " << query.lastError().text() << Qt::endl;
+            } else {
+                QElapsedTimer timer;
+                timer.start();
+                QSqlQuery insert(db);
+                int preparedRows = 0;
+                for (int done = 0; done < samples.size(); done += BATCH_ROWS) {
+                    const int rows = qMin(BATCH_ROWS, samples.size() - done);
+                    if (rows != preparedRows) {
+                        QStringList tuples;
+                        for (int i = 0; i < rows; i++) {
+                            tuples << "(?, ?, ?, ?, ?)";
+                        }
+                        insert.prepare("INSERT INTO bench_ship_logs (log_time, log_time_ms, speed, accel, dist) VALUES "
+                                       + tuples.join(","));
+                        preparedRows = rows;
+                    }
+                    for (int i = 0; i < rows; i++) {
+                        const TelemetrySample &sample = samples[done + i];
+                        insert.bindValue(i * 5, QDateTime::fromMSecsSinceEpoch(sample.timeMs).toString("yyyy-MM-dd HH:mm:ss"));
+                        insert.bindValue(i * 5 + 1, sample.timeMs);
+                        insert.bindValue(i * 5 + 2, sample.speed);
+                        insert.bindValue(i * 5 + 3, sample.accel);
+                        insert.bindValue(i * 5 + 4, sample.dist);
+                    }
+                    db.transaction();
+                    if (!insert.exec()) {
+                        out << "mysql: " << insert.lastError().text() << Qt::endl;
+                        db.rollback();
+                        break;
+                    }
+                    db.commit();
+                }
+                result.ingestUs = timer.nsecsElapsed() / 1000;
+
+                if (query.exec("ANALYZE TABLE bench_ship_logs") && query.exec(
+                        "SELECT DATA_LENGTH + INDEX_LENGTH FROM information_schema.TABLES "
+                        "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = 'bench_ship_logs'") && query.next()) {
+                    result.bytes = query.value(0).toLongLong();
+                }
+
+                QSqlQuery rangeQuery(db);
+                rangeQuery.setForwardOnly(true);
+                rangeQuery.prepare("SELECT log_time_ms, speed, accel, dist FROM bench_ship_logs "
+                                   "WHERE log_time_ms BETWEEN ? AND ? ORDER BY log_time_ms");
+                QSqlQuery pageQuery(db);
+                pageQuery.setForwardOnly(true);
+                pageQuery.prepare("SELECT id, log_time_ms, speed, accel, dist FROM bench_ship_logs "
+                                  "WHERE id < ? ORDER BY id DESC LIMIT ?");
+                for (const QueryKind &kind : kinds) {
+                    Latency latency;
+                    for (qint64 start : kind.starts) {
+                        timer.start();
+                        QSqlQuery &q = kind.spanMs > 0 ? rangeQuery : pageQuery;
+                        q.bindValue(0, start);
+                        q.bindValue(1, kind.spanMs > 0 ? start + kind.spanMs : PAGE_ROWS);
+                        q.exec();
+                        // 与 DBManager 一样把结果全部读出
+                        int rows = 0;
+                        while (q.next()) {
+                            TelemetrySample sample;
+                            sample.timeMs = q.value(kind.spanMs > 0 ? 0 : 1).toLongLong();
+                            sample.speed = q.value(kind.spanMs > 0 ? 1 : 2).toDouble();
+                            rows++;
+                        }
+                        latency.us.append(timer.nsecsElapsed() / 1000);
+                        latency.rows += rows;
+                    }
+                    result.queries.append(latency);
+                }
+                query.exec("DROP TABLE bench_ship_logs");
+            }
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase("tsdb_bench");
+    return result;
+}
+
+} // namespace
+
+SampleGenerator::SampleGenerator(qint64 intervalMs)
+    : m_rng(20240601)
+    , m_intervalMs(intervalMs)
+{
+}
+
+// 航速缓慢起伏、加速度随之变化、位移累加；数值按传感器分辨率保留两位小数
+TelemetrySample SampleGenerator::next()
+{
+    m_timeMs += m_intervalMs + qint64(m_rng.bounded(7)) - 3;
+    const double phase = m_index++ * m_intervalMs / 600000.0;
+    const double speed = std::round((4.0 + 2.0 * std::sin(phase) + m_rng.bounded(0.2)) * 100.0) / 100.0;
+    m_dist += speed * m_intervalMs / 1000.0;
+    TelemetrySample sample;
+    sample.timeMs = m_timeMs;
+    sample.speed = speed;
+    sample.accel = std::round((speed - m_prevSpeed) * 1000.0 / m_intervalMs * 100.0) / 100.0;
+    sample.dist = std::round(m_dist * 100.0) / 100.0;
+    m_prevSpeed = speed;
+    return sample;
+}
+
+bool isRequested(const QStringList &args)
+{
+    return args.contains("--bench-tsdb");
+}
+
+int run(const QStringList &args)
+{
+    QTextStream out(stdout);
+    const int rows = qMax(1000, option(args, "--rows", "1000000").toInt());
+    const qint64 intervalMs = qMax(10, option(args, "--interval-ms", "1000").toInt());
+    const int queries = qMax(1, option(args, "--queries", "200").toInt());
+
+    QTemporaryDir tempDir;
+    QString dir = option(args, "--dir");
+    if (dir.isEmpty()) {
+        dir = tempDir.path();
+    } else if (QDir(dir).exists("telemetry.tsd")) {
+        out << "bench: " << dir << " already contains a store, use an empty directory" << Qt::endl;
+        return 2;
+    }
+
+    const QVector<TelemetrySample> samples = generate(rows, intervalMs);
+    const QVector<QueryKind> kinds = planQueries(samples, queries);
+    out << QString("rows %1  interval %2 ms  span %3 h  raw %4 MB")
+               .arg(rows).arg(intervalMs)
+               .arg((samples.last().timeMs - samples.first().timeMs) / 3600000.0, 0, 'f', 1)
+               .arg(rows * double(sizeof(TelemetrySample)) / 1048576.0, 0, 'f', 1) << Qt::endl;
+
+    QVector<Result> results;
+    results.append(runEmbedded(samples, kinds, dir));
+    if (args.contains("--mysql")) {
+        results.append(runMysql(samples, kinds));
+    }
+
+    // --- 报告 ---
+    out << QString("%1 %2 %3 %4").arg("backend", -10).arg("rows/s", 12).arg("MB", 10).arg("bytes/row", 10) << Qt::endl;
+    for (const Result &r : results) {
+        out << QString("%1 %2 %3 %4").arg(r.backend, -10)
+                   .arg(r.ingestUs > 0 ? rows * 1e6 / r.ingestUs : 0.0, 12, 'f', 0)
+                   .arg(r.bytes >= 0 ? r.bytes / 1048576.0 : -1.0, 10, 'f', 1)
+                   .arg(r.bytes >= 0 ? double(r.bytes) / rows : -1.0, 10, 'f', 2) << Qt::endl;
+    }
+    out << QString("%1 %2 %3 %4 %5 %6 %7").arg("query", -14).arg("backend", -10).arg("mean us", 10)
+               .arg("p50 us", 10).arg("p95 us", 10).arg("p99 us", 10).arg("rows/q", 10) << Qt::endl;
+    for (int k = 0; k < kinds.size(); k++) {
+        for (Result &r : results) {
+            if (k >= r.queries.size()) {
+                continue;
+            }
+            Latency &l = r.queries[k];
+            std::sort(l.us.begin(), l.us.end());
+            out << QString("%1 %2 %3 %4 %5 %6 %7").arg(kinds[k].name, -14).arg(r.backend, -10)
+                       .arg(l.mean(), 10, 'f', 1).arg(l.percentile(0.50), 10).arg(l.percentile(0.95), 10)
+                       .arg(l.percentile(0.99), 10).arg(double(l.rows) / qMax(1, l.us.size()), 10, 'f', 1)
+                       << Qt::endl;
+        }
+    }
+    return results.first().ingestUs > 0 ? 0 : 1;
+}
+
+} // namespace TsdbBench
@@ -0,0 +1,44 @@
+#ifndef TSDBBENCH_H
+#define TSDBBENCH_H
+
+#include <QStringList>
+#include <QRandomGenerator>
+#include "Database/dbmanager.h"
+
+/**
+ * @brief 遥测存储基准测试 (命令行，不启动主界面)
+ * 生成一段合成遥测 (按 1 秒上下抖动的时间戳，数值保留两位小数，与传感器分辨率一致)，
+ * 分别写入嵌入式存储 (TsdbStore) 和 MySQL 临时表，再用相同的随机时间范围与按 id 翻页查询，
+ * 对比写入速率、每条占用空间和查询耗时分位数。
+ *
+ *   --bench-tsdb          启用
+ *   --rows <n>            记录条数 (默认 1000000)
+ *   --interval-ms <n>     记录间隔 (默认 1000)
+ *   --queries <n>         每种查询的次数 (默认 200)
+ *   --dir <path>          嵌入式存储目录 (默认临时目录，结束后删除)
+ *   --mysql               同时测试 MySQL (按 config.ini 连接，用临时表 bench_ship_logs，结束后删除)
+ */
+namespace TsdbBench {
+
+// 合成遥测 (固定随机种子，每次相同)；逐条生成，可以边生成边分批写入
+class SampleGenerator
+{
+public:
+    explicit SampleGenerator(qint64 intervalMs);
+    TelemetrySample next();
+
+private:
+    QRandomGenerator m_rng;
+    qint64 m_intervalMs;
+    qint64 m_timeMs = 1700000000000ll;
+    qint64 m_index = 0;
+    double m_dist = 0;
+    double m_prevSpeed = 0;
+};
+
+bool isRequested(const QStringList &args);
+int run(const QStringList &args);
+
+} // namespace TsdbBench
+
+#endif // TSDBBENCH_H
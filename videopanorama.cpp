@@ -12,6 +12,9 @@
 #include <QDebug>
 #include <QSettings>
 #include "streamvideowidget.h"
+#include <QMenu>
+#include <QMessageBox>
+#include <QDateTime>
 
 VideoPanorama::VideoPanorama(QWidget *parent)
     : QWidget(parent)
@@ -81,8 +84,45 @@ VideoPanorama::VideoPanorama(QWidget *parent)
         ui->pageMultiCam->layout()->addWidget(container);
     }
     
+    // 即时回看：所有旁路帧都进入回看缓冲 (只存压缩数据)
+    m_replay = new ReplayBuffer(this);
+    connect(this, &VideoPanorama::frameArrived, m_replay, &ReplayBuffer::push);
+    connect(m_replay, &ReplayBuffer::clipSaved, this,
+            [=](int camId, const QString &segPath, int frames, bool ok, const QString &error){
+        if (ok) {
+            QMessageBox::information(this, "保存片段", QString("相机 %1 片段已保存 (%2 帧)\n%3")
+                                     .arg(camId).arg(frames).arg(QDir::toNativeSeparators(segPath)));
+        } else {
+            QMessageBox::warning(this, "保存片段", QString("相机 %1 片段保存失败: %2").arg(camId).arg(error));
+        }
+    });
+    for (int i = 0; i < 3; i++) {
+        initTileReplay(i);
+    }
+
     m_cameraActiveFlags.resize(14);
     m_cameraActiveFlags.fill(false);
+    m_clientConnected.resize(14);
+    m_clientConnected.fill(false);
+
+    // 后台保持全部相机订阅 (画面分析/录像需要)
+    {
+        QString configPath = QCoreApplication::applicationDirPath() + "/config.ini";
+        QSettings settings(configPath, QSettings::IniFormat);
+        setBackgroundStreams(settings.value("Cameras/KeepAllStreams", false).toBool());
+        m_clipDir = settings.value("Recording/RootDir", QCoreApplication::applicationDirPath() + "/recordings")
+                        .toString() + "/clips";
+
+        // 全景流 (配置了 Cameras/Panorama 才连接)，同样经 frameArrived 旁路 (camId 0) 供录像使用
+        QString panoramaUrl = settings.value("Cameras/Panorama").toString();
+        if (!panoramaUrl.isEmpty()) {
+            connect(m_panoramaClient, &WebSocketClient::sendBynariesToPlayer, this, [=](const QByteArray &data){
+                m_videoWidget->receiveFrameData(data);
+                emit frameArrived(0, data);
+            });
+            m_panoramaClient->connectToServer(panoramaUrl);
+        }
+    }
 
     // 默认显示第一页
     ui->stackVideoMode->setCurrentIndex(0);
@@ -115,6 +155,11 @@ QString VideoPanorama::getCamWsUrl(int camId)
 
 void VideoPanorama::switchMode(int pageIndex)
 {
+    // 翻页前结束所有回看 (窗口随后会换新的帧令牌)
+    for (int i = 0; i < 3; i++) {
+        exitReplay(i, false);
+        m_tileCamIds[i] = 0;
+    }
     for (int i = 0; i < 3; i++) {
         if (m_multiVideoWidgets[i]) {
             m_multiVideoWidgets[i]->setAcceptFrames(false);
@@ -156,6 +201,7 @@ void VideoPanorama::switchMode(int pageIndex)
                 m_multiVideoWidgets[i]->parentWidget()->show();
                 m_multiVideoWidgets[i]->show();
                 m_multiLabels[i]->setText(QString("相机 %1").arg(currentCamId));
+                m_tileCamIds[i] = currentCamId;
 
                 m_multiVideoWidgets[i]->setAcceptFrames(true);
                 m_multiVideoWidgets[i]->setFrameToken(++m_frameTokenCounter);
@@ -195,6 +241,7 @@ void VideoPanorama::switchMode(int pageIndex)
             // 优化：如果已经连接且 URL 没变，可以不调 connectToServer
             QString url = getCamWsUrl(camId);
             client->connectToServer(url);
+            m_clientConnected[camId] = true;
 
             // 3. 计算它应该显示在哪个窗口 (0, 1, 2)
             // 算法：(camId - 1) % 3
@@ -213,9 +260,17 @@ void VideoPanorama::switchMode(int pageIndex)
             qDebug() << "相机" << camId << "绑定到窗口" << widgetIndex;
             }
 
+            // 4. 旁路输出，供帧分析使用
+            connect(client, &WebSocketClient::sendBynariesToPlayer, this, [=](const QByteArray &data){
+                emit frameArrived(camId, data);
+            });
+
+        } else if (m_backgroundStreams) {
+            bindBackgroundStream(camId);
         } else {
             client->disconnect();
             client->disconnectFromServer();
+            m_clientConnected[camId] = false;
         }
     }
 
@@ -224,6 +279,39 @@ void VideoPanorama::switchMode(int pageIndex)
     resizeEvent(&event);
 }
 
+void VideoPanorama::setBackgroundStreams(bool enabled)
+{
+    m_backgroundStreams = enabled;
+    for (int camId = 1; camId <= 13; camId++) {
+        if (m_cameraActiveFlags[camId]) {
+            continue;
+        }
+        if (enabled) {
+            bindBackgroundStream(camId);
+        } else if (m_camClients[camId]) {
+            m_camClients[camId]->disconnect();
+            m_camClients[camId]->disconnectFromServer();
+            m_clientConnected[camId] = false;
+        }
+    }
+}
+
+// 未显示的相机：保持连接，只转发到旁路信号
+void VideoPanorama::bindBackgroundStream(int camId)
+{
+    WebSocketClient *client = m_camClients[camId];
+    if (!client) return;
+
+    client->disconnect();
+    if (!m_clientConnected[camId]) {
+        client->connectToServer(getCamWsUrl(camId));
+        m_clientConnected[camId] = true;
+    }
+    connect(client, &WebSocketClient::sendBynariesToPlayer, this, [=](const QByteArray &data){
+        emit frameArrived(camId, data);
+    });
+}
+
 void VideoPanorama::pauseFramesFor(int ms)
 {
     for (int i = 0; i < 3; i++) {
@@ -299,3 +387,166 @@ bool VideoPanorama::isCameraAvailable(int camId)
     // return true;
     return false;
 }
+
+// ==========================================
+// 即时回看
+// ==========================================
+void VideoPanorama::initTileReplay(int tile)
+{
+    TileReplay &r = m_tileReplay[tile];
+    StreamVideoWidget *widget = m_multiVideoWidgets[tile];
+
+    widget->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(widget, &QWidget::customContextMenuRequested, this, [=](const QPoint &pos){
+        showTileContextMenu(tile, pos);
+    });
+
+    // 回看控制条 (拖动条 + 播放/保存/返回直播)，平时隐藏
+    r.bar = new QWidget(widget->parentWidget());
+    QHBoxLayout *hbox = new QHBoxLayout(r.bar);
+    hbox->setContentsMargins(0, 0, 0, 0);
+    r.slider = new QSlider(Qt::Horizontal, r.bar);
+    r.btnPlay = new QPushButton("播放", r.bar);
+    QPushButton *btnSave = new QPushButton("保存", r.bar);
+    QPushButton *btnLive = new QPushButton("直播", r.bar);
+    hbox->addWidget(r.slider, 1);
+    hbox->addWidget(r.btnPlay);
+    hbox->addWidget(btnSave);
+    hbox->addWidget(btnLive);
+    widget->parentWidget()->layout()->addWidget(r.bar);
+    r.bar->hide();
+
+    r.timer = new QTimer(this);
+    r.timer->setSingleShot(true);
+    r.timer->setTimerType(Qt::PreciseTimer);
+    connect(r.timer, &QTimer::timeout, this, [=](){
+        TileReplay &tr = m_tileReplay[tile];
+        if (tr.index + 1 >= tr.frames.size()) {
+            // 回放到缓冲末尾，停在最后一帧
+            tr.btnPlay->setText("播放");
+            return;
+        }
+        showReplayFrame(tile, tr.index + 1);
+        scheduleReplayTick(tile);
+    });
+
+    connect(r.slider, &QSlider::valueChanged, this, [=](int value){
+        if (m_tileReplay[tile].active && value != m_tileReplay[tile].index) {
+            showReplayFrame(tile, value);
+        }
+    });
+    connect(r.btnPlay, &QPushButton::clicked, this, [=](){
+        TileReplay &tr = m_tileReplay[tile];
+        if (tr.timer->isActive()) {
+            tr.timer->stop();
+            tr.btnPlay->setText("播放");
+        } else {
+            if (tr.index + 1 >= tr.frames.size()) {
+                showReplayFrame(tile, 0);
+            }
+            tr.btnPlay->setText("暂停");
+            scheduleReplayTick(tile);
+        }
+    });
+    connect(btnSave, &QPushButton::clicked, this, [=](){
+        saveClip(m_tileReplay[tile].camId, m_tileReplay[tile].frames);
+    });
+    connect(btnLive, &QPushButton::clicked, this, [=](){ exitReplay(tile); });
+}
+
+void VideoPanorama::showTileContextMenu(int tile, const QPoint &pos)
+{
+    int camId = m_tileCamIds[tile];
+    if (camId <= 0) {
+        return;
+    }
+    QMenu menu(this);
+    if (m_tileReplay[tile].active) {
+        menu.addAction("返回直播", this, [=](){ exitReplay(tile); });
+    } else {
+        menu.addAction("即时回看", this, [=](){ enterReplay(tile); });
+    }
+    menu.addAction("保存最近片段", this, [=](){
+        saveClip(camId, m_tileReplay[tile].active ? m_tileReplay[tile].frames : m_replay->frames(camId));
+    });
+    menu.exec(m_multiVideoWidgets[tile]->mapToGlobal(pos));
+}
+
+void VideoPanorama::enterReplay(int tile)
+{
+    TileReplay &r = m_tileReplay[tile];
+    int camId = m_tileCamIds[tile];
+    QVector<ReplayBuffer::Frame> frames = m_replay->frames(camId);
+    if (camId <= 0 || frames.isEmpty()) {
+        return;
+    }
+    StreamVideoWidget *widget = m_multiVideoWidgets[tile];
+    r.active = true;
+    r.camId = camId;
+    r.frames = frames;
+    // 换一个令牌让直播帧失效，回看结束时换回来
+    r.liveToken = widget->frameToken();
+    widget->setFrameToken(++m_frameTokenCounter);
+
+    r.slider->blockSignals(true);
+    r.slider->setRange(0, r.frames.size() - 1);
+    r.slider->blockSignals(false);
+    r.btnPlay->setText("播放");
+    r.bar->show();
+    r.index = -1;
+    showReplayFrame(tile, r.frames.size() - 1);
+}
+
+void VideoPanorama::exitReplay(int tile, bool restoreLive)
+{
+    TileReplay &r = m_tileReplay[tile];
+    if (!r.active) {
+        return;
+    }
+    r.timer->stop();
+    r.active = false;
+    r.frames.clear();
+    r.bar->hide();
+    if (restoreLive) {
+        m_multiVideoWidgets[tile]->setFrameToken(r.liveToken);
+        m_multiLabels[tile]->setText(QString("相机 %1").arg(r.camId));
+    }
+}
+
+// 只有显示到的那一帧才会被解码
+void VideoPanorama::showReplayFrame(int tile, int index)
+{
+    TileReplay &r = m_tileReplay[tile];
+    if (index < 0 || index >= r.frames.size()) {
+        return;
+    }
+    r.index = index;
+    m_multiVideoWidgets[tile]->receiveFrameData(r.frames[index].data);
+    r.slider->blockSignals(true);
+    r.slider->setValue(index);
+    r.slider->blockSignals(false);
+
+    double behindSec = (QDateTime::currentMSecsSinceEpoch() - r.frames[index].timestampMs) / 1000.0;
+    m_multiLabels[tile]->setText(QString("相机 %1  回看 -%2s").arg(r.camId).arg(behindSec, 0, 'f', 1));
+}
+
+// 按原始帧间隔排下一帧 (1 倍速)
+void VideoPanorama::scheduleReplayTick(int tile)
+{
+    TileReplay &r = m_tileReplay[tile];
+    if (r.index + 1 >= r.frames.size()) {
+        r.btnPlay->setText("播放");
+        return;
+    }
+    qint64 gap = r.frames[r.index + 1].timestampMs - r.frames[r.index].timestampMs;
+    r.timer->start(int(qBound<qint64>(0, gap, 1000)));
+}
+
+void VideoPanorama::saveClip(int camId, const QVector<ReplayBuffer::Frame> &frames)
+{
+    if (frames.isEmpty()) {
+        QMessageBox::warning(this, "保存片段", QString("相机 %1 暂无缓存画面").arg(camId));
+        return;
+    }
+    m_replay->saveClip(camId, frames, m_clipDir);
+}
@@ -6,9 +6,13 @@
 #include <QLabel>
 #include <QTemporaryFile>
 #include <QResizeEvent>
+#include <QSlider>
+#include <QPushButton>
+#include <QTimer>
 
 #include "websocketclient.h"
 #include "streamvideowidget.h"
+#include "Record/replaybuffer.h"
 
 namespace Ui {
 class VideoPanorama;
@@ -26,11 +30,18 @@ public:
     void adjustHeightToWidth();
     bool isCameraAvailable(int camId);
     void pauseFramesFor(int ms);
+    // 未显示的相机也保持订阅 (只走 frameArrived 旁路，供分析/录像使用)
+    void setBackgroundStreams(bool enabled);
+    bool backgroundStreams() const { return m_backgroundStreams; }
 
 public slots:
     // 接收模式切换信号 (0=全景, >0=相机组页码)
     void switchMode(int pageIndex);
 
+signals:
+    // 收到一帧压缩数据 (供分析/录像等旁路使用，camId 0 为全景)
+    void frameArrived(int camId, const QByteArray &data);
+
 protected:
     void resizeEvent(QResizeEvent *event) override;
     void showEvent(QShowEvent *event) override;
@@ -62,7 +73,34 @@ private:
     QString getCamWsUrl(int camId);
     //相机标志位
     QVector<bool> m_cameraActiveFlags;
+    QVector<bool> m_clientConnected;   // 各 client 是否已发起连接
+    bool m_backgroundStreams = false;
+    void bindBackgroundStream(int camId);
     quint64 m_frameTokenCounter = 0;
+
+    // --- 即时回看 (分屏窗口右键菜单) ---
+    struct TileReplay {
+        bool active = false;
+        int camId = 0;
+        quint64 liveToken = 0;              // 回看结束后恢复，直播帧重新生效
+        QVector<ReplayBuffer::Frame> frames; // 进入回看时冻结的窗口
+        int index = 0;
+        QWidget *bar = nullptr;
+        QSlider *slider = nullptr;
+        QPushButton *btnPlay = nullptr;
+        QTimer *timer = nullptr;
+    };
+    ReplayBuffer *m_replay;
+    TileReplay m_tileReplay[3];
+    int m_tileCamIds[3] = {0, 0, 0};        // 各分屏窗口当前显示的相机
+    QString m_clipDir;                       // 回看片段保存目录
+    void initTileReplay(int tile);
+    void showTileContextMenu(int tile, const QPoint &pos);
+    void enterReplay(int tile);
+    void exitReplay(int tile, bool restoreLive = true);
+    void showReplayFrame(int tile, int index);
+    void scheduleReplayTick(int tile);
+    void saveClip(int camId, const QVector<ReplayBuffer::Frame> &frames);
 };
 
 #endif // VIDEOPANORAMA_H